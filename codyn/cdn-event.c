@@ -4,7 +4,13 @@
 #include "cdn-phaseable.h"
 #include "cdn-math.h"
 #include "instructions/cdn-instruction-function.h"
+#include "instructions/cdn-instruction-number.h"
+#include "instructions/cdn-instruction-variable.h"
+#include "instructions/cdn-instruction-rand.h"
+#include "instructions/cdn-instruction-custom-function.h"
+#include "instructions/cdn-instruction-custom-operator.h"
 #include "cdn-expression-tree-iter.h"
+#include "cdn-function.h"
 
 #include <math.h>
 
@@ -34,6 +40,12 @@
 
 #define CDN_EVENT_GET_PRIVATE(object)(G_TYPE_INSTANCE_GET_PRIVATE((object), CDN_TYPE_EVENT, CdnEventPrivate))
 
+/* The number of time derivatives of a condition after which it has to
+ * vanish for the horizon to be bounded, and the number of bisections to
+ * solve for the horizon */
+#define HORIZON_MAX_ORDER 4
+#define HORIZON_ITERATIONS 30
+
 typedef CdnEventLogicalNode LogicalNode;
 
 
@@ -58,6 +70,11 @@ struct _CdnEventLogicalNode
 	// Only for terminal nodes
 	CdnExpression *expression;
 
+	// The time derivatives of the expression up to the first one which
+	// vanishes symbolically, used to bound the horizon of the event
+	CdnExpression *derivatives[HORIZON_MAX_ORDER];
+	guint num_derivatives;
+
 	gdouble last_distance;
 	gdouble value;
 };
@@ -75,6 +92,9 @@ struct _CdnEventPrivate
 	gchar *goto_state;
 
 	guint terminal : 1;
+
+	guint horizon_derived : 1;
+	guint has_horizon : 1;
 };
 
 /**
@@ -159,6 +179,19 @@ logical_node_copy_shallow (LogicalNode *node)
 	return logical_node_copy (node, FALSE);
 }
 
+static void
+logical_node_clear_derivatives (LogicalNode *node)
+{
+	guint i;
+
+	for (i = 0; i < node->num_derivatives; ++i)
+	{
+		g_object_unref (node->derivatives[i]);
+	}
+
+	node->num_derivatives = 0;
+}
+
 static void
 logical_node_free (LogicalNode *node)
 {
@@ -175,6 +208,8 @@ logical_node_free (LogicalNode *node)
 		g_object_unref (node->expression);
 	}
 
+	logical_node_clear_derivatives (node);
+
 	g_slice_free (LogicalNode, node);
 }
 
@@ -720,6 +755,9 @@ extract_condition_parts (CdnEvent        *event,
 		event->priv->condition_node = NULL;
 	}
 
+	event->priv->horizon_derived = FALSE;
+	event->priv->has_horizon = FALSE;
+
 	iter = cdn_expression_tree_iter_new (event->priv->condition);
 	node = logical_node_new (event, iter, error);
 
@@ -860,6 +898,9 @@ do_copy (CdnEvent *e,
 	e->priv->condition_node = logical_node_copy (se->priv->condition_node,
 	                                             TRUE);
 
+	e->priv->horizon_derived = FALSE;
+	e->priv->has_horizon = FALSE;
+
 	/* Copy set variables. */
 	for (item = se->priv->set_variables; item; item = g_slist_next (item))
 	{
@@ -1162,6 +1203,57 @@ cdn_event_happened (CdnEvent *event,
 	return ret;
 }
 
+static gdouble
+logical_node_crossing (LogicalNode *node,
+                       gboolean     initial)
+{
+	gdouble val;
+
+	if (node->type == CDN_MATH_FUNCTION_TYPE_AND)
+	{
+		return MIN (logical_node_crossing (node->left, initial),
+		            logical_node_crossing (node->right, initial));
+	}
+	else if (node->type == CDN_MATH_FUNCTION_TYPE_OR)
+	{
+		return MAX (logical_node_crossing (node->left, initial),
+		            logical_node_crossing (node->right, initial));
+	}
+
+	val = initial ? node->value : cdn_expression_evaluate (node->expression);
+
+	if (node->type == CDN_MATH_FUNCTION_TYPE_EQUAL && node->value > 0)
+	{
+		// Equality is reached by crossing zero from either side
+		return -val;
+	}
+
+	return val;
+}
+
+/**
+ * cdn_event_crossing:
+ * @event: the #CdnEvent.
+ * @initial: whether to use the condition value at the start of the step.
+ *
+ * Get a continuous measure of the event condition which is negative when
+ * the condition does not hold and crosses zero where the condition starts
+ * to hold. This is used by the integrator to locate the time at which an
+ * event happened within a step. If @initial is %TRUE, the value at the
+ * start of the step (as stored by #cdn_event_update) is used, otherwise the
+ * condition is evaluated.
+ *
+ * Returns: the crossing value of the condition.
+ *
+ **/
+gdouble
+cdn_event_crossing (CdnEvent *event,
+                    gboolean  initial)
+{
+	/* Omit check for speed up */
+	return logical_node_crossing (event->priv->condition_node, initial);
+}
+
 /**
  * cdn_event_add_set_variable:
  * @event: the #CdnEvent.
@@ -1300,6 +1392,341 @@ cdn_event_get_terminal (CdnEvent *event)
 	return event->priv->terminal;
 }
 
+/* Whether the condition only changes smoothly during integration, i.e. it
+ * does not depend on inputs, discrete variables, random numbers or
+ * operators whose values can jump from one step to the next */
+static gboolean
+expression_is_smooth (CdnExpression *expression,
+                      CdnVariable   *t,
+                      GHashTable    *visited)
+{
+	GSList const *item;
+
+	if (!expression || g_hash_table_lookup (visited, expression))
+	{
+		return TRUE;
+	}
+
+	g_hash_table_insert (visited, expression, expression);
+
+	for (item = cdn_expression_get_instructions (expression); item; item = g_slist_next (item))
+	{
+		CdnInstruction *instr = item->data;
+
+		if (CDN_IS_INSTRUCTION_RAND (instr) ||
+		    CDN_IS_INSTRUCTION_CUSTOM_OPERATOR (instr))
+		{
+			return FALSE;
+		}
+		else if (CDN_IS_INSTRUCTION_CUSTOM_FUNCTION (instr))
+		{
+			CdnFunction *f;
+
+			f = cdn_instruction_custom_function_get_function (CDN_INSTRUCTION_CUSTOM_FUNCTION (instr));
+
+			if (!expression_is_smooth (cdn_function_get_expression (f), t, visited))
+			{
+				return FALSE;
+			}
+		}
+		else if (CDN_IS_INSTRUCTION_VARIABLE (instr))
+		{
+			CdnVariable *v;
+
+			v = cdn_instruction_variable_get_variable (CDN_INSTRUCTION_VARIABLE (instr));
+
+			if (v == t || cdn_variable_has_flag (v, CDN_VARIABLE_FLAG_INTEGRATED))
+			{
+				continue;
+			}
+
+			if (cdn_variable_has_flag (v, CDN_VARIABLE_FLAG_IN |
+			                              CDN_VARIABLE_FLAG_DISCRETE))
+			{
+				return FALSE;
+			}
+
+			if (!expression_is_smooth (cdn_variable_get_expression (v), t, visited))
+			{
+				return FALSE;
+			}
+		}
+	}
+
+	return TRUE;
+}
+
+static CdnExpressionTreeIter *
+derive_time (CdnExpressionTreeIter *iter,
+             CdnVariable           *t)
+{
+	CdnExpressionTreeIter *ret;
+	GHashTable *towards;
+
+	towards = g_hash_table_new_full (g_direct_hash,
+	                                 g_direct_equal,
+	                                 (GDestroyNotify)g_object_unref,
+	                                 (GDestroyNotify)cdn_expression_tree_iter_free);
+
+	if (t)
+	{
+		CdnInstruction *instr;
+
+		instr = cdn_instruction_number_new_from_string ("1");
+
+		g_hash_table_insert (towards,
+		                     g_object_ref (t),
+		                     cdn_expression_tree_iter_new_from_instruction_take (instr));
+	}
+
+	ret = cdn_expression_tree_iter_derive (iter,
+	                                       NULL,
+	                                       towards,
+	                                       1,
+	                                       CDN_EXPRESSION_TREE_ITER_DERIVE_TIME |
+	                                       CDN_EXPRESSION_TREE_ITER_DERIVE_SIMPLIFY,
+	                                       NULL);
+
+	g_hash_table_unref (towards);
+	return ret;
+}
+
+static CdnExpression *
+derived_expression (CdnExpressionTreeIter *iter)
+{
+	CdnExpression *ret;
+
+	if (g_strcmp0 (cdn_expression_tree_iter_to_string (iter), "0") == 0)
+	{
+		return NULL;
+	}
+
+	ret = cdn_expression_tree_iter_to_expression (iter);
+
+	// Not part of the integrator state, so the cache would never be reset
+	cdn_expression_set_has_cache (ret, FALSE);
+
+	return g_object_ref_sink (ret);
+}
+
+/* Derive the condition with respect to time until a derivative vanishes
+ * symbolically. Along the solution the condition is then exactly a
+ * polynomial in time, whose coefficients are the derivatives at the last
+ * update. Returns FALSE if no derivative up to HORIZON_MAX_ORDER vanishes.
+ */
+static gboolean
+logical_node_derive (LogicalNode *node,
+                     CdnVariable *t)
+{
+	CdnExpressionTreeIter *iter;
+	gboolean ret = FALSE;
+
+	if (node->type == CDN_MATH_FUNCTION_TYPE_AND ||
+	    node->type == CDN_MATH_FUNCTION_TYPE_OR)
+	{
+		return logical_node_derive (node->left, t) &&
+		       logical_node_derive (node->right, t);
+	}
+
+	logical_node_clear_derivatives (node);
+	iter = cdn_expression_tree_iter_new (node->expression);
+
+	while (iter)
+	{
+		CdnExpressionTreeIter *next;
+		CdnExpression *derivative;
+
+		next = derive_time (iter, t);
+		cdn_expression_tree_iter_free (iter);
+
+		iter = next;
+
+		if (!iter)
+		{
+			break;
+		}
+
+		derivative = derived_expression (iter);
+
+		if (!derivative)
+		{
+			ret = TRUE;
+			break;
+		}
+
+		if (node->num_derivatives == HORIZON_MAX_ORDER)
+		{
+			g_object_unref (derivative);
+			break;
+		}
+
+		node->derivatives[node->num_derivatives++] = derivative;
+	}
+
+	if (iter)
+	{
+		cdn_expression_tree_iter_free (iter);
+	}
+
+	if (!ret)
+	{
+		logical_node_clear_derivatives (node);
+	}
+
+	return ret;
+}
+
+/* Bound on the change of the condition after s, with coeffs[i] the absolute
+ * value of the (i + 1)-th derivative divided by (i + 1)! */
+static gdouble
+horizon_reach (gdouble const *coeffs,
+               guint          num,
+               gdouble        s)
+{
+	gdouble ret = 0;
+	guint i;
+
+	for (i = num; i > 0; --i)
+	{
+		ret = (ret + coeffs[i - 1]) * s;
+	}
+
+	return ret;
+}
+
+static gdouble
+logical_node_horizon (CdnEvent    *event,
+                      LogicalNode *node)
+{
+	gdouble coeffs[HORIZON_MAX_ORDER];
+	gdouble factorial = 1;
+	gdouble dist;
+	gdouble lo = G_MAXDOUBLE;
+	gdouble hi = G_MAXDOUBLE;
+	guint i;
+
+	if (node->type == CDN_MATH_FUNCTION_TYPE_AND ||
+	    node->type == CDN_MATH_FUNCTION_TYPE_OR)
+	{
+		// Either side has to cross for the event to happen
+		return MIN (logical_node_horizon (event, node->left),
+		            logical_node_horizon (event, node->right));
+	}
+
+	dist = fabs (node->value);
+
+	if (node->type == CDN_MATH_FUNCTION_TYPE_EQUAL)
+	{
+		dist -= event->priv->approximation;
+	}
+
+	if (!(dist > 0))
+	{
+		return 0;
+	}
+
+	// Each term on its own reaching dist gives an upper bound on the
+	// smallest s for which their sum reaches dist. Before every term
+	// reaches dist / n, their sum cannot reach dist.
+	for (i = 0; i < node->num_derivatives; ++i)
+	{
+		factorial *= i + 1;
+
+		coeffs[i] = fabs (cdn_expression_evaluate (node->derivatives[i])) /
+		            factorial;
+
+		if (!isfinite (coeffs[i]))
+		{
+			return 0;
+		}
+
+		if (coeffs[i] > 0)
+		{
+			hi = MIN (hi, pow (dist / coeffs[i], 1.0 / (i + 1)));
+			lo = MIN (lo, pow (dist / (node->num_derivatives * coeffs[i]),
+			                   1.0 / (i + 1)));
+		}
+	}
+
+	// The condition stays where it is
+	if (hi == G_MAXDOUBLE)
+	{
+		return G_MAXDOUBLE;
+	}
+
+	for (i = 0; i < HORIZON_ITERATIONS; ++i)
+	{
+		gdouble mid = lo + (hi - lo) / 2;
+
+		if (horizon_reach (coeffs, node->num_derivatives, mid) < dist)
+		{
+			lo = mid;
+		}
+		else
+		{
+			hi = mid;
+		}
+	}
+
+	// lo never reaches dist
+	return lo;
+}
+
+/**
+ * cdn_event_horizon:
+ * @event: the #CdnEvent.
+ * @t: (allow-none): the time variable.
+ *
+ * Compute the time after the last update (see #cdn_event_update) before
+ * which the condition of @event cannot happen. The integrator uses this to
+ * skip checking events which are far away from happening.
+ *
+ * The horizon is a bound, not an estimate. It is only available for
+ * conditions of which a time derivative (at most the fourth) vanishes
+ * symbolically, such as the height of a body under constant acceleration.
+ * Along the solution, the distance of such a condition to zero is exactly
+ * a polynomial in time, whose coefficients are the derivatives at the last
+ * update, and the horizon is the time before which this polynomial cannot
+ * reach zero. For any other condition, and for conditions which depend on
+ * inputs, discrete variables, random numbers or operators, 0 is returned.
+ *
+ * Returns: the horizon, or 0 if no bound is available.
+ *
+ **/
+gdouble
+cdn_event_horizon (CdnEvent    *event,
+                   CdnVariable *t)
+{
+	g_return_val_if_fail (CDN_IS_EVENT (event), 0);
+	g_return_val_if_fail (t == NULL || CDN_IS_VARIABLE (t), 0);
+
+	if (!event->priv->condition_node)
+	{
+		return 0;
+	}
+
+	if (!event->priv->horizon_derived)
+	{
+		GHashTable *visited;
+
+		visited = g_hash_table_new (g_direct_hash, g_direct_equal);
+
+		event->priv->horizon_derived = TRUE;
+		event->priv->has_horizon =
+			expression_is_smooth (event->priv->condition, t, visited) &&
+			logical_node_derive (event->priv->condition_node, t);
+
+		g_hash_table_destroy (visited);
+	}
+
+	if (!event->priv->has_horizon)
+	{
+		return 0;
+	}
+
+	return logical_node_horizon (event, event->priv->condition_node);
+}
+
 // Do not use G_DEFINE_BOXED_TYPE here because the C# API parser doesn't
 // understand
 GType
@@ -49,8 +49,12 @@ gboolean         cdn_event_happened          (CdnEvent      *event,
                                               gdouble       *dist);
 
 gdouble          cdn_event_last_distance     (CdnEvent      *event);
+gdouble          cdn_event_crossing          (CdnEvent      *event,
+                                              gboolean       initial);
 
 void             cdn_event_update            (CdnEvent      *event);
+gdouble          cdn_event_horizon           (CdnEvent      *event,
+                                              CdnVariable   *t);
 CdnExpression *  cdn_event_get_condition     (CdnEvent      *event);
 gdouble          cdn_event_get_approximation (CdnEvent      *event);
 
@@ -34,6 +34,8 @@
 #include "cdn-node.h"
 #include "cdn-io.h"
 #include "cdn-debug.h"
+#include "cdn-statement.h"
+#include "cdn-profile.h"
 
 #include <codyn/instructions/cdn-instructions.h>
 
@@ -47,6 +49,97 @@
 
 #define CDN_EXPRESSION_GET_PRIVATE(object)(G_TYPE_INSTANCE_GET_PRIVATE((object), CDN_TYPE_EXPRESSION, CdnExpressionPrivate))
 
+typedef void (*BytecodeExecuteFunc) (CdnInstruction *instruction,
+                                     CdnStack       *stack);
+
+typedef enum
+{
+	BYTECODE_NUMBER,
+	BYTECODE_VARIABLE,
+	BYTECODE_VARIABLE_SLICE,
+	BYTECODE_FUNCTION,
+	BYTECODE_FUNCTION_CACHED,
+	BYTECODE_FUNCTION_SPARSE,
+	BYTECODE_INSTRUCTION,
+
+	// Specializations of builtin functions on scalar arguments
+	BYTECODE_NEGATE,
+	BYTECODE_PLUS,
+	BYTECODE_MINUS,
+	BYTECODE_MULTIPLY,
+	BYTECODE_DIVIDE,
+	BYTECODE_UNARY,
+	BYTECODE_BINARY
+} BytecodeOpcode;
+
+// Dispatch directly from one opcode handler to the next using computed
+// gotos where the compiler supports them
+#if defined(__GNUC__) && !defined(CDN_DISABLE_THREADED_BYTECODE)
+#define BYTECODE_THREADED
+#endif
+
+// Flat, evaluation-ready form of a single instruction. The common instruction
+// types are decoded into their operands so that evaluating them does not
+// require any virtual dispatch, everything else falls back to calling the
+// execute function of the instruction directly.
+typedef struct
+{
+	BytecodeOpcode opcode;
+
+	union
+	{
+		gdouble number;
+		CdnVariable *variable;
+
+		gdouble (*unary) (gdouble);
+		gdouble (*binary) (gdouble, gdouble);
+
+		struct
+		{
+			CdnVariable *variable;
+			guint const *indices;
+			guint length;
+		} slice;
+
+		struct
+		{
+			guint id;
+			CdnStackArgs const *args;
+
+			union
+			{
+				CdnMathFunctionCache *cache;
+
+				// Structural sparsity of each argument
+				CdnStackSparsity const * const *sparsity;
+			};
+		} function;
+
+		struct
+		{
+			CdnInstruction *instruction;
+			BytecodeExecuteFunc execute;
+		} instruction;
+	};
+} Bytecode;
+
+// Maximum stack depth of expressions evaluated by the scalar evaluator
+#define BYTECODE_SCALAR_REGISTERS 32
+
+// Topologically ordered set of expressions which are evaluated together in
+// a single pass. Members are not invalidated individually, instead the
+// whole program is marked dirty by advancing its stamp.
+struct _CdnExpressionProgram
+{
+	CdnExpression **expressions;
+	guint num_expressions;
+
+	// Expressions outside of the program which depend on a member
+	GSList *boundary;
+
+	guint stamp;
+};
+
 struct _CdnExpressionPrivate
 {
 	// Expression to evaluate
@@ -55,6 +148,39 @@ struct _CdnExpressionPrivate
 	GSList *instructions;
 	GSList *rand_instructions;
 
+	// Compiled form of instructions, built lazily on evaluation
+	Bytecode *bytecode;
+	guint bytecode_size;
+	guint bytecode_dirty : 1;
+
+	// Whether all the bytecode operates on 1-by-1 values only
+	guint bytecode_scalar : 1;
+
+	// Structural sparsity of the arguments of function calls (arrays
+	// parallel to their stack arguments), and the sparsity patterns
+	// themselves, owned by the bytecode
+	GSList *bytecode_args;
+	GSList *bytecode_sparsity;
+
+	// Structural sparsity of the result (owned by the bytecode), whether
+	// expressions depending on this one were compiled against it, and
+	// whether the value was set from outside, in which case the structure
+	// of the expression says nothing about its value
+	CdnStackSparsity const *bytecode_result;
+	guint bytecode_compiling : 1;
+	guint sparsity_exported : 1;
+	guint values_set : 1;
+
+	// Per call site caches of factorizations, owned by the bytecode
+	GSList *bytecode_caches;
+
+	// Fused evaluation program this expression is a member of
+	CdnExpressionProgram *program;
+	guint program_stamp;
+
+	// Profile results, only while profiling
+	CdnProfileEntry *profile;
+
 	CdnStack output;
 	CdnStackArg retdim;
 
@@ -63,6 +189,10 @@ struct _CdnExpressionPrivate
 
 	CdnMatrix cached_output;
 
+	// External memory which holds the cached value, see
+	// _cdn_expression_set_storage
+	gdouble *storage;
+
 	gint error_at;
 	GSList *error_start;
 
@@ -74,6 +204,11 @@ struct _CdnExpressionPrivate
 	CdnExpressionCacheNotify evaluate_notify;
 	GDestroyNotify evaluate_destroy_notify;
 
+	gint line_start;
+	gint line_end;
+	gint column_start;
+	gint column_end;
+
 	guint cached : 1;
 	guint prevent_cache_reset : 1;
 	guint modified : 1;
@@ -104,13 +239,18 @@ static gboolean parse_variable (CdnExpression *expression,
 static gboolean reset_cache (CdnExpression *expression,
                              gboolean       dimschanged);
 
+static void program_invalidate (CdnExpressionProgram *program);
+
 static void cdn_modifiable_iface_init (gpointer iface);
+static void cdn_statement_iface_init (gpointer iface);
 
 G_DEFINE_TYPE_WITH_CODE (CdnExpression,
                          cdn_expression,
                          G_TYPE_INITIALLY_UNOWNED,
                          G_IMPLEMENT_INTERFACE (CDN_TYPE_MODIFIABLE,
-                                                cdn_modifiable_iface_init))
+                                                cdn_modifiable_iface_init);
+                         G_IMPLEMENT_INTERFACE (CDN_TYPE_STATEMENT,
+                                                cdn_statement_iface_init))
 
 enum
 {
@@ -118,7 +258,11 @@ enum
 	PROP_EXPRESSION,
 	PROP_VALUE,
 	PROP_HAS_CACHE,
-	PROP_MODIFIED
+	PROP_MODIFIED,
+	PROP_LINE_START,
+	PROP_LINE_END,
+	PROP_COLUMN_START,
+	PROP_COLUMN_END
 };
 
 #define dump_context(s, expression, context) \
@@ -173,6 +317,12 @@ cdn_modifiable_iface_init (gpointer iface)
 	/* Use default implementation */
 }
 
+static void
+cdn_statement_iface_init (gpointer iface)
+{
+	/* Use default implementation */
+}
+
 static void
 push_error_start (CdnExpression *expression,
                   ParserContext *ctx)
@@ -189,9 +339,832 @@ pop_error_start (CdnExpression *expression,
 	                                                     expression->priv->error_start);
 }
 
+/* Recompile the bytecode of expressions which were compiled against the
+ * structural sparsity of the value of @expression */
+static void
+sparsity_invalidate (CdnExpression *expression)
+{
+	GSList *item;
+
+	if (!expression->priv->sparsity_exported)
+	{
+		return;
+	}
+
+	expression->priv->sparsity_exported = FALSE;
+
+	for (item = expression->priv->depends_on_me; item; item = g_slist_next (item))
+	{
+		CdnExpression *dep = item->data;
+
+		dep->priv->bytecode_dirty = TRUE;
+	}
+}
+
+static void
+bytecode_free (CdnExpression *expression)
+{
+	sparsity_invalidate (expression);
+
+	g_slist_foreach (expression->priv->bytecode_args,
+	                 (GFunc)g_free,
+	                 NULL);
+
+	g_slist_foreach (expression->priv->bytecode_sparsity,
+	                 (GFunc)_cdn_stack_sparsity_free,
+	                 NULL);
+
+	g_slist_foreach (expression->priv->bytecode_caches,
+	                 (GFunc)_cdn_math_function_cache_free,
+	                 NULL);
+
+	g_slist_free (expression->priv->bytecode_args);
+	g_slist_free (expression->priv->bytecode_sparsity);
+	g_slist_free (expression->priv->bytecode_caches);
+
+	expression->priv->bytecode_args = NULL;
+	expression->priv->bytecode_sparsity = NULL;
+	expression->priv->bytecode_result = NULL;
+	expression->priv->bytecode_caches = NULL;
+
+	g_free (expression->priv->bytecode);
+
+	expression->priv->bytecode = NULL;
+	expression->priv->bytecode_size = 0;
+	expression->priv->bytecode_scalar = FALSE;
+}
+
+static gboolean
+bytecode_compile_scalar (Bytecode           *code,
+                         guint               id,
+                         CdnStackArgs const *args)
+{
+	gdouble (*unary) (gdouble) = NULL;
+	gdouble (*binary) (gdouble, gdouble) = NULL;
+	gint i;
+
+	for (i = 0; i < args->num; ++i)
+	{
+		if (args->args[i].rows != 1 || args->args[i].columns != 1)
+		{
+			return FALSE;
+		}
+	}
+
+	switch (id)
+	{
+		case CDN_MATH_FUNCTION_TYPE_UNARY_MINUS:
+			code->opcode = BYTECODE_NEGATE;
+		break;
+		case CDN_MATH_FUNCTION_TYPE_PLUS:
+			code->opcode = BYTECODE_PLUS;
+		break;
+		case CDN_MATH_FUNCTION_TYPE_MINUS:
+			code->opcode = BYTECODE_MINUS;
+		break;
+		case CDN_MATH_FUNCTION_TYPE_MULTIPLY:
+		case CDN_MATH_FUNCTION_TYPE_EMULTIPLY:
+			code->opcode = BYTECODE_MULTIPLY;
+		break;
+		case CDN_MATH_FUNCTION_TYPE_DIVIDE:
+			code->opcode = BYTECODE_DIVIDE;
+		break;
+		case CDN_MATH_FUNCTION_TYPE_SIN:
+			unary = sin;
+		break;
+		case CDN_MATH_FUNCTION_TYPE_COS:
+			unary = cos;
+		break;
+		case CDN_MATH_FUNCTION_TYPE_TAN:
+			unary = tan;
+		break;
+		case CDN_MATH_FUNCTION_TYPE_ASIN:
+			unary = asin;
+		break;
+		case CDN_MATH_FUNCTION_TYPE_ACOS:
+			unary = acos;
+		break;
+		case CDN_MATH_FUNCTION_TYPE_ATAN:
+			unary = atan;
+		break;
+		case CDN_MATH_FUNCTION_TYPE_SQRT:
+			unary = sqrt;
+		break;
+		case CDN_MATH_FUNCTION_TYPE_EXP:
+			unary = exp;
+		break;
+		case CDN_MATH_FUNCTION_TYPE_FLOOR:
+			unary = floor;
+		break;
+		case CDN_MATH_FUNCTION_TYPE_CEIL:
+			unary = ceil;
+		break;
+		case CDN_MATH_FUNCTION_TYPE_ABS:
+			unary = fabs;
+		break;
+		case CDN_MATH_FUNCTION_TYPE_LN:
+			unary = log;
+		break;
+		case CDN_MATH_FUNCTION_TYPE_LOG10:
+			unary = log10;
+		break;
+		case CDN_MATH_FUNCTION_TYPE_SINH:
+			unary = sinh;
+		break;
+		case CDN_MATH_FUNCTION_TYPE_COSH:
+			unary = cosh;
+		break;
+		case CDN_MATH_FUNCTION_TYPE_TANH:
+			unary = tanh;
+		break;
+		case CDN_MATH_FUNCTION_TYPE_ATAN2:
+			binary = atan2;
+		break;
+		case CDN_MATH_FUNCTION_TYPE_POW:
+		case CDN_MATH_FUNCTION_TYPE_POWER:
+			binary = pow;
+		break;
+		default:
+			return FALSE;
+	}
+
+	if (unary)
+	{
+		code->opcode = BYTECODE_UNARY;
+		code->unary = unary;
+	}
+	else if (binary)
+	{
+		code->opcode = BYTECODE_BINARY;
+		code->binary = binary;
+	}
+
+	return TRUE;
+}
+
+static gboolean
+bytecode_is_scalar (CdnExpression *expression)
+{
+	Bytecode const *code;
+	Bytecode const *end;
+	guint depth = 0;
+
+	if (!cdn_dimension_is_one (&expression->priv->retdim.dimension))
+	{
+		return FALSE;
+	}
+
+	code = expression->priv->bytecode;
+	end = code + expression->priv->bytecode_size;
+
+	for (; code < end; ++code)
+	{
+		switch (code->opcode)
+		{
+			case BYTECODE_NUMBER:
+			case BYTECODE_VARIABLE:
+				++depth;
+			break;
+			case BYTECODE_VARIABLE_SLICE:
+				if (code->slice.length != 1)
+				{
+					return FALSE;
+				}
+
+				++depth;
+			break;
+			case BYTECODE_NEGATE:
+			case BYTECODE_UNARY:
+			break;
+			case BYTECODE_PLUS:
+			case BYTECODE_MINUS:
+			case BYTECODE_MULTIPLY:
+			case BYTECODE_DIVIDE:
+			case BYTECODE_BINARY:
+				--depth;
+			break;
+			default:
+				return FALSE;
+		}
+
+		if (depth > BYTECODE_SCALAR_REGISTERS)
+		{
+			return FALSE;
+		}
+	}
+
+	return depth == 1;
+}
+
+static CdnStackSparsity *
+sparsity_concat (CdnStackManipulation const  *smanip,
+                 CdnStackSparsity const     **args)
+{
+	CdnStackSparsity *ret;
+	gboolean *mask;
+	gint offset = 0;
+	gint i;
+
+	mask = g_new0 (gboolean, cdn_stack_arg_size (&smanip->push));
+
+	// Matrix instructions only concatenate their arguments, in the order
+	// in which they were pushed (i.e. the last popped argument first)
+	for (i = smanip->pop.num - 1; i >= 0; --i)
+	{
+		CdnStackArg const *arg = smanip->pop.args + i;
+		gboolean *m;
+		gint num;
+
+		num = cdn_stack_arg_size (arg);
+		m = _cdn_stack_sparsity_get_mask (args[i], &arg->dimension);
+
+		memcpy (mask + offset, m, sizeof (gboolean) * num);
+		offset += num;
+
+		g_free (m);
+	}
+
+	ret = _cdn_stack_sparsity_new_from_mask (&smanip->push.dimension, mask);
+	g_free (mask);
+
+	return ret;
+}
+
+static void bytecode_compile (CdnExpression *expression);
+
+/* The structural sparsity of the value of @variable, if that value always
+ * comes from evaluating its own expression. Values of inputs, integrated,
+ * discrete and constrained variables, function arguments and variables
+ * targeted by edge actions are set from outside and are never considered
+ * sparse. Neither are variables whose value was set explicitly (see
+ * cdn_expression_set_values). */
+static CdnStackSparsity *
+variable_sparsity (CdnExpression     *expression,
+                   CdnVariable       *variable,
+                   CdnStackArg const *push)
+{
+	CdnExpression *expr;
+	CdnStackSparsity *ret;
+	gboolean *mask;
+
+	if ((cdn_variable_get_flags (variable) & (CDN_VARIABLE_FLAG_INTEGRATED |
+	                                          CDN_VARIABLE_FLAG_IN |
+	                                          CDN_VARIABLE_FLAG_DISCRETE |
+	                                          CDN_VARIABLE_FLAG_FUNCTION_ARGUMENT)) ||
+	    cdn_variable_get_constraint (variable) ||
+	    cdn_variable_has_actions (variable))
+	{
+		return NULL;
+	}
+
+	expr = cdn_variable_get_expression (variable);
+
+	if (!expr ||
+	    expr == expression ||
+	    expr->priv->values_set ||
+	    expr->priv->bytecode_compiling ||
+	    !expr->priv->instructions ||
+	    !cdn_dimension_equal (&expr->priv->retdim.dimension, &push->dimension))
+	{
+		return NULL;
+	}
+
+	if (!expr->priv->bytecode || expr->priv->bytecode_dirty)
+	{
+		bytecode_compile (expr);
+	}
+
+	if (!expr->priv->bytecode_result)
+	{
+		return NULL;
+	}
+
+	// Recompile this expression when the pattern of the variable changes
+	expr->priv->sparsity_exported = TRUE;
+
+	mask = _cdn_stack_sparsity_get_mask (expr->priv->bytecode_result,
+	                                     &push->dimension);
+
+	ret = _cdn_stack_sparsity_new_from_mask (&push->dimension, mask);
+	g_free (mask);
+
+	return ret;
+}
+
+/* Track the structural sparsity of the values on the stack while compiling
+ * the bytecode. Structural zeros originate from literal zeros in the
+ * expression and are propagated through matrix instructions, variables
+ * whose value comes from their own expression (see variable_sparsity) and
+ * the functions which preserve them (see _cdn_math_function_get_sparsity).
+ * For functions with at least one sparse argument, the sparsity of each
+ * argument is returned so the math kernels can exploit them.
+ */
+static CdnStackSparsity const **
+bytecode_sparsity (CdnExpression   *expression,
+                   CdnInstruction  *inst,
+                   GSList         **stack)
+{
+	CdnStackManipulation const *smanip;
+	CdnStackSparsity const **args;
+	CdnStackSparsity const **ret = NULL;
+	CdnStackSparsity *push = NULL;
+	gboolean sparse = FALSE;
+	gint i;
+
+	smanip = cdn_instruction_get_stack_manipulation (inst, NULL);
+
+	if (!smanip)
+	{
+		g_slist_free (*stack);
+		*stack = NULL;
+
+		return NULL;
+	}
+
+	args = g_new0 (CdnStackSparsity const *, smanip->pop.num + 1);
+
+	for (i = 0; i < smanip->pop.num && *stack; ++i)
+	{
+		args[i] = (*stack)->data;
+		sparse = sparse || args[i] != NULL;
+
+		*stack = g_slist_delete_link (*stack, *stack);
+	}
+
+	if (CDN_IS_INSTRUCTION_NUMBER (inst))
+	{
+		if (cdn_instruction_number_get_value ((CdnInstructionNumber *)inst) == 0)
+		{
+			gboolean nonzero = FALSE;
+
+			push = _cdn_stack_sparsity_new_from_mask (&smanip->push.dimension,
+			                                          &nonzero);
+		}
+	}
+	else if (CDN_IS_INSTRUCTION_MATRIX (inst) && sparse)
+	{
+		push = sparsity_concat (smanip, args);
+	}
+	else if (CDN_IS_INSTRUCTION_VARIABLE (inst) &&
+	         !cdn_instruction_variable_has_slice ((CdnInstructionVariable *)inst))
+	{
+		CdnVariable *variable;
+
+		variable = cdn_instruction_variable_get_variable ((CdnInstructionVariable *)inst);
+		push = variable_sparsity (expression, variable, &smanip->push);
+	}
+	else if (CDN_IS_INSTRUCTION_FUNCTION (inst))
+	{
+		guint id;
+
+		id = cdn_instruction_function_get_id ((CdnInstructionFunction *)inst);
+
+		push = _cdn_math_function_get_sparsity (id,
+		                                        &smanip->pop,
+		                                        args,
+		                                        &smanip->push);
+
+		if (sparse)
+		{
+			expression->priv->bytecode_args =
+				g_slist_prepend (expression->priv->bytecode_args,
+				                 args);
+
+			ret = args;
+			args = NULL;
+		}
+	}
+
+	if (push)
+	{
+		expression->priv->bytecode_sparsity =
+			g_slist_prepend (expression->priv->bytecode_sparsity,
+			                 push);
+	}
+
+	*stack = g_slist_prepend (*stack, push);
+
+	g_free (args);
+	return ret;
+}
+
+static void
+bytecode_compile (CdnExpression *expression)
+{
+	GSList *item;
+	Bytecode *code;
+	gboolean scalar = TRUE;
+	GSList *sparsity = NULL;
+
+	bytecode_free (expression);
+
+	expression->priv->bytecode_compiling = TRUE;
+
+	expression->priv->bytecode = g_new0 (Bytecode,
+	                                     g_slist_length (expression->priv->instructions));
+
+	code = expression->priv->bytecode;
+
+	for (item = expression->priv->instructions; item; item = g_slist_next (item))
+	{
+		CdnInstruction *inst = item->data;
+		CdnStackSparsity const **sargs;
+
+		sargs = bytecode_sparsity (expression, inst, &sparsity);
+
+		if (CDN_IS_INSTRUCTION_MATRIX (inst))
+		{
+			// Matrix instructions only encode dimensions, they do
+			// not touch the stack
+			continue;
+		}
+		else if (CDN_IS_INSTRUCTION_NUMBER (inst))
+		{
+			code->opcode = BYTECODE_NUMBER;
+			code->number = cdn_instruction_number_get_value ((CdnInstructionNumber *)inst);
+		}
+		else if (CDN_IS_INSTRUCTION_VARIABLE (inst))
+		{
+			CdnInstructionVariable *v = (CdnInstructionVariable *)inst;
+			CdnVariable *variable;
+
+			variable = cdn_instruction_variable_get_variable (v);
+
+			if (cdn_instruction_variable_has_slice (v))
+			{
+				code->opcode = BYTECODE_VARIABLE_SLICE;
+				code->slice.variable = variable;
+				code->slice.indices = cdn_instruction_variable_get_slice (v,
+				                                                          &code->slice.length,
+				                                                          NULL);
+			}
+			else
+			{
+				CdnStackManipulation const *smanip;
+
+				code->opcode = BYTECODE_VARIABLE;
+				code->variable = variable;
+
+				smanip = cdn_instruction_get_stack_manipulation (inst, NULL);
+
+				if (!smanip ||
+				    smanip->push.rows != 1 ||
+				    smanip->push.columns != 1)
+				{
+					scalar = FALSE;
+				}
+			}
+		}
+		else if (CDN_IS_INSTRUCTION_FUNCTION (inst) &&
+		         cdn_instruction_get_stack_manipulation (inst, NULL) != NULL)
+		{
+			CdnStackManipulation const *smanip;
+			guint id;
+
+			smanip = cdn_instruction_get_stack_manipulation (inst, NULL);
+			id = cdn_instruction_function_get_id ((CdnInstructionFunction *)inst);
+
+			if (!bytecode_compile_scalar (code, id, &smanip->pop))
+			{
+				code->opcode = BYTECODE_FUNCTION;
+				code->function.id = id;
+				code->function.args = &smanip->pop;
+
+				code->function.cache =
+					_cdn_math_function_cache_new (id,
+					                              &smanip->pop,
+					                              sargs,
+					                              &smanip->push);
+
+				if (code->function.cache)
+				{
+					code->opcode = BYTECODE_FUNCTION_CACHED;
+
+					expression->priv->bytecode_caches =
+						g_slist_prepend (expression->priv->bytecode_caches,
+						                 code->function.cache);
+				}
+				else if (sargs)
+				{
+					code->opcode = BYTECODE_FUNCTION_SPARSE;
+					code->function.sparsity = sargs;
+				}
+			}
+		}
+		else
+		{
+			code->opcode = BYTECODE_INSTRUCTION;
+			code->instruction.instruction = inst;
+			code->instruction.execute = CDN_INSTRUCTION_GET_CLASS (inst)->execute;
+		}
+
+		++code;
+	}
+
+	expression->priv->bytecode_result = sparsity ? sparsity->data : NULL;
+	g_slist_free (sparsity);
+
+	expression->priv->bytecode_size = code - expression->priv->bytecode;
+	expression->priv->bytecode_dirty = FALSE;
+	expression->priv->bytecode_compiling = FALSE;
+
+#ifdef CDN_DISABLE_SCALAR_BYTECODE
+	scalar = FALSE;
+#endif
+
+	expression->priv->bytecode_scalar = scalar &&
+	                                     bytecode_is_scalar (expression);
+}
+
+#ifdef BYTECODE_THREADED
+#define BYTECODE_SWITCH(opcode) goto *dispatch[opcode];
+#define BYTECODE_CASE(opcode) opcode##_label:
+#define BYTECODE_BREAK if (++code == end) return; goto *dispatch[code->opcode];
+#else
+#define BYTECODE_SWITCH(opcode) switch (opcode)
+#define BYTECODE_CASE(opcode) case opcode:
+#define BYTECODE_BREAK break;
+#endif
+
+static void
+bytecode_run (Bytecode const *code,
+              Bytecode const *end,
+              CdnStack       *stack)
+{
+
+#ifdef BYTECODE_THREADED
+	static void const *dispatch[] = {
+		[BYTECODE_NUMBER] = &&BYTECODE_NUMBER_label,
+		[BYTECODE_VARIABLE] = &&BYTECODE_VARIABLE_label,
+		[BYTECODE_VARIABLE_SLICE] = &&BYTECODE_VARIABLE_SLICE_label,
+		[BYTECODE_FUNCTION] = &&BYTECODE_FUNCTION_label,
+		[BYTECODE_FUNCTION_CACHED] = &&BYTECODE_FUNCTION_CACHED_label,
+		[BYTECODE_FUNCTION_SPARSE] = &&BYTECODE_FUNCTION_SPARSE_label,
+		[BYTECODE_INSTRUCTION] = &&BYTECODE_INSTRUCTION_label,
+		[BYTECODE_NEGATE] = &&BYTECODE_NEGATE_label,
+		[BYTECODE_PLUS] = &&BYTECODE_PLUS_label,
+		[BYTECODE_MINUS] = &&BYTECODE_MINUS_label,
+		[BYTECODE_MULTIPLY] = &&BYTECODE_MULTIPLY_label,
+		[BYTECODE_DIVIDE] = &&BYTECODE_DIVIDE_label,
+		[BYTECODE_UNARY] = &&BYTECODE_UNARY_label,
+		[BYTECODE_BINARY] = &&BYTECODE_BINARY_label
+	};
+#endif
+
+	if (code == end)
+	{
+		return;
+	}
+
+	while (TRUE)
+	{
+		BYTECODE_SWITCH (code->opcode)
+		{
+			BYTECODE_CASE (BYTECODE_NUMBER)
+				cdn_stack_push (stack, code->number);
+			BYTECODE_BREAK
+			BYTECODE_CASE (BYTECODE_VARIABLE)
+			{
+				CdnMatrix const *values;
+
+				values = cdn_variable_get_values (code->variable);
+
+				cdn_stack_pushn (stack,
+				                 cdn_matrix_get (values),
+				                 cdn_matrix_size (values));
+			}
+			BYTECODE_BREAK
+			BYTECODE_CASE (BYTECODE_VARIABLE_SLICE)
+			{
+				gdouble const *vals;
+				guint i;
+
+				vals = cdn_matrix_get (cdn_variable_get_values (code->slice.variable));
+
+				for (i = 0; i < code->slice.length; ++i)
+				{
+					cdn_stack_push (stack, vals[code->slice.indices[i]]);
+				}
+			}
+			BYTECODE_BREAK
+			BYTECODE_CASE (BYTECODE_FUNCTION)
+				cdn_math_function_execute (code->function.id,
+				                           code->function.args,
+				                           stack);
+			BYTECODE_BREAK
+			BYTECODE_CASE (BYTECODE_FUNCTION_CACHED)
+				_cdn_math_function_execute_cached (code->function.id,
+				                                   code->function.args,
+				                                   stack,
+				                                   code->function.cache);
+			BYTECODE_BREAK
+			BYTECODE_CASE (BYTECODE_FUNCTION_SPARSE)
+				_cdn_math_function_execute_sparse (code->function.id,
+				                                   code->function.args,
+				                                   code->function.sparsity,
+				                                   stack);
+			BYTECODE_BREAK
+			BYTECODE_CASE (BYTECODE_INSTRUCTION)
+				code->instruction.execute (code->instruction.instruction,
+				                           stack);
+			BYTECODE_BREAK
+			BYTECODE_CASE (BYTECODE_NEGATE)
+				stack->output_ptr[-1] = -stack->output_ptr[-1];
+			BYTECODE_BREAK
+			BYTECODE_CASE (BYTECODE_PLUS)
+				--stack->output_ptr;
+				stack->output_ptr[-1] += *stack->output_ptr;
+			BYTECODE_BREAK
+			BYTECODE_CASE (BYTECODE_MINUS)
+				--stack->output_ptr;
+				stack->output_ptr[-1] -= *stack->output_ptr;
+			BYTECODE_BREAK
+			BYTECODE_CASE (BYTECODE_MULTIPLY)
+				--stack->output_ptr;
+				stack->output_ptr[-1] *= *stack->output_ptr;
+			BYTECODE_BREAK
+			BYTECODE_CASE (BYTECODE_DIVIDE)
+				--stack->output_ptr;
+				stack->output_ptr[-1] /= *stack->output_ptr;
+			BYTECODE_BREAK
+			BYTECODE_CASE (BYTECODE_UNARY)
+				stack->output_ptr[-1] = code->unary (stack->output_ptr[-1]);
+			BYTECODE_BREAK
+			BYTECODE_CASE (BYTECODE_BINARY)
+				--stack->output_ptr;
+				stack->output_ptr[-1] = code->binary (stack->output_ptr[-1],
+				                                      *stack->output_ptr);
+			BYTECODE_BREAK
+		}
+
+		if (++code == end)
+		{
+			return;
+		}
+	}
+}
+
+static void
+bytecode_execute (CdnExpression *expression,
+                  CdnStack      *stack)
+{
+	bytecode_run (expression->priv->bytecode,
+	              expression->priv->bytecode + expression->priv->bytecode_size,
+	              stack);
+}
+
+// Evaluate bytecode which only operates on 1-by-1 values (see
+// bytecode_is_scalar) using a plain array of registers instead of the stack.
+// The result is left in the first register.
+static void
+bytecode_run_scalar (Bytecode const *code,
+                     Bytecode const *end,
+                     gdouble        *regs)
+{
+	gdouble *r = regs;
+
+#ifdef BYTECODE_THREADED
+	static void const *dispatch[] = {
+		[BYTECODE_NUMBER] = &&BYTECODE_NUMBER_label,
+		[BYTECODE_VARIABLE] = &&BYTECODE_VARIABLE_label,
+		[BYTECODE_VARIABLE_SLICE] = &&BYTECODE_VARIABLE_SLICE_label,
+		[BYTECODE_FUNCTION] = &&BYTECODE_FUNCTION_label,
+		[BYTECODE_FUNCTION_CACHED] = &&BYTECODE_FUNCTION_CACHED_label,
+		[BYTECODE_FUNCTION_SPARSE] = &&BYTECODE_FUNCTION_SPARSE_label,
+		[BYTECODE_INSTRUCTION] = &&BYTECODE_INSTRUCTION_label,
+		[BYTECODE_NEGATE] = &&BYTECODE_NEGATE_label,
+		[BYTECODE_PLUS] = &&BYTECODE_PLUS_label,
+		[BYTECODE_MINUS] = &&BYTECODE_MINUS_label,
+		[BYTECODE_MULTIPLY] = &&BYTECODE_MULTIPLY_label,
+		[BYTECODE_DIVIDE] = &&BYTECODE_DIVIDE_label,
+		[BYTECODE_UNARY] = &&BYTECODE_UNARY_label,
+		[BYTECODE_BINARY] = &&BYTECODE_BINARY_label
+	};
+#endif
+
+	if (code == end)
+	{
+		return;
+	}
+
+	while (TRUE)
+	{
+		BYTECODE_SWITCH (code->opcode)
+		{
+			BYTECODE_CASE (BYTECODE_NUMBER)
+				*r++ = code->number;
+			BYTECODE_BREAK
+			BYTECODE_CASE (BYTECODE_VARIABLE)
+				*r++ = *cdn_matrix_get (cdn_variable_get_values (code->variable));
+			BYTECODE_BREAK
+			BYTECODE_CASE (BYTECODE_VARIABLE_SLICE)
+				*r++ = cdn_matrix_get (cdn_variable_get_values (code->slice.variable))[code->slice.indices[0]];
+			BYTECODE_BREAK
+			BYTECODE_CASE (BYTECODE_NEGATE)
+				r[-1] = -r[-1];
+			BYTECODE_BREAK
+			BYTECODE_CASE (BYTECODE_PLUS)
+				--r;
+				r[-1] += *r;
+			BYTECODE_BREAK
+			BYTECODE_CASE (BYTECODE_MINUS)
+				--r;
+				r[-1] -= *r;
+			BYTECODE_BREAK
+			BYTECODE_CASE (BYTECODE_MULTIPLY)
+				--r;
+				r[-1] *= *r;
+			BYTECODE_BREAK
+			BYTECODE_CASE (BYTECODE_DIVIDE)
+				--r;
+				r[-1] /= *r;
+			BYTECODE_BREAK
+			BYTECODE_CASE (BYTECODE_UNARY)
+				r[-1] = code->unary (r[-1]);
+			BYTECODE_BREAK
+			BYTECODE_CASE (BYTECODE_BINARY)
+				--r;
+				r[-1] = code->binary (r[-1], *r);
+			BYTECODE_BREAK
+			BYTECODE_CASE (BYTECODE_FUNCTION)
+			BYTECODE_CASE (BYTECODE_FUNCTION_CACHED)
+			BYTECODE_CASE (BYTECODE_FUNCTION_SPARSE)
+			BYTECODE_CASE (BYTECODE_INSTRUCTION)
+				// Never part of scalar bytecode
+				g_assert_not_reached ();
+			BYTECODE_BREAK
+		}
+
+		if (++code == end)
+		{
+			return;
+		}
+	}
+}
+
+static GType
+bytecode_instruction_type (Bytecode const *code)
+{
+	switch (code->opcode)
+	{
+		case BYTECODE_NUMBER:
+			return CDN_TYPE_INSTRUCTION_NUMBER;
+		case BYTECODE_VARIABLE:
+		case BYTECODE_VARIABLE_SLICE:
+			return CDN_TYPE_INSTRUCTION_VARIABLE;
+		case BYTECODE_INSTRUCTION:
+			return G_TYPE_FROM_INSTANCE (code->instruction.instruction);
+		default:
+			return CDN_TYPE_INSTRUCTION_FUNCTION;
+	}
+}
+
+static void
+bytecode_execute_profiled (CdnExpression *expression,
+                           CdnStack      *stack)
+{
+	Bytecode const *code;
+	Bytecode const *end;
+
+	code = expression->priv->bytecode;
+	end = code + expression->priv->bytecode_size;
+
+	// Time each instruction separately
+	while (code < end)
+	{
+		gint64 begin;
+
+		begin = _cdn_profile_instruction_begin ();
+		bytecode_run (code, code + 1, stack);
+
+		_cdn_profile_instruction_end (bytecode_instruction_type (code),
+		                              begin);
+
+		++code;
+	}
+}
+
+static gboolean
+is_cached (CdnExpression *expression)
+{
+	if (!expression->priv->cached)
+	{
+		return FALSE;
+	}
+
+	// Values which are set explicitly (e.g. integrated states) are not
+	// invalidated by the program stamp
+	return !expression->priv->program ||
+	       expression->priv->program_stamp == expression->priv->program->stamp ||
+	       (expression->priv->prevent_cache_reset &&
+	        !expression->priv->evaluate_notify);
+}
+
 static void
 instructions_free (CdnExpression *expression)
 {
+	bytecode_free (expression);
+
 	while (expression->priv->instructions)
 	{
 		GSList *deps;
@@ -206,6 +1179,14 @@ instructions_free (CdnExpression *expression)
 			other->priv->depends_on_me =
 				g_slist_remove (other->priv->depends_on_me,
 				                expression);
+
+			if (other->priv->program &&
+			    other->priv->program != expression->priv->program)
+			{
+				other->priv->program->boundary =
+					g_slist_remove (other->priv->program->boundary,
+					                expression);
+			}
 		}
 
 		g_slist_free (deps);
@@ -303,6 +1284,18 @@ reset_depending_cache (CdnExpression *expression,
 		CdnExpression *dep = item->data;
 		gboolean realchanged = dimschanged;
 
+		// Members of a fused program are not reset one by one, the
+		// program as a whole is invalidated instead
+		if (dep->priv->program && !dimschanged)
+		{
+			if (!dep->priv->prevent_cache_reset && is_cached (dep))
+			{
+				program_invalidate (dep->priv->program);
+			}
+
+			continue;
+		}
+
 		// Reset the cache of any expressions that depend on this
 		// expression
 		if (dimschanged && !dep->priv->prevent_cache_reset)
@@ -328,6 +1321,42 @@ reset_depending_cache (CdnExpression *expression,
 	}
 }
 
+static void
+set_cached_output (CdnExpression      *expression,
+                   gdouble const      *values,
+                   CdnDimension const *dimension)
+{
+	CdnMatrix *cached = &expression->priv->cached_output;
+
+	if (!expression->priv->storage)
+	{
+		cdn_matrix_set (cached, values, dimension);
+		return;
+	}
+
+	if (!values || !cdn_dimension_equal (&cached->dimension, dimension))
+	{
+		// The storage was laid out for the old dimension
+		_cdn_expression_set_storage (expression, NULL);
+		cdn_matrix_set (cached, values, dimension);
+		return;
+	}
+
+	if (values != expression->priv->storage)
+	{
+		memcpy (expression->priv->storage,
+		        values,
+		        sizeof (gdouble) * cdn_dimension_size (dimension));
+	}
+
+	// Single values live inside the matrix itself and are mirrored in the
+	// storage, larger ones use the storage directly
+	if (cdn_dimension_is_one (dimension))
+	{
+		cached->value = *values;
+	}
+}
+
 static void
 set_values (CdnExpression       *expression,
             gdouble       const *values,
@@ -344,9 +1373,28 @@ set_values (CdnExpression       *expression,
 
 	expression->priv->cached = TRUE;
 
-	cdn_matrix_set (&expression->priv->cached_output,
-	                values,
-	                dimension);
+	if (expression->priv->program)
+	{
+		expression->priv->program_stamp = expression->priv->program->stamp;
+	}
+
+	set_cached_output (expression, values, dimension);
+
+	// Keep the arena copy of the value up to date so that it can be
+	// snapshotted together with the rest of the arena
+	if (_cdn_stack_is_borrowed (&expression->priv->output))
+	{
+		gdouble *ptr;
+		guint size;
+
+		ptr = cdn_stack_ptr (&expression->priv->output);
+		size = cdn_dimension_size (dimension);
+
+		if (ptr != values && size <= expression->priv->output.size)
+		{
+			memcpy (ptr, values, sizeof (gdouble) * size);
+		}
+	}
 
 	if (expression->priv->has_cache || dimschanged)
 	{
@@ -362,6 +1410,7 @@ cdn_expression_finalize (GObject *object)
 
 	expression = CDN_EXPRESSION (object);
 
+	_cdn_expression_set_storage (expression, NULL);
 	instructions_free (expression);
 
 	cdn_stack_destroy (&(expression->priv->output));
@@ -381,6 +1430,11 @@ cdn_expression_finalize (GObject *object)
 
 	cdn_stack_arg_destroy (&expression->priv->retdim);
 
+	if (expression->priv->profile)
+	{
+		_cdn_profile_entry_detach (expression->priv->profile);
+	}
+
 	G_OBJECT_CLASS (cdn_expression_parent_class)->finalize (object);
 }
 
@@ -439,6 +1493,18 @@ cdn_expression_set_property (GObject      *object,
 		case PROP_MODIFIED:
 			self->priv->modified = g_value_get_boolean (value);
 		break;
+		case PROP_LINE_START:
+			self->priv->line_start = g_value_get_int (value);
+		break;
+		case PROP_LINE_END:
+			self->priv->line_end = g_value_get_int (value);
+		break;
+		case PROP_COLUMN_START:
+			self->priv->column_start = g_value_get_int (value);
+		break;
+		case PROP_COLUMN_END:
+			self->priv->column_end = g_value_get_int (value);
+		break;
 		default:
 			G_OBJECT_WARN_INVALID_PROPERTY_ID (object, prop_id, pspec);
 		break;
@@ -467,6 +1533,18 @@ cdn_expression_get_property (GObject    *object,
 		case PROP_MODIFIED:
 			g_value_set_boolean (value, self->priv->modified);
 		break;
+		case PROP_LINE_START:
+			g_value_set_int (value, self->priv->line_start);
+		break;
+		case PROP_LINE_END:
+			g_value_set_int (value, self->priv->line_end);
+		break;
+		case PROP_COLUMN_START:
+			g_value_set_int (value, self->priv->column_start);
+		break;
+		case PROP_COLUMN_END:
+			g_value_set_int (value, self->priv->column_end);
+		break;
 		default:
 			G_OBJECT_WARN_INVALID_PROPERTY_ID (object, prop_id, pspec);
 		break;
@@ -514,6 +1592,22 @@ cdn_expression_class_init (CdnExpressionClass *klass)
 	g_object_class_override_property (object_class,
 	                                  PROP_MODIFIED,
 	                                  "modified");
+
+	g_object_class_override_property (object_class,
+	                                  PROP_LINE_START,
+	                                  "line-start");
+
+	g_object_class_override_property (object_class,
+	                                  PROP_LINE_END,
+	                                  "line-end");
+
+	g_object_class_override_property (object_class,
+	                                  PROP_COLUMN_START,
+	                                  "column-start");
+
+	g_object_class_override_property (object_class,
+	                                  PROP_COLUMN_END,
+	                                  "column-end");
 }
 
 static void
@@ -5302,6 +6396,8 @@ validate_stack (CdnExpression *expression,
 		g_slist_free (expression->priv->depends_on);
 		expression->priv->depends_on = NULL;
 
+		bytecode_free (expression);
+
 		// check for empty instruction set
 		if (!expression->priv->instructions)
 		{
@@ -5310,6 +6406,13 @@ validate_stack (CdnExpression *expression,
 			                   NULL);
 		}
 	}
+	else
+	{
+		// Recompile on the next evaluation since the bytecode is
+		// specialized on the argument dimensions. It might be in use
+		// at this point, so it is not freed here.
+		expression->priv->bytecode_dirty = TRUE;
+	}
 
 	dim = expression->priv->retdim.dimension;
 
@@ -5431,6 +6534,14 @@ validate_stack (CdnExpression *expression,
 				other->priv->depends_on_me =
 					g_slist_prepend (other->priv->depends_on_me,
 					                 expression);
+
+				if (other->priv->program &&
+				    other->priv->program != expression->priv->program)
+				{
+					other->priv->program->boundary =
+						g_slist_prepend (other->priv->program->boundary,
+						                 expression);
+				}
 			}
 
 			g_slist_free (deps);
@@ -5715,6 +6826,12 @@ cdn_expression_set_value (CdnExpression  *expression,
 {
 	set_values (expression, &value, cdn_dimension_onep);
 	expression->priv->prevent_cache_reset = TRUE;
+
+	if (G_UNLIKELY (!expression->priv->values_set))
+	{
+		expression->priv->values_set = TRUE;
+		sparsity_invalidate (expression);
+	}
 }
 
 /**
@@ -5731,6 +6848,12 @@ cdn_expression_set_values (CdnExpression       *expression,
 {
 	set_values (expression, cdn_matrix_get (values), &values->dimension);
 	expression->priv->prevent_cache_reset = TRUE;
+
+	if (G_UNLIKELY (!expression->priv->values_set))
+	{
+		expression->priv->values_set = TRUE;
+		sparsity_invalidate (expression);
+	}
 }
 
 /**
@@ -5752,53 +6875,31 @@ cdn_expression_evaluate (CdnExpression *expression)
 
 	ret = cdn_expression_evaluate_values (expression);
 	return ret ? *cdn_matrix_get (ret) : 0;
-}
-
-static void
-set_cache_from_stack (CdnExpression *expression)
-{
-	set_values (expression,
-	            cdn_stack_ptr (&(expression->priv->output)),
-	            &expression->priv->retdim.dimension);
-}
-
-/**
- * cdn_expression_evaluate_values:
- * @expression: a #CdnExpression
- *
- * Evaluate the given expression and return its value as a matrix. Note that
- * values are always cached in expressions, and this function thus returns
- * an internal reference to the resulting matrix.
- *
- * Returns: (transfer none): the result of evaluating the expression
- *
- */
-CdnMatrix const *
-cdn_expression_evaluate_values (CdnExpression *expression)
-{
-	/* Omit type check to increase speed */
-	if (!expression)
-	{
-		return NULL;
-	}
-
-	if (expression->priv->cached)
-	{
-		return &expression->priv->cached_output;
-	}
+}
+
+static void
+set_cache_from_stack (CdnExpression *expression)
+{
+	set_values (expression,
+	            cdn_stack_ptr (&(expression->priv->output)),
+	            &expression->priv->retdim.dimension);
+}
 
+static CdnMatrix const *
+evaluate_values (CdnExpression *expression,
+                 gboolean       profile)
+{
 	if (expression->priv->evaluate_notify)
 	{
 		expression->priv->evaluate_notify (expression,
 		                                   expression->priv->evaluate_userdata);
 
-		if (expression->priv->cached)
+		if (is_cached (expression))
 		{
 			return &expression->priv->cached_output;
 		}
 	}
 
-	GSList *item;
 	CdnStack *stack = &(expression->priv->output);
 
 	cdn_stack_reset (stack);
@@ -5835,29 +6936,59 @@ cdn_expression_evaluate_values (CdnExpression *expression)
 		cdn_expression_tree_iter_free (iter);
 	}
 
-	for (item = expression->priv->instructions; item; item = g_slist_next(item))
+	if (!expression->priv->bytecode || expression->priv->bytecode_dirty)
 	{
-		cdn_instruction_execute (item->data, stack);
+		bytecode_compile (expression);
 	}
 
-	if (cdn_debug_is_enabled (CDN_DEBUG_MATH))
+	if (expression->priv->bytecode_scalar && !profile)
 	{
-		cdn_debug_pop_indent ();
-	}
+		gdouble regs[BYTECODE_SCALAR_REGISTERS];
 
-	if (cdn_stack_count (&(expression->priv->output)) !=
-	    cdn_dimension_size (&expression->priv->retdim.dimension))
-	{
-		g_warning ("Invalid output stack after evaluating: `%s' (expected %d but got %d)",
-		           expression->priv->expression,
-		           cdn_dimension_size (&expression->priv->retdim.dimension),
-		           cdn_stack_count (&(expression->priv->output)));
+		// The stack depth was verified when compiling, there is no
+		// need to check the output
+		bytecode_run_scalar (expression->priv->bytecode,
+		                     expression->priv->bytecode + expression->priv->bytecode_size,
+		                     regs);
 
-		return NULL;
+		if (cdn_debug_is_enabled (CDN_DEBUG_MATH))
+		{
+			cdn_debug_pop_indent ();
+		}
+
+		set_values (expression, regs, cdn_dimension_onep);
+		expression->priv->cached = expression->priv->has_cache;
 	}
+	else
+	{
+		if (G_UNLIKELY (profile))
+		{
+			bytecode_execute_profiled (expression, stack);
+		}
+		else
+		{
+			bytecode_execute (expression, stack);
+		}
 
-	set_cache_from_stack (expression);
-	expression->priv->cached = expression->priv->has_cache;
+		if (cdn_debug_is_enabled (CDN_DEBUG_MATH))
+		{
+			cdn_debug_pop_indent ();
+		}
+
+		if (cdn_stack_count (&(expression->priv->output)) !=
+		    cdn_dimension_size (&expression->priv->retdim.dimension))
+		{
+			g_warning ("Invalid output stack after evaluating: `%s' (expected %d but got %d)",
+			           expression->priv->expression,
+			           cdn_dimension_size (&expression->priv->retdim.dimension),
+			           cdn_stack_count (&(expression->priv->output)));
+
+			return NULL;
+		}
+
+		set_cache_from_stack (expression);
+		expression->priv->cached = expression->priv->has_cache;
+	}
 
 	if (cdn_debug_is_enabled (CDN_DEBUG_MATH))
 	{
@@ -5896,6 +7027,61 @@ cdn_expression_evaluate_values (CdnExpression *expression)
 	return &expression->priv->cached_output;
 }
 
+static CdnMatrix const *
+evaluate_values_profiled (CdnExpression *expression)
+{
+	CdnMatrix const *ret;
+
+	if (!expression->priv->profile)
+	{
+		expression->priv->profile = _cdn_profile_entry_new (expression);
+	}
+
+	_cdn_profile_begin (expression->priv->profile);
+	ret = evaluate_values (expression, TRUE);
+	_cdn_profile_end (expression->priv->profile);
+
+	return ret;
+}
+
+/**
+ * cdn_expression_evaluate_values:
+ * @expression: a #CdnExpression
+ *
+ * Evaluate the given expression and return its value as a matrix. Note that
+ * values are always cached in expressions, and this function thus returns
+ * an internal reference to the resulting matrix.
+ *
+ * Returns: (transfer none): the result of evaluating the expression
+ *
+ */
+CdnMatrix const *
+cdn_expression_evaluate_values (CdnExpression *expression)
+{
+	/* Omit type check to increase speed */
+	if (!expression)
+	{
+		return NULL;
+	}
+
+	if (is_cached (expression))
+	{
+		if (G_UNLIKELY (expression->priv->profile))
+		{
+			_cdn_profile_hit (expression->priv->profile);
+		}
+
+		return &expression->priv->cached_output;
+	}
+
+	if (G_UNLIKELY (cdn_profile_get_enabled ()))
+	{
+		return evaluate_values_profiled (expression);
+	}
+
+	return evaluate_values (expression, FALSE);
+}
+
 static gboolean
 reset_cache (CdnExpression *expression,
              gboolean       dimschanged)
@@ -5906,7 +7092,7 @@ reset_cache (CdnExpression *expression,
 	}
 
 	/* Omit type check to increase speed */
-	if (expression->priv->cached || dimschanged)
+	if (is_cached (expression) || dimschanged)
 	{
 		// Disable the cache, next evaluate will recalculate the
 		// expression
@@ -5921,6 +7107,20 @@ reset_cache (CdnExpression *expression,
 	return FALSE;
 }
 
+static void
+program_invalidate (CdnExpressionProgram *program)
+{
+	GSList *item;
+
+	++program->stamp;
+
+	// Expressions outside of the program still rely on being reset
+	for (item = program->boundary; item; item = g_slist_next (item))
+	{
+		reset_cache (item->data, FALSE);
+	}
+}
+
 /**
  * cdn_expression_reset_cache:
  * @expression: a #CdnExpression
@@ -6084,6 +7284,11 @@ cdn_expression_reset (CdnExpression *expression)
 
 	/* Omit type check to increase speed */
 	expression->priv->prevent_cache_reset = FALSE;
+	expression->priv->values_set = FALSE;
+
+	// Recompile the bytecode on the next evaluation in case the
+	// instructions were modified in place
+	bytecode_free (expression);
 
 	// Reset the cache to go back to original settings
 	reset_cache (expression,
@@ -6289,6 +7494,11 @@ cdn_expression_copy (CdnExpression *expression)
 	ret->priv->has_cache = expression->priv->has_cache;
 	ret->priv->once = expression->priv->once;
 
+	ret->priv->line_start = expression->priv->line_start;
+	ret->priv->line_end = expression->priv->line_end;
+	ret->priv->column_start = expression->priv->column_start;
+	ret->priv->column_end = expression->priv->column_end;
+
 	instr = expression->priv->instructions;
 
 	while (instr)
@@ -6492,7 +7702,7 @@ cdn_expression_get_stack_size (CdnExpression *expression)
 gboolean
 cdn_expression_is_cached (CdnExpression *expression)
 {
-	return expression->priv->cached;
+	return is_cached (expression);
 }
 
 /**
@@ -6519,6 +7729,10 @@ _cdn_expression_transfer_dependencies (CdnExpression *expression,
 	g_return_if_fail (CDN_IS_EXPRESSION (expression));
 	g_return_if_fail (transfer_to == NULL || CDN_IS_EXPRESSION (transfer_to));
 
+	// The expressions depending on @expression might have been compiled
+	// against its sparsity
+	sparsity_invalidate (expression);
+
 	// Transfer dependencies from other expressions on @expression to
 	// dependencies on @transfer_to
 	for (item = expression->priv->depends_on_me; item; item = g_slist_next (item))
@@ -6554,6 +7768,330 @@ _cdn_expression_transfer_dependencies (CdnExpression *expression,
 	}
 }
 
+CdnExpressionProgram *
+_cdn_expression_program_new (GSList const *expressions)
+{
+	CdnExpressionProgram *ret;
+	GSList const *item;
+	guint i;
+
+	ret = g_slice_new0 (CdnExpressionProgram);
+
+	ret->num_expressions = g_slist_length ((GSList *)expressions);
+	ret->expressions = g_new (CdnExpression *, ret->num_expressions);
+
+	for (i = 0, item = expressions; item; item = g_slist_next (item), ++i)
+	{
+		CdnExpression *expr = item->data;
+
+		ret->expressions[i] = g_object_ref (expr);
+
+		expr->priv->program = ret;
+		expr->priv->program_stamp = ret->stamp;
+	}
+
+	for (i = 0; i < ret->num_expressions; ++i)
+	{
+		CdnExpression *expr = ret->expressions[i];
+
+		for (item = expr->priv->depends_on_me; item; item = g_slist_next (item))
+		{
+			CdnExpression *other = item->data;
+
+			if (other->priv->program != ret)
+			{
+				ret->boundary = g_slist_prepend (ret->boundary,
+				                                 other);
+			}
+		}
+	}
+
+	// Members may have been cached before, make sure they are all dirty
+	program_invalidate (ret);
+	return ret;
+}
+
+void
+_cdn_expression_program_free (CdnExpressionProgram *program)
+{
+	guint i;
+
+	if (!program)
+	{
+		return;
+	}
+
+	for (i = 0; i < program->num_expressions; ++i)
+	{
+		CdnExpression *expr = program->expressions[i];
+
+		if (expr->priv->program == program)
+		{
+			expr->priv->program = NULL;
+
+			// Go back to invalidating through the dependencies
+			expr->priv->cached = FALSE;
+			reset_depending_cache (expr, FALSE);
+		}
+
+		g_object_unref (expr);
+	}
+
+	g_free (program->expressions);
+	g_slist_free (program->boundary);
+
+	g_slice_free (CdnExpressionProgram, program);
+}
+
+static void
+program_evaluate_member (CdnExpression *expression)
+{
+	CdnStack *stack;
+
+	// Values which are set explicitly are left alone, except for
+	// expressions which compute their own value on evaluation
+	if (expression->priv->evaluate_notify ||
+	    cdn_debug_is_enabled (CDN_DEBUG_MATH) ||
+	    cdn_profile_get_enabled ())
+	{
+		cdn_expression_evaluate_values (expression);
+		return;
+	}
+
+	if (expression->priv->prevent_cache_reset ||
+	    !expression->priv->instructions)
+	{
+		return;
+	}
+
+	if (!expression->priv->bytecode || expression->priv->bytecode_dirty)
+	{
+		bytecode_compile (expression);
+	}
+
+	stack = &(expression->priv->output);
+
+	if (expression->priv->bytecode_scalar &&
+	    cdn_dimension_is_one (&expression->priv->cached_output.dimension))
+	{
+		gdouble regs[BYTECODE_SCALAR_REGISTERS];
+
+		bytecode_run_scalar (expression->priv->bytecode,
+		                     expression->priv->bytecode + expression->priv->bytecode_size,
+		                     regs);
+
+		// Keep the result at the bottom of the stack, where it is
+		// expected to be found in the arena
+		*cdn_stack_ptr (stack) = regs[0];
+		expression->priv->cached_output.value = regs[0];
+
+		if (expression->priv->storage)
+		{
+			*expression->priv->storage = regs[0];
+		}
+
+		expression->priv->cached = expression->priv->has_cache;
+		expression->priv->program_stamp = expression->priv->program->stamp;
+		return;
+	}
+
+	cdn_stack_reset (stack);
+	bytecode_execute (expression, stack);
+
+	if (cdn_stack_count (stack) !=
+	    cdn_dimension_size (&expression->priv->retdim.dimension) ||
+	    !cdn_dimension_equal (&expression->priv->cached_output.dimension,
+	                          &expression->priv->retdim.dimension))
+	{
+		// Let the generic path deal with errors and dimension changes
+		cdn_expression_evaluate_values (expression);
+		return;
+	}
+
+	// Members are evaluated in dependency order, so there is no need to
+	// reset anything that depends on the new value here
+	set_cached_output (expression,
+	                   cdn_stack_ptr (stack),
+	                   &expression->priv->retdim.dimension);
+
+	expression->priv->cached = expression->priv->has_cache;
+	expression->priv->program_stamp = expression->priv->program->stamp;
+}
+
+void
+_cdn_expression_program_evaluate (CdnExpressionProgram *program)
+{
+	CdnExpression **expr;
+	CdnExpression **end;
+
+	program_invalidate (program);
+
+	end = program->expressions + program->num_expressions;
+
+	for (expr = program->expressions; expr < end; ++expr)
+	{
+		program_evaluate_member (*expr);
+	}
+}
+
+void
+_cdn_expression_set_profile (CdnExpression   *expression,
+                             CdnProfileEntry *entry)
+{
+	expression->priv->profile = entry;
+}
+
+/*
+ * _cdn_expression_set_arena:
+ * @expression: a #CdnExpression
+ * @storage: (allow-none): memory for the evaluation stack
+ *
+ * Use @storage, which must hold at least #cdn_expression_get_stack_size
+ * values, for the evaluation stack of @expression instead of its own memory.
+ * After each evaluation the bottom of the stack contains the value of the
+ * expression. Values which are set explicitly are copied there as well,
+ * so @storage always reflects the cached value. Use %NULL for @storage to
+ * move the stack back to its own memory.
+ *
+ * If the expression is recompiled with a different stack size, it
+ * automatically falls back to its own memory.
+ */
+void
+_cdn_expression_set_arena (CdnExpression *expression,
+                           gdouble       *storage)
+{
+	CdnStack *stack;
+	guint size;
+
+	stack = &(expression->priv->output);
+
+	if (!storage)
+	{
+		_cdn_stack_unborrow (stack);
+		return;
+	}
+
+	size = cdn_stack_size (stack);
+	_cdn_stack_borrow (stack, storage, size);
+
+	size = MIN (size, cdn_matrix_size (&expression->priv->cached_output));
+
+	memcpy (storage,
+	        cdn_matrix_get (&expression->priv->cached_output),
+	        sizeof (gdouble) * size);
+}
+
+/*
+ * _cdn_expression_get_arena:
+ * @expression: a #CdnExpression
+ *
+ * Get the memory set with #_cdn_expression_set_arena.
+ *
+ * Returns: the arena memory of @expression, or %NULL if the expression
+ *          does not (or no longer) use an arena
+ */
+gdouble *
+_cdn_expression_get_arena (CdnExpression *expression)
+{
+	if (!_cdn_stack_is_borrowed (&expression->priv->output))
+	{
+		return NULL;
+	}
+
+	return cdn_stack_ptr (&expression->priv->output);
+}
+
+/*
+ * _cdn_expression_load_arena:
+ * @expression: a #CdnExpression
+ *
+ * Reload the cached value of @expression from its arena memory, for example
+ * after the arena has been restored from a snapshot. This does not change
+ * whether the expression is considered to be cached.
+ */
+void
+_cdn_expression_load_arena (CdnExpression *expression)
+{
+	CdnDimension dim;
+	gdouble *storage;
+
+	storage = _cdn_expression_get_arena (expression);
+	dim = expression->priv->cached_output.dimension;
+
+	if (!storage ||
+	    cdn_dimension_size (&dim) > cdn_stack_size (&expression->priv->output))
+	{
+		return;
+	}
+
+	set_cached_output (expression, storage, &dim);
+}
+
+/*
+ * _cdn_expression_set_storage:
+ * @expression: a #CdnExpression
+ * @storage: (allow-none): memory for the value
+ *
+ * Use @storage, which must hold as many values as the current value of
+ * @expression, as the memory of the cached value of @expression. The
+ * current value is copied into @storage, and values which are set or
+ * evaluated later are stored there directly. Use %NULL for @storage to
+ * move the value back to its own memory.
+ *
+ * If the value of @expression changes dimension, it automatically falls
+ * back to its own memory. Use #_cdn_expression_get_storage to check whether
+ * @storage is still in use.
+ */
+void
+_cdn_expression_set_storage (CdnExpression *expression,
+                             gdouble       *storage)
+{
+	CdnMatrix *cached = &expression->priv->cached_output;
+	guint size;
+
+	if (storage == expression->priv->storage)
+	{
+		return;
+	}
+
+	size = cdn_matrix_size (cached);
+
+	if (expression->priv->storage && size > 1)
+	{
+		cached->values = g_memdup (cached->values, sizeof (gdouble) * size);
+	}
+
+	expression->priv->storage = storage;
+
+	if (!storage)
+	{
+		return;
+	}
+
+	memcpy (storage, cdn_matrix_get (cached), sizeof (gdouble) * size);
+
+	if (size > 1)
+	{
+		g_free (cached->values);
+		cached->values = storage;
+	}
+}
+
+/*
+ * _cdn_expression_get_storage:
+ * @expression: a #CdnExpression
+ *
+ * Get the memory set with #_cdn_expression_set_storage.
+ *
+ * Returns: the storage of @expression, or %NULL if the expression does not
+ *          (or no longer) use external storage
+ */
+gdouble *
+_cdn_expression_get_storage (CdnExpression *expression)
+{
+	return expression->priv->storage;
+}
+
 /**
  * cdn_expression_sum:
  * @expressions: (element-type CdnExpression): a #GSList of #CdnExpression.
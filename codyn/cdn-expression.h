@@ -44,6 +44,8 @@ G_BEGIN_DECLS
 typedef struct _CdnExpression		CdnExpression;
 typedef struct _CdnExpressionClass	CdnExpressionClass;
 typedef struct _CdnExpressionPrivate	CdnExpressionPrivate;
+typedef struct _CdnExpressionProgram	CdnExpressionProgram;
+typedef struct _CdnProfileEntry		CdnProfileEntry;
 
 typedef void (*CdnExpressionCacheNotify) (CdnExpression *expression,
                                           gpointer       userdata);
@@ -162,6 +164,23 @@ guint          cdn_expression_get_stack_size   (CdnExpression       *expression)
 void          _cdn_expression_transfer_dependencies (CdnExpression *expression,
                                                      CdnExpression *transfer_to);
 
+CdnExpressionProgram *
+              _cdn_expression_program_new      (GSList const         *expressions);
+void          _cdn_expression_program_free     (CdnExpressionProgram *program);
+void          _cdn_expression_program_evaluate (CdnExpressionProgram *program);
+
+void          _cdn_expression_set_profile      (CdnExpression        *expression,
+                                                CdnProfileEntry      *entry);
+
+void          _cdn_expression_set_arena        (CdnExpression        *expression,
+                                                gdouble              *storage);
+gdouble      *_cdn_expression_get_arena        (CdnExpression        *expression);
+void          _cdn_expression_load_arena       (CdnExpression        *expression);
+
+void          _cdn_expression_set_storage      (CdnExpression        *expression,
+                                                gdouble              *storage);
+gdouble      *_cdn_expression_get_storage      (CdnExpression        *expression);
+
 CdnExpression *cdn_expression_sum                (GSList const *expressions);
 
 G_END_DECLS
@@ -49,6 +49,9 @@ ensure_defaults ()
 		cdn_integrators_register (CDN_TYPE_INTEGRATOR_LEAP_FROG);
 		cdn_integrators_register (CDN_TYPE_INTEGRATOR_PREDICT_CORRECT);
 		cdn_integrators_register (CDN_TYPE_INTEGRATOR_RUNGE_KUTTA);
+		cdn_integrators_register (CDN_TYPE_INTEGRATOR_DORMAND_PRINCE);
+		cdn_integrators_register (CDN_TYPE_INTEGRATOR_ROSENBROCK);
+		cdn_integrators_register (CDN_TYPE_INTEGRATOR_YOSHIDA);
 
 		initing = FALSE;
 	}
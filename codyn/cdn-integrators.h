@@ -27,6 +27,9 @@
 #include <codyn/integrators/cdn-integrator-leap-frog.h>
 #include <codyn/integrators/cdn-integrator-predict-correct.h>
 #include <codyn/integrators/cdn-integrator-runge-kutta.h>
+#include <codyn/integrators/cdn-integrator-dormand-prince.h>
+#include <codyn/integrators/cdn-integrator-rosenbrock.h>
+#include <codyn/integrators/cdn-integrator-yoshida.h>
 
 G_BEGIN_DECLS
 
@@ -48,6 +48,16 @@ extern void dgesv_ (LP_int *,
                     LP_int *,
                     LP_int *);
 
+extern void dgetrs_ (char *,
+                     LP_int *,
+                     LP_int *,
+                     LP_double *,
+                     LP_int *,
+                     LP_int *,
+                     LP_double *,
+                     LP_int *,
+                     LP_int *);
+
 extern void dgeqrf_ (LP_int *,
                      LP_int *,
                      LP_double *,
@@ -247,6 +257,29 @@ op_linsolve (CdnStack           *stack,
 	cdn_stack_popn (stack, numa);
 }
 
+void
+linsolve_factorize (LP_double *lu,
+                    LP_int    *ipiv,
+                    LP_int     n)
+{
+	LP_int info;
+
+	dgetrf_ (&n, &n, lu, &n, ipiv, &info);
+}
+
+void
+linsolve_factorized (LP_double *lu,
+                     LP_int    *ipiv,
+                     LP_double *b,
+                     LP_int     n,
+                     LP_int     nrhs)
+{
+	LP_int info;
+	char trans = 'N';
+
+	dgetrs_ (&trans, &n, &nrhs, lu, &n, ipiv, b, &n, &info);
+}
+
 void
 op_qr (CdnStack           *stack,
        CdnStackArgs const *argdim,
@@ -50,6 +50,20 @@ LP_int qr_work_space             (CdnDimension const *dim);
 
 #endif
 
+#ifdef HAVE_LAPACK
+
+// LU factorization of the n-by-n matrix lu in place, and solving with it
+void   linsolve_factorize        (LP_double          *lu,
+                                  LP_int             *ipiv,
+                                  LP_int              n);
+void   linsolve_factorized       (LP_double          *lu,
+                                  LP_int             *ipiv,
+                                  LP_double          *b,
+                                  LP_int              n,
+                                  LP_int              nrhs);
+
+#endif
+
 #ifdef __cplusplus
 }
 #endif //__cplusplus
@@ -0,0 +1,571 @@
+/*
+ * cdn-math-simd.c
+ * This file is part of codyn
+ *
+ * Copyright (C) 2011 - Jesse van den Kieboom
+ *
+ * codyn is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * codyn is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with codyn; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor,
+ * Boston, MA  02110-1301  USA
+ */
+
+#ifdef HAVE_CONFIG_H
+#include <config.h>
+#endif
+
+#include <math.h>
+
+#include "cdn-math-simd.h"
+
+/*
+ * Element-wise kernels for the arithmetic and comparison operators. Every
+ * operator has a plain C implementation which is always available, and
+ * SSE2 and AVX2 implementations on x86. The implementation to use is
+ * selected once, at runtime, based on what the cpu supports. The
+ * CDN_MATH_SIMD environment variable (none, sse2 or avx2) can be used to
+ * restrict the selection.
+ *
+ * The vector implementations compute exactly the same results as the
+ * scalar ones in cdn-math.c (including the handling of NaN), so the
+ * selected level never changes the outcome of a simulation.
+ *
+ * The kernels may be called with @out overlapping the input, as long as
+ * @out does not start after the input (all the kernels load a block before
+ * storing it).
+ */
+
+#if defined (__GNUC__) && (defined (__x86_64__) || (defined (__i386__) && defined (__SSE2__)))
+#define CDN_MATH_SIMD_X86 1
+#include <immintrin.h>
+#endif
+
+#define EQUAL_EPSILON 10e-12
+
+typedef void (*BinaryKernel) (gdouble       *out,
+                              gdouble const *a,
+                              gdouble const *b,
+                              gint           n);
+
+typedef void (*UnaryKernel) (gdouble *ptr,
+                             gint     n);
+
+typedef void (*AxpyKernel) (gdouble       *y,
+                            gdouble        a,
+                            gdouble const *x,
+                            gint           n);
+
+typedef struct
+{
+	BinaryKernel vv;
+	BinaryKernel vs;
+	BinaryKernel sv;
+} BinaryKernels;
+
+static BinaryKernels binary_kernels[CDN_MATH_SIMD_NUM_BINARY];
+static UnaryKernel unary_kernels[CDN_MATH_SIMD_NUM_UNARY];
+static AxpyKernel axpy_kernel;
+
+static CdnMathSimdLevel simd_level;
+static gsize simd_initialized = 0;
+
+#define BINARY_OPS(X)						\
+	X (PLUS, plus)						\
+	X (MINUS, minus)					\
+	X (MULTIPLY, multiply)					\
+	X (DIVIDE, divide)					\
+	X (MIN, min)						\
+	X (MAX, max)						\
+	X (GREATER, greater)					\
+	X (LESS, less)						\
+	X (GREATER_OR_EQUAL, greater_or_equal)			\
+	X (LESS_OR_EQUAL, less_or_equal)			\
+	X (EQUAL, equal)					\
+	X (NEQUAL, nequal)					\
+	X (OR, or)						\
+	X (AND, and)
+
+#define VECTOR_UNARY_OPS(X)					\
+	X (UNARY_MINUS, unary_minus)				\
+	X (ABS, abs)						\
+	X (SQRT, sqrt)						\
+	X (INVSQRT, invsqrt)					\
+	X (NEGATE, negate)
+
+#define UNARY_OPS(X)						\
+	VECTOR_UNARY_OPS (X)					\
+	X (FLOOR, floor)					\
+	X (CEIL, ceil)
+
+/* Scalar reference implementations, these match cdn-math.c */
+#define S_PLUS(a, b)			((a) + (b))
+#define S_MINUS(a, b)			((a) - (b))
+#define S_MULTIPLY(a, b)		((a) * (b))
+#define S_DIVIDE(a, b)			((a) / (b))
+#define S_MIN(a, b)			((a) < (b) ? (a) : (b))
+#define S_MAX(a, b)			((a) > (b) ? (a) : (b))
+#define S_GREATER(a, b)			((a) > (b) ? 1.0 : 0.0)
+#define S_LESS(a, b)			((a) < (b) ? 1.0 : 0.0)
+#define S_GREATER_OR_EQUAL(a, b)	((a) >= (b) ? 1.0 : 0.0)
+#define S_LESS_OR_EQUAL(a, b)		((a) <= (b) ? 1.0 : 0.0)
+#define S_EQUAL(a, b)			(fabs ((a) - (b)) < EQUAL_EPSILON ? 1.0 : 0.0)
+#define S_NEQUAL(a, b)			(fabs ((a) - (b)) >= EQUAL_EPSILON ? 1.0 : 0.0)
+#define S_NONZERO(a)			(!(fabs (a) < EQUAL_EPSILON))
+#define S_OR(a, b)			((S_NONZERO (a) || S_NONZERO (b)) ? 1.0 : 0.0)
+#define S_AND(a, b)			((S_NONZERO (a) && S_NONZERO (b)) ? 1.0 : 0.0)
+
+#define S_UNARY_MINUS(a)		(-1 * (a))
+#define S_ABS(a)			fabs (a)
+#define S_SQRT(a)			sqrt (a)
+#define S_INVSQRT(a)			(1.0 / sqrt (a))
+#define S_FLOOR(a)			floor (a)
+#define S_CEIL(a)			ceil (a)
+#define S_NEGATE(a)			(fabs (a) < EQUAL_EPSILON ? 1.0 : 0.0)
+
+#define SCALAR_BINARY_KERNELS(name, OP)					\
+static void									\
+kernel_##name##_vv_scalar (gdouble       *out,				\
+                           gdouble const *a,				\
+                           gdouble const *b,				\
+                           gint           n)				\
+{										\
+	gint i;									\
+										\
+	for (i = 0; i < n; ++i)							\
+	{									\
+		out[i] = OP (a[i], b[i]);					\
+	}									\
+}										\
+										\
+static void									\
+kernel_##name##_vs_scalar (gdouble       *out,				\
+                           gdouble const *a,				\
+                           gdouble const *b,				\
+                           gint           n)				\
+{										\
+	gdouble s = b[0];							\
+	gint i;									\
+										\
+	for (i = 0; i < n; ++i)							\
+	{									\
+		out[i] = OP (a[i], s);						\
+	}									\
+}										\
+										\
+static void									\
+kernel_##name##_sv_scalar (gdouble       *out,				\
+                           gdouble const *a,				\
+                           gdouble const *b,				\
+                           gint           n)				\
+{										\
+	gdouble s = a[0];							\
+	gint i;									\
+										\
+	for (i = 0; i < n; ++i)							\
+	{									\
+		out[i] = OP (s, b[i]);						\
+	}									\
+}
+
+#define SCALAR_UNARY_KERNEL(name, OP)						\
+static void									\
+kernel_##name##_scalar (gdouble *ptr,						\
+                        gint     n)						\
+{										\
+	gint i;									\
+										\
+	for (i = 0; i < n; ++i)							\
+	{									\
+		ptr[i] = OP (ptr[i]);						\
+	}									\
+}
+
+#define DEFINE_SCALAR_BINARY(OP, name) SCALAR_BINARY_KERNELS (name, S_##OP)
+#define DEFINE_SCALAR_UNARY(OP, name) SCALAR_UNARY_KERNEL (name, S_##OP)
+
+BINARY_OPS (DEFINE_SCALAR_BINARY)
+UNARY_OPS (DEFINE_SCALAR_UNARY)
+
+static void
+kernel_axpy_scalar (gdouble       *y,
+                    gdouble        a,
+                    gdouble const *x,
+                    gint           n)
+{
+	gint i;
+
+	for (i = 0; i < n; ++i)
+	{
+		y[i] += a * x[i];
+	}
+}
+
+#ifdef CDN_MATH_SIMD_X86
+
+#define VECTOR_BINARY_KERNELS(name, suffix, attr, vtype, width, load, store, set1, VOP, OP) \
+static attr void								\
+kernel_##name##_vv_##suffix (gdouble       *out,				\
+                             gdouble const *a,				\
+                             gdouble const *b,				\
+                             gint           n)				\
+{										\
+	gint i = 0;								\
+										\
+	for (; i + width <= n; i += width)					\
+	{									\
+		vtype x = load (a + i);						\
+		vtype y = load (b + i);						\
+										\
+		store (out + i, VOP (x, y));					\
+	}									\
+										\
+	for (; i < n; ++i)							\
+	{									\
+		out[i] = OP (a[i], b[i]);					\
+	}									\
+}										\
+										\
+static attr void								\
+kernel_##name##_vs_##suffix (gdouble       *out,				\
+                             gdouble const *a,				\
+                             gdouble const *b,				\
+                             gint           n)				\
+{										\
+	gdouble s = b[0];							\
+	vtype y = set1 (s);							\
+	gint i = 0;								\
+										\
+	for (; i + width <= n; i += width)					\
+	{									\
+		vtype x = load (a + i);						\
+										\
+		store (out + i, VOP (x, y));					\
+	}									\
+										\
+	for (; i < n; ++i)							\
+	{									\
+		out[i] = OP (a[i], s);						\
+	}									\
+}										\
+										\
+static attr void								\
+kernel_##name##_sv_##suffix (gdouble       *out,				\
+                             gdouble const *a,				\
+                             gdouble const *b,				\
+                             gint           n)				\
+{										\
+	gdouble s = a[0];							\
+	vtype x = set1 (s);							\
+	gint i = 0;								\
+										\
+	for (; i + width <= n; i += width)					\
+	{									\
+		vtype y = load (b + i);						\
+										\
+		store (out + i, VOP (x, y));					\
+	}									\
+										\
+	for (; i < n; ++i)							\
+	{									\
+		out[i] = OP (s, b[i]);						\
+	}									\
+}
+
+#define VECTOR_UNARY_KERNEL(name, suffix, attr, vtype, width, load, store, VOP, OP) \
+static attr void								\
+kernel_##name##_##suffix (gdouble *ptr,						\
+                          gint     n)						\
+{										\
+	gint i = 0;								\
+										\
+	for (; i + width <= n; i += width)					\
+	{									\
+		vtype x = load (ptr + i);					\
+										\
+		store (ptr + i, VOP (x));					\
+	}									\
+										\
+	for (; i < n; ++i)							\
+	{									\
+		ptr[i] = OP (ptr[i]);						\
+	}									\
+}
+
+/* Multiply and add are kept separate (no fma) to match the scalar kernel */
+#define VECTOR_AXPY_KERNEL(suffix, attr, vtype, width, load, store, set1, add, mul) \
+static attr void								\
+kernel_axpy_##suffix (gdouble       *y,					\
+                      gdouble        a,					\
+                      gdouble const *x,					\
+                      gint           n)					\
+{										\
+	vtype va = set1 (a);							\
+	gint i = 0;								\
+										\
+	for (; i + width <= n; i += width)					\
+	{									\
+		store (y + i, add (load (y + i), mul (va, load (x + i))));	\
+	}									\
+										\
+	for (; i < n; ++i)							\
+	{									\
+		y[i] += a * x[i];						\
+	}									\
+}
+
+/* SSE2, two doubles at a time */
+#define V2_BOOL(m)			_mm_and_pd ((m), _mm_set1_pd (1.0))
+#define V2_ABS(x)			_mm_andnot_pd (_mm_set1_pd (-0.0), (x))
+#define V2_EPSILON			_mm_set1_pd (EQUAL_EPSILON)
+#define V2_NONZERO(x)			_mm_cmpnlt_pd (V2_ABS (x), V2_EPSILON)
+
+#define V2_PLUS(x, y)			_mm_add_pd ((x), (y))
+#define V2_MINUS(x, y)			_mm_sub_pd ((x), (y))
+#define V2_MULTIPLY(x, y)		_mm_mul_pd ((x), (y))
+#define V2_DIVIDE(x, y)			_mm_div_pd ((x), (y))
+#define V2_MIN(x, y)			_mm_min_pd ((x), (y))
+#define V2_MAX(x, y)			_mm_max_pd ((x), (y))
+#define V2_GREATER(x, y)		V2_BOOL (_mm_cmpgt_pd ((x), (y)))
+#define V2_LESS(x, y)			V2_BOOL (_mm_cmplt_pd ((x), (y)))
+#define V2_GREATER_OR_EQUAL(x, y)	V2_BOOL (_mm_cmpge_pd ((x), (y)))
+#define V2_LESS_OR_EQUAL(x, y)		V2_BOOL (_mm_cmple_pd ((x), (y)))
+#define V2_EQUAL(x, y)			V2_BOOL (_mm_cmplt_pd (V2_ABS (_mm_sub_pd ((x), (y))), V2_EPSILON))
+#define V2_NEQUAL(x, y)			V2_BOOL (_mm_cmpge_pd (V2_ABS (_mm_sub_pd ((x), (y))), V2_EPSILON))
+#define V2_OR(x, y)			V2_BOOL (_mm_or_pd (V2_NONZERO (x), V2_NONZERO (y)))
+#define V2_AND(x, y)			V2_BOOL (_mm_and_pd (V2_NONZERO (x), V2_NONZERO (y)))
+
+#define V2_UNARY_MINUS(x)		_mm_mul_pd (_mm_set1_pd (-1.0), (x))
+#define V2_SQRT(x)			_mm_sqrt_pd (x)
+#define V2_INVSQRT(x)			_mm_div_pd (_mm_set1_pd (1.0), _mm_sqrt_pd (x))
+#define V2_NEGATE(x)			V2_BOOL (_mm_cmplt_pd (V2_ABS (x), V2_EPSILON))
+
+#define DEFINE_SSE2_BINARY(OP, name)						\
+	VECTOR_BINARY_KERNELS (name, sse2, , __m128d, 2,			\
+	                       _mm_loadu_pd, _mm_storeu_pd, _mm_set1_pd,	\
+	                       V2_##OP, S_##OP)
+
+#define DEFINE_SSE2_UNARY(OP, name)						\
+	VECTOR_UNARY_KERNEL (name, sse2, , __m128d, 2,				\
+	                     _mm_loadu_pd, _mm_storeu_pd,			\
+	                     V2_##OP, S_##OP)
+
+BINARY_OPS (DEFINE_SSE2_BINARY)
+VECTOR_UNARY_OPS (DEFINE_SSE2_UNARY)
+
+VECTOR_AXPY_KERNEL (sse2, , __m128d, 2,
+                    _mm_loadu_pd, _mm_storeu_pd, _mm_set1_pd,
+                    _mm_add_pd, _mm_mul_pd)
+
+/* AVX2, four doubles at a time */
+#define AVX2_FUNCTION __attribute__ ((target ("avx2")))
+
+#define V4_BOOL(m)			_mm256_and_pd ((m), _mm256_set1_pd (1.0))
+#define V4_ABS(x)			_mm256_andnot_pd (_mm256_set1_pd (-0.0), (x))
+#define V4_EPSILON			_mm256_set1_pd (EQUAL_EPSILON)
+#define V4_NONZERO(x)			_mm256_cmp_pd (V4_ABS (x), V4_EPSILON, _CMP_NLT_UQ)
+
+#define V4_PLUS(x, y)			_mm256_add_pd ((x), (y))
+#define V4_MINUS(x, y)			_mm256_sub_pd ((x), (y))
+#define V4_MULTIPLY(x, y)		_mm256_mul_pd ((x), (y))
+#define V4_DIVIDE(x, y)			_mm256_div_pd ((x), (y))
+#define V4_MIN(x, y)			_mm256_min_pd ((x), (y))
+#define V4_MAX(x, y)			_mm256_max_pd ((x), (y))
+#define V4_GREATER(x, y)		V4_BOOL (_mm256_cmp_pd ((x), (y), _CMP_GT_OQ))
+#define V4_LESS(x, y)			V4_BOOL (_mm256_cmp_pd ((x), (y), _CMP_LT_OQ))
+#define V4_GREATER_OR_EQUAL(x, y)	V4_BOOL (_mm256_cmp_pd ((x), (y), _CMP_GE_OQ))
+#define V4_LESS_OR_EQUAL(x, y)		V4_BOOL (_mm256_cmp_pd ((x), (y), _CMP_LE_OQ))
+#define V4_EQUAL(x, y)			V4_BOOL (_mm256_cmp_pd (V4_ABS (_mm256_sub_pd ((x), (y))), V4_EPSILON, _CMP_LT_OQ))
+#define V4_NEQUAL(x, y)			V4_BOOL (_mm256_cmp_pd (V4_ABS (_mm256_sub_pd ((x), (y))), V4_EPSILON, _CMP_GE_OQ))
+#define V4_OR(x, y)			V4_BOOL (_mm256_or_pd (V4_NONZERO (x), V4_NONZERO (y)))
+#define V4_AND(x, y)			V4_BOOL (_mm256_and_pd (V4_NONZERO (x), V4_NONZERO (y)))
+
+#define V4_UNARY_MINUS(x)		_mm256_mul_pd (_mm256_set1_pd (-1.0), (x))
+#define V4_SQRT(x)			_mm256_sqrt_pd (x)
+#define V4_INVSQRT(x)			_mm256_div_pd (_mm256_set1_pd (1.0), _mm256_sqrt_pd (x))
+#define V4_NEGATE(x)			V4_BOOL (_mm256_cmp_pd (V4_ABS (x), V4_EPSILON, _CMP_LT_OQ))
+#define V4_FLOOR(x)			_mm256_floor_pd (x)
+#define V4_CEIL(x)			_mm256_ceil_pd (x)
+
+#define DEFINE_AVX2_BINARY(OP, name)						\
+	VECTOR_BINARY_KERNELS (name, avx2, AVX2_FUNCTION, __m256d, 4,		\
+	                       _mm256_loadu_pd, _mm256_storeu_pd, _mm256_set1_pd,	\
+	                       V4_##OP, S_##OP)
+
+#define DEFINE_AVX2_UNARY(OP, name)						\
+	VECTOR_UNARY_KERNEL (name, avx2, AVX2_FUNCTION, __m256d, 4,		\
+	                     _mm256_loadu_pd, _mm256_storeu_pd,			\
+	                     V4_##OP, S_##OP)
+
+BINARY_OPS (DEFINE_AVX2_BINARY)
+UNARY_OPS (DEFINE_AVX2_UNARY)
+
+VECTOR_AXPY_KERNEL (avx2, AVX2_FUNCTION, __m256d, 4,
+                    _mm256_loadu_pd, _mm256_storeu_pd, _mm256_set1_pd,
+                    _mm256_add_pd, _mm256_mul_pd)
+
+#endif /* CDN_MATH_SIMD_X86 */
+
+#define REGISTER_BINARY(OP, name, suffix)					\
+	binary_kernels[CDN_MATH_SIMD_##OP].vv = kernel_##name##_vv_##suffix;	\
+	binary_kernels[CDN_MATH_SIMD_##OP].vs = kernel_##name##_vs_##suffix;	\
+	binary_kernels[CDN_MATH_SIMD_##OP].sv = kernel_##name##_sv_##suffix;
+
+#define REGISTER_UNARY(OP, name, suffix)					\
+	unary_kernels[CDN_MATH_SIMD_##OP] = kernel_##name##_##suffix;
+
+#define REGISTER_SCALAR_BINARY(OP, name) REGISTER_BINARY (OP, name, scalar)
+#define REGISTER_SCALAR_UNARY(OP, name) REGISTER_UNARY (OP, name, scalar)
+#define REGISTER_SSE2_BINARY(OP, name) REGISTER_BINARY (OP, name, sse2)
+#define REGISTER_SSE2_UNARY(OP, name) REGISTER_UNARY (OP, name, sse2)
+#define REGISTER_AVX2_BINARY(OP, name) REGISTER_BINARY (OP, name, avx2)
+#define REGISTER_AVX2_UNARY(OP, name) REGISTER_UNARY (OP, name, avx2)
+
+static void
+install_kernels (CdnMathSimdLevel level)
+{
+	BINARY_OPS (REGISTER_SCALAR_BINARY)
+	UNARY_OPS (REGISTER_SCALAR_UNARY)
+	axpy_kernel = kernel_axpy_scalar;
+
+#ifdef CDN_MATH_SIMD_X86
+	if (level >= CDN_MATH_SIMD_LEVEL_SSE2)
+	{
+		BINARY_OPS (REGISTER_SSE2_BINARY)
+		VECTOR_UNARY_OPS (REGISTER_SSE2_UNARY)
+		axpy_kernel = kernel_axpy_sse2;
+	}
+
+	if (level >= CDN_MATH_SIMD_LEVEL_AVX2)
+	{
+		BINARY_OPS (REGISTER_AVX2_BINARY)
+		UNARY_OPS (REGISTER_AVX2_UNARY)
+		axpy_kernel = kernel_axpy_avx2;
+	}
+#endif
+}
+
+static CdnMathSimdLevel
+detect_level (void)
+{
+#ifdef CDN_MATH_SIMD_X86
+	__builtin_cpu_init ();
+
+	if (__builtin_cpu_supports ("avx2"))
+	{
+		return CDN_MATH_SIMD_LEVEL_AVX2;
+	}
+
+	if (__builtin_cpu_supports ("sse2"))
+	{
+		return CDN_MATH_SIMD_LEVEL_SSE2;
+	}
+#endif
+
+	return CDN_MATH_SIMD_LEVEL_NONE;
+}
+
+static void
+ensure_kernels (void)
+{
+	if (g_once_init_enter (&simd_initialized))
+	{
+		CdnMathSimdLevel level;
+		gchar const *env;
+
+		level = detect_level ();
+		env = g_getenv ("CDN_MATH_SIMD");
+
+		if (env != NULL)
+		{
+			if (g_ascii_strcasecmp (env, "none") == 0)
+			{
+				level = CDN_MATH_SIMD_LEVEL_NONE;
+			}
+			else if (g_ascii_strcasecmp (env, "sse2") == 0)
+			{
+				level = MIN (level, CDN_MATH_SIMD_LEVEL_SSE2);
+			}
+		}
+
+		install_kernels (level);
+		simd_level = level;
+
+		g_once_init_leave (&simd_initialized, 1);
+	}
+}
+
+/*
+ * _cdn_math_simd_get_level:
+ *
+ * Get the instruction set used by the element-wise kernels.
+ *
+ * Returns: a #CdnMathSimdLevel
+ */
+CdnMathSimdLevel
+_cdn_math_simd_get_level (void)
+{
+	ensure_kernels ();
+	return simd_level;
+}
+
+void
+_cdn_math_simd_binary_vv (CdnMathSimdBinary  op,
+                          gdouble           *out,
+                          gdouble const     *a,
+                          gdouble const     *b,
+                          gint               n)
+{
+	ensure_kernels ();
+	binary_kernels[op].vv (out, a, b, n);
+}
+
+void
+_cdn_math_simd_binary_vs (CdnMathSimdBinary  op,
+                          gdouble           *out,
+                          gdouble const     *a,
+                          gdouble const     *b,
+                          gint               n)
+{
+	ensure_kernels ();
+	binary_kernels[op].vs (out, a, b, n);
+}
+
+void
+_cdn_math_simd_binary_sv (CdnMathSimdBinary  op,
+                          gdouble           *out,
+                          gdouble const     *a,
+                          gdouble const     *b,
+                          gint               n)
+{
+	ensure_kernels ();
+	binary_kernels[op].sv (out, a, b, n);
+}
+
+void
+_cdn_math_simd_unary (CdnMathSimdUnary  op,
+                      gdouble          *ptr,
+                      gint              n)
+{
+	ensure_kernels ();
+	unary_kernels[op] (ptr, n);
+}
+
+void
+_cdn_math_simd_axpy (gdouble       *y,
+                     gdouble        a,
+                     gdouble const *x,
+                     gint           n)
+{
+	ensure_kernels ();
+	axpy_kernel (y, a, x, n);
+}
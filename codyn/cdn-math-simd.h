@@ -0,0 +1,84 @@
+#ifndef __CDN_MATH_SIMD_H__
+#define __CDN_MATH_SIMD_H__
+
+#include <glib.h>
+
+G_BEGIN_DECLS
+
+typedef enum
+{
+	CDN_MATH_SIMD_LEVEL_NONE,
+	CDN_MATH_SIMD_LEVEL_SSE2,
+	CDN_MATH_SIMD_LEVEL_AVX2
+} CdnMathSimdLevel;
+
+typedef enum
+{
+	CDN_MATH_SIMD_BINARY_NONE = -1,
+	CDN_MATH_SIMD_PLUS,
+	CDN_MATH_SIMD_MINUS,
+	CDN_MATH_SIMD_MULTIPLY,
+	CDN_MATH_SIMD_DIVIDE,
+	CDN_MATH_SIMD_MIN,
+	CDN_MATH_SIMD_MAX,
+	CDN_MATH_SIMD_GREATER,
+	CDN_MATH_SIMD_LESS,
+	CDN_MATH_SIMD_GREATER_OR_EQUAL,
+	CDN_MATH_SIMD_LESS_OR_EQUAL,
+	CDN_MATH_SIMD_EQUAL,
+	CDN_MATH_SIMD_NEQUAL,
+	CDN_MATH_SIMD_OR,
+	CDN_MATH_SIMD_AND,
+	CDN_MATH_SIMD_NUM_BINARY
+} CdnMathSimdBinary;
+
+typedef enum
+{
+	CDN_MATH_SIMD_UNARY_NONE = -1,
+	CDN_MATH_SIMD_UNARY_MINUS,
+	CDN_MATH_SIMD_ABS,
+	CDN_MATH_SIMD_SQRT,
+	CDN_MATH_SIMD_INVSQRT,
+	CDN_MATH_SIMD_FLOOR,
+	CDN_MATH_SIMD_CEIL,
+	CDN_MATH_SIMD_NEGATE,
+	CDN_MATH_SIMD_NUM_UNARY
+} CdnMathSimdUnary;
+
+CdnMathSimdLevel _cdn_math_simd_get_level (void);
+
+/* out[i] = a[i] op b[i] */
+void _cdn_math_simd_binary_vv (CdnMathSimdBinary  op,
+                               gdouble           *out,
+                               gdouble const     *a,
+                               gdouble const     *b,
+                               gint               n);
+
+/* out[i] = a[i] op b[0] */
+void _cdn_math_simd_binary_vs (CdnMathSimdBinary  op,
+                               gdouble           *out,
+                               gdouble const     *a,
+                               gdouble const     *b,
+                               gint               n);
+
+/* out[i] = a[0] op b[i] */
+void _cdn_math_simd_binary_sv (CdnMathSimdBinary  op,
+                               gdouble           *out,
+                               gdouble const     *a,
+                               gdouble const     *b,
+                               gint               n);
+
+/* ptr[i] = op ptr[i] */
+void _cdn_math_simd_unary     (CdnMathSimdUnary   op,
+                               gdouble           *ptr,
+                               gint               n);
+
+/* y[i] += a * x[i] */
+void _cdn_math_simd_axpy      (gdouble           *y,
+                               gdouble            a,
+                               gdouble const     *x,
+                               gint               n);
+
+G_END_DECLS
+
+#endif /* __CDN_MATH_SIMD_H__ */
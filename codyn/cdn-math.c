@@ -33,35 +33,50 @@
 #include "cdn-math.h"
 
 #include "cdn-math-linear-algebra.h"
-
-#define foreach_element(op)							\
-gint i;										\
-gint num;									\
-gint start;									\
+#include "cdn-math-simd.h"
+#include "cdn-stack-private.h"
+
+// Operates directly on the values on top of the stack, using the
+// vectorized kernel simd (if any) for more than a single value
+#define foreach_element(op, simd)						\
+gdouble *ptr;									\
+gdouble *end;									\
 										\
-num = argdim ? (cdn_stack_arg_size (argdim->args)) : 1;				\
-start = cdn_stack_count (stack) - 1;						\
+end = cdn_stack_output_ptr (stack);						\
+ptr = end - (argdim ? (cdn_stack_arg_size (argdim->args)) : 1);		\
 										\
-for (i = 0; i < num; ++i)							\
+if (simd != CDN_MATH_SIMD_UNARY_NONE && end - ptr > 1)				\
+{										\
+	_cdn_math_simd_unary (simd, ptr, end - ptr);				\
+}										\
+else										\
 {										\
-	cdn_stack_set_at (stack, start, op (cdn_stack_at (stack, start)));	\
-	--start;								\
+	for (; ptr < end; ++ptr)						\
+	{									\
+		*ptr = op (*ptr);						\
+	}									\
 }
 
 #define SIMPLE_MATH_MAP(func)	SIMPLE_MATH_MAP_CODE(func, func)
 
 #define SIMPLE_MATH_MAP_CODE(func, code)					\
+	SIMPLE_MATH_MAP_SIMD(func, code, CDN_MATH_SIMD_UNARY_NONE)
+
+#define SIMPLE_MATH_MAP_SIMD(func, code, simd)					\
 static void									\
 op_##func (CdnStack           *stack,						\
            CdnStackArgs const *argdim,						\
            gpointer            userdata)					\
 {										\
-	foreach_element (code);							\
+	foreach_element (code, simd);						\
 }
 
 #define BIN_MATH_MAP(func)	BIN_MATH_MAP_CODE(func, func)
 
 #define BIN_MATH_MAP_CODE(func, code)						\
+	BIN_MATH_MAP_SIMD(func, code, CDN_MATH_SIMD_BINARY_NONE)
+
+#define BIN_MATH_MAP_SIMD(func, code, simd)					\
 static void									\
 op_##func (CdnStack           *stack,						\
            CdnStackArgs const *argdim,						\
@@ -71,17 +86,17 @@ op_##func (CdnStack           *stack,						\
 	    argdim->args[0].rows == argdim->args[1].rows &&			\
 	    argdim->args[0].rows != 1)						\
 	{									\
-		foreach_celement2 (stack, argdim, code);			\
+		foreach_celement2 (stack, argdim, code, simd);			\
 	}									\
 	else if ((argdim->args[0].rows == 1 || argdim->args[1].rows == 1) &&	\
 	    argdim->args[0].columns == argdim->args[1].columns &&		\
 	    argdim->args[0].columns != 1)					\
 	{									\
-		foreach_relement2 (stack, argdim, code);			\
+		foreach_relement2 (stack, argdim, code, simd);			\
 	}									\
 	else									\
 	{									\
-		foreach_element2 (stack, argdim, code);				\
+		foreach_element2 (stack, argdim, code, simd);			\
 	}									\
 }										\
 
@@ -90,7 +105,8 @@ typedef gdouble (*BinaryFunction)(gdouble a, gdouble b);
 static void
 foreach_element2 (CdnStack           *stack,
                   CdnStackArgs const *argdim,
-                  BinaryFunction      op)
+                  BinaryFunction      op,
+                  CdnMathSimdBinary   simd)
 {
 	gint num1;
 	gint num2;
@@ -104,6 +120,37 @@ foreach_element2 (CdnStack           *stack,
 
 		cdn_stack_set (stack, op (cdn_stack_peek (stack), second));
 	}
+	else if (simd != CDN_MATH_SIMD_BINARY_NONE && num1 == 1)
+	{
+		gdouble *first;
+
+		// Result replaces the scalar and shifts the vector down by one
+		first = cdn_stack_output_ptr (stack) - num2 - 1;
+		_cdn_math_simd_binary_sv (simd, first, first, first + 1, num2);
+
+		cdn_stack_pop (stack);
+	}
+	else if (simd != CDN_MATH_SIMD_BINARY_NONE && num2 == 1)
+	{
+		gdouble second;
+		gdouble *first;
+
+		second = cdn_stack_pop (stack);
+		first = cdn_stack_output_ptr (stack) - num1;
+
+		_cdn_math_simd_binary_vs (simd, first, first, &second, num1);
+	}
+	else if (simd != CDN_MATH_SIMD_BINARY_NONE && num1 == num2)
+	{
+		gdouble *second;
+		gdouble *first;
+
+		second = cdn_stack_output_ptr (stack) - num2;
+		first = second - num1;
+
+		_cdn_math_simd_binary_vv (simd, first, first, second, num1);
+		cdn_stack_set_output_ptr (stack, second);
+	}
 	else if (num1 == 1)
 	{
 		gdouble first;
@@ -167,7 +214,8 @@ foreach_element2 (CdnStack           *stack,
 static void
 foreach_celement2 (CdnStack           *stack,
                    CdnStackArgs const *argdim,
-                   BinaryFunction      func)
+                   BinaryFunction      func,
+                   CdnMathSimdBinary   simd)
 {
 	gdouble *a;
 	gdouble *b;
@@ -195,6 +243,18 @@ foreach_celement2 (CdnStack           *stack,
 		size_t r;
 		gdouble *bptr = b;
 
+		if (simd != CDN_MATH_SIMD_BINARY_NONE)
+		{
+			_cdn_math_simd_binary_vv (simd,
+			                          aptr,
+			                          aptr,
+			                          bptr,
+			                          argdim->args[1].rows);
+
+			aptr += argdim->args[1].rows;
+			continue;
+		}
+
 		for (r = 0; r < argdim->args[1].rows; ++r)
 		{
 			*aptr = func (*aptr, *bptr);
@@ -222,7 +282,8 @@ foreach_celement2 (CdnStack           *stack,
 static void
 foreach_relement2 (CdnStack           *stack,
                    CdnStackArgs const *argdim,
-                   BinaryFunction      func)
+                   BinaryFunction      func,
+                   CdnMathSimdBinary   simd)
 {
 	gdouble *a;
 	gdouble *b;
@@ -254,6 +315,16 @@ foreach_relement2 (CdnStack           *stack,
 	{
 		size_t r;
 
+		if (simd != CDN_MATH_SIMD_BINARY_NONE)
+		{
+			_cdn_math_simd_binary_vs (simd, aptr, aptr, bptr, rows);
+
+			aptr += rows;
+			++bptr;
+
+			continue;
+		}
+
 		for (r = 0; r < rows; ++r)
 		{
 			*aptr = func (*aptr, *bptr);
@@ -370,15 +441,15 @@ sign_value (gdouble value)
 SIMPLE_MATH_MAP (sin)
 SIMPLE_MATH_MAP (cos)
 SIMPLE_MATH_MAP (tan)
-SIMPLE_MATH_MAP (sqrt)
-SIMPLE_MATH_MAP_CODE (invsqrt, 1.0 / sqrt)
+SIMPLE_MATH_MAP_SIMD (sqrt, sqrt, CDN_MATH_SIMD_SQRT)
+SIMPLE_MATH_MAP_SIMD (invsqrt, 1.0 / sqrt, CDN_MATH_SIMD_INVSQRT)
 SIMPLE_MATH_MAP (asin)
 SIMPLE_MATH_MAP (acos)
 SIMPLE_MATH_MAP (atan)
-SIMPLE_MATH_MAP (floor)
-SIMPLE_MATH_MAP (ceil)
+SIMPLE_MATH_MAP_SIMD (floor, floor, CDN_MATH_SIMD_FLOOR)
+SIMPLE_MATH_MAP_SIMD (ceil, ceil, CDN_MATH_SIMD_CEIL)
 SIMPLE_MATH_MAP (round)
-SIMPLE_MATH_MAP_CODE (abs, fabs)
+SIMPLE_MATH_MAP_SIMD (abs, fabs, CDN_MATH_SIMD_ABS)
 SIMPLE_MATH_MAP (exp)
 SIMPLE_MATH_MAP (erf)
 SIMPLE_MATH_MAP_CODE (ln, log)
@@ -445,9 +516,40 @@ static void
 op_nested (CdnStack            *stack,
            CdnStackArgs const  *argdim,
            gdouble              initial,
-           gdouble            (*func)(gdouble, gdouble, gboolean))
+           gdouble            (*func)(gdouble, gdouble, gboolean),
+           CdnMathSimdBinary    simd)
 {
-	if (argdim->num == 2)
+	if (argdim->num == 2 &&
+	    simd != CDN_MATH_SIMD_BINARY_NONE &&
+	    cdn_stack_arg_size (&argdim->args[0]) +
+	    cdn_stack_arg_size (&argdim->args[1]) > 2)
+	{
+		gdouble *ptrA;
+		gdouble *ptrB;
+
+		gint n1 = cdn_stack_arg_size (&argdim->args[1]);
+		gint n2 = cdn_stack_arg_size (&argdim->args[0]);
+
+		ptrB = cdn_stack_output_ptr (stack) - n2;
+		ptrA = ptrB - n1;
+
+		if (n1 == n2)
+		{
+			_cdn_math_simd_binary_vv (simd, ptrA, ptrA, ptrB, n1);
+			cdn_stack_set_output_ptr (stack, ptrB);
+		}
+		else if (n1 == 1)
+		{
+			_cdn_math_simd_binary_sv (simd, ptrA, ptrA, ptrB, n2);
+			cdn_stack_pop (stack);
+		}
+		else
+		{
+			_cdn_math_simd_binary_sv (simd, ptrA, ptrB, ptrA, n1);
+			cdn_stack_pop (stack);
+		}
+	}
+	else if (argdim->num == 2)
 	{
 		gdouble *ptrA;
 		gdouble *ptrB;
@@ -528,12 +630,15 @@ op_nested (CdnStack            *stack,
 #define NESTED_MATH_MAP(func, initial) NESTED_MATH_MAP_CODE(func, func, initial)
 
 #define NESTED_MATH_MAP_CODE(func, cb, initial)					\
+	NESTED_MATH_MAP_SIMD(func, cb, initial, CDN_MATH_SIMD_BINARY_NONE)
+
+#define NESTED_MATH_MAP_SIMD(func, cb, initial, simd)				\
 static void									\
 op_##func (CdnStack           *stack,						\
            CdnStackArgs const *argdim,						\
            gpointer            userdata)					\
 {										\
-	op_nested (stack, argdim, initial, cb);					\
+	op_nested (stack, argdim, initial, cb, simd);				\
 }
 
 static gdouble
@@ -544,8 +649,8 @@ sqsum (gdouble  a,
 	return a + b * b;
 }
 
-NESTED_MATH_MAP (min, 0)
-NESTED_MATH_MAP (max, 0)
+NESTED_MATH_MAP_SIMD (min, min, 0, CDN_MATH_SIMD_MIN)
+NESTED_MATH_MAP_SIMD (max, max, 0, CDN_MATH_SIMD_MAX)
 NESTED_MATH_MAP (sum, 0)
 NESTED_MATH_MAP (product, 1)
 NESTED_MATH_MAP (sqsum, 0)
@@ -575,7 +680,7 @@ op_hypot (CdnStack           *stack,
 	}
 	else
 	{
-		op_nested (stack, argdim, 0, sqsum);
+		op_nested (stack, argdim, 0, sqsum, CDN_MATH_SIMD_BINARY_NONE);
 		cdn_stack_push (stack, sqrt (cdn_stack_pop (stack)));
 	}
 }
@@ -646,7 +751,7 @@ op_noop (CdnStack           *stack,
 {
 }
 
-SIMPLE_MATH_MAP_CODE (unary_minus, -1 * )
+SIMPLE_MATH_MAP_SIMD (unary_minus, -1 * , CDN_MATH_SIMD_UNARY_MINUS)
 
 static gdouble
 minus_impl (gdouble a,
@@ -747,27 +852,103 @@ negate_impl (gdouble a)
 	return equal_impl (a, 0) ? 1 : 0;
 }
 
-BIN_MATH_MAP_CODE (minus, minus_impl)
-BIN_MATH_MAP_CODE (plus, plus_impl)
-BIN_MATH_MAP_CODE (emultiply, emultiply_impl)
-BIN_MATH_MAP_CODE (divide, divide_impl)
+BIN_MATH_MAP_SIMD (minus, minus_impl, CDN_MATH_SIMD_MINUS)
+BIN_MATH_MAP_SIMD (plus, plus_impl, CDN_MATH_SIMD_PLUS)
+BIN_MATH_MAP_SIMD (emultiply, emultiply_impl, CDN_MATH_SIMD_MULTIPLY)
+BIN_MATH_MAP_SIMD (divide, divide_impl, CDN_MATH_SIMD_DIVIDE)
 BIN_MATH_MAP_CODE (modulo, modulo_impl)
 BIN_MATH_MAP_CODE (power, pow)
-BIN_MATH_MAP_CODE (greater, greater_impl)
-BIN_MATH_MAP_CODE (less, less_impl)
-BIN_MATH_MAP_CODE (greater_or_equal, greater_or_equal_impl)
-BIN_MATH_MAP_CODE (less_or_equal, less_or_equal_impl)
-BIN_MATH_MAP_CODE (equal, equal_impl)
-BIN_MATH_MAP_CODE (nequal, nequal_impl)
-BIN_MATH_MAP_CODE (or, or_impl)
-BIN_MATH_MAP_CODE (and, and_impl)
-SIMPLE_MATH_MAP_CODE (negate, negate_impl)
+BIN_MATH_MAP_SIMD (greater, greater_impl, CDN_MATH_SIMD_GREATER)
+BIN_MATH_MAP_SIMD (less, less_impl, CDN_MATH_SIMD_LESS)
+BIN_MATH_MAP_SIMD (greater_or_equal, greater_or_equal_impl, CDN_MATH_SIMD_GREATER_OR_EQUAL)
+BIN_MATH_MAP_SIMD (less_or_equal, less_or_equal_impl, CDN_MATH_SIMD_LESS_OR_EQUAL)
+BIN_MATH_MAP_SIMD (equal, equal_impl, CDN_MATH_SIMD_EQUAL)
+BIN_MATH_MAP_SIMD (nequal, nequal_impl, CDN_MATH_SIMD_NEQUAL)
+BIN_MATH_MAP_SIMD (or, or_impl, CDN_MATH_SIMD_OR)
+BIN_MATH_MAP_SIMD (and, and_impl, CDN_MATH_SIMD_AND)
+SIMPLE_MATH_MAP_SIMD (negate, negate_impl, CDN_MATH_SIMD_NEGATE)
 
 
+// Only skip structural zeros when at most half of the elements can be nonzero,
+// otherwise the dense kernels are faster
+static gboolean
+arg_is_sparse (CdnStackArg const      *arg,
+               CdnStackSparsity const *sparsity)
+{
+	return sparsity != NULL &&
+	       sparsity->num_nonzeros * 2 <= (gint)cdn_stack_arg_size (arg);
+}
+
 static void
-op_multiply (CdnStack           *stack,
-             CdnStackArgs const *argdim,
-             gpointer            userdata)
+matrix_multiply_sparse (CdnStack                       *stack,
+                        CdnStackArgs const             *argdim,
+                        CdnStackSparsity const * const *sparsity)
+{
+	CdnStackSparsity const *sa;
+	CdnStackSparsity const *sb;
+	gdouble *ptrA;
+	gdouble *ptrB;
+	gdouble *ptrC;
+	gint m;
+	gint k;
+	gint n;
+	gint i;
+
+	sa = sparsity[1];
+	sb = sparsity[0];
+
+	m = argdim->args[1].rows;
+	k = argdim->args[1].columns;
+	n = argdim->args[0].columns;
+
+	ptrC = cdn_stack_output_ptr (stack);
+	ptrB = ptrC - k * n;
+	ptrA = ptrB - m * k;
+
+	memset (ptrC, 0, sizeof (gdouble) * m * n);
+
+	if (arg_is_sparse (&argdim->args[0], sb))
+	{
+		// C(:, j) += B(l, j) * A(:, l) for the nonzeros of B
+		for (i = 0; i < sb->num_nonzeros; ++i)
+		{
+			gint idx = sb->nonzeros[i];
+
+			_cdn_math_simd_axpy (ptrC + (idx / k) * m,
+			                     ptrB[idx],
+			                     ptrA + (idx % k) * m,
+			                     m);
+		}
+	}
+	else
+	{
+		gint j;
+
+		// C(i, j) += A(i, l) * B(l, j) for the nonzeros of A
+		for (j = 0; j < n; ++j)
+		{
+			gdouble *c = ptrC + j * m;
+			gdouble const *b = ptrB + j * k;
+
+			for (i = 0; i < sa->num_nonzeros; ++i)
+			{
+				gint idx = sa->nonzeros[i];
+
+				c[idx % m] += ptrA[idx] * b[idx / m];
+			}
+		}
+	}
+
+	memmove (ptrA, ptrC, sizeof (gdouble) * m * n);
+	cdn_stack_set_output_ptr (stack, ptrA + m * n);
+}
+
+/* Multiply, skipping the structural zeros of the operands when @sparsity
+ * (one pattern per argument) is given */
+static void
+multiply_impl (CdnStack                       *stack,
+               CdnStackArgs const             *argdim,
+               CdnStackSparsity const * const *sparsity)
 {
 	gboolean n1;
 	gboolean n2;
@@ -787,18 +968,35 @@ op_multiply (CdnStack           *stack,
 	}
 	else if (n1 || n2)
 	{
-		foreach_element2 (stack, argdim, emultiply_impl);
+		foreach_element2 (stack, argdim, emultiply_impl, CDN_MATH_SIMD_MULTIPLY);
 	}
 	else if (argdim->args[1].columns == argdim->args[0].rows)
 	{
-		matrix_multiply (stack, argdim);
+		if (sparsity &&
+		    (arg_is_sparse (&argdim->args[0], sparsity[0]) ||
+		     arg_is_sparse (&argdim->args[1], sparsity[1])))
+		{
+			matrix_multiply_sparse (stack, argdim, sparsity);
+		}
+		else
+		{
+			matrix_multiply (stack, argdim);
+		}
 	}
 	else
 	{
-		foreach_element2 (stack, argdim, emultiply_impl);
+		foreach_element2 (stack, argdim, emultiply_impl, CDN_MATH_SIMD_MULTIPLY);
 	}
 }
 
+static void
+op_multiply (CdnStack           *stack,
+             CdnStackArgs const *argdim,
+             gpointer            userdata)
+{
+	multiply_impl (stack, argdim, NULL);
+}
+
 static void
 op_ternary (CdnStack           *stack,
             CdnStackArgs const *argdim,
@@ -1859,6 +2057,100 @@ op_rsum (CdnStack           *stack,
 	cdn_stack_set_output_ptr (stack, outptr);
 }
 
+#if defined (HAVE_LAPACK) || defined(HAVE_EIGEN)
+/* Solve A X = B by substitution when A is structurally triangular. The
+ * elements of A are visited column by column following its sparsity, so
+ * structural zeros are never touched.
+ */
+static void
+linsolve_triangular (gdouble const          *ptrA,
+                     gdouble                *ptrB,
+                     gint                    n,
+                     gint                    nrhs,
+                     CdnStackSparsity const *sparsity)
+{
+	gint c;
+
+	for (c = 0; c < nrhs; ++c)
+	{
+		gdouble *b = ptrB + c * n;
+		gint j;
+		gint k;
+
+		if (sparsity->lower)
+		{
+			k = 0;
+
+			// forward substitution
+			for (j = 0; j < n; ++j)
+			{
+				gdouble x = b[j] / ptrA[j * n + j];
+
+				b[j] = x;
+
+				while (k < sparsity->num_nonzeros &&
+				       sparsity->nonzeros[k] < (j + 1) * n)
+				{
+					gint idx = sparsity->nonzeros[k++];
+
+					if (idx % n > j)
+					{
+						b[idx % n] -= ptrA[idx] * x;
+					}
+				}
+			}
+		}
+		else
+		{
+			k = sparsity->num_nonzeros - 1;
+
+			// backward substitution
+			for (j = n - 1; j >= 0; --j)
+			{
+				gdouble x = b[j] / ptrA[j * n + j];
+
+				b[j] = x;
+
+				while (k >= 0 && sparsity->nonzeros[k] >= j * n)
+				{
+					gint idx = sparsity->nonzeros[k--];
+
+					if (idx % n < j)
+					{
+						b[idx % n] -= ptrA[idx] * x;
+					}
+				}
+			}
+		}
+	}
+}
+
+static void
+linsolve_sparse (CdnStack               *stack,
+                 CdnStackArgs const     *argdim,
+                 CdnStackSparsity const *sparsity)
+{
+	gint numa;
+
+	if (!sparsity || !(sparsity->lower || sparsity->upper))
+	{
+		op_linsolve (stack, argdim, NULL);
+		return;
+	}
+
+	numa = cdn_stack_arg_size (argdim->args);
+
+	linsolve_triangular (cdn_stack_output_ptr (stack) - numa,
+	                     cdn_stack_output_ptr (stack) - numa -
+	                     cdn_stack_arg_size (argdim->args + 1),
+	                     argdim->args[0].rows,
+	                     argdim->args[1].columns,
+	                     sparsity);
+
+	cdn_stack_popn (stack, numa);
+}
+#endif
+
 typedef struct
 {
 	gchar *name;
@@ -2261,6 +2553,299 @@ cdn_math_function_execute (CdnMathFunctionType  type,
 	entry->function (stack, argdim, userdata);
 }
 
+/*
+ * _cdn_math_function_execute_sparse:
+ * @type: the math function type
+ * @argdim: the argument dimensions
+ * @sparsity: the structural sparsity of each argument (%NULL when dense)
+ * @stack: the stack
+ *
+ * Execute the function @type like #cdn_math_function_execute, exploiting
+ * the structural sparsity of its arguments where possible. @sparsity is
+ * a parallel array to the arguments in @argdim.
+ *
+ */
+void
+_cdn_math_function_execute_sparse (CdnMathFunctionType             type,
+                                   CdnStackArgs const             *argdim,
+                                   CdnStackSparsity const * const *sparsity,
+                                   CdnStack                       *stack)
+{
+	switch (type)
+	{
+		case CDN_MATH_FUNCTION_TYPE_MULTIPLY:
+			multiply_impl (stack, argdim, sparsity);
+		break;
+#if defined (HAVE_LAPACK) || defined(HAVE_EIGEN)
+		case CDN_MATH_FUNCTION_TYPE_LINSOLVE:
+			linsolve_sparse (stack, argdim, sparsity[0]);
+		break;
+#endif
+		default:
+			cdn_math_function_execute (type, argdim, stack);
+		break;
+	}
+}
+
+/* Cache of the result, or the factorization, of an expensive function at a
+ * single call site. The cache is reused for as long as the operands it was
+ * computed from are bitwise unchanged, which is much cheaper to check than
+ * recomputing the (O(n³)) factorization.
+ */
+struct _CdnMathFunctionCache
+{
+	CdnMathFunctionType type;
+
+	// Copy of the operands the cache was computed from, i.e. the top
+	// key_size values on the stack
+	gdouble *key;
+	gint key_size;
+
+	// Cached result or factorization
+	gdouble *value;
+	gint value_size;
+
+#ifdef HAVE_LAPACK
+	LP_int *ipiv;
+#endif
+
+	guint valid : 1;
+};
+
+/*
+ * _cdn_math_function_cache_new:
+ * @type: the math function type
+ * @inargs: the input arguments
+ * @sparsity: (allow-none): the structural sparsity of each input argument
+ * @outarg: the output argument
+ *
+ * Create a cache for a single call site of the function @type. Only
+ * functions which factorize (or invert) their matrix operand are cached.
+ *
+ * Returns: a new #CdnMathFunctionCache, or %NULL if @type is not cached
+ *
+ */
+CdnMathFunctionCache *
+_cdn_math_function_cache_new (CdnMathFunctionType             type,
+                              CdnStackArgs const             *inargs,
+                              CdnStackSparsity const * const *sparsity,
+                              CdnStackArg const              *outarg)
+{
+	CdnMathFunctionCache *ret;
+	gint key_size;
+	gint value_size;
+
+	switch (type)
+	{
+#if defined (HAVE_LAPACK) || defined(HAVE_EIGEN)
+		case CDN_MATH_FUNCTION_TYPE_INVERSE:
+		case CDN_MATH_FUNCTION_TYPE_PSEUDO_INVERSE:
+			key_size = cdn_stack_arg_size (inargs->args);
+			value_size = cdn_stack_arg_size (outarg);
+		break;
+#endif
+#ifdef HAVE_LAPACK
+		case CDN_MATH_FUNCTION_TYPE_LINSOLVE:
+		{
+			if (sparsity && sparsity[0] &&
+			    (sparsity[0]->lower || sparsity[0]->upper))
+			{
+				// Solved by substitution, see linsolve_sparse
+				return NULL;
+			}
+
+			key_size = cdn_stack_arg_size (inargs->args);
+			value_size = key_size;
+		}
+		break;
+#endif
+		case CDN_MATH_FUNCTION_TYPE_SLTDL:
+			key_size = cdn_stack_arg_size (inargs->args) +
+			           cdn_stack_arg_size (inargs->args + 1);
+
+			value_size = cdn_stack_arg_size (outarg);
+		break;
+		case CDN_MATH_FUNCTION_TYPE_SLINSOLVE:
+			key_size = cdn_stack_arg_size (inargs->args) +
+			           cdn_stack_arg_size (inargs->args + 1);
+
+			value_size = cdn_stack_arg_size (inargs->args);
+		break;
+		default:
+			return NULL;
+	}
+
+	if (key_size <= 1)
+	{
+		// Not worth it for scalars
+		return NULL;
+	}
+
+	ret = g_slice_new0 (CdnMathFunctionCache);
+
+	ret->type = type;
+	ret->key = g_new (gdouble, key_size);
+	ret->key_size = key_size;
+	ret->value = g_new (gdouble, value_size);
+	ret->value_size = value_size;
+
+#ifdef HAVE_LAPACK
+	if (type == CDN_MATH_FUNCTION_TYPE_LINSOLVE)
+	{
+		ret->ipiv = g_new (LP_int, inargs->args[0].rows);
+	}
+#endif
+
+	return ret;
+}
+
+void
+_cdn_math_function_cache_free (CdnMathFunctionCache *cache)
+{
+	if (!cache)
+	{
+		return;
+	}
+
+	g_free (cache->key);
+	g_free (cache->value);
+
+#ifdef HAVE_LAPACK
+	g_free (cache->ipiv);
+#endif
+
+	g_slice_free (CdnMathFunctionCache, cache);
+}
+
+#ifdef HAVE_LAPACK
+static void
+linsolve_cached (CdnStack             *stack,
+                 CdnStackArgs const   *argdim,
+                 CdnMathFunctionCache *cache,
+                 gboolean              hit)
+{
+	gdouble *ptrA;
+	gdouble *ptrB;
+	gint numa;
+
+	numa = cdn_stack_arg_size (argdim->args);
+
+	ptrA = cdn_stack_output_ptr (stack) - numa;
+	ptrB = ptrA - cdn_stack_arg_size (argdim->args + 1);
+
+	if (!hit)
+	{
+		memcpy (cache->value, ptrA, sizeof (gdouble) * numa);
+		linsolve_factorize (cache->value, cache->ipiv, argdim->args[0].rows);
+	}
+
+	linsolve_factorized (cache->value,
+	                     cache->ipiv,
+	                     ptrB,
+	                     argdim->args[0].rows,
+	                     argdim->args[1].columns);
+
+	cdn_stack_popn (stack, numa);
+}
+#endif
+
+static void
+slinsolve_cached (CdnStack             *stack,
+                  CdnStackArgs const   *argdim,
+                  CdnMathFunctionCache *cache,
+                  gboolean              hit)
+{
+	gdouble *ptrA;
+	gdouble *ptrB;
+	gdouble *ptrL;
+	gint numa;
+	gint numl;
+	gint n;
+
+	numa = cdn_stack_arg_size (&argdim->args[0]);
+	numl = cdn_stack_arg_size (&argdim->args[1]);
+
+	ptrA = cdn_stack_output_ptr (stack) - numa;
+	ptrL = ptrA - numl;
+	ptrB = ptrL - cdn_stack_arg_size (&argdim->args[2]);
+
+	n = argdim->args[0].rows;
+
+	if (!hit)
+	{
+		sltdl_impl (ptrA, ptrL, n);
+		memcpy (cache->value, ptrA, sizeof (gdouble) * numa);
+	}
+
+	// Solve using the (cached) LTDL factorization, see op_slinsolve
+	sltdl_dinvlinvt_impl (cache->value, ptrL, ptrB, n);
+	sltdl_linv_impl (cache->value, ptrL, ptrB, n);
+
+	cdn_stack_popn (stack, numa + numl);
+}
+
+/*
+ * _cdn_math_function_execute_cached:
+ * @type: the math function type
+ * @argdim: the argument dimensions
+ * @stack: the stack
+ * @cache: the #CdnMathFunctionCache of the call site
+ *
+ * Execute the function @type like #cdn_math_function_execute, reusing the
+ * result or factorization in @cache if the operands did not change since
+ * the last execution.
+ *
+ */
+void
+_cdn_math_function_execute_cached (CdnMathFunctionType   type,
+                                   CdnStackArgs const   *argdim,
+                                   CdnStack             *stack,
+                                   CdnMathFunctionCache *cache)
+{
+	gdouble *key;
+	gboolean hit;
+
+	key = cdn_stack_output_ptr (stack) - cache->key_size;
+
+	hit = cache->valid &&
+	      memcmp (key, cache->key, sizeof (gdouble) * cache->key_size) == 0;
+
+	if (!hit)
+	{
+		memcpy (cache->key, key, sizeof (gdouble) * cache->key_size);
+	}
+
+	switch (cache->type)
+	{
+#ifdef HAVE_LAPACK
+		case CDN_MATH_FUNCTION_TYPE_LINSOLVE:
+			linsolve_cached (stack, argdim, cache, hit);
+		break;
+#endif
+		case CDN_MATH_FUNCTION_TYPE_SLINSOLVE:
+			slinsolve_cached (stack, argdim, cache, hit);
+		break;
+		default:
+			// The result replaces the operands on the stack
+			if (hit)
+			{
+				memcpy (key, cache->value, sizeof (gdouble) * cache->value_size);
+				cdn_stack_set_output_ptr (stack, key + cache->value_size);
+			}
+			else
+			{
+				cdn_math_function_execute (type, argdim, stack);
+
+				memcpy (cache->value,
+				        cdn_stack_output_ptr (stack) - cache->value_size,
+				        sizeof (gdouble) * cache->value_size);
+			}
+		break;
+	}
+
+	cache->valid = TRUE;
+}
+
 typedef struct
 {
 	gchar const *name;
@@ -2968,3 +3553,229 @@ cdn_math_function_get_stack_manipulation (CdnMathFunctionType    type,
 
 	return TRUE;
 }
+
+static gboolean
+sparsity_elementwise (CdnStackArgs const             *inargs,
+                      CdnStackSparsity const * const *sparsity,
+                      gboolean                        product,
+                      gint                            num,
+                      gboolean                       *mask)
+{
+	gboolean *a;
+	gboolean *b;
+	gint na;
+	gint nb;
+	gint i;
+
+	// Note: args[1] is the first operand
+	na = cdn_stack_arg_size (inargs->args + 1);
+	nb = cdn_stack_arg_size (inargs->args);
+
+	if ((!sparsity[0] && !sparsity[1]) ||
+	    (na != 1 && na != num) ||
+	    (nb != 1 && nb != num))
+	{
+		return FALSE;
+	}
+
+	a = _cdn_stack_sparsity_get_mask (sparsity[1],
+	                                  &inargs->args[1].dimension);
+
+	b = _cdn_stack_sparsity_get_mask (sparsity[0],
+	                                  &inargs->args[0].dimension);
+
+	for (i = 0; i < num; ++i)
+	{
+		gboolean ai = a[na == 1 ? 0 : i];
+		gboolean bi = b[nb == 1 ? 0 : i];
+
+		mask[i] = product ? (ai && bi) : (ai || bi);
+	}
+
+	g_free (a);
+	g_free (b);
+
+	return TRUE;
+}
+
+static gboolean
+sparsity_matrix_multiply (CdnStackArgs const             *inargs,
+                          CdnStackSparsity const * const *sparsity,
+                          gboolean                       *mask)
+{
+	gboolean *a;
+	gboolean *b;
+	gint m;
+	gint k;
+	gint n;
+	gint j;
+
+	if (!sparsity[0] && !sparsity[1])
+	{
+		return FALSE;
+	}
+
+	m = inargs->args[1].rows;
+	k = inargs->args[1].columns;
+	n = inargs->args[0].columns;
+
+	a = _cdn_stack_sparsity_get_mask (sparsity[1],
+	                                  &inargs->args[1].dimension);
+
+	b = _cdn_stack_sparsity_get_mask (sparsity[0],
+	                                  &inargs->args[0].dimension);
+
+	// C(i, j) can only be nonzero if A(i, l) and B(l, j) are for some l
+	for (j = 0; j < n; ++j)
+	{
+		gint l;
+
+		for (l = 0; l < k; ++l)
+		{
+			gint i;
+
+			if (!b[j * k + l])
+			{
+				continue;
+			}
+
+			for (i = 0; i < m; ++i)
+			{
+				mask[j * m + i] = mask[j * m + i] || a[l * m + i];
+			}
+		}
+	}
+
+	g_free (a);
+	g_free (b);
+
+	return TRUE;
+}
+
+static gboolean
+sparsity_mask (CdnMathFunctionType             type,
+               CdnStackArgs const             *inargs,
+               CdnStackSparsity const * const *sparsity,
+               CdnStackArg const              *outarg,
+               gboolean                       *mask)
+{
+	CdnStackArg const *arg = inargs->args;
+	gboolean *a;
+	gint num;
+	gint i;
+
+	num = cdn_stack_arg_size (outarg);
+
+	switch (type)
+	{
+		case CDN_MATH_FUNCTION_TYPE_PLUS:
+		case CDN_MATH_FUNCTION_TYPE_MINUS:
+			return sparsity_elementwise (inargs, sparsity, FALSE, num, mask);
+		case CDN_MATH_FUNCTION_TYPE_EMULTIPLY:
+			return sparsity_elementwise (inargs, sparsity, TRUE, num, mask);
+		case CDN_MATH_FUNCTION_TYPE_MULTIPLY:
+			// Follows the dispatching in op_multiply
+			if (cdn_stack_arg_size (inargs->args) != 1 &&
+			    cdn_stack_arg_size (inargs->args + 1) != 1 &&
+			    inargs->args[1].columns == inargs->args[0].rows)
+			{
+				return sparsity_matrix_multiply (inargs, sparsity, mask);
+			}
+
+			return sparsity_elementwise (inargs, sparsity, TRUE, num, mask);
+		case CDN_MATH_FUNCTION_TYPE_UNARY_MINUS:
+		case CDN_MATH_FUNCTION_TYPE_TRANSPOSE:
+		case CDN_MATH_FUNCTION_TYPE_TRIL:
+		case CDN_MATH_FUNCTION_TYPE_TRIU:
+		case CDN_MATH_FUNCTION_TYPE_DIAG:
+		break;
+		default:
+			return FALSE;
+	}
+
+	// Unary functions which preserve (or introduce) structural zeros
+	if (!sparsity[0] &&
+	    type != CDN_MATH_FUNCTION_TYPE_TRIL &&
+	    type != CDN_MATH_FUNCTION_TYPE_TRIU &&
+	    type != CDN_MATH_FUNCTION_TYPE_DIAG)
+	{
+		return FALSE;
+	}
+
+	a = _cdn_stack_sparsity_get_mask (sparsity[0], &arg->dimension);
+
+	for (i = 0; i < cdn_stack_arg_size (arg); ++i)
+	{
+		gint r = i % arg->rows;
+		gint c = i / arg->rows;
+
+		switch (type)
+		{
+			case CDN_MATH_FUNCTION_TYPE_UNARY_MINUS:
+				mask[i] = a[i];
+			break;
+			case CDN_MATH_FUNCTION_TYPE_TRANSPOSE:
+				mask[c + r * arg->columns] = a[i];
+			break;
+			case CDN_MATH_FUNCTION_TYPE_TRIL:
+				mask[i] = a[i] && r >= c;
+			break;
+			case CDN_MATH_FUNCTION_TYPE_TRIU:
+				mask[i] = a[i] && r <= c;
+			break;
+			case CDN_MATH_FUNCTION_TYPE_DIAG:
+				if (arg->rows == 1 || arg->columns == 1)
+				{
+					// Vector to diagonal matrix
+					mask[i * (outarg->rows + 1)] = a[i];
+				}
+				else if (r == c)
+				{
+					// Diagonal of a matrix
+					mask[r] = a[i];
+				}
+			break;
+			default:
+			break;
+		}
+	}
+
+	g_free (a);
+	return TRUE;
+}
+
+/*
+ * _cdn_math_function_get_sparsity:
+ * @type: the math function type
+ * @inargs: the input arguments
+ * @sparsity: the structural sparsity of each input argument
+ * @outarg: the output argument
+ *
+ * Derive the structural sparsity of the result of a mathematical function or
+ * operator from the structural sparsity of its arguments. Only functions which
+ * are known to preserve (or introduce) structural zeros are considered,
+ * all other functions produce a dense result.
+ *
+ * Returns: a new #CdnStackSparsity, or %NULL if the result is dense.
+ *
+ */
+CdnStackSparsity *
+_cdn_math_function_get_sparsity (CdnMathFunctionType             type,
+                                 CdnStackArgs const             *inargs,
+                                 CdnStackSparsity const * const *sparsity,
+                                 CdnStackArg const              *outarg)
+{
+	CdnStackSparsity *ret = NULL;
+	gboolean *mask;
+
+	mask = g_new0 (gboolean, cdn_stack_arg_size (outarg));
+
+	if (sparsity_mask (type, inargs, sparsity, outarg, mask))
+	{
+		ret = _cdn_stack_sparsity_new_from_mask (&outarg->dimension,
+		                                         mask);
+	}
+
+	g_free (mask);
+	return ret;
+}
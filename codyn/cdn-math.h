@@ -186,6 +186,8 @@ typedef enum
 	CDN_MATH_FUNCTION_TYPE_NUM
 } CdnMathFunctionType;
 
+typedef struct _CdnMathFunctionCache CdnMathFunctionCache;
+
 typedef void (*CdnMathFunctionEvaluateFunc)(CdnStack           *stack,
                                             CdnStackArgs const *argdim,
                                             gpointer            userdata);
@@ -224,6 +226,28 @@ guint                cdn_math_register_builtin_function       (gchar const
                                                                gpointer                       userdata,
                                                                GDestroyNotify                 destroy_notify);
 
+CdnStackSparsity    *_cdn_math_function_get_sparsity          (CdnMathFunctionType             type,
+                                                               CdnStackArgs const             *inargs,
+                                                               CdnStackSparsity const * const *sparsity,
+                                                               CdnStackArg const              *outarg);
+
+void                 _cdn_math_function_execute_sparse        (CdnMathFunctionType             type,
+                                                               CdnStackArgs const             *argdim,
+                                                               CdnStackSparsity const * const *sparsity,
+                                                               CdnStack                       *stack);
+
+CdnMathFunctionCache *
+                     _cdn_math_function_cache_new             (CdnMathFunctionType             type,
+                                                               CdnStackArgs const             *inargs,
+                                                               CdnStackSparsity const * const *sparsity,
+                                                               CdnStackArg const              *outarg);
+void                 _cdn_math_function_cache_free            (CdnMathFunctionCache *cache);
+
+void                 _cdn_math_function_execute_cached        (CdnMathFunctionType   type,
+                                                               CdnStackArgs const   *argdim,
+                                                               CdnStack             *stack,
+                                                               CdnMathFunctionCache *cache);
+
 G_END_DECLS
 
 #endif /* __CDN_MATH_H__ */
@@ -0,0 +1,751 @@
+#include "cdn-network.h"
+#include "cdn-expression-tree-iter.h"
+#include "cdn-event.h"
+#include "instructions/cdn-instructions.h"
+
+#include <math.h>
+
+#define PLAIN_VARIABLE_FLAGS (CDN_VARIABLE_FLAG_INTEGRATED | \
+                              CDN_VARIABLE_FLAG_IN | \
+                              CDN_VARIABLE_FLAG_DISCRETE | \
+                              CDN_VARIABLE_FLAG_FUNCTION_ARGUMENT)
+
+enum
+{
+	CONSTNESS_UNKNOWN,
+	CONSTNESS_VISITING,
+	CONSTNESS_CONSTANT,
+	CONSTNESS_VARYING
+};
+
+typedef struct
+{
+	CdnExpression *expression;
+	CdnExpressionTreeIter *iter;
+
+	// The variable for which this is the expression, if the value of the
+	// variable is always equal to its expression
+	CdnVariable *variable;
+
+	gboolean changed;
+} Item;
+
+typedef struct
+{
+	CdnNetwork *network;
+
+	// Variables which are set by events (CdnVariable * -> NULL)
+	GHashTable *event_targets;
+
+	// Cached constness of variables (CdnVariable * -> CONSTNESS_*)
+	GHashTable *constness;
+
+	// Number of occurrences of each subexpression (gchar * -> guint)
+	GHashTable *counts;
+
+	// Variables holding shared subexpressions (gchar * -> CdnVariable *)
+	GHashTable *shared;
+
+	// Newly created temporaries, still to be processed
+	GQueue temporaries;
+	guint num_temporaries;
+} Optimizer;
+
+static gboolean
+is_plain_variable (Optimizer   *opt,
+                   CdnVariable *v,
+                   gboolean     allow_once)
+{
+	CdnVariableFlags flags;
+	CdnVariableFlags mask = PLAIN_VARIABLE_FLAGS;
+
+	if (!allow_once)
+	{
+		mask |= CDN_VARIABLE_FLAG_ONCE;
+	}
+
+	flags = cdn_variable_get_flags (v);
+
+	// A plain variable always has the value of its expression
+	return !(flags & mask) &&
+	       !cdn_variable_has_actions (v) &&
+	       cdn_variable_get_constraint (v) == NULL &&
+	       !g_hash_table_lookup_extended (opt->event_targets, v, NULL, NULL);
+}
+
+static gboolean variable_is_constant (Optimizer   *opt,
+                                      CdnVariable *v);
+
+static gboolean
+instruction_is_pure (CdnInstruction *instr)
+{
+	return CDN_IS_INSTRUCTION_NUMBER (instr) ||
+	       CDN_IS_INSTRUCTION_VARIABLE (instr) ||
+	       CDN_IS_INSTRUCTION_FUNCTION (instr) ||
+	       CDN_IS_INSTRUCTION_MATRIX (instr) ||
+	       CDN_IS_INSTRUCTION_INDEX (instr);
+}
+
+static gboolean
+iter_is_constant (Optimizer             *opt,
+                  CdnExpressionTreeIter *iter)
+{
+	CdnInstruction *instr;
+	gint i;
+
+	instr = cdn_expression_tree_iter_get_instruction (iter);
+
+	if (!instruction_is_pure (instr))
+	{
+		return FALSE;
+	}
+
+	if (CDN_IS_INSTRUCTION_VARIABLE (instr) &&
+	    !variable_is_constant (opt,
+	                           cdn_instruction_variable_get_variable (CDN_INSTRUCTION_VARIABLE (instr))))
+	{
+		return FALSE;
+	}
+
+	for (i = 0; i < cdn_expression_tree_iter_get_num_children (iter); ++i)
+	{
+		if (!iter_is_constant (opt, cdn_expression_tree_iter_get_child (iter, i)))
+		{
+			return FALSE;
+		}
+	}
+
+	return TRUE;
+}
+
+static gboolean
+variable_is_constant (Optimizer   *opt,
+                      CdnVariable *v)
+{
+	CdnExpressionTreeIter *iter;
+	gboolean ret;
+	guint constness;
+
+	constness = GPOINTER_TO_UINT (g_hash_table_lookup (opt->constness, v));
+
+	if (constness != CONSTNESS_UNKNOWN)
+	{
+		// Note that recursion (VISITING) is never constant
+		return constness == CONSTNESS_CONSTANT;
+	}
+
+	if (!is_plain_variable (opt, v, TRUE))
+	{
+		g_hash_table_insert (opt->constness,
+		                     v,
+		                     GUINT_TO_POINTER (CONSTNESS_VARYING));
+
+		return FALSE;
+	}
+
+	g_hash_table_insert (opt->constness,
+	                     v,
+	                     GUINT_TO_POINTER (CONSTNESS_VISITING));
+
+	iter = cdn_expression_tree_iter_new (cdn_variable_get_expression (v));
+	ret = iter != NULL && iter_is_constant (opt, iter);
+
+	if (iter)
+	{
+		cdn_expression_tree_iter_free (iter);
+	}
+
+	g_hash_table_insert (opt->constness,
+	                     v,
+	                     GUINT_TO_POINTER (ret ? CONSTNESS_CONSTANT : CONSTNESS_VARYING));
+
+	return ret;
+}
+
+static CdnExpression *
+iter_to_expression (CdnExpressionTreeIter *iter)
+{
+	CdnExpression *ret;
+	GSList *instructions;
+
+	// Use the full variable names so that the expression still makes sense
+	// outside of its original scope
+	ret = cdn_expression_new (cdn_expression_tree_iter_to_string_dbg (iter));
+
+	instructions = cdn_expression_tree_iter_to_instructions (iter);
+	cdn_expression_set_instructions_take (ret, instructions);
+
+	g_slist_foreach (instructions, (GFunc)cdn_mini_object_unref, NULL);
+	g_slist_free (instructions);
+
+	return ret;
+}
+
+static CdnExpressionTreeIter *
+fold_iter (CdnExpressionTreeIter *iter)
+{
+	CdnStackManipulation const *smanip;
+	CdnExpression *expr;
+	CdnInstruction *instr;
+	gdouble value;
+
+	instr = cdn_expression_tree_iter_get_instruction (iter);
+
+	if (cdn_expression_tree_iter_get_num_children (iter) == 0 &&
+	    !CDN_IS_INSTRUCTION_VARIABLE (instr))
+	{
+		return NULL;
+	}
+
+	smanip = cdn_instruction_get_stack_manipulation (instr, NULL);
+
+	// Only scalars can be represented by a single number instruction
+	if (!smanip || !cdn_dimension_is_one (&smanip->push.dimension))
+	{
+		return NULL;
+	}
+
+	expr = iter_to_expression (iter);
+	g_object_ref_sink (expr);
+
+	value = cdn_expression_evaluate (expr);
+	g_object_unref (expr);
+
+	if (!isfinite (value))
+	{
+		return NULL;
+	}
+
+	return cdn_expression_tree_iter_new_from_instruction_take (cdn_instruction_number_new (value));
+}
+
+static gboolean
+fold_constants (Optimizer             *opt,
+                CdnExpressionTreeIter *iter,
+                gboolean              *changed)
+{
+	gint num;
+	gint i;
+	gboolean *isconst;
+	gboolean ret;
+	CdnInstruction *instr;
+
+	num = cdn_expression_tree_iter_get_num_children (iter);
+	instr = cdn_expression_tree_iter_get_instruction (iter);
+
+	ret = instruction_is_pure (instr);
+
+	if (ret && CDN_IS_INSTRUCTION_VARIABLE (instr))
+	{
+		CdnVariable *v;
+
+		v = cdn_instruction_variable_get_variable (CDN_INSTRUCTION_VARIABLE (instr));
+		ret = variable_is_constant (opt, v);
+	}
+
+	isconst = g_new0 (gboolean, num);
+
+	for (i = 0; i < num; ++i)
+	{
+		CdnExpressionTreeIter *child;
+
+		child = cdn_expression_tree_iter_get_child (iter, i);
+		isconst[i] = fold_constants (opt, child, changed);
+
+		ret = ret && isconst[i];
+	}
+
+	if (!ret)
+	{
+		// Fold the largest constant subexpressions
+		for (i = 0; i < num; ++i)
+		{
+			CdnExpressionTreeIter *folded;
+
+			if (!isconst[i])
+			{
+				continue;
+			}
+
+			folded = fold_iter (cdn_expression_tree_iter_get_child (iter, i));
+
+			if (folded)
+			{
+				cdn_expression_tree_iter_take_child (iter, i, folded);
+				*changed = TRUE;
+			}
+		}
+	}
+
+	g_free (isconst);
+	return ret;
+}
+
+static gboolean
+count_subexpressions (Optimizer             *opt,
+                      CdnExpressionTreeIter *iter)
+{
+	gboolean ret;
+	gint num;
+	gint i;
+	CdnInstruction *instr;
+
+	instr = cdn_expression_tree_iter_get_instruction (iter);
+	num = cdn_expression_tree_iter_get_num_children (iter);
+
+	ret = instruction_is_pure (instr);
+
+	if (ret && CDN_IS_INSTRUCTION_VARIABLE (instr))
+	{
+		CdnVariable *v;
+
+		v = cdn_instruction_variable_get_variable (CDN_INSTRUCTION_VARIABLE (instr));
+		ret = !(cdn_variable_get_flags (v) & CDN_VARIABLE_FLAG_FUNCTION_ARGUMENT);
+	}
+
+	for (i = 0; i < num; ++i)
+	{
+		if (!count_subexpressions (opt, cdn_expression_tree_iter_get_child (iter, i)))
+		{
+			ret = FALSE;
+		}
+	}
+
+	// Only count subexpressions which are worth sharing and which can be
+	// safely evaluated out of their original context
+	if (ret && num > 0)
+	{
+		gchar const *key;
+		guint count;
+
+		key = cdn_expression_tree_iter_to_string_dbg (iter);
+		count = GPOINTER_TO_UINT (g_hash_table_lookup (opt->counts, key));
+
+		g_hash_table_insert (opt->counts,
+		                     g_strdup (key),
+		                     GUINT_TO_POINTER (count + 1));
+	}
+
+	return ret;
+}
+
+static void
+uncount_subexpressions (Optimizer             *opt,
+                        CdnExpressionTreeIter *iter)
+{
+	gint i;
+
+	for (i = 0; i < cdn_expression_tree_iter_get_num_children (iter); ++i)
+	{
+		CdnExpressionTreeIter *child;
+		gchar const *key;
+		guint count;
+
+		child = cdn_expression_tree_iter_get_child (iter, i);
+
+		if (cdn_expression_tree_iter_get_num_children (child) == 0)
+		{
+			continue;
+		}
+
+		key = cdn_expression_tree_iter_to_string_dbg (child);
+		count = GPOINTER_TO_UINT (g_hash_table_lookup (opt->counts, key));
+
+		if (count > 0)
+		{
+			g_hash_table_insert (opt->counts,
+			                     g_strdup (key),
+			                     GUINT_TO_POINTER (count - 1));
+		}
+
+		uncount_subexpressions (opt, child);
+	}
+}
+
+static CdnVariable *
+create_temporary (Optimizer             *opt,
+                  CdnExpressionTreeIter *iter)
+{
+	CdnVariable *ret;
+	gchar *name;
+
+	do
+	{
+		name = g_strdup_printf ("_cse%u", opt->num_temporaries++);
+
+		if (cdn_object_get_variable (CDN_OBJECT (opt->network), name) == NULL)
+		{
+			break;
+		}
+
+		g_free (name);
+	} while (TRUE);
+
+	ret = cdn_variable_new (name,
+	                        iter_to_expression (iter),
+	                        CDN_VARIABLE_FLAG_NONE);
+
+	g_free (name);
+
+	if (!cdn_object_add_variable (CDN_OBJECT (opt->network), ret, NULL))
+	{
+		return NULL;
+	}
+
+	g_queue_push_tail (&opt->temporaries, ret);
+	return ret;
+}
+
+static CdnVariable *
+shared_variable (Optimizer             *opt,
+                 CdnExpressionTreeIter *iter)
+{
+	gchar const *key;
+	CdnVariable *ret;
+
+	if (cdn_expression_tree_iter_get_num_children (iter) == 0)
+	{
+		return NULL;
+	}
+
+	key = cdn_expression_tree_iter_to_string_dbg (iter);
+
+	if (GPOINTER_TO_UINT (g_hash_table_lookup (opt->counts, key)) < 2)
+	{
+		return NULL;
+	}
+
+	ret = g_hash_table_lookup (opt->shared, key);
+
+	if (ret)
+	{
+		// This occurrence disappears, and with it its subexpressions
+		uncount_subexpressions (opt, iter);
+		return ret;
+	}
+
+	// The first occurrence becomes the expression of the temporary
+	ret = create_temporary (opt, iter);
+
+	if (ret)
+	{
+		g_hash_table_insert (opt->shared, g_strdup (key), ret);
+	}
+
+	return ret;
+}
+
+static CdnExpressionTreeIter *
+iter_new_variable (CdnVariable *v)
+{
+	return cdn_expression_tree_iter_new_from_instruction_take (cdn_instruction_variable_new (v));
+}
+
+static void
+eliminate_children (Optimizer             *opt,
+                    CdnExpressionTreeIter *iter,
+                    gboolean              *changed)
+{
+	gint i;
+
+	for (i = 0; i < cdn_expression_tree_iter_get_num_children (iter); ++i)
+	{
+		CdnExpressionTreeIter *child;
+		CdnVariable *v;
+
+		child = cdn_expression_tree_iter_get_child (iter, i);
+		v = shared_variable (opt, child);
+
+		if (v)
+		{
+			cdn_expression_tree_iter_take_child (iter, i, iter_new_variable (v));
+			*changed = TRUE;
+		}
+		else
+		{
+			eliminate_children (opt, child, changed);
+		}
+	}
+}
+
+static void
+eliminate_item (Optimizer *opt,
+                Item      *item)
+{
+	CdnVariable *v = NULL;
+
+	// Leave alone the expression of a variable which itself stands in for
+	// its expression
+	if (!item->variable ||
+	    cdn_expression_tree_iter_get_num_children (item->iter) == 0 ||
+	    g_hash_table_lookup (opt->shared,
+	                         cdn_expression_tree_iter_to_string_dbg (item->iter)) != item->variable)
+	{
+		v = shared_variable (opt, item->iter);
+	}
+
+	if (v)
+	{
+		// The whole expression is shared
+		cdn_expression_tree_iter_free (item->iter);
+		item->iter = iter_new_variable (v);
+		item->changed = TRUE;
+
+		return;
+	}
+
+	eliminate_children (opt, item->iter, &item->changed);
+}
+
+static void
+apply_item (Item *item)
+{
+	GSList *instructions;
+
+	if (!item->changed)
+	{
+		return;
+	}
+
+	instructions = cdn_expression_tree_iter_to_instructions (item->iter);
+	cdn_expression_set_instructions_take (item->expression, instructions);
+
+	g_slist_foreach (instructions, (GFunc)cdn_mini_object_unref, NULL);
+	g_slist_free (instructions);
+}
+
+static void
+add_item (GPtrArray     *items,
+          GHashTable    *seen,
+          CdnExpression *expr,
+          CdnVariable   *variable)
+{
+	Item *item;
+	CdnExpressionTreeIter *iter;
+
+	if (g_hash_table_lookup_extended (seen, expr, NULL, NULL))
+	{
+		return;
+	}
+
+	g_hash_table_insert (seen, expr, NULL);
+
+	iter = cdn_expression_tree_iter_new (expr);
+
+	if (iter == NULL)
+	{
+		return;
+	}
+
+	item = g_slice_new0 (Item);
+
+	item->expression = expr;
+	item->iter = iter;
+	item->variable = variable;
+
+	g_ptr_array_add (items, item);
+}
+
+static void
+item_free (Item *item)
+{
+	cdn_expression_tree_iter_free (item->iter);
+	g_slice_free (Item, item);
+}
+
+static void
+add_edge_actions (GPtrArray    *items,
+                  GHashTable   *seen,
+                  GSList const *actions)
+{
+	while (actions)
+	{
+		add_item (items,
+		          seen,
+		          cdn_edge_action_get_equation (actions->data),
+		          NULL);
+
+		actions = g_slist_next (actions);
+	}
+}
+
+static void
+collect_event_targets (Optimizer          *opt,
+                       CdnIntegratorState *state)
+{
+	GSList const *ev;
+
+	for (ev = cdn_integrator_state_events (state); ev; ev = g_slist_next (ev))
+	{
+		GSList const *sv;
+
+		sv = cdn_event_get_set_variables (ev->data);
+
+		while (sv)
+		{
+			g_hash_table_insert (opt->event_targets,
+			                     cdn_event_set_variable_get_variable (sv->data),
+			                     NULL);
+
+			sv = g_slist_next (sv);
+		}
+	}
+}
+
+static void
+optimize_network (CdnNetwork *network)
+{
+	CdnIntegratorState *state;
+	Optimizer opt = {0,};
+	GPtrArray *items;
+	GHashTable *seen;
+	GSList const *l;
+	guint i;
+
+	state = cdn_integrator_get_state (cdn_network_get_integrator (network));
+
+	opt.network = network;
+	opt.event_targets = g_hash_table_new (g_direct_hash, g_direct_equal);
+	opt.constness = g_hash_table_new (g_direct_hash, g_direct_equal);
+	opt.counts = g_hash_table_new_full (g_str_hash, g_str_equal, g_free, NULL);
+	opt.shared = g_hash_table_new_full (g_str_hash, g_str_equal, g_free, NULL);
+	g_queue_init (&opt.temporaries);
+
+	collect_event_targets (&opt, state);
+
+	items = g_ptr_array_new_with_free_func ((GDestroyNotify)item_free);
+	seen = g_hash_table_new (g_direct_hash, g_direct_equal);
+
+	// Collect the expressions which are evaluated during the simulation.
+	// Expressions of integrated and input variables are only initial values
+	for (l = cdn_integrator_state_all_variables (state); l; l = g_slist_next (l))
+	{
+		CdnVariable *v = l->data;
+
+		if (cdn_variable_get_flags (v) & (CDN_VARIABLE_FLAG_INTEGRATED |
+		                                  CDN_VARIABLE_FLAG_IN |
+		                                  CDN_VARIABLE_FLAG_FUNCTION_ARGUMENT))
+		{
+			continue;
+		}
+
+		add_item (items,
+		          seen,
+		          cdn_variable_get_expression (v),
+		          is_plain_variable (&opt, v, FALSE) ? v : NULL);
+	}
+
+	add_edge_actions (items, seen, cdn_integrator_state_integrated_edge_actions (state));
+	add_edge_actions (items, seen, cdn_integrator_state_direct_edge_actions (state));
+	add_edge_actions (items, seen, cdn_integrator_state_discrete_edge_actions (state));
+
+	g_hash_table_destroy (seen);
+
+	// Pass 1: fold constant subexpressions
+	for (i = 0; i < items->len; ++i)
+	{
+		Item *item = g_ptr_array_index (items, i);
+		CdnExpressionTreeIter *folded;
+
+		if (!fold_constants (&opt, item->iter, &item->changed))
+		{
+			continue;
+		}
+
+		folded = fold_iter (item->iter);
+
+		if (folded)
+		{
+			cdn_expression_tree_iter_free (item->iter);
+			item->iter = folded;
+			item->changed = TRUE;
+		}
+	}
+
+	// Pass 2: count subexpressions. Plain variables can directly stand in
+	// for occurrences of their own expression elsewhere
+	for (i = 0; i < items->len; ++i)
+	{
+		Item *item = g_ptr_array_index (items, i);
+		gchar const *key;
+
+		count_subexpressions (&opt, item->iter);
+
+		if (!item->variable ||
+		    cdn_expression_tree_iter_get_num_children (item->iter) == 0)
+		{
+			continue;
+		}
+
+		key = cdn_expression_tree_iter_to_string_dbg (item->iter);
+
+		if (!g_hash_table_lookup (opt.shared, key))
+		{
+			g_hash_table_insert (opt.shared, g_strdup (key), item->variable);
+		}
+	}
+
+	// Pass 3: replace shared subexpressions by variables
+	for (i = 0; i < items->len; ++i)
+	{
+		Item *item = g_ptr_array_index (items, i);
+
+		eliminate_item (&opt, item);
+		apply_item (item);
+	}
+
+	while (!g_queue_is_empty (&opt.temporaries))
+	{
+		CdnVariable *v;
+		Item item = {0,};
+
+		v = g_queue_pop_head (&opt.temporaries);
+
+		item.expression = cdn_variable_get_expression (v);
+		item.iter = cdn_expression_tree_iter_new (item.expression);
+		item.variable = v;
+
+		eliminate_children (&opt, item.iter, &item.changed);
+		apply_item (&item);
+
+		cdn_expression_tree_iter_free (item.iter);
+	}
+
+	g_ptr_array_free (items, TRUE);
+
+	g_hash_table_destroy (opt.event_targets);
+	g_hash_table_destroy (opt.constness);
+	g_hash_table_destroy (opt.counts);
+	g_hash_table_destroy (opt.shared);
+}
+
+/**
+ * cdn_network_optimize:
+ * @network a #CdnNetwork.
+ *
+ * Optimize the expressions of the network as a whole. Subexpressions which
+ * only depend on constants (numbers and variables which are never changed
+ * by the simulation) are folded into numbers. Subexpressions which occur
+ * more than once in the network are computed only once, by replacing them
+ * with a reference to a variable holding the subexpression. Where needed,
+ * these variables are added to the network (named _cse0, _cse1, etc.).
+ *
+ * Note that folded variables are no longer taken into account when they
+ * are changed after the network has been optimized, so only optimize
+ * networks of which the parameters do not change at runtime.
+ */
+void
+cdn_network_optimize (CdnNetwork *network)
+{
+	g_return_if_fail (CDN_IS_NETWORK (network));
+
+	if (!cdn_object_compile (CDN_OBJECT (network), NULL, NULL))
+	{
+		return;
+	}
+
+	optimize_network (network);
+
+	// Compile again to pick up the introduced temporaries
+	cdn_object_compile (CDN_OBJECT (network), NULL, NULL);
+}
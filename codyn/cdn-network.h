@@ -32,6 +32,7 @@
 #include <codyn/cdn-function.h>
 #include <codyn/integrators/cdn-integrator.h>
 #include <codyn/cdn-node.h>
+#include <codyn/cdn-profile.h>
 #include <codyn/cdn-forward-decl.h>
 
 G_BEGIN_DECLS
@@ -238,6 +239,7 @@ void              _cdn_network_register_import       (CdnNetwork        *network
                                                       CdnImportForward *import);
 
 void              cdn_network_simplify               (CdnNetwork *network);
+void              cdn_network_optimize               (CdnNetwork *network);
 
 CdnParserContextForward *cdn_network_get_parser_context     (CdnNetwork *network);
 
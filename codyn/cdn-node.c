@@ -93,6 +93,8 @@ struct _CdnNodePrivate
 
 	gchar *state;
 	gchar *initial_state;
+
+	guint integrate_every;
 };
 
 G_DEFINE_TYPE (CdnNode, cdn_node, CDN_TYPE_OBJECT)
@@ -101,7 +103,8 @@ enum
 {
 	PROP_0,
 	PROP_STATE,
-	PROP_INITIAL_STATE
+	PROP_INITIAL_STATE,
+	PROP_INTEGRATE_EVERY
 };
 
 enum
@@ -1122,6 +1125,11 @@ cdn_node_cdn_apply_template (CdnObject  *object,
 		node->priv->initial_state = g_strdup (source->priv->initial_state);
 	}
 
+	if (source->priv->integrate_every)
+	{
+		node->priv->integrate_every = source->priv->integrate_every;
+	}
+
 	/* Apply interfaces from template */
 	source_iface = cdn_node_get_variable_interface (source);
 
@@ -1213,6 +1221,8 @@ cdn_node_cdn_copy (CdnObject *object,
 
 	g_free (g->priv->initial_state);
 	g->priv->initial_state = g_strdup (CDN_NODE (source)->priv->initial_state);
+
+	g->priv->integrate_every = CDN_NODE (source)->priv->integrate_every;
 }
 
 static gchar *
@@ -1610,6 +1620,9 @@ cdn_node_set_property (GObject      *object,
 			g_free (self->priv->initial_state);
 			self->priv->initial_state = g_value_dup_string (value);
 			break;
+		case PROP_INTEGRATE_EVERY:
+			cdn_node_set_integrate_every (self, g_value_get_uint (value));
+			break;
 		default:
 			G_OBJECT_WARN_INVALID_PROPERTY_ID (object, prop_id, pspec);
 		break;
@@ -1632,6 +1645,9 @@ cdn_node_get_property (GObject    *object,
 		case PROP_INITIAL_STATE:
 			g_value_set_string (value, self->priv->initial_state);
 			break;
+		case PROP_INTEGRATE_EVERY:
+			g_value_set_uint (value, self->priv->integrate_every);
+			break;
 		default:
 			G_OBJECT_WARN_INVALID_PROPERTY_ID (object, prop_id, pspec);
 		break;
@@ -1788,6 +1804,25 @@ cdn_node_class_init (CdnNodeClass *klass)
 	                                                      NULL,
 	                                                      G_PARAM_READWRITE |
 	                                                      G_PARAM_STATIC_STRINGS));
+
+	/**
+	 * CdnNode:integrate-every:
+	 *
+	 * The number of simulation steps over which the integrated variables
+	 * in the node are integrated at once. In between, the variables are
+	 * interpolated linearly. A value of 0 inherits the value of the
+	 * parent node.
+	 */
+	g_object_class_install_property (object_class,
+	                                 PROP_INTEGRATE_EVERY,
+	                                 g_param_spec_uint ("integrate-every",
+	                                                    "Integrate Every",
+	                                                    "Integrate every",
+	                                                    0,
+	                                                    G_MAXUINT,
+	                                                    0,
+	                                                    G_PARAM_READWRITE |
+	                                                    G_PARAM_STATIC_STRINGS));
 }
 
 static void
@@ -2452,3 +2487,52 @@ cdn_node_get_initial_state (CdnNode *node)
 {
 	return node->priv->initial_state;
 }
+
+/**
+ * cdn_node_set_integrate_every:
+ * @node: a #CdnNode.
+ * @steps: the number of steps.
+ *
+ * Set the number of simulation steps over which the integrated variables in
+ * @node (and its children) are integrated at once. Slow subsystems can use
+ * this to avoid recomputing their dynamics at the rate of the fastest
+ * subsystem. At the start of each interval of @steps steps, the variables
+ * are integrated over the whole interval with the integration method of
+ * the network, while all faster variables are held. During the steps of
+ * the interval, the variables are then interpolated linearly between their
+ * values at both ends. Use 0 to inherit the value of the parent node.
+ *
+ */
+void
+cdn_node_set_integrate_every (CdnNode *node,
+                              guint    steps)
+{
+	g_return_if_fail (CDN_IS_NODE (node));
+
+	if (node->priv->integrate_every == steps)
+	{
+		return;
+	}
+
+	node->priv->integrate_every = steps;
+
+	cdn_object_taint (CDN_OBJECT (node));
+	g_object_notify (G_OBJECT (node), "integrate-every");
+}
+
+/**
+ * cdn_node_get_integrate_every:
+ * @node: a #CdnNode.
+ *
+ * Get the number of simulation steps over which the integrated variables in
+ * @node are integrated at once. See #cdn_node_set_integrate_every.
+ *
+ * Returns: the number of steps, or 0 if inherited from the parent node.
+ */
+guint
+cdn_node_get_integrate_every (CdnNode *node)
+{
+	g_return_val_if_fail (CDN_IS_NODE (node), 0);
+
+	return node->priv->integrate_every;
+}
@@ -164,6 +164,11 @@ void cdn_node_set_initial_state (CdnNode     *node,
 
 const gchar *cdn_node_get_initial_state (CdnNode     *node);
 
+void  cdn_node_set_integrate_every (CdnNode *node,
+                                    guint    steps);
+
+guint cdn_node_get_integrate_every (CdnNode *node);
+
 /* used for referencing links */
 void             _cdn_node_link           (CdnNode       *node,
                                             CdnEdgeForward *link);
@@ -638,6 +638,31 @@ statement_end (CdnParserContext *context,
 	cdn_statement_set_column (st, cstart, inp->cend);
 }
 
+static CdnExpression *
+expression_new_for_statement (gchar const *expression,
+                              gpointer     obj)
+{
+	CdnExpression *ret;
+	gint start;
+	gint end;
+
+	ret = cdn_expression_new (expression);
+
+	if (!obj || !CDN_IS_STATEMENT (obj))
+	{
+		return ret;
+	}
+
+	// Keep track of where the expression was defined
+	cdn_statement_get_line (CDN_STATEMENT (obj), &start, &end);
+	cdn_statement_set_line (CDN_STATEMENT (ret), start, end);
+
+	cdn_statement_get_column (CDN_STATEMENT (obj), &start, &end);
+	cdn_statement_set_column (CDN_STATEMENT (ret), start, end);
+
+	return ret;
+}
+
 static gboolean
 parser_failed_error (CdnParserContext *context,
                      CdnStatement     *statement,
@@ -1381,6 +1406,7 @@ add_variable_diff (CdnParserContext  *context,
                    gchar const       *dotname,
                    gint               order,
                    NameValuePair     *p,
+                   CdnEmbeddedString *expression,
                    CdnVariableFlags   add_flags,
                    CdnVariableFlags   remove_flags,
                    CdnEmbeddedString *constraint,
@@ -1461,7 +1487,7 @@ add_variable_diff (CdnParserContext  *context,
 		if (i == order - 1)
 		{
 			action = cdn_edge_action_new (fname,
-			                              cdn_expression_new (ex));
+			                              expression_new_for_statement (ex, expression));
 		}
 		else
 		{
@@ -1654,7 +1680,8 @@ cdn_parser_context_set_variable (CdnParserContext  *context,
 			if (*cdn_expansion_get (ex, 0) != '\0')
 			{
 				cdn_variable_set_expression (v,
-				                             cdn_expression_new (cdn_expansion_get (ex, 0)));
+				                             expression_new_for_statement (cdn_expansion_get (ex, 0),
+				                                                           expression));
 			}
 
 			cdn_variable_add_flags (v, add_flags);
@@ -1775,6 +1802,7 @@ cdn_parser_context_add_variable (CdnParserContext  *context,
 				                   dotname,
 				                   order,
 				                   p,
+				                   expression,
 				                   add_flags,
 				                   remove_flags,
 				                   constraint,
@@ -1864,7 +1892,8 @@ cdn_parser_context_add_variable (CdnParserContext  *context,
 			flags |= add_flags;
 
 			nv = cdn_variable_new (noindexname,
-			                       cdn_expression_new (exexpression),
+			                       expression_new_for_statement (exexpression,
+			                                                     p->value ? expression : NULL),
 			                       flags);
 
 			if (property)
@@ -2100,7 +2129,8 @@ cdn_parser_context_add_action (CdnParserContext  *context,
 				}
 
 				action = cdn_edge_action_new (name,
-				                              cdn_expression_new (exexpression));
+				                              expression_new_for_statement (exexpression,
+				                                                            expression));
 
 				while (phases)
 				{
@@ -3661,6 +3691,65 @@ cdn_parser_context_set_node_state (CdnParserContext  *context,
 	g_ptr_array_free (states, TRUE);
 }
 
+/**
+ * cdn_parser_context_set_node_integrate_every: (skip)
+ */
+void
+cdn_parser_context_set_node_integrate_every (CdnParserContext  *context,
+                                             GPtrArray         *steps)
+{
+	GSList *objects;
+	gint i = 0;
+
+	g_return_if_fail (CDN_IS_PARSER_CONTEXT (context));
+	g_return_if_fail (steps != NULL);
+
+	objects = each_selections (context, FALSE);
+
+	while (objects)
+	{
+		CdnSelection *sel = objects->data;
+		CdnNode *node = cdn_selection_get_object (sel);
+		CdnEmbeddedString *every;
+
+		every = g_ptr_array_index (steps, i % steps->len);
+		++i;
+
+		if (CDN_IS_NODE (node) && !context->priv->error)
+		{
+			gchar const *st;
+			gchar *end = NULL;
+			guint64 num;
+
+			expansion_context_push_selection (context, sel);
+
+			embedded_string_expand (st, every, context);
+
+			num = g_ascii_strtoull (st, &end, 10);
+
+			if (end == st || *end != '\0' || num > G_MAXUINT)
+			{
+				parser_failed (context,
+				               CDN_STATEMENT (every),
+				               CDN_NETWORK_LOAD_ERROR_OBJECT,
+				               "Expected a number of steps for integrate-every but got `%s'",
+				               st);
+			}
+			else
+			{
+				cdn_node_set_integrate_every (node, (guint)num);
+			}
+
+			expansion_context_pop (context);
+		}
+
+		cdn_selection_unref (objects->data);
+		objects = g_slist_delete_link (objects, objects);
+	}
+
+	g_ptr_array_free (steps, TRUE);
+}
+
 /**
  * cdn_parser_context_push_edge: (skip)
  *
@@ -6709,7 +6798,8 @@ cdn_parser_context_add_event_set_variable (CdnParserContext  *context,
 
 			cdn_event_add_set_variable (ev,
 			                            CDN_VARIABLE (cdn_selection_get_object (ret->data)),
-			                            cdn_expression_new (cdn_expansion_get (val, 0)));
+			                            expression_new_for_statement (cdn_expansion_get (val, 0),
+			                                                          value));
 
 			g_slist_foreach (vals, (GFunc)cdn_expansion_unref, NULL);
 			g_slist_free (vals);
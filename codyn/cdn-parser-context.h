@@ -188,6 +188,9 @@ void                   cdn_parser_context_push_node            (CdnParserContext
 void                   cdn_parser_context_set_node_state       (CdnParserContext           *context,
                                                                 GPtrArray                  *states);
 
+void                   cdn_parser_context_set_node_integrate_every (CdnParserContext       *context,
+                                                                    GPtrArray              *steps);
+
 void                   cdn_parser_context_push_edge            (CdnParserContext           *context,
                                                                 CdnEmbeddedString          *id,
                                                                 GSList                     *templates,
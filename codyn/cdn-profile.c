@@ -0,0 +1,540 @@
+/*
+ * cdn-profile.c
+ * This file is part of codyn
+ *
+ * Copyright (C) 2011 - Jesse van den Kieboom
+ *
+ * codyn is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * codyn is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with codyn; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor,
+ * Boston, MA  02110-1301  USA
+ */
+
+#include "cdn-profile.h"
+#include "cdn-statement.h"
+#include "cdn-node.h"
+#include "cdn-edge.h"
+#include "cdn-variable.h"
+
+#include <time.h>
+
+struct _CdnProfileEntry
+{
+	CdnExpression *expression;
+
+	gchar *text;
+	gint line;
+
+	guint64 hits;
+	guint64 misses;
+
+	// Time in nanoseconds, with and without the time spent in the
+	// expressions evaluated on demand while evaluating this one
+	gint64 time;
+	gint64 self_time;
+};
+
+typedef struct
+{
+	GType type;
+
+	guint64 count;
+	gint64 time;
+} InstructionEntry;
+
+typedef struct
+{
+	CdnProfileEntry *entry;
+
+	gint64 start;
+	gint64 child_time;
+} Frame;
+
+static gboolean profile_enabled = FALSE;
+
+static GSList *profile_entries = NULL;
+static GHashTable *profile_instructions = NULL;
+static GArray *profile_frames = NULL;
+
+static gint64
+profile_now (void)
+{
+#ifdef CLOCK_MONOTONIC
+	struct timespec ts;
+
+	clock_gettime (CLOCK_MONOTONIC, &ts);
+	return (gint64)ts.tv_sec * 1000000000 + ts.tv_nsec;
+#else
+	return g_get_monotonic_time () * 1000;
+#endif
+}
+
+/**
+ * cdn_profile_set_enabled:
+ * @enabled: whether to enable profiling
+ *
+ * Enable or disable profiling of expression evaluations. When profiling is
+ * enabled, the number of evaluations, the cache hits and misses and the time
+ * spent is recorded for each expression, as well as the time spent in each
+ * type of instruction. Note that profiling slows down evaluation
+ * considerably, and that the results are accumulated until
+ * cdn_profile_reset() is called.
+ *
+ **/
+void
+cdn_profile_set_enabled (gboolean enabled)
+{
+	profile_enabled = enabled;
+}
+
+/**
+ * cdn_profile_get_enabled:
+ *
+ * Get whether profiling of expression evaluations is enabled.
+ *
+ * Returns: %TRUE if profiling is enabled, %FALSE otherwise
+ *
+ **/
+gboolean
+cdn_profile_get_enabled ()
+{
+	return profile_enabled;
+}
+
+static void
+entry_free (CdnProfileEntry *entry)
+{
+	if (entry->expression)
+	{
+		_cdn_expression_set_profile (entry->expression, NULL);
+	}
+
+	g_free (entry->text);
+	g_slice_free (CdnProfileEntry, entry);
+}
+
+static void
+instruction_entry_free (InstructionEntry *entry)
+{
+	g_slice_free (InstructionEntry, entry);
+}
+
+/**
+ * cdn_profile_reset:
+ *
+ * Discard all the profile results recorded so far.
+ *
+ **/
+void
+cdn_profile_reset ()
+{
+	g_slist_foreach (profile_entries, (GFunc)entry_free, NULL);
+	g_slist_free (profile_entries);
+	profile_entries = NULL;
+
+	if (profile_instructions)
+	{
+		g_hash_table_destroy (profile_instructions);
+		profile_instructions = NULL;
+	}
+
+	if (profile_frames)
+	{
+		g_array_set_size (profile_frames, 0);
+	}
+}
+
+CdnProfileEntry *
+_cdn_profile_entry_new (CdnExpression *expression)
+{
+	CdnProfileEntry *ret;
+
+	ret = g_slice_new0 (CdnProfileEntry);
+
+	ret->expression = expression;
+	ret->text = g_strdup (cdn_expression_get_as_string (expression));
+
+	cdn_statement_get_line (CDN_STATEMENT (expression), &ret->line, NULL);
+
+	profile_entries = g_slist_prepend (profile_entries, ret);
+	return ret;
+}
+
+void
+_cdn_profile_entry_detach (CdnProfileEntry *entry)
+{
+	// The expression is going away, keep the results
+	entry->expression = NULL;
+}
+
+void
+_cdn_profile_hit (CdnProfileEntry *entry)
+{
+	if (profile_enabled)
+	{
+		++entry->hits;
+	}
+}
+
+void
+_cdn_profile_begin (CdnProfileEntry *entry)
+{
+	Frame frame = {entry, 0, 0};
+
+	if (!profile_frames)
+	{
+		profile_frames = g_array_new (FALSE, FALSE, sizeof (Frame));
+	}
+
+	++entry->misses;
+
+	frame.start = profile_now ();
+	g_array_append_val (profile_frames, frame);
+}
+
+void
+_cdn_profile_end (CdnProfileEntry *entry)
+{
+	Frame *frame;
+	gint64 elapsed;
+
+	if (!profile_frames || profile_frames->len == 0)
+	{
+		return;
+	}
+
+	frame = &g_array_index (profile_frames, Frame, profile_frames->len - 1);
+
+	if (frame->entry != entry)
+	{
+		return;
+	}
+
+	elapsed = profile_now () - frame->start;
+
+	entry->time += elapsed;
+	entry->self_time += elapsed - frame->child_time;
+
+	g_array_set_size (profile_frames, profile_frames->len - 1);
+
+	if (profile_frames->len > 0)
+	{
+		g_array_index (profile_frames,
+		               Frame,
+		               profile_frames->len - 1).child_time += elapsed;
+	}
+}
+
+static gint64
+self_clock (void)
+{
+	gint64 ret;
+
+	ret = profile_now ();
+
+	// Do not count time spent evaluating other expressions
+	if (profile_frames && profile_frames->len > 0)
+	{
+		ret -= g_array_index (profile_frames,
+		                      Frame,
+		                      profile_frames->len - 1).child_time;
+	}
+
+	return ret;
+}
+
+gint64
+_cdn_profile_instruction_begin ()
+{
+	return self_clock ();
+}
+
+void
+_cdn_profile_instruction_end (GType  type,
+                              gint64 begin)
+{
+	InstructionEntry *entry;
+	gint64 elapsed;
+
+	elapsed = self_clock () - begin;
+
+	if (!profile_instructions)
+	{
+		profile_instructions =
+			g_hash_table_new_full (g_direct_hash,
+			                       g_direct_equal,
+			                       NULL,
+			                       (GDestroyNotify)instruction_entry_free);
+	}
+
+	entry = g_hash_table_lookup (profile_instructions, GSIZE_TO_POINTER (type));
+
+	if (!entry)
+	{
+		entry = g_slice_new0 (InstructionEntry);
+		entry->type = type;
+
+		g_hash_table_insert (profile_instructions,
+		                     GSIZE_TO_POINTER (type),
+		                     entry);
+	}
+
+	++entry->count;
+	entry->time += elapsed;
+}
+
+static void
+collect_labels (CdnObject  *object,
+                GHashTable *labels)
+{
+	GSList *variables;
+	GSList *item;
+
+	variables = cdn_object_get_variables (object);
+
+	for (item = variables; item; item = g_slist_next (item))
+	{
+		g_hash_table_insert (labels,
+		                     cdn_variable_get_expression (item->data),
+		                     cdn_variable_get_full_name_for_display (item->data));
+	}
+
+	g_slist_free (variables);
+
+	if (CDN_IS_EDGE (object))
+	{
+		GSList const *actions;
+		gchar *id;
+
+		id = cdn_object_get_full_id_for_display (object);
+
+		for (actions = cdn_edge_get_actions (CDN_EDGE (object));
+		     actions;
+		     actions = g_slist_next (actions))
+		{
+			g_hash_table_insert (labels,
+			                     cdn_edge_action_get_equation (actions->data),
+			                     g_strdup_printf ("%s<%s",
+			                                      id,
+			                                      cdn_edge_action_get_target (actions->data)));
+		}
+
+		g_free (id);
+	}
+
+	if (CDN_IS_NODE (object))
+	{
+		GSList const *children;
+
+		for (children = cdn_node_get_children (CDN_NODE (object));
+		     children;
+		     children = g_slist_next (children))
+		{
+			collect_labels (children->data, labels);
+		}
+	}
+}
+
+static gint
+compare_entries (CdnProfileEntry const **a,
+                 CdnProfileEntry const **b,
+                 gpointer                userdata)
+{
+	CdnProfileSort sort = GPOINTER_TO_INT (userdata);
+	gint64 va;
+	gint64 vb;
+
+	switch (sort)
+	{
+		case CDN_PROFILE_SORT_TIME:
+			va = (*a)->time;
+			vb = (*b)->time;
+		break;
+		case CDN_PROFILE_SORT_EVALUATIONS:
+			va = (*a)->hits + (*a)->misses;
+			vb = (*b)->hits + (*b)->misses;
+		break;
+		case CDN_PROFILE_SORT_MISSES:
+			va = (*a)->misses;
+			vb = (*b)->misses;
+		break;
+		default:
+			va = (*a)->self_time;
+			vb = (*b)->self_time;
+		break;
+	}
+
+	return va < vb ? 1 : (va > vb ? -1 : 0);
+}
+
+static gint
+compare_instructions (InstructionEntry const **a,
+                      InstructionEntry const **b)
+{
+	return (*a)->time < (*b)->time ? 1 : ((*a)->time > (*b)->time ? -1 : 0);
+}
+
+static gdouble
+percentage (gint64 part,
+            gint64 total)
+{
+	return total > 0 ? 100.0 * part / total : 0;
+}
+
+static void
+report_instructions (GString *ret)
+{
+	GPtrArray *sorted;
+	GHashTableIter iter;
+	gpointer value;
+	gint64 total = 0;
+	guint i;
+
+	if (!profile_instructions)
+	{
+		return;
+	}
+
+	sorted = g_ptr_array_new ();
+
+	g_hash_table_iter_init (&iter, profile_instructions);
+
+	while (g_hash_table_iter_next (&iter, NULL, &value))
+	{
+		InstructionEntry *entry = value;
+
+		total += entry->time;
+		g_ptr_array_add (sorted, entry);
+	}
+
+	g_ptr_array_sort (sorted, (GCompareFunc)compare_instructions);
+
+	g_string_append (ret, "\n   self ms   self %        count  instruction\n");
+
+	for (i = 0; i < sorted->len; ++i)
+	{
+		InstructionEntry *entry = g_ptr_array_index (sorted, i);
+
+		g_string_append_printf (ret,
+		                        "%10.3f %7.2f%% %12" G_GUINT64_FORMAT "  %s\n",
+		                        entry->time / 1e6,
+		                        percentage (entry->time, total),
+		                        entry->count,
+		                        g_type_name (entry->type));
+	}
+
+	g_ptr_array_free (sorted, TRUE);
+}
+
+/**
+ * cdn_profile_report:
+ * @root: (allow-none): the #CdnObject to find expression names in
+ * @sort: how to sort the report
+ * @max_entries: the maximum number of expressions to report, or 0 to report
+ *               all of them
+ *
+ * Generate a human readable report of the profile results recorded so far.
+ * For each expression the report lists the time spent in the expression
+ * itself (self time), the time including the expressions it evaluated, the
+ * number of evaluations, the cache hit ratio and the line of the expression
+ * in the file it was parsed from. If @root is given, expressions of the
+ * variables and edge actions in @root are named accordingly. The report ends
+ * with the time spent in each type of instruction.
+ *
+ * Returns: (transfer full): the report
+ *
+ **/
+gchar *
+cdn_profile_report (CdnObject      *root,
+                    CdnProfileSort  sort,
+                    guint           max_entries)
+{
+	GString *ret;
+	GPtrArray *sorted;
+	GHashTable *labels;
+	GSList *item;
+	gint64 total = 0;
+	guint i;
+
+	g_return_val_if_fail (root == NULL || CDN_IS_OBJECT (root), NULL);
+
+	labels = g_hash_table_new_full (g_direct_hash,
+	                                g_direct_equal,
+	                                NULL,
+	                                (GDestroyNotify)g_free);
+
+	if (root)
+	{
+		collect_labels (root, labels);
+	}
+
+	sorted = g_ptr_array_new ();
+
+	for (item = profile_entries; item; item = g_slist_next (item))
+	{
+		CdnProfileEntry *entry = item->data;
+
+		total += entry->self_time;
+		g_ptr_array_add (sorted, entry);
+	}
+
+	g_ptr_array_sort_with_data (sorted,
+	                            (GCompareDataFunc)compare_entries,
+	                            GINT_TO_POINTER (sort));
+
+	ret = g_string_new ("");
+
+	g_string_append_printf (ret,
+	                        "Total time: %.3f ms\n\n",
+	                        total / 1e6);
+
+	g_string_append (ret, "   self ms   self %    total ms        evals   hits %  line  expression\n");
+
+	for (i = 0; i < sorted->len && (max_entries == 0 || i < max_entries); ++i)
+	{
+		CdnProfileEntry *entry = g_ptr_array_index (sorted, i);
+		guint64 evals;
+		gchar const *label = NULL;
+		gchar *line;
+
+		evals = entry->hits + entry->misses;
+
+		if (entry->expression)
+		{
+			label = g_hash_table_lookup (labels, entry->expression);
+		}
+
+		line = entry->line > 0 ? g_strdup_printf ("%d", entry->line) : g_strdup ("-");
+
+		g_string_append_printf (ret,
+		                        "%10.3f %7.2f%% %11.3f %12" G_GUINT64_FORMAT " %7.2f%% %5s  %s%s%s\n",
+		                        entry->self_time / 1e6,
+		                        percentage (entry->self_time, total),
+		                        entry->time / 1e6,
+		                        evals,
+		                        evals > 0 ? 100.0 * entry->hits / evals : 0,
+		                        line,
+		                        label ? label : "",
+		                        label ? " = " : "",
+		                        entry->text);
+
+		g_free (line);
+	}
+
+	report_instructions (ret);
+
+	g_ptr_array_free (sorted, TRUE);
+	g_hash_table_destroy (labels);
+
+	return g_string_free (ret, FALSE);
+}
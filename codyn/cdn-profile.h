@@ -0,0 +1,72 @@
+/*
+ * cdn-profile.h
+ * This file is part of codyn
+ *
+ * Copyright (C) 2011 - Jesse van den Kieboom
+ *
+ * codyn is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * codyn is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with codyn; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor,
+ * Boston, MA  02110-1301  USA
+ */
+
+#ifndef __CDN_PROFILE_H__
+#define __CDN_PROFILE_H__
+
+#include <glib-object.h>
+#include <codyn/cdn-object.h>
+#include <codyn/cdn-expression.h>
+
+G_BEGIN_DECLS
+
+/**
+ * CdnProfileSort:
+ * @CDN_PROFILE_SORT_SELF_TIME: sort by the time spent in the expression itself
+ * @CDN_PROFILE_SORT_TIME: sort by the time spent in the expression, including
+ *                         the expressions it evaluated
+ * @CDN_PROFILE_SORT_EVALUATIONS: sort by the number of evaluations
+ * @CDN_PROFILE_SORT_MISSES: sort by the number of cache misses
+ *
+ * Sort order of a profile report.
+ */
+typedef enum
+{
+	CDN_PROFILE_SORT_SELF_TIME,
+	CDN_PROFILE_SORT_TIME,
+	CDN_PROFILE_SORT_EVALUATIONS,
+	CDN_PROFILE_SORT_MISSES
+} CdnProfileSort;
+
+void      cdn_profile_set_enabled (gboolean        enabled);
+gboolean  cdn_profile_get_enabled (void);
+
+void      cdn_profile_reset       (void);
+
+gchar    *cdn_profile_report      (CdnObject      *root,
+                                   CdnProfileSort  sort,
+                                   guint           max_entries);
+
+CdnProfileEntry *_cdn_profile_entry_new          (CdnExpression   *expression);
+void             _cdn_profile_entry_detach       (CdnProfileEntry *entry);
+
+void             _cdn_profile_hit                (CdnProfileEntry *entry);
+void             _cdn_profile_begin              (CdnProfileEntry *entry);
+void             _cdn_profile_end                (CdnProfileEntry *entry);
+
+gint64           _cdn_profile_instruction_begin  (void);
+void             _cdn_profile_instruction_end    (GType            type,
+                                                  gint64           begin);
+
+G_END_DECLS
+
+#endif /* __CDN_PROFILE_H__ */
@@ -9,7 +9,36 @@ struct _CdnStack
 	gdouble *output_ptr;
 	gdouble *output;
 	guint size;
+
+	guint borrowed : 1;
 };
 
+/* Structural sparsity of a stack argument. Only the elements listed in
+ * nonzeros (column-major indices, sorted) can be different from zero. The
+ * values themselves are still stored densely on the stack.
+ */
+struct _CdnStackSparsity
+{
+	gint *nonzeros;
+	gint num_nonzeros;
+
+	// All nonzeros are on or below (lower), or on or above (upper) the
+	// diagonal
+	guint lower : 1;
+	guint upper : 1;
+};
+
+void     _cdn_stack_borrow      (CdnStack *stack,
+                                 gdouble  *storage,
+                                 guint     size);
+void     _cdn_stack_unborrow    (CdnStack *stack);
+gboolean _cdn_stack_is_borrowed (CdnStack *stack);
+
+CdnStackSparsity *_cdn_stack_sparsity_new_from_mask (CdnDimension const     *dim,
+                                                     gboolean const         *mask);
+gboolean         *_cdn_stack_sparsity_get_mask      (CdnStackSparsity const *sparsity,
+                                                     CdnDimension const     *dim);
+void              _cdn_stack_sparsity_free          (CdnStackSparsity       *sparsity);
+
 #endif /* __CDN_STACK_PRIVATE_H__ */
 
@@ -251,6 +251,7 @@ cdn_stack_init (CdnStack  *stack,
                 guint      size)
 {
 	stack->size = size;
+	stack->borrowed = FALSE;
 
 	if (size)
 	{
@@ -319,7 +320,14 @@ void
 cdn_stack_resize (CdnStack *stack,
                   guint     size)
 {
-	if (size != stack->size)
+	if (size != stack->size && stack->borrowed)
+	{
+		// Borrowed storage cannot grow, fall back to owned memory
+		stack->borrowed = FALSE;
+		stack->output = g_new0 (gdouble, size);
+		stack->size = size;
+	}
+	else if (size != stack->size)
 	{
 		stack->output = g_renew (gdouble, stack->output, size);
 		memset(stack->output, 0, size);
@@ -340,13 +348,208 @@ cdn_stack_resize (CdnStack *stack,
 void
 cdn_stack_destroy (CdnStack *stack)
 {
-	g_free (stack->output);
+	if (!stack->borrowed)
+	{
+		g_free (stack->output);
+	}
+
+	stack->borrowed = FALSE;
 
 	stack->output = NULL;
 	stack->output_ptr = NULL;
 	stack->size = 0;
 }
 
+/*
+ * _cdn_stack_borrow:
+ * @stack: A #CdnStack
+ * @storage: the memory to use for the stack
+ * @size: the number of values in @storage
+ *
+ * Make the stack use @storage instead of its own memory. The stack does not
+ * take ownership of @storage, which must stay alive until the stack is
+ * destroyed or #_cdn_stack_unborrow is called. The current contents of the
+ * stack are copied to @storage.
+ *
+ */
+void
+_cdn_stack_borrow (CdnStack *stack,
+                   gdouble  *storage,
+                   guint     size)
+{
+	guint count;
+
+	count = MIN (cdn_stack_count (stack), size);
+	memcpy (storage, stack->output, sizeof (gdouble) * count);
+
+	if (!stack->borrowed)
+	{
+		g_free (stack->output);
+	}
+
+	stack->output = storage;
+	stack->output_ptr = storage + count;
+	stack->size = size;
+	stack->borrowed = TRUE;
+}
+
+/*
+ * _cdn_stack_unborrow:
+ * @stack: A #CdnStack
+ *
+ * Move the stack back to its own memory after #_cdn_stack_borrow. The
+ * contents of the stack are preserved.
+ *
+ */
+void
+_cdn_stack_unborrow (CdnStack *stack)
+{
+	gdouble *output;
+
+	if (!stack->borrowed)
+	{
+		return;
+	}
+
+	output = g_new (gdouble, stack->size > 0 ? stack->size : 1);
+	memcpy (output, stack->output, sizeof (gdouble) * stack->size);
+
+	stack->output_ptr = output + (stack->output_ptr - stack->output);
+	stack->output = output;
+	stack->borrowed = FALSE;
+}
+
+gboolean
+_cdn_stack_is_borrowed (CdnStack *stack)
+{
+	return stack->borrowed;
+}
+
+/*
+ * _cdn_stack_sparsity_new_from_mask:
+ * @dim: the dimension of the argument
+ * @mask: column-major mask of the elements which can be nonzero
+ *
+ * Create the structural sparsity of an argument of dimension @dim from
+ * @mask.
+ *
+ * Returns: a new #CdnStackSparsity, or %NULL if all elements can be nonzero
+ *
+ */
+CdnStackSparsity *
+_cdn_stack_sparsity_new_from_mask (CdnDimension const *dim,
+                                   gboolean const     *mask)
+{
+	CdnStackSparsity *ret;
+	gint num;
+	gint i;
+	gint n = 0;
+
+	num = cdn_dimension_size (dim);
+
+	for (i = 0; i < num; ++i)
+	{
+		if (mask[i])
+		{
+			++n;
+		}
+	}
+
+	if (n == num)
+	{
+		return NULL;
+	}
+
+	ret = g_slice_new (CdnStackSparsity);
+
+	ret->nonzeros = g_new (gint, n > 0 ? n : 1);
+	ret->num_nonzeros = 0;
+	ret->lower = TRUE;
+	ret->upper = TRUE;
+
+	for (i = 0; i < num; ++i)
+	{
+		gint r;
+		gint c;
+
+		if (!mask[i])
+		{
+			continue;
+		}
+
+		r = i % dim->rows;
+		c = i / dim->rows;
+
+		if (r < c)
+		{
+			ret->lower = FALSE;
+		}
+		else if (r > c)
+		{
+			ret->upper = FALSE;
+		}
+
+		ret->nonzeros[ret->num_nonzeros++] = i;
+	}
+
+	return ret;
+}
+
+/*
+ * _cdn_stack_sparsity_get_mask:
+ * @sparsity: (allow-none): a #CdnStackSparsity
+ * @dim: the dimension of the argument
+ *
+ * Get the column-major mask of elements which can be nonzero. A %NULL
+ * @sparsity means that all elements can be nonzero.
+ *
+ * Returns: (transfer full): a newly allocated mask
+ *
+ */
+gboolean *
+_cdn_stack_sparsity_get_mask (CdnStackSparsity const *sparsity,
+                              CdnDimension const     *dim)
+{
+	gboolean *ret;
+	gint num;
+	gint i;
+
+	num = cdn_dimension_size (dim);
+
+	if (!sparsity)
+	{
+		ret = g_new (gboolean, num);
+
+		for (i = 0; i < num; ++i)
+		{
+			ret[i] = TRUE;
+		}
+
+		return ret;
+	}
+
+	ret = g_new0 (gboolean, num);
+
+	for (i = 0; i < sparsity->num_nonzeros; ++i)
+	{
+		ret[sparsity->nonzeros[i]] = TRUE;
+	}
+
+	return ret;
+}
+
+void
+_cdn_stack_sparsity_free (CdnStackSparsity *sparsity)
+{
+	if (!sparsity)
+	{
+		return;
+	}
+
+	g_free (sparsity->nonzeros);
+	g_slice_free (CdnStackSparsity, sparsity);
+}
+
 /**
  * cdn_stack_free:
  * @stack: A #CdnStack
@@ -36,6 +36,8 @@ G_BEGIN_DECLS
  */
 typedef struct _CdnStack CdnStack;
 
+typedef struct _CdnStackSparsity CdnStackSparsity;
+
 #ifdef __GI_SCANNER__
 
 typedef struct
@@ -356,3 +356,117 @@ cdn_instruction_rand_reset (CdnInstructionRand *self)
 
 	cdn_instruction_rand_next (self);
 }
+
+/**
+ * cdn_instruction_rand_save_state:
+ * @self: the #CdnInstructionRand
+ *
+ * Save the current random values of the instruction and, when using
+ * streams, the state of its random number generator.
+ *
+ * Returns: (transfer full): a floating #GVariant
+ *
+ */
+GVariant *
+cdn_instruction_rand_save_state (CdnInstructionRand *self)
+{
+	GVariantBuilder values;
+	GVariant *stream;
+	guint i;
+
+	g_variant_builder_init (&values, G_VARIANT_TYPE ("ax"));
+
+	for (i = 0; i < self->priv->num_random_value; ++i)
+	{
+		g_variant_builder_add (&values, "x", (gint64)self->priv->random_value[i]);
+	}
+
+	stream = NULL;
+
+#ifndef MINGW
+	if (use_streams)
+	{
+		CdnInstructionRandStatePrivate *spriv =
+			(CdnInstructionRandStatePrivate *)self->priv;
+
+		stream = g_variant_new_fixed_array (G_VARIANT_TYPE_BYTE,
+		                                    spriv->state,
+		                                    sizeof (spriv->state),
+		                                    1);
+	}
+#endif
+
+	if (!stream)
+	{
+		stream = g_variant_new_array (G_VARIANT_TYPE_BYTE, NULL, 0);
+	}
+
+	return g_variant_new ("(ax@ay)", &values, stream);
+}
+
+/**
+ * cdn_instruction_rand_restore_state:
+ * @self: the #CdnInstructionRand
+ * @state: a #GVariant obtained from #cdn_instruction_rand_save_state
+ *
+ * Restore the random values (and stream state) of the instruction. Note that
+ * when not using streams, the random values come from the global generator
+ * of the C library, whose state cannot be restored.
+ *
+ * Returns: %TRUE if the state could be restored, %FALSE otherwise
+ *
+ */
+gboolean
+cdn_instruction_rand_restore_state (CdnInstructionRand *self,
+                                    GVariant           *state)
+{
+	GVariant *values;
+	GVariant *stream;
+	gint64 const *vals;
+	gsize num;
+	guint i;
+
+	if (!g_variant_is_of_type (state, G_VARIANT_TYPE ("(axay)")))
+	{
+		return FALSE;
+	}
+
+	g_variant_get (state, "(@ax@ay)", &values, &stream);
+
+	vals = g_variant_get_fixed_array (values, &num, sizeof (gint64));
+
+	if (num != self->priv->num_random_value)
+	{
+		g_variant_unref (values);
+		g_variant_unref (stream);
+
+		return FALSE;
+	}
+
+	for (i = 0; i < num; ++i)
+	{
+		self->priv->random_value[i] = (glong)vals[i];
+	}
+
+#ifndef MINGW
+	if (use_streams)
+	{
+		CdnInstructionRandStatePrivate *spriv =
+			(CdnInstructionRandStatePrivate *)self->priv;
+		guint8 const *st;
+		gsize num_stream;
+
+		st = g_variant_get_fixed_array (stream, &num_stream, 1);
+
+		if (num_stream == sizeof (spriv->state))
+		{
+			memcpy (spriv->state, st, num_stream);
+		}
+	}
+#endif
+
+	g_variant_unref (values);
+	g_variant_unref (stream);
+
+	return TRUE;
+}
@@ -45,6 +45,10 @@ guint           cdn_instruction_rand_get_seed (CdnInstructionRand *self);
 
 void            cdn_instruction_rand_reset (CdnInstructionRand *self);
 
+GVariant       *cdn_instruction_rand_save_state    (CdnInstructionRand *self);
+gboolean        cdn_instruction_rand_restore_state (CdnInstructionRand *self,
+                                                    GVariant           *state);
+
 G_END_DECLS
 
 #endif /* __CDN_INSTRUCTION_RAND_H__ */
@@ -0,0 +1,946 @@
+/*
+ * cdn-integrator-dormand-prince.c
+ * This file is part of codyn
+ *
+ * Copyright (C) 2011 - Jesse van den Kieboom
+ *
+ * codyn is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * codyn is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with codyn; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor,
+ * Boston, MA  02110-1301  USA
+ */
+
+
+#include "cdn-integrator-dormand-prince.h"
+#include "cdn-network.h"
+#include <math.h>
+#include <string.h>
+
+#define CDN_INTEGRATOR_DORMAND_PRINCE_GET_PRIVATE(object)(G_TYPE_INSTANCE_GET_PRIVATE((object), CDN_TYPE_INTEGRATOR_DORMAND_PRINCE, CdnIntegratorDormandPrincePrivate))
+
+#define NUM_STAGES 7
+#define NUM_DENSE 5
+
+#define DEFAULT_ABSOLUTE_TOLERANCE 1e-6
+#define DEFAULT_RELATIVE_TOLERANCE 1e-6
+#define DEFAULT_MINIMUM_STEP 1e-10
+
+/* Step size control (Hairer, Norsett & Wanner) */
+#define SAFETY 0.9
+#define MIN_FACTOR 0.2
+#define MAX_FACTOR 5.0
+
+static const gdouble c[NUM_STAGES] = {
+	0, 1 / 5.0, 3 / 10.0, 4 / 5.0, 8 / 9.0, 1, 1
+};
+
+static const gdouble a[NUM_STAGES][NUM_STAGES - 1] = {
+	{0, 0, 0, 0, 0, 0},
+	{1 / 5.0, 0, 0, 0, 0, 0},
+	{3 / 40.0, 9 / 40.0, 0, 0, 0, 0},
+	{44 / 45.0, -56 / 15.0, 32 / 9.0, 0, 0, 0},
+	{19372 / 6561.0, -25360 / 2187.0, 64448 / 6561.0, -212 / 729.0, 0, 0},
+	{9017 / 3168.0, -355 / 33.0, 46732 / 5247.0, 49 / 176.0, -5103 / 18656.0, 0},
+	{35 / 384.0, 0, 500 / 1113.0, 125 / 192.0, -2187 / 6784.0, 11 / 84.0}
+};
+
+/* Difference between the 5th and the embedded 4th order solutions */
+static const gdouble e[NUM_STAGES] = {
+	71 / 57600.0, 0, -71 / 16695.0, 71 / 1920.0, -17253 / 339200.0, 22 / 525.0, -1 / 40.0
+};
+
+/* Dense output coefficients */
+static const gdouble d[NUM_STAGES] = {
+	-12715105075 / 11282082432.0,
+	0,
+	87487479700 / 32700410799.0,
+	-10690763975 / 1880347072.0,
+	701980252875 / 199316789632.0,
+	-1453857185 / 822651844.0,
+	69997945 / 29380423.0
+};
+
+struct _CdnIntegratorDormandPrincePrivate
+{
+	gdouble absolute_tolerance;
+	gdouble relative_tolerance;
+	gdouble minimum_step;
+	gdouble maximum_step;
+
+	guint num_values;
+
+	/* Last accepted internal step, from (t0, y0) to (t1, y1) */
+	gdouble t0;
+	gdouble t1;
+	gdouble *y0;
+	gdouble *y1;
+
+	gdouble *ynew;
+	gdouble *ytmp;
+	gdouble *k[NUM_STAGES];
+	gdouble *dense[NUM_DENSE];
+
+	/* Values last handed to the network, at time tout */
+	gdouble tout;
+	gdouble *yout;
+
+	/* Proposed size of the next internal step */
+	gdouble h;
+
+	guint num_steps;
+	guint num_rejected;
+
+	guint has_dense : 1;
+	guint fsal : 1;
+	guint warned_tolerance : 1;
+};
+
+/* Properties */
+enum
+{
+	PROP_0,
+	PROP_ABSOLUTE_TOLERANCE,
+	PROP_RELATIVE_TOLERANCE,
+	PROP_MINIMUM_STEP,
+	PROP_MAXIMUM_STEP
+};
+
+G_DEFINE_TYPE (CdnIntegratorDormandPrince, cdn_integrator_dormand_prince, CDN_TYPE_INTEGRATOR)
+
+static void
+free_buffers (CdnIntegratorDormandPrince *dp)
+{
+	guint i;
+
+	g_free (dp->priv->y0);
+	g_free (dp->priv->y1);
+	g_free (dp->priv->ynew);
+	g_free (dp->priv->ytmp);
+	g_free (dp->priv->yout);
+
+	dp->priv->y0 = NULL;
+	dp->priv->y1 = NULL;
+	dp->priv->ynew = NULL;
+	dp->priv->ytmp = NULL;
+	dp->priv->yout = NULL;
+
+	for (i = 0; i < NUM_STAGES; ++i)
+	{
+		g_free (dp->priv->k[i]);
+		dp->priv->k[i] = NULL;
+	}
+
+	for (i = 0; i < NUM_DENSE; ++i)
+	{
+		g_free (dp->priv->dense[i]);
+		dp->priv->dense[i] = NULL;
+	}
+
+	dp->priv->num_values = 0;
+}
+
+static void
+cdn_integrator_dormand_prince_finalize (GObject *object)
+{
+	free_buffers (CDN_INTEGRATOR_DORMAND_PRINCE (object));
+
+	G_OBJECT_CLASS (cdn_integrator_dormand_prince_parent_class)->finalize (object);
+}
+
+static void
+initialize_buffers (CdnIntegratorDormandPrince *dp)
+{
+	guint len;
+	guint i;
+
+	len = cdn_integrator_state_integrated_size (cdn_integrator_get_state (CDN_INTEGRATOR (dp)));
+
+	dp->priv->has_dense = FALSE;
+	dp->priv->fsal = FALSE;
+	dp->priv->h = 0;
+
+	if (len == dp->priv->num_values && dp->priv->y0)
+	{
+		return;
+	}
+
+	free_buffers (dp);
+
+	dp->priv->y0 = g_new0 (gdouble, len);
+	dp->priv->y1 = g_new0 (gdouble, len);
+	dp->priv->ynew = g_new0 (gdouble, len);
+	dp->priv->ytmp = g_new0 (gdouble, len);
+	dp->priv->yout = g_new0 (gdouble, len);
+
+	for (i = 0; i < NUM_STAGES; ++i)
+	{
+		dp->priv->k[i] = g_new0 (gdouble, len);
+	}
+
+	for (i = 0; i < NUM_DENSE; ++i)
+	{
+		dp->priv->dense[i] = g_new0 (gdouble, len);
+	}
+
+	dp->priv->num_values = len;
+}
+
+static void
+derivatives (CdnIntegrator *integrator,
+             gdouble        t,
+             gdouble        h,
+             gdouble       *k)
+{
+	cdn_integrator_evaluate (integrator, t, h);
+
+	cdn_integrator_state_get_integrated_updates (cdn_integrator_get_state (integrator),
+	                                             k);
+}
+
+/* The internal steps can only run past the end of the requested step when
+ * nothing but the integrated variables changes between requested steps. The
+ * rate of slow nodes changes at the end of each of their intervals. */
+static gboolean
+is_continuous (CdnIntegratorState *state)
+{
+	return cdn_integrator_state_phase_events (state) == NULL &&
+	       cdn_integrator_state_discrete_variables (state) == NULL &&
+	       cdn_integrator_state_operators (state) == NULL &&
+	       cdn_integrator_state_io (state) == NULL &&
+	       cdn_integrator_state_rand_instructions (state) == NULL &&
+	       cdn_integrator_state_slow_edge_actions (state) == NULL;
+}
+
+/* Attempt a single internal step of size h from (t1, y1) into ynew and
+ * return the scaled error norm of the step */
+static gdouble
+attempt_step (CdnIntegratorDormandPrince *dp,
+              CdnIntegratorState         *state,
+              gdouble                     h)
+{
+	CdnIntegrator *integrator = CDN_INTEGRATOR (dp);
+	CdnIntegratorDormandPrincePrivate *priv = dp->priv;
+	gdouble err = 0;
+	guint s;
+	guint i;
+
+	if (!priv->fsal)
+	{
+		cdn_integrator_state_set_integrated_values (state, priv->y1);
+		derivatives (integrator, priv->t1, h, priv->k[0]);
+
+		priv->fsal = TRUE;
+	}
+
+	for (s = 1; s < NUM_STAGES; ++s)
+	{
+		gdouble *y = (s == NUM_STAGES - 1) ? priv->ynew : priv->ytmp;
+
+		for (i = 0; i < priv->num_values; ++i)
+		{
+			gdouble sum = 0;
+			guint j;
+
+			for (j = 0; j < s; ++j)
+			{
+				sum += a[s][j] * priv->k[j][i];
+			}
+
+			y[i] = priv->y1[i] + h * sum;
+		}
+
+		cdn_integrator_state_set_integrated_values (state, y);
+		derivatives (integrator, priv->t1 + c[s] * h, h, priv->k[s]);
+	}
+
+	for (i = 0; i < priv->num_values; ++i)
+	{
+		gdouble est = 0;
+		gdouble sc;
+		guint j;
+
+		for (j = 0; j < NUM_STAGES; ++j)
+		{
+			est += e[j] * priv->k[j][i];
+		}
+
+		sc = priv->absolute_tolerance +
+		     priv->relative_tolerance * MAX (fabs (priv->y1[i]),
+		                                     fabs (priv->ynew[i]));
+
+		est = h * est / sc;
+		err += est * est;
+	}
+
+	return priv->num_values > 0 ? sqrt (err / priv->num_values) : 0;
+}
+
+static void
+accept_step (CdnIntegratorDormandPrince *dp,
+             gdouble                     h)
+{
+	CdnIntegratorDormandPrincePrivate *priv = dp->priv;
+	gdouble *tmp;
+	guint i;
+
+	for (i = 0; i < priv->num_values; ++i)
+	{
+		gdouble ydiff;
+		gdouble bspl;
+		gdouble sum = 0;
+		guint j;
+
+		ydiff = priv->ynew[i] - priv->y1[i];
+		bspl = h * priv->k[0][i] - ydiff;
+
+		for (j = 0; j < NUM_STAGES; ++j)
+		{
+			sum += d[j] * priv->k[j][i];
+		}
+
+		priv->dense[0][i] = priv->y1[i];
+		priv->dense[1][i] = ydiff;
+		priv->dense[2][i] = bspl;
+		priv->dense[3][i] = ydiff - h * priv->k[NUM_STAGES - 1][i] - bspl;
+		priv->dense[4][i] = h * sum;
+	}
+
+	tmp = priv->y0;
+	priv->y0 = priv->y1;
+	priv->y1 = priv->ynew;
+	priv->ynew = tmp;
+
+	/* First same as last */
+	tmp = priv->k[0];
+	priv->k[0] = priv->k[NUM_STAGES - 1];
+	priv->k[NUM_STAGES - 1] = tmp;
+
+	priv->t0 = priv->t1;
+	priv->t1 += h;
+
+	priv->has_dense = TRUE;
+	++priv->num_steps;
+}
+
+static void
+interpolate (CdnIntegratorDormandPrince *dp,
+             gdouble                     t,
+             gdouble                    *y)
+{
+	CdnIntegratorDormandPrincePrivate *priv = dp->priv;
+	gdouble theta;
+	gdouble theta1;
+	guint i;
+
+	theta = (t - priv->t0) / (priv->t1 - priv->t0);
+	theta1 = 1 - theta;
+
+	for (i = 0; i < priv->num_values; ++i)
+	{
+		y[i] = priv->dense[0][i] +
+		       theta * (priv->dense[1][i] +
+		                theta1 * (priv->dense[2][i] +
+		                          theta * (priv->dense[3][i] +
+		                                   theta1 * priv->dense[4][i])));
+	}
+}
+
+static void
+cdn_integrator_dormand_prince_reset_impl (CdnIntegrator *integrator)
+{
+	CdnIntegratorDormandPrince *dp = CDN_INTEGRATOR_DORMAND_PRINCE (integrator);
+
+	if (CDN_INTEGRATOR_CLASS (cdn_integrator_dormand_prince_parent_class)->reset)
+	{
+		CDN_INTEGRATOR_CLASS (cdn_integrator_dormand_prince_parent_class)->reset (integrator);
+	}
+
+	initialize_buffers (dp);
+
+	dp->priv->num_steps = 0;
+	dp->priv->num_rejected = 0;
+	dp->priv->warned_tolerance = FALSE;
+}
+
+/* Put the values at the start of the step (stored in yout) back and start
+ * afresh on the next step */
+static gdouble
+fail_step (CdnIntegratorDormandPrince *dp,
+           CdnIntegratorState         *state)
+{
+	CdnIntegratorDormandPrincePrivate *priv = dp->priv;
+
+	cdn_integrator_state_set_integrated_values (state, priv->yout);
+
+	priv->has_dense = FALSE;
+	priv->fsal = FALSE;
+	priv->h = 0;
+
+	return 0;
+}
+
+static gdouble
+cdn_integrator_dormand_prince_step_impl (CdnIntegrator *integrator,
+                                         gdouble        t,
+                                         gdouble        timestep)
+{
+	CdnIntegratorDormandPrince *dp;
+	CdnIntegratorDormandPrincePrivate *priv;
+	CdnIntegratorState *state;
+	CdnIntegratorClass *cls;
+	gboolean continuous;
+	gdouble target;
+	gdouble eps;
+
+	dp = CDN_INTEGRATOR_DORMAND_PRINCE (integrator);
+	priv = dp->priv;
+
+	if (!cdn_integrator_step_prepare (integrator, t, timestep))
+	{
+		return 0;
+	}
+
+	state = cdn_integrator_get_state (integrator);
+
+	if (cdn_integrator_state_integrated_size (state) != priv->num_values)
+	{
+		initialize_buffers (dp);
+	}
+
+	continuous = is_continuous (state);
+	target = t + timestep;
+	eps = 1e-12 * MAX (1, fabs (target));
+
+	cdn_integrator_state_get_integrated_values (state, priv->ytmp);
+
+	/* Continue from the last internal step only if nobody touched the
+	 * values since they were handed out */
+	if (!continuous ||
+	    !priv->has_dense ||
+	    fabs (t - priv->tout) > eps ||
+	    memcmp (priv->ytmp, priv->yout, sizeof (gdouble) * priv->num_values) != 0)
+	{
+		memcpy (priv->y1, priv->ytmp, sizeof (gdouble) * priv->num_values);
+		memcpy (priv->yout, priv->ytmp, sizeof (gdouble) * priv->num_values);
+
+		priv->t1 = t;
+		priv->has_dense = FALSE;
+		priv->fsal = FALSE;
+	}
+
+	if (priv->h <= 0)
+	{
+		priv->h = timestep;
+	}
+
+	while (priv->t1 < target - eps)
+	{
+		gdouble h = priv->h;
+		gboolean clipped = FALSE;
+		gboolean rejected = FALSE;
+
+		if (priv->maximum_step > 0 && h > priv->maximum_step)
+		{
+			h = priv->maximum_step;
+		}
+
+		if (!continuous && priv->t1 + h > target)
+		{
+			h = target - priv->t1;
+			clipped = TRUE;
+		}
+
+		while (TRUE)
+		{
+			gdouble err;
+			gdouble factor;
+
+			err = attempt_step (dp, state, h);
+
+			/* A step which cannot be made any smaller is accepted
+			 * even when it does not meet the tolerance, but it
+			 * is an error when it does not even give numbers */
+			if (h <= priv->minimum_step && !isfinite (err))
+			{
+				g_warning ("Dormand-Prince: the error of the step at t = %g "
+				           "is not finite at the minimum step size",
+				           priv->t1);
+
+				return fail_step (dp, state);
+			}
+
+			if (err <= 1 || h <= priv->minimum_step)
+			{
+				if (err > 1 && !priv->warned_tolerance)
+				{
+					g_warning ("Dormand-Prince: the tolerance is not met at "
+					           "t = %g with the minimum step size (%g)",
+					           priv->t1,
+					           priv->minimum_step);
+
+					priv->warned_tolerance = TRUE;
+				}
+
+				factor = err > 0 ? SAFETY * pow (err, -0.2) : MAX_FACTOR;
+				factor = CLAMP (factor, MIN_FACTOR, rejected ? 1 : MAX_FACTOR);
+
+				accept_step (dp, h);
+
+				/* A step shortened to end on the requested
+				 * time says little about the next step */
+				priv->h = clipped ? MAX (priv->h, h * factor) : h * factor;
+				break;
+			}
+
+			factor = isfinite (err) ? MAX (MIN_FACTOR, SAFETY * pow (err, -0.2))
+			                        : MIN_FACTOR;
+
+			h = MAX (h * factor, priv->minimum_step);
+			clipped = FALSE;
+			rejected = TRUE;
+
+			++priv->num_rejected;
+		}
+	}
+
+	if (priv->has_dense && target < priv->t1 - eps)
+	{
+		interpolate (dp, target, priv->yout);
+	}
+	else
+	{
+		memcpy (priv->yout, priv->y1, sizeof (gdouble) * priv->num_values);
+	}
+
+	cdn_integrator_state_set_integrated_values (state, priv->yout);
+	priv->tout = target;
+
+	cls = CDN_INTEGRATOR_CLASS (cdn_integrator_dormand_prince_parent_class);
+
+	/* Chain up to emit 'step' */
+	return cls->step (integrator, t, timestep);
+}
+
+static gboolean
+cdn_integrator_dormand_prince_interpolate_impl (CdnIntegrator *integrator,
+                                                gdouble        t,
+                                                gdouble       *values)
+{
+	CdnIntegratorDormandPrince *dp = CDN_INTEGRATOR_DORMAND_PRINCE (integrator);
+	CdnIntegratorDormandPrincePrivate *priv = dp->priv;
+	gdouble eps;
+
+	eps = 1e-12 * MAX (1, fabs (t));
+
+	if (!priv->has_dense || t < priv->t0 - eps || t > priv->t1 + eps)
+	{
+		return FALSE;
+	}
+
+	interpolate (dp, t, values);
+	return TRUE;
+}
+
+/* The buffers which are carried over from one step to the next: y1, yout,
+ * the first same as last stage and the dense output coefficients */
+static gdouble **
+state_buffers (CdnIntegratorDormandPrince *dp,
+               guint                      *num)
+{
+	gdouble **ret;
+	guint i;
+
+	*num = 3 + NUM_DENSE;
+	ret = g_new (gdouble *, *num);
+
+	ret[0] = dp->priv->y1;
+	ret[1] = dp->priv->yout;
+	ret[2] = dp->priv->k[0];
+
+	for (i = 0; i < NUM_DENSE; ++i)
+	{
+		ret[3 + i] = dp->priv->dense[i];
+	}
+
+	return ret;
+}
+
+static GVariant *
+cdn_integrator_dormand_prince_save_state_impl (CdnIntegrator *integrator)
+{
+	CdnIntegratorDormandPrince *dp = CDN_INTEGRATOR_DORMAND_PRINCE (integrator);
+	CdnIntegratorDormandPrincePrivate *priv = dp->priv;
+	GVariantBuilder buffers;
+	gdouble **bufs;
+	guint num;
+	guint i;
+
+	g_variant_builder_init (&buffers, G_VARIANT_TYPE ("aad"));
+	bufs = state_buffers (dp, &num);
+
+	for (i = 0; i < num; ++i)
+	{
+		g_variant_builder_add_value (&buffers,
+		                             g_variant_new_fixed_array (G_VARIANT_TYPE_DOUBLE,
+		                                                        bufs[i],
+		                                                        priv->num_values,
+		                                                        sizeof (gdouble)));
+	}
+
+	g_free (bufs);
+
+	return g_variant_new ("(ddddbbuuaad)",
+	                      priv->t0,
+	                      priv->t1,
+	                      priv->tout,
+	                      priv->h,
+	                      (gboolean)priv->has_dense,
+	                      (gboolean)priv->fsal,
+	                      priv->num_steps,
+	                      priv->num_rejected,
+	                      &buffers);
+}
+
+static gboolean
+cdn_integrator_dormand_prince_restore_state_impl (CdnIntegrator *integrator,
+                                                  GVariant      *state)
+{
+	CdnIntegratorDormandPrince *dp = CDN_INTEGRATOR_DORMAND_PRINCE (integrator);
+	CdnIntegratorDormandPrincePrivate *priv = dp->priv;
+	GVariant *buffers;
+	gdouble t0;
+	gdouble t1;
+	gdouble tout;
+	gdouble h;
+	gboolean has_dense;
+	gboolean fsal;
+	guint num_steps;
+	guint num_rejected;
+	gdouble **bufs;
+	guint num;
+	guint i;
+
+	if (!g_variant_is_of_type (state, G_VARIANT_TYPE ("(ddddbbuuaad)")))
+	{
+		return FALSE;
+	}
+
+	if (cdn_integrator_state_integrated_size (cdn_integrator_get_state (integrator)) != priv->num_values)
+	{
+		initialize_buffers (dp);
+	}
+
+	g_variant_get (state,
+	               "(ddddbbuu@aad)",
+	               &t0,
+	               &t1,
+	               &tout,
+	               &h,
+	               &has_dense,
+	               &fsal,
+	               &num_steps,
+	               &num_rejected,
+	               &buffers);
+
+	bufs = state_buffers (dp, &num);
+
+	if (g_variant_n_children (buffers) != num)
+	{
+		g_free (bufs);
+		g_variant_unref (buffers);
+
+		return FALSE;
+	}
+
+	for (i = 0; i < num; ++i)
+	{
+		GVariant *item;
+		gdouble const *values;
+		gsize n;
+
+		item = g_variant_get_child_value (buffers, i);
+		values = g_variant_get_fixed_array (item, &n, sizeof (gdouble));
+
+		if (n != priv->num_values)
+		{
+			g_variant_unref (item);
+			g_free (bufs);
+			g_variant_unref (buffers);
+
+			return FALSE;
+		}
+
+		memcpy (bufs[i], values, sizeof (gdouble) * n);
+		g_variant_unref (item);
+	}
+
+	g_free (bufs);
+	g_variant_unref (buffers);
+
+	priv->t0 = t0;
+	priv->t1 = t1;
+	priv->tout = tout;
+	priv->h = h;
+	priv->has_dense = has_dense;
+	priv->fsal = fsal;
+	priv->num_steps = num_steps;
+	priv->num_rejected = num_rejected;
+
+	return TRUE;
+}
+
+static gchar const *
+cdn_integrator_dormand_prince_get_name_impl (CdnIntegrator *integrator)
+{
+	return "Dormand-Prince 5(4)";
+}
+
+static void
+cdn_integrator_dormand_prince_set_property (GObject      *object,
+                                            guint         prop_id,
+                                            const GValue *value,
+                                            GParamSpec   *pspec)
+{
+	CdnIntegratorDormandPrince *self = CDN_INTEGRATOR_DORMAND_PRINCE (object);
+
+	switch (prop_id)
+	{
+		case PROP_ABSOLUTE_TOLERANCE:
+			self->priv->absolute_tolerance = g_value_get_double (value);
+		break;
+		case PROP_RELATIVE_TOLERANCE:
+			self->priv->relative_tolerance = g_value_get_double (value);
+		break;
+		case PROP_MINIMUM_STEP:
+			self->priv->minimum_step = g_value_get_double (value);
+		break;
+		case PROP_MAXIMUM_STEP:
+			self->priv->maximum_step = g_value_get_double (value);
+		break;
+		default:
+			G_OBJECT_WARN_INVALID_PROPERTY_ID (object, prop_id, pspec);
+		break;
+	}
+}
+
+static void
+cdn_integrator_dormand_prince_get_property (GObject    *object,
+                                            guint       prop_id,
+                                            GValue     *value,
+                                            GParamSpec *pspec)
+{
+	CdnIntegratorDormandPrince *self = CDN_INTEGRATOR_DORMAND_PRINCE (object);
+
+	switch (prop_id)
+	{
+		case PROP_ABSOLUTE_TOLERANCE:
+			g_value_set_double (value, self->priv->absolute_tolerance);
+		break;
+		case PROP_RELATIVE_TOLERANCE:
+			g_value_set_double (value, self->priv->relative_tolerance);
+		break;
+		case PROP_MINIMUM_STEP:
+			g_value_set_double (value, self->priv->minimum_step);
+		break;
+		case PROP_MAXIMUM_STEP:
+			g_value_set_double (value, self->priv->maximum_step);
+		break;
+		default:
+			G_OBJECT_WARN_INVALID_PROPERTY_ID (object, prop_id, pspec);
+		break;
+	}
+}
+
+static void
+cdn_integrator_dormand_prince_class_init (CdnIntegratorDormandPrinceClass *klass)
+{
+	GObjectClass *object_class = G_OBJECT_CLASS (klass);
+	CdnIntegratorClass *integrator_class = CDN_INTEGRATOR_CLASS (klass);
+
+	object_class->finalize = cdn_integrator_dormand_prince_finalize;
+	object_class->set_property = cdn_integrator_dormand_prince_set_property;
+	object_class->get_property = cdn_integrator_dormand_prince_get_property;
+
+	integrator_class->step = cdn_integrator_dormand_prince_step_impl;
+	integrator_class->get_name = cdn_integrator_dormand_prince_get_name_impl;
+	integrator_class->reset = cdn_integrator_dormand_prince_reset_impl;
+	integrator_class->save_state = cdn_integrator_dormand_prince_save_state_impl;
+	integrator_class->restore_state = cdn_integrator_dormand_prince_restore_state_impl;
+	integrator_class->interpolate = cdn_integrator_dormand_prince_interpolate_impl;
+
+	integrator_class->integrator_id = "dormand-prince";
+
+	g_object_class_install_property (object_class,
+	                                 PROP_ABSOLUTE_TOLERANCE,
+	                                 g_param_spec_double ("absolute-tolerance",
+	                                                      "Absolute Tolerance",
+	                                                      "Absolute error tolerance",
+	                                                      0,
+	                                                      G_MAXDOUBLE,
+	                                                      DEFAULT_ABSOLUTE_TOLERANCE,
+	                                                      G_PARAM_READWRITE | G_PARAM_CONSTRUCT));
+
+	g_object_class_install_property (object_class,
+	                                 PROP_RELATIVE_TOLERANCE,
+	                                 g_param_spec_double ("relative-tolerance",
+	                                                      "Relative Tolerance",
+	                                                      "Relative error tolerance",
+	                                                      0,
+	                                                      G_MAXDOUBLE,
+	                                                      DEFAULT_RELATIVE_TOLERANCE,
+	                                                      G_PARAM_READWRITE | G_PARAM_CONSTRUCT));
+
+	g_object_class_install_property (object_class,
+	                                 PROP_MINIMUM_STEP,
+	                                 g_param_spec_double ("minimum-step",
+	                                                      "Minimum Step",
+	                                                      "Minimum internal step size",
+	                                                      0,
+	                                                      G_MAXDOUBLE,
+	                                                      DEFAULT_MINIMUM_STEP,
+	                                                      G_PARAM_READWRITE | G_PARAM_CONSTRUCT));
+
+	g_object_class_install_property (object_class,
+	                                 PROP_MAXIMUM_STEP,
+	                                 g_param_spec_double ("maximum-step",
+	                                                      "Maximum Step",
+	                                                      "Maximum internal step size (0 for unlimited)",
+	                                                      0,
+	                                                      G_MAXDOUBLE,
+	                                                      0,
+	                                                      G_PARAM_READWRITE | G_PARAM_CONSTRUCT));
+
+	g_type_class_add_private (object_class, sizeof(CdnIntegratorDormandPrincePrivate));
+}
+
+static void
+cdn_integrator_dormand_prince_init (CdnIntegratorDormandPrince *self)
+{
+	self->priv = CDN_INTEGRATOR_DORMAND_PRINCE_GET_PRIVATE (self);
+}
+
+/**
+ * cdn_integrator_dormand_prince_new:
+ *
+ * Create a new adaptive Dormand-Prince 5(4) integrator.
+ *
+ * Returns: A #CdnIntegratorDormandPrince
+ *
+ **/
+CdnIntegratorDormandPrince *
+cdn_integrator_dormand_prince_new (void)
+{
+	return g_object_new (CDN_TYPE_INTEGRATOR_DORMAND_PRINCE, NULL);
+}
+
+/**
+ * cdn_integrator_dormand_prince_set_absolute_tolerance:
+ * @dp: A #CdnIntegratorDormandPrince
+ * @tolerance: the absolute tolerance
+ *
+ * Set the absolute tolerance on the local error of each internal step.
+ *
+ **/
+void
+cdn_integrator_dormand_prince_set_absolute_tolerance (CdnIntegratorDormandPrince *dp,
+                                                      gdouble                     tolerance)
+{
+	g_return_if_fail (CDN_IS_INTEGRATOR_DORMAND_PRINCE (dp));
+
+	g_object_set (dp, "absolute-tolerance", tolerance, NULL);
+}
+
+/**
+ * cdn_integrator_dormand_prince_get_absolute_tolerance:
+ * @dp: A #CdnIntegratorDormandPrince
+ *
+ * Get the absolute tolerance on the local error of each internal step.
+ *
+ * Returns: the absolute tolerance
+ *
+ **/
+gdouble
+cdn_integrator_dormand_prince_get_absolute_tolerance (CdnIntegratorDormandPrince *dp)
+{
+	g_return_val_if_fail (CDN_IS_INTEGRATOR_DORMAND_PRINCE (dp), 0);
+
+	return dp->priv->absolute_tolerance;
+}
+
+/**
+ * cdn_integrator_dormand_prince_set_relative_tolerance:
+ * @dp: A #CdnIntegratorDormandPrince
+ * @tolerance: the relative tolerance
+ *
+ * Set the relative tolerance on the local error of each internal step.
+ *
+ **/
+void
+cdn_integrator_dormand_prince_set_relative_tolerance (CdnIntegratorDormandPrince *dp,
+                                                      gdouble                     tolerance)
+{
+	g_return_if_fail (CDN_IS_INTEGRATOR_DORMAND_PRINCE (dp));
+
+	g_object_set (dp, "relative-tolerance", tolerance, NULL);
+}
+
+/**
+ * cdn_integrator_dormand_prince_get_relative_tolerance:
+ * @dp: A #CdnIntegratorDormandPrince
+ *
+ * Get the relative tolerance on the local error of each internal step.
+ *
+ * Returns: the relative tolerance
+ *
+ **/
+gdouble
+cdn_integrator_dormand_prince_get_relative_tolerance (CdnIntegratorDormandPrince *dp)
+{
+	g_return_val_if_fail (CDN_IS_INTEGRATOR_DORMAND_PRINCE (dp), 0);
+
+	return dp->priv->relative_tolerance;
+}
+
+/**
+ * cdn_integrator_dormand_prince_get_num_steps:
+ * @dp: A #CdnIntegratorDormandPrince
+ *
+ * Get the number of accepted internal steps since the last reset.
+ *
+ * Returns: the number of accepted internal steps
+ *
+ **/
+guint
+cdn_integrator_dormand_prince_get_num_steps (CdnIntegratorDormandPrince *dp)
+{
+	g_return_val_if_fail (CDN_IS_INTEGRATOR_DORMAND_PRINCE (dp), 0);
+
+	return dp->priv->num_steps;
+}
+
+/**
+ * cdn_integrator_dormand_prince_get_num_rejected:
+ * @dp: A #CdnIntegratorDormandPrince
+ *
+ * Get the number of rejected internal steps since the last reset.
+ *
+ * Returns: the number of rejected internal steps
+ *
+ **/
+guint
+cdn_integrator_dormand_prince_get_num_rejected (CdnIntegratorDormandPrince *dp)
+{
+	g_return_val_if_fail (CDN_IS_INTEGRATOR_DORMAND_PRINCE (dp), 0);
+
+	return dp->priv->num_rejected;
+}
@@ -0,0 +1,89 @@
+/*
+ * cdn-integrator-dormand-prince.h
+ * This file is part of codyn
+ *
+ * Copyright (C) 2011 - Jesse van den Kieboom
+ *
+ * codyn is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * codyn is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with codyn; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor,
+ * Boston, MA  02110-1301  USA
+ */
+
+
+#ifndef __CDN_INTEGRATOR_DORMAND_PRINCE_H__
+#define __CDN_INTEGRATOR_DORMAND_PRINCE_H__
+
+#include <codyn/integrators/cdn-integrator.h>
+
+G_BEGIN_DECLS
+
+#define CDN_TYPE_INTEGRATOR_DORMAND_PRINCE				(cdn_integrator_dormand_prince_get_type ())
+#define CDN_INTEGRATOR_DORMAND_PRINCE(obj)				(G_TYPE_CHECK_INSTANCE_CAST ((obj), CDN_TYPE_INTEGRATOR_DORMAND_PRINCE, CdnIntegratorDormandPrince))
+#define CDN_INTEGRATOR_DORMAND_PRINCE_CONST(obj)		(G_TYPE_CHECK_INSTANCE_CAST ((obj), CDN_TYPE_INTEGRATOR_DORMAND_PRINCE, CdnIntegratorDormandPrince const))
+#define CDN_INTEGRATOR_DORMAND_PRINCE_CLASS(klass)		(G_TYPE_CHECK_CLASS_CAST ((klass), CDN_TYPE_INTEGRATOR_DORMAND_PRINCE, CdnIntegratorDormandPrinceClass))
+#define CDN_IS_INTEGRATOR_DORMAND_PRINCE(obj)			(G_TYPE_CHECK_INSTANCE_TYPE ((obj), CDN_TYPE_INTEGRATOR_DORMAND_PRINCE))
+#define CDN_IS_INTEGRATOR_DORMAND_PRINCE_CLASS(klass)	(G_TYPE_CHECK_CLASS_TYPE ((klass), CDN_TYPE_INTEGRATOR_DORMAND_PRINCE))
+#define CDN_INTEGRATOR_DORMAND_PRINCE_GET_CLASS(obj)	(G_TYPE_INSTANCE_GET_CLASS ((obj), CDN_TYPE_INTEGRATOR_DORMAND_PRINCE, CdnIntegratorDormandPrinceClass))
+
+typedef struct _CdnIntegratorDormandPrince			CdnIntegratorDormandPrince;
+typedef struct _CdnIntegratorDormandPrinceClass	CdnIntegratorDormandPrinceClass;
+typedef struct _CdnIntegratorDormandPrincePrivate	CdnIntegratorDormandPrincePrivate;
+
+/**
+ * CdnIntegratorDormandPrince:
+ *
+ * Adaptive Dormand-Prince 5(4) integrator.
+ *
+ * The Dormand-Prince integrator is a #CdnIntegrator subclass implementing an
+ * embedded Runge-Kutta 5(4) scheme. Each step requested from the integrator
+ * is covered by as many internal steps as needed to keep the estimated local
+ * error within the absolute and relative tolerances. The values at the end of
+ * the requested step are obtained from the dense output of the internal
+ * steps, so internal steps can be much larger than the requested step when
+ * the system allows it. Networks with events, discrete variables, operators
+ * or io are integrated with internal steps which never cross the end of
+ * the requested step.
+ */
+struct _CdnIntegratorDormandPrince
+{
+	/*< private >*/
+	CdnIntegrator parent;
+
+	CdnIntegratorDormandPrincePrivate *priv;
+};
+
+struct _CdnIntegratorDormandPrinceClass
+{
+	/*< private >*/
+	CdnIntegratorClass parent_class;
+};
+
+GType cdn_integrator_dormand_prince_get_type (void) G_GNUC_CONST;
+
+CdnIntegratorDormandPrince *cdn_integrator_dormand_prince_new (void);
+
+void    cdn_integrator_dormand_prince_set_absolute_tolerance (CdnIntegratorDormandPrince *dp,
+                                                              gdouble                     tolerance);
+gdouble cdn_integrator_dormand_prince_get_absolute_tolerance (CdnIntegratorDormandPrince *dp);
+
+void    cdn_integrator_dormand_prince_set_relative_tolerance (CdnIntegratorDormandPrince *dp,
+                                                              gdouble                     tolerance);
+gdouble cdn_integrator_dormand_prince_get_relative_tolerance (CdnIntegratorDormandPrince *dp);
+
+guint   cdn_integrator_dormand_prince_get_num_steps          (CdnIntegratorDormandPrince *dp);
+guint   cdn_integrator_dormand_prince_get_num_rejected       (CdnIntegratorDormandPrince *dp);
+
+G_END_DECLS
+
+#endif /* __CDN_INTEGRATOR_DORMAND_PRINCE_H__ */
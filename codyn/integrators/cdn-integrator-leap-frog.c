@@ -126,70 +126,55 @@ update_values (CdnVariable *variable)
 	cdn_variable_set_values (variable, values);
 }
 
-static gdouble
-cdn_integrator_leap_frog_step_impl (CdnIntegrator *integrator,
-                                    gdouble        t,
-                                    gdouble        timestep)
+static void
+integrate_group (CdnIntegrator *integrator,
+                 GSList const  *actions,
+                 GSList const  *variables,
+                 gdouble        t,
+                 gdouble        timestep)
 {
-	GSList const *integrated;
-	CdnIntegratorLeapFrog *self;
-	CdnIntegratorState *state;
-	GSList *item;
-	CdnIntegratorClass *cls;
+	GSList const *item;
 
-	if (!cdn_integrator_step_prepare (integrator, t, timestep))
+	cdn_integrator_step_prepare (integrator, t, timestep);
+
+	for (item = variables; item; item = g_slist_next (item))
 	{
-		return 0;
+		cdn_variable_clear_update (item->data);
 	}
 
-	self = (CdnIntegratorLeapFrog *)integrator;
-	state = cdn_integrator_get_state (integrator);
-
-	// Reset accumulated state
-	integrated = cdn_integrator_state_integrated_variables (state);
+	cdn_integrator_simulation_step_integrate (integrator, actions);
 
-	while (integrated)
+	for (item = variables; item; item = g_slist_next (item))
 	{
-		cdn_variable_clear_update (integrated->data);
-		integrated = g_slist_next (integrated);
+		integrate_values (item->data, timestep);
 	}
 
-	if (self->priv->second_order)
+	for (item = variables; item; item = g_slist_next (item))
 	{
-		cdn_integrator_step_prepare (integrator, t - timestep / 2, timestep);
-
-		// Calculate v
-		cdn_integrator_simulation_step_integrate (integrator,
-		                                          self->priv->second_order);
+		update_values (item->data);
+	}
+}
 
-		// Integrate v
-		for (item = self->priv->second_order_variables; item; item = g_slist_next (item))
-		{
-			integrate_values (item->data, timestep);
-		}
+static gdouble
+cdn_integrator_leap_frog_step_impl (CdnIntegrator *integrator,
+                                    gdouble        t,
+                                    gdouble        timestep)
+{
+	CdnIntegratorLeapFrog *self;
+	CdnIntegratorClass *cls;
 
-		for (item = self->priv->second_order_variables; item; item = g_slist_next (item))
-		{
-			update_values (item->data);
-		}
+	if (!cdn_integrator_step_prepare (integrator, t, timestep))
+	{
+		return 0;
 	}
 
-	cdn_integrator_step_prepare (integrator, t, timestep);
+	self = (CdnIntegratorLeapFrog *)integrator;
 
-	// Calculate x
-	cdn_integrator_simulation_step_integrate (integrator,
-	                                          self->priv->first_order);
+	// Integrate v, staggered by half a step
+	cdn_integrator_leap_frog_kick (self, t - timestep / 2, timestep);
 
 	// Integrate x
-	for (item = self->priv->first_order_variables; item; item = g_slist_next (item))
-	{
-		integrate_values (item->data, timestep);
-	}
-
-	for (item = self->priv->first_order_variables; item; item = g_slist_next (item))
-	{
-		update_values (item->data);
-	}
+	cdn_integrator_leap_frog_drift (self, t, timestep);
 
 	/* Chain up to emit 'step' */
 	cls = CDN_INTEGRATOR_CLASS (cdn_integrator_leap_frog_parent_class);
@@ -333,3 +318,55 @@ cdn_integrator_leap_frog_new (void)
 {
 	return g_object_new (CDN_TYPE_INTEGRATOR_LEAP_FROG, NULL);
 }
+
+/**
+ * cdn_integrator_leap_frog_kick:
+ * @lf: A #CdnIntegratorLeapFrog
+ * @t: the time at which to evaluate the accelerations
+ * @timestep: the time step
+ *
+ * Integrate the second order variables (i.e. the variables which are the
+ * derivative of another variable) over @timestep, using the accelerations
+ * evaluated at @t. This is a utility function for integrators which compose
+ * a step from multiple kicks and drifts.
+ *
+ **/
+void
+cdn_integrator_leap_frog_kick (CdnIntegratorLeapFrog *lf,
+                               gdouble                t,
+                               gdouble                timestep)
+{
+	/* Omit check for speed up */
+	if (lf->priv->second_order)
+	{
+		integrate_group (CDN_INTEGRATOR (lf),
+		                 lf->priv->second_order,
+		                 lf->priv->second_order_variables,
+		                 t,
+		                 timestep);
+	}
+}
+
+/**
+ * cdn_integrator_leap_frog_drift:
+ * @lf: A #CdnIntegratorLeapFrog
+ * @t: the time at which to evaluate the derivatives
+ * @timestep: the time step
+ *
+ * Integrate the first order variables (e.g. positions) over @timestep, using
+ * the derivatives evaluated at @t. This is a utility function for integrators
+ * which compose a step from multiple kicks and drifts.
+ *
+ **/
+void
+cdn_integrator_leap_frog_drift (CdnIntegratorLeapFrog *lf,
+                                gdouble                t,
+                                gdouble                timestep)
+{
+	/* Omit check for speed up */
+	integrate_group (CDN_INTEGRATOR (lf),
+	                 lf->priv->first_order,
+	                 lf->priv->first_order_variables,
+	                 t,
+	                 timestep);
+}
@@ -67,6 +67,14 @@ struct _CdnIntegratorLeapFrogClass
 GType cdn_integrator_leap_frog_get_type (void) G_GNUC_CONST;
 CdnIntegratorLeapFrog *cdn_integrator_leap_frog_new (void);
 
+void cdn_integrator_leap_frog_kick  (CdnIntegratorLeapFrog *lf,
+                                     gdouble                t,
+                                     gdouble                timestep);
+
+void cdn_integrator_leap_frog_drift (CdnIntegratorLeapFrog *lf,
+                                     gdouble                t,
+                                     gdouble                timestep);
+
 G_END_DECLS
 
 #endif /* __CDN_INTEGRATOR_LEAP_FROG_H__ */
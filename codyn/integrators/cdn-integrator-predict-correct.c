@@ -24,6 +24,9 @@
 #include <codyn/cdn-integrators.h>
 
 #include "cdn-integrator-predict-correct.h"
+#include "cdn-math-simd.h"
+
+#include <string.h>
 
 #define CDN_INTEGRATOR_PREDICT_CORRECT_GET_PRIVATE(object)(G_TYPE_INSTANCE_GET_PRIVATE((object), CDN_TYPE_INTEGRATOR_PREDICT_CORRECT, CdnIntegratorPredictCorrectPrivate))
 
@@ -54,19 +57,23 @@ static const gdouble correction_coeffs[][MAX_CORRECTION_ORDER - 1] = {
 	{9 / 24.0, 19 / 24.0, -5 / 24.0, 1 / 24.0}
 };
 
-static const guint index_cycle[] = {0, 1, 2, 3, 0, 1, 2};
-
 struct _CdnIntegratorPredictCorrectPrivate
 {
 	gdouble *current_value;
-	gdouble *state_history[MAX_HISTORY_DEPTH];
+
+	/* Ring buffer of MAX_HISTORY_DEPTH blocks of num_states derivatives,
+	 * history_cursor being the block of f(t), history_cursor + 1 the
+	 * block of f(t-1), etc. */
+	gdouble *history;
 	gint history_cursor;
 	guint step_index;
 
 	guint prediction_order;
 	guint correction_order;
 
-	gdouble *tmpd;
+	/* Accumulates the coefficient combinations, and then the new values */
+	gdouble *combination;
+	guint num_states;
 };
 
 /* Properties */
@@ -90,251 +97,126 @@ history_move_cursor (CdnIntegratorPredictCorrect *pc)
 	}
 }
 
-static guint
-history_index (CdnIntegratorPredictCorrect *pc,
+static gdouble *
+history_block (CdnIntegratorPredictCorrect *pc,
                guint                        time_offset)
 {
-	return index_cycle[pc->priv->history_cursor + time_offset];
-}
-
-static void
-history_set (CdnIntegratorPredictCorrect *pc,
-             guint                        state_index,
-             guint                        time_offset,
-             gdouble                      value)
-{
-	pc->priv->state_history[history_index (pc, time_offset)][state_index] = value;
-}
+	guint idx = (pc->priv->history_cursor + time_offset) % MAX_HISTORY_DEPTH;
 
-static gdouble
-history_get (CdnIntegratorPredictCorrect *pc,
-             guint                        state_index,
-             guint                        time_offset)
-{
-	return pc->priv->state_history[history_index (pc, time_offset)][state_index];
+	return pc->priv->history + idx * pc->priv->num_states;
 }
 
 static void
-history_update_states (CdnIntegratorPredictCorrect *pc,
-                       GSList const                *states,
-                       guint                       *i)
+history_update (CdnIntegratorPredictCorrect *pc,
+                CdnIntegratorState          *state)
 {
-	while (states)
-	{
-		gint n;
-		gint j;
-		CdnMatrix *up;
-		gdouble *upvals;
-
-		up = cdn_variable_get_update (states->data);
-		upvals = cdn_matrix_get_memory (up);
-
-		n = cdn_matrix_size (up);
-
-		for (j = 0; j < n; ++j)
-		{
-			history_set (pc, (*i)++, 0, upvals[j]);
-		}
-
-		states = g_slist_next (states);
-	}
-
+	cdn_integrator_state_get_integrated_updates (state,
+	                                             history_block (pc, 0));
 }
 
 static void
-history_update (CdnIntegratorPredictCorrect *pc,
-                GSList const                *integrated)
+read_current_values (CdnIntegratorPredictCorrect *pc,
+                     CdnIntegratorState          *state)
 {
-	guint i = 0;
-
-	history_update_states (pc, integrated, &i);
+	cdn_integrator_state_get_integrated_values (state,
+	                                            pc->priv->current_value);
 }
 
+/* combination += sum (coeffs[i] * f(t - time_offset - i)), then
+ * combination = current_value + timestep * combination */
 static void
-read_current_values (CdnIntegratorPredictCorrect *pc,
-                     GSList const                *integrated)
+combine_history (CdnIntegratorPredictCorrect *pc,
+                 gdouble const               *coeffs,
+                 guint                        n_coeffs,
+                 guint                        time_offset,
+                 gdouble                      timestep)
 {
-	guint i = 0;
+	gint n = pc->priv->num_states;
+	guint i;
 
-	while (integrated)
+	for (i = 0; i < n_coeffs; ++i)
 	{
-		CdnVariable *prop = integrated->data;
-
-		pc->priv->current_value[i] = cdn_variable_get_value (prop);
-
-		integrated = g_slist_next (integrated);
-		++i;
+		_cdn_math_simd_axpy (pc->priv->combination,
+		                     coeffs[i],
+		                     history_block (pc, time_offset + i),
+		                     n);
 	}
+
+	_cdn_math_simd_binary_vs (CDN_MATH_SIMD_MULTIPLY,
+	                          pc->priv->combination,
+	                          pc->priv->combination,
+	                          &timestep,
+	                          n);
+
+	_cdn_math_simd_binary_vv (CDN_MATH_SIMD_PLUS,
+	                          pc->priv->combination,
+	                          pc->priv->current_value,
+	                          pc->priv->combination,
+	                          n);
 }
 
 static void
 prediction_step (CdnIntegratorPredictCorrect *pc,
-                 GSList const                *integrated,
+                 CdnIntegratorState          *state,
+                 guint                        step_index,
                  gdouble                      timestep)
 {
 	/* for the first timesteps we have to use lower orders, e.g. at
 	 * timestep 0 we use prediction method order 2, which only needs
 	 * f(t) */
-	guint order = MIN (pc->priv->prediction_order, pc->priv->step_index + 2);
-	guint coeff_row = order - 2;
-	guint n_coeffs = order - 1;
+	guint order = MIN (pc->priv->prediction_order, step_index + 2);
+	gdouble const *coeffs = prediction_coeffs[order - 2];
 
-	guint state_index = 0;
+	/* derivative prediction for t+1 */
+	_cdn_math_simd_binary_vs (CDN_MATH_SIMD_MULTIPLY,
+	                          pc->priv->combination,
+	                          history_block (pc, 0),
+	                          coeffs,
+	                          pc->priv->num_states);
 
-	while (integrated)
-	{
-		CdnVariable *prop = integrated->data;
-		guint coeff_index;
-		CdnMatrix *up;
-		gint i;
-		gint n;
-		CdnMatrix tmp;
-
-		up = cdn_variable_get_update (prop);
-		n = cdn_matrix_size (up);
-
-		/* derivative prediction for t+1 */
-		for (i = 0; i < n; ++i)
-		{
-			pc->priv->tmpd[i] = 0;
-
-			for (coeff_index = 0; coeff_index < n_coeffs; ++coeff_index)
-			{
-				pc->priv->tmpd[i] +=
-					prediction_coeffs[coeff_row][coeff_index] *
-					history_get (pc, state_index + i, coeff_index);
-			}
-
-			pc->priv->tmpd[i] =
-				pc->priv->current_value[state_index + i] +
-				timestep * pc->priv->tmpd[i];
-		}
+	combine_history (pc, coeffs + 1, order - 2, 1, timestep);
 
-		tmp = cdn_matrix_init (pc->priv->tmpd, &up->dimension);
-
-		cdn_variable_set_values (prop, &tmp);
-
-		integrated = g_slist_next (integrated);
-		state_index += n;
-	}
+	cdn_integrator_state_set_integrated_values (state, pc->priv->combination);
 }
 
 static void
 correction_step (CdnIntegratorPredictCorrect *pc,
-                 GSList const                *integrated,
+                 CdnIntegratorState          *state,
+                 guint                        step_index,
                  gdouble                      timestep)
 {
 	/* for the first timesteps we have to use lower orders, e.g. at
 	 * timestep 0 we use correction method order 3, which only needs
 	 * f(t) (and f(t+1)) */
-	guint order = MIN (pc->priv->correction_order, pc->priv->step_index + 3);
-	guint coeff_row = order - 3;
-	guint n_coeffs = order - 1;
+	guint order = MIN (pc->priv->correction_order, step_index + 3);
+	gdouble const *coeffs = correction_coeffs[order - 3];
 
-	guint state_index = 0;
+	/* f(t+1) */
+	cdn_integrator_state_get_integrated_updates (state, pc->priv->combination);
 
-	while (integrated)
-	{
-		CdnVariable *prop = integrated->data;
-		guint coeff_index;
-		CdnMatrix *up;
-		gdouble const *upvals;
-		gint i;
-		gint n;
-		CdnMatrix tmp;
-
-		up = cdn_variable_get_update (prop);
-		upvals = cdn_matrix_get (up);
-		n = cdn_matrix_size (up);
-
-		/* derivative prediction for t+1 */
-		for (i = 0; i < n; ++i)
-		{
-			pc->priv->tmpd[i] = correction_coeffs[coeff_row][0] * upvals[i];
+	_cdn_math_simd_binary_vs (CDN_MATH_SIMD_MULTIPLY,
+	                          pc->priv->combination,
+	                          pc->priv->combination,
+	                          coeffs,
+	                          pc->priv->num_states);
 
-			for (coeff_index = 1; coeff_index < n_coeffs; ++coeff_index)
-			{
-				pc->priv->tmpd[i] += correction_coeffs[coeff_row][coeff_index] * history_get (pc, state_index + i, coeff_index - 1);
-			}
-
-			pc->priv->tmpd[i] = pc->priv->current_value[state_index + i] +
-			                    timestep * pc->priv->tmpd[i];
-		}
+	combine_history (pc, coeffs + 1, order - 2, 0, timestep);
 
-		tmp = cdn_matrix_init (pc->priv->tmpd, &up->dimension);
-
-		cdn_variable_set_values (prop, &tmp);
-
-		integrated = g_slist_next (integrated);
-		state_index += n;
-	}
+	cdn_integrator_state_set_integrated_values (state, pc->priv->combination);
 }
 
 static void
 cdn_integrator_predict_correct_finalize (GObject *object)
 {
 	CdnIntegratorPredictCorrect *pc = CDN_INTEGRATOR_PREDICT_CORRECT (object);
-	guint i = 0;
 
-	for (i = 0; i < MAX_HISTORY_DEPTH; ++i)
-	{
-		if (pc->priv->state_history[i])
-		{
-			g_free (pc->priv->state_history[i]);
-		}
-	}
-
-	g_free (pc->priv->tmpd);
+	g_free (pc->priv->history);
+	g_free (pc->priv->combination);
 	g_free (pc->priv->current_value);
 
 	G_OBJECT_CLASS (cdn_integrator_predict_correct_parent_class)->finalize (object);
 }
 
-static gint
-calculate_props_length (GSList const *props,
-                        gint         *longest)
-{
-	gint len = 0;
-
-	while (props)
-	{
-		CdnExpression *expr;
-
-		CdnDimension dim;
-		gint n;
-
-		expr = cdn_variable_get_expression (props->data);
-		cdn_expression_get_dimension (expr, &dim);
-
-		n = cdn_dimension_size (&dim);
-
-		len += n;
-
-		if (n > *longest)
-		{
-			*longest = n;
-		}
-
-		props = g_slist_next (props);
-	}
-
-	return len;
-}
-
-static gint
-calculate_length (CdnIntegratorPredictCorrect *pc,
-                  gint                        *longest)
-{
-	CdnIntegratorState *state;
-
-	state = cdn_integrator_get_state (CDN_INTEGRATOR (pc));
-
-	*longest = 0;
-
-	return calculate_props_length (cdn_integrator_state_integrated_variables (state),
-	                               longest);
-}
-
 static void
 cdn_integrator_predict_correct_reset_impl (CdnIntegrator *integrator)
 {
@@ -345,21 +227,19 @@ cdn_integrator_predict_correct_reset_impl (CdnIntegrator *integrator)
 		CDN_INTEGRATOR_CLASS (cdn_integrator_predict_correct_parent_class)->reset (integrator);
 	}
 
-	gint longest;
-	gint len = calculate_length (pc, &longest);
-	gint i;
+	CdnIntegratorState *state = cdn_integrator_get_state (integrator);
+	guint len = cdn_integrator_state_integrated_size (state);
 
-	for (i = 0; i < MAX_HISTORY_DEPTH; ++i)
-	{
-		g_free (pc->priv->state_history[i]);
-		pc->priv->state_history[i] = g_new0 (gdouble, len);
-	}
+	g_free (pc->priv->history);
+	pc->priv->history = g_new0 (gdouble, len * MAX_HISTORY_DEPTH);
 
 	g_free (pc->priv->current_value);
 	pc->priv->current_value = g_new0 (gdouble, len);
 
-	g_free (pc->priv->tmpd);
-	pc->priv->tmpd = g_new0 (gdouble, longest);
+	g_free (pc->priv->combination);
+	pc->priv->combination = g_new0 (gdouble, len);
+
+	pc->priv->num_states = len;
 
 	pc->priv->history_cursor = 0;
 	pc->priv->step_index = 0;
@@ -373,6 +253,7 @@ cdn_integrator_predict_correct_step_impl (CdnIntegrator *integrator,
 	CdnIntegratorPredictCorrect *pc;
 	CdnIntegratorState *state;
 	CdnIntegratorClass *cls;
+	guint step_index;
 
 	pc = CDN_INTEGRATOR_PREDICT_CORRECT (integrator);
 	state = cdn_integrator_get_state (integrator);
@@ -382,25 +263,28 @@ cdn_integrator_predict_correct_step_impl (CdnIntegrator *integrator,
 		return 0;
 	}
 
-	GSList const *integrated = cdn_integrator_state_integrated_variables (state);
+	/* the history is not spaced by the timestep of the interval of slow
+	 * nodes, so start over for that step */
+	step_index = cdn_integrator_get_integrate_every (integrator) > 1 ?
+	             0 : pc->priv->step_index;
 
 	/* evaluate f(t) */
 	cdn_integrator_evaluate (integrator, t, timestep);
 
 	/* backup of current states */
-	read_current_values (pc, integrated);
+	read_current_values (pc, state);
 
 	/* store f(t) */
-	history_update (pc, integrated);
+	history_update (pc, state);
 
 	/* calculate prediction for t+1 */
-	prediction_step (pc, integrated, timestep);
+	prediction_step (pc, state, step_index, timestep);
 
 	/* evaluate f(t+1) */
 	cdn_integrator_evaluate (integrator, t + timestep, timestep);
 
 	/* correct the prediction */
-	correction_step (pc, integrated, timestep);
+	correction_step (pc, state, step_index, timestep);
 
 	history_move_cursor (pc);
 
@@ -412,6 +296,82 @@ cdn_integrator_predict_correct_step_impl (CdnIntegrator *integrator,
 	return cls->step (integrator, t, timestep);
 }
 
+static GVariant *
+cdn_integrator_predict_correct_save_state_impl (CdnIntegrator *integrator)
+{
+	CdnIntegratorPredictCorrect *pc = CDN_INTEGRATOR_PREDICT_CORRECT (integrator);
+	GVariantBuilder history;
+	guint i;
+
+	g_variant_builder_init (&history, G_VARIANT_TYPE ("aad"));
+
+	for (i = 0; i < MAX_HISTORY_DEPTH; ++i)
+	{
+		g_variant_builder_add_value (&history,
+		                             g_variant_new_fixed_array (G_VARIANT_TYPE_DOUBLE,
+		                                                        pc->priv->history + i * pc->priv->num_states,
+		                                                        pc->priv->num_states,
+		                                                        sizeof (gdouble)));
+	}
+
+	return g_variant_new ("(iuaad)",
+	                      pc->priv->history_cursor,
+	                      pc->priv->step_index,
+	                      &history);
+}
+
+static gboolean
+cdn_integrator_predict_correct_restore_state_impl (CdnIntegrator *integrator,
+                                                   GVariant      *state)
+{
+	CdnIntegratorPredictCorrect *pc = CDN_INTEGRATOR_PREDICT_CORRECT (integrator);
+	GVariant *history;
+	gint cursor;
+	guint step_index;
+	guint i;
+
+	if (!g_variant_is_of_type (state, G_VARIANT_TYPE ("(iuaad)")))
+	{
+		return FALSE;
+	}
+
+	g_variant_get (state, "(iu@aad)", &cursor, &step_index, &history);
+
+	if (cursor < 0 || cursor >= MAX_HISTORY_DEPTH ||
+	    g_variant_n_children (history) != MAX_HISTORY_DEPTH)
+	{
+		g_variant_unref (history);
+		return FALSE;
+	}
+
+	for (i = 0; i < MAX_HISTORY_DEPTH; ++i)
+	{
+		GVariant *item;
+		gdouble const *values;
+		gsize num;
+
+		item = g_variant_get_child_value (history, i);
+		values = g_variant_get_fixed_array (item, &num, sizeof (gdouble));
+
+		if (num != pc->priv->num_states)
+		{
+			g_variant_unref (item);
+			g_variant_unref (history);
+
+			return FALSE;
+		}
+
+		memcpy (pc->priv->history + i * num, values, sizeof (gdouble) * num);
+		g_variant_unref (item);
+	}
+
+	pc->priv->history_cursor = cursor;
+	pc->priv->step_index = step_index;
+
+	g_variant_unref (history);
+	return TRUE;
+}
+
 static gchar const *
 cdn_integrator_predict_correct_get_name_impl (CdnIntegrator *integrator)
 {
@@ -475,6 +435,8 @@ cdn_integrator_predict_correct_class_init (CdnIntegratorPredictCorrectClass *kla
 	integrator_class->step = cdn_integrator_predict_correct_step_impl;
 	integrator_class->get_name = cdn_integrator_predict_correct_get_name_impl;
 	integrator_class->reset = cdn_integrator_predict_correct_reset_impl;
+	integrator_class->save_state = cdn_integrator_predict_correct_save_state_impl;
+	integrator_class->restore_state = cdn_integrator_predict_correct_restore_state_impl;
 
 	integrator_class->integrator_id = "predict-correct";
 
@@ -0,0 +1,814 @@
+/*
+ * cdn-integrator-rosenbrock.c
+ * This file is part of codyn
+ *
+ * Copyright (C) 2011 - Jesse van den Kieboom
+ *
+ * codyn is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * codyn is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with codyn; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor,
+ * Boston, MA  02110-1301  USA
+ */
+
+
+#include "cdn-integrator-rosenbrock.h"
+#include "cdn-network.h"
+#include "cdn-edge-action.h"
+#include "cdn-expression-tree-iter.h"
+#include <math.h>
+#include <float.h>
+#include <string.h>
+
+#define CDN_INTEGRATOR_ROSENBROCK_GET_PRIVATE(object)(G_TYPE_INSTANCE_GET_PRIVATE((object), CDN_TYPE_INTEGRATOR_ROSENBROCK, CdnIntegratorRosenbrockPrivate))
+
+/* ROS2, see Verwer et al. (1999), gamma = 1 + 1 / sqrt(2) */
+#define GAMMA 1.7071067811865475
+
+/* Number of times the step size is halved when the iteration matrix is
+ * singular before falling back to an explicit step */
+#define MAX_SINGULAR_RETRIES 8
+
+/* The partial derivatives of one edge action towards each of the integrated
+ * variables, followed by the partial derivative towards time */
+typedef struct
+{
+	gint row;
+	CdnExpression **columns;
+} JacobianRow;
+
+struct _CdnIntegratorRosenbrockPrivate
+{
+	guint num_values;
+
+	gdouble *y0;
+	gdouble *ytmp;
+	gdouble *f0;
+	gdouble *ftmp;
+	gdouble *k1;
+	gdouble *k2;
+
+	/* Partial derivative of the integrated edge actions towards time */
+	gdouble *dfdt;
+
+	/* Jacobian and the factorized iteration matrix, row major */
+	gdouble *jacobian;
+	gdouble *lu;
+	gint *pivots;
+
+	/* Maps integrated edge actions to their row of symbolic partial
+	 * derivatives */
+	GHashTable *rows;
+
+	guint prepared : 1;
+	guint symbolic : 1;
+	guint warned_singular : 1;
+};
+
+G_DEFINE_TYPE (CdnIntegratorRosenbrock, cdn_integrator_rosenbrock, CDN_TYPE_INTEGRATOR)
+
+static void
+jacobian_row_free (JacobianRow *row,
+                   guint        n)
+{
+	guint i;
+
+	for (i = 0; i <= n; ++i)
+	{
+		if (row->columns[i])
+		{
+			g_object_unref (row->columns[i]);
+		}
+	}
+
+	g_free (row->columns);
+	g_slice_free (JacobianRow, row);
+}
+
+static void
+free_rows (CdnIntegratorRosenbrock *rb)
+{
+	GHashTableIter iter;
+	gpointer value;
+
+	if (!rb->priv->rows)
+	{
+		return;
+	}
+
+	g_hash_table_iter_init (&iter, rb->priv->rows);
+
+	while (g_hash_table_iter_next (&iter, NULL, &value))
+	{
+		jacobian_row_free (value, rb->priv->num_values);
+	}
+
+	g_hash_table_destroy (rb->priv->rows);
+	rb->priv->rows = NULL;
+}
+
+static void
+free_buffers (CdnIntegratorRosenbrock *rb)
+{
+	free_rows (rb);
+
+	g_free (rb->priv->y0);
+	g_free (rb->priv->ytmp);
+	g_free (rb->priv->f0);
+	g_free (rb->priv->ftmp);
+	g_free (rb->priv->k1);
+	g_free (rb->priv->k2);
+	g_free (rb->priv->dfdt);
+	g_free (rb->priv->jacobian);
+	g_free (rb->priv->lu);
+	g_free (rb->priv->pivots);
+
+	rb->priv->y0 = NULL;
+	rb->priv->ytmp = NULL;
+	rb->priv->f0 = NULL;
+	rb->priv->ftmp = NULL;
+	rb->priv->k1 = NULL;
+	rb->priv->k2 = NULL;
+	rb->priv->dfdt = NULL;
+	rb->priv->jacobian = NULL;
+	rb->priv->lu = NULL;
+	rb->priv->pivots = NULL;
+
+	rb->priv->num_values = 0;
+}
+
+static void
+cdn_integrator_rosenbrock_finalize (GObject *object)
+{
+	free_buffers (CDN_INTEGRATOR_ROSENBROCK (object));
+
+	G_OBJECT_CLASS (cdn_integrator_rosenbrock_parent_class)->finalize (object);
+}
+
+static void
+initialize_buffers (CdnIntegratorRosenbrock *rb)
+{
+	guint len;
+
+	len = cdn_integrator_state_integrated_size (cdn_integrator_get_state (CDN_INTEGRATOR (rb)));
+
+	free_buffers (rb);
+
+	rb->priv->y0 = g_new0 (gdouble, len);
+	rb->priv->ytmp = g_new0 (gdouble, len);
+	rb->priv->f0 = g_new0 (gdouble, len);
+	rb->priv->ftmp = g_new0 (gdouble, len);
+	rb->priv->k1 = g_new0 (gdouble, len);
+	rb->priv->k2 = g_new0 (gdouble, len);
+	rb->priv->dfdt = g_new0 (gdouble, len);
+	rb->priv->jacobian = g_new0 (gdouble, len * len);
+	rb->priv->lu = g_new0 (gdouble, len * len);
+	rb->priv->pivots = g_new0 (gint, len);
+
+	rb->priv->num_values = len;
+	rb->priv->prepared = FALSE;
+	rb->priv->symbolic = FALSE;
+}
+
+static void
+derivatives (CdnIntegrator *integrator,
+             gdouble        t,
+             gdouble        h,
+             gdouble       *f)
+{
+	cdn_integrator_evaluate (integrator, t, h);
+
+	cdn_integrator_state_get_integrated_updates (cdn_integrator_get_state (integrator),
+	                                             f);
+}
+
+static CdnExpression *
+derive_towards (CdnExpressionTreeIter *iter,
+                GSList const          *integrated,
+                CdnVariable           *towards,
+                gboolean              *ret)
+{
+	CdnExpressionTreeIter *derived;
+	CdnExpression *expr = NULL;
+	GHashTable *tow;
+	GError *error = NULL;
+
+	tow = g_hash_table_new (g_direct_hash, g_direct_equal);
+	g_hash_table_insert (tow, towards, NULL);
+
+	derived = cdn_expression_tree_iter_derive (iter,
+	                                           (GSList *)integrated,
+	                                           tow,
+	                                           1,
+	                                           CDN_EXPRESSION_TREE_ITER_DERIVE_PARTIAL |
+	                                           CDN_EXPRESSION_TREE_ITER_DERIVE_SIMPLIFY,
+	                                           &error);
+
+	g_hash_table_unref (tow);
+
+	if (!derived)
+	{
+		if (error)
+		{
+			g_error_free (error);
+		}
+
+		*ret = FALSE;
+		return NULL;
+	}
+
+	if (g_strcmp0 (cdn_expression_tree_iter_to_string (derived), "0") != 0)
+	{
+		expr = cdn_expression_tree_iter_to_expression (derived);
+		cdn_expression_set_has_cache (expr, FALSE);
+
+		g_object_ref_sink (expr);
+	}
+
+	cdn_expression_tree_iter_free (derived);
+
+	*ret = TRUE;
+	return expr;
+}
+
+static JacobianRow *
+derive_row (CdnEdgeAction *action,
+            GSList const  *integrated,
+            CdnVariable   *t,
+            GHashTable    *indices,
+            guint          n)
+{
+	CdnExpression *equation;
+	CdnExpressionTreeIter *iter;
+	CdnDimension dim;
+	JacobianRow *row;
+	GSList const *item;
+	gboolean ok = TRUE;
+	guint j = 0;
+
+	row = g_slice_new0 (JacobianRow);
+
+	row->row = GPOINTER_TO_INT (g_hash_table_lookup (indices,
+	                                                 cdn_edge_action_get_target_variable (action))) - 1;
+
+	row->columns = g_new0 (CdnExpression *, n + 1);
+
+	equation = cdn_edge_action_get_equation (action);
+	cdn_expression_get_dimension (equation, &dim);
+
+	iter = cdn_expression_tree_iter_new (equation);
+
+	if (row->row < 0 || !cdn_dimension_is_one (&dim) || !iter)
+	{
+		if (iter)
+		{
+			cdn_expression_tree_iter_free (iter);
+		}
+
+		jacobian_row_free (row, n);
+		return NULL;
+	}
+
+	for (item = integrated; item; item = g_slist_next (item))
+	{
+		row->columns[j++] = derive_towards (iter, integrated, item->data, &ok);
+
+		if (!ok)
+		{
+			break;
+		}
+	}
+
+	if (ok && t)
+	{
+		row->columns[n] = derive_towards (iter, integrated, t, &ok);
+	}
+
+	cdn_expression_tree_iter_free (iter);
+
+	if (!ok)
+	{
+		jacobian_row_free (row, n);
+		return NULL;
+	}
+
+	return row;
+}
+
+/* Derive the partial derivatives of all integrated edge actions towards all
+ * integrated variables. This is only supported for scalar variables and
+ * actions, and when no direct edge actions can change variables behind the
+ * back of the derivatives. */
+static gboolean
+derive_jacobian (CdnIntegratorRosenbrock *rb)
+{
+	CdnIntegratorState *state;
+	GSList const *integrated;
+	GSList const *actions;
+	GHashTable *indices;
+	CdnVariable *t;
+	gint i = 0;
+	gboolean ret = TRUE;
+
+	state = cdn_integrator_get_state (CDN_INTEGRATOR (rb));
+	integrated = cdn_integrator_state_integrated_variables (state);
+
+	if (cdn_integrator_state_direct_edge_actions (state) != NULL ||
+	    g_slist_length ((GSList *)integrated) != rb->priv->num_values)
+	{
+		return FALSE;
+	}
+
+	indices = g_hash_table_new (g_direct_hash, g_direct_equal);
+
+	while (integrated)
+	{
+		g_hash_table_insert (indices, integrated->data, GINT_TO_POINTER (++i));
+		integrated = g_slist_next (integrated);
+	}
+
+	integrated = cdn_integrator_state_integrated_variables (state);
+	actions = cdn_integrator_state_integrated_edge_actions (state);
+
+	t = cdn_object_get_variable (CDN_OBJECT (rb), "t");
+
+	rb->priv->rows = g_hash_table_new (g_direct_hash, g_direct_equal);
+
+	while (actions)
+	{
+		JacobianRow *row;
+
+		row = derive_row (actions->data,
+		                  integrated,
+		                  t,
+		                  indices,
+		                  rb->priv->num_values);
+
+		if (!row)
+		{
+			ret = FALSE;
+			break;
+		}
+
+		g_hash_table_insert (rb->priv->rows, actions->data, row);
+		actions = g_slist_next (actions);
+	}
+
+	g_hash_table_destroy (indices);
+
+	if (!ret)
+	{
+		free_rows (rb);
+	}
+
+	return ret;
+}
+
+static void
+evaluate_jacobian_symbolic (CdnIntegratorRosenbrock *rb)
+{
+	CdnIntegratorState *state;
+	GSList const *actions;
+	guint n = rb->priv->num_values;
+
+	state = cdn_integrator_get_state (CDN_INTEGRATOR (rb));
+	actions = cdn_integrator_state_phase_integrated_edge_actions (state);
+
+	memset (rb->priv->jacobian, 0, sizeof (gdouble) * n * n);
+	memset (rb->priv->dfdt, 0, sizeof (gdouble) * n);
+
+	while (actions)
+	{
+		JacobianRow *row;
+		gdouble *ptr;
+		guint j;
+
+		row = g_hash_table_lookup (rb->priv->rows, actions->data);
+		actions = g_slist_next (actions);
+
+		if (!row)
+		{
+			continue;
+		}
+
+		ptr = rb->priv->jacobian + row->row * n;
+
+		for (j = 0; j < n; ++j)
+		{
+			if (row->columns[j])
+			{
+				ptr[j] += cdn_expression_evaluate (row->columns[j]);
+			}
+		}
+
+		if (row->columns[n])
+		{
+			rb->priv->dfdt[row->row] += cdn_expression_evaluate (row->columns[n]);
+		}
+	}
+}
+
+static void
+evaluate_jacobian_numeric (CdnIntegratorRosenbrock *rb,
+                           CdnIntegratorState      *state,
+                           gdouble                  t,
+                           gdouble                  h)
+{
+	CdnIntegratorRosenbrockPrivate *priv = rb->priv;
+	guint n = priv->num_values;
+	gdouble delta;
+	guint i;
+	guint j;
+
+	memcpy (priv->ytmp, priv->y0, sizeof (gdouble) * n);
+
+	for (j = 0; j < n; ++j)
+	{
+		delta = sqrt (DBL_EPSILON) * MAX (1, fabs (priv->y0[j]));
+
+		priv->ytmp[j] = priv->y0[j] + delta;
+
+		cdn_integrator_state_set_integrated_values (state, priv->ytmp);
+		derivatives (CDN_INTEGRATOR (rb), t, h, priv->ftmp);
+
+		for (i = 0; i < n; ++i)
+		{
+			priv->jacobian[i * n + j] = (priv->ftmp[i] - priv->f0[i]) / delta;
+		}
+
+		priv->ytmp[j] = priv->y0[j];
+	}
+
+	delta = sqrt (DBL_EPSILON) * MAX (1, fabs (t));
+
+	cdn_integrator_state_set_integrated_values (state, priv->y0);
+	derivatives (CDN_INTEGRATOR (rb), t + delta, h, priv->ftmp);
+
+	for (i = 0; i < n; ++i)
+	{
+		priv->dfdt[i] = (priv->ftmp[i] - priv->f0[i]) / delta;
+	}
+}
+
+/* LU decomposition with partial pivoting, in place. Pivots that vanish
+ * relative to the largest entry of the matrix are treated as singular */
+static gboolean
+lu_factorize (gdouble *a,
+              gint    *pivots,
+              guint    n)
+{
+	gdouble tolerance = 0;
+	guint k;
+
+	for (k = 0; k < n * n; ++k)
+	{
+		tolerance = MAX (tolerance, fabs (a[k]));
+	}
+
+	tolerance *= n * DBL_EPSILON;
+
+	for (k = 0; k < n; ++k)
+	{
+		guint p = k;
+		gdouble mx = fabs (a[k * n + k]);
+		guint i;
+
+		for (i = k + 1; i < n; ++i)
+		{
+			if (fabs (a[i * n + k]) > mx)
+			{
+				mx = fabs (a[i * n + k]);
+				p = i;
+			}
+		}
+
+		pivots[k] = p;
+
+		if (mx <= tolerance)
+		{
+			return FALSE;
+		}
+
+		if (p != k)
+		{
+			guint j;
+
+			for (j = 0; j < n; ++j)
+			{
+				gdouble tmp = a[k * n + j];
+
+				a[k * n + j] = a[p * n + j];
+				a[p * n + j] = tmp;
+			}
+		}
+
+		for (i = k + 1; i < n; ++i)
+		{
+			gdouble f;
+			guint j;
+
+			f = a[i * n + k] / a[k * n + k];
+			a[i * n + k] = f;
+
+			for (j = k + 1; j < n; ++j)
+			{
+				a[i * n + j] -= f * a[k * n + j];
+			}
+		}
+	}
+
+	return TRUE;
+}
+
+static void
+lu_solve (gdouble const *a,
+          gint const    *pivots,
+          guint          n,
+          gdouble       *b)
+{
+	guint i;
+
+	for (i = 0; i < n; ++i)
+	{
+		guint j;
+
+		if ((guint)pivots[i] != i)
+		{
+			gdouble tmp = b[i];
+
+			b[i] = b[pivots[i]];
+			b[pivots[i]] = tmp;
+		}
+
+		for (j = 0; j < i; ++j)
+		{
+			b[i] -= a[i * n + j] * b[j];
+		}
+	}
+
+	for (i = n; i > 0; --i)
+	{
+		guint r = i - 1;
+		guint j;
+
+		for (j = r + 1; j < n; ++j)
+		{
+			b[r] -= a[r * n + j] * b[j];
+		}
+
+		b[r] /= a[r * n + r];
+	}
+}
+
+/* Factorize the iteration matrix (I - gamma h J). Returns FALSE when the
+ * matrix is singular for this step size. */
+static gboolean
+factorize (CdnIntegratorRosenbrock *rb,
+           gdouble                  h)
+{
+	CdnIntegratorRosenbrockPrivate *priv = rb->priv;
+	guint n = priv->num_values;
+	guint i;
+
+	for (i = 0; i < n * n; ++i)
+	{
+		priv->lu[i] = -GAMMA * h * priv->jacobian[i];
+	}
+
+	for (i = 0; i < n; ++i)
+	{
+		priv->lu[i * n + i] += 1;
+	}
+
+	return lu_factorize (priv->lu, priv->pivots, n);
+}
+
+static void
+cdn_integrator_rosenbrock_reset_impl (CdnIntegrator *integrator)
+{
+	if (CDN_INTEGRATOR_CLASS (cdn_integrator_rosenbrock_parent_class)->reset)
+	{
+		CDN_INTEGRATOR_CLASS (cdn_integrator_rosenbrock_parent_class)->reset (integrator);
+	}
+
+	initialize_buffers (CDN_INTEGRATOR_ROSENBROCK (integrator));
+	CDN_INTEGRATOR_ROSENBROCK (integrator)->priv->warned_singular = FALSE;
+}
+
+/* Factorize the iteration matrix, halving the step size while it is
+ * singular (I - gamma h J is singular only when 1 / (gamma h) is an
+ * eigenvalue of J, so a smaller step moves away from it). Returns FALSE
+ * when no step size above the minimum time step gives a regular matrix. */
+static gboolean
+factorize_shrink (CdnIntegratorRosenbrock *rb,
+                  gdouble                  t,
+                  gdouble                 *timestep)
+{
+	CdnIntegrator *integrator = CDN_INTEGRATOR (rb);
+	gdouble minimum_timestep;
+	gdouble h = *timestep;
+	guint i;
+
+	if (factorize (rb, h))
+	{
+		return TRUE;
+	}
+
+	g_object_get (integrator, "minimum-timestep", &minimum_timestep, NULL);
+
+	for (i = 0; i < MAX_SINGULAR_RETRIES && h / 2 >= minimum_timestep; ++i)
+	{
+		h /= 2;
+
+		if (factorize (rb, h))
+		{
+			/* Reject the original step and redo the derivatives at
+			   the smaller step size */
+			*timestep = h;
+
+			cdn_integrator_step_prepare (integrator, t, h);
+
+			cdn_integrator_state_set_integrated_values (cdn_integrator_get_state (integrator),
+			                                            rb->priv->y0);
+
+			derivatives (integrator, t, h, rb->priv->f0);
+			return TRUE;
+		}
+	}
+
+	return FALSE;
+}
+
+static gdouble
+cdn_integrator_rosenbrock_step_impl (CdnIntegrator *integrator,
+                                     gdouble        t,
+                                     gdouble        timestep)
+{
+	CdnIntegratorRosenbrock *rb;
+	CdnIntegratorRosenbrockPrivate *priv;
+	CdnIntegratorState *state;
+	CdnIntegratorClass *cls;
+	gboolean implicit;
+	guint n;
+	guint i;
+
+	rb = CDN_INTEGRATOR_ROSENBROCK (integrator);
+	priv = rb->priv;
+
+	if (!cdn_integrator_step_prepare (integrator, t, timestep))
+	{
+		return 0;
+	}
+
+	state = cdn_integrator_get_state (integrator);
+
+	if (cdn_integrator_state_integrated_size (state) != priv->num_values)
+	{
+		initialize_buffers (rb);
+	}
+
+	if (!priv->prepared)
+	{
+		priv->symbolic = derive_jacobian (rb);
+		priv->prepared = TRUE;
+	}
+
+	n = priv->num_values;
+
+	cdn_integrator_state_get_integrated_values (state, priv->y0);
+	derivatives (integrator, t, timestep, priv->f0);
+
+	if (priv->symbolic)
+	{
+		evaluate_jacobian_symbolic (rb);
+	}
+	else
+	{
+		evaluate_jacobian_numeric (rb, state, t, timestep);
+	}
+
+	implicit = factorize_shrink (rb, t, &timestep);
+
+	if (!implicit && !priv->warned_singular)
+	{
+		g_warning ("Rosenbrock: the iteration matrix is singular at t = %g, "
+		           "falling back to explicit steps",
+		           t);
+
+		priv->warned_singular = TRUE;
+	}
+
+	/* (I - gamma h J) k1 = f(t, y0) + gamma h df/dt */
+	for (i = 0; i < n; ++i)
+	{
+		priv->k1[i] = priv->f0[i] + GAMMA * timestep * priv->dfdt[i];
+	}
+
+	if (implicit)
+	{
+		lu_solve (priv->lu, priv->pivots, n, priv->k1);
+	}
+
+	for (i = 0; i < n; ++i)
+	{
+		priv->ytmp[i] = priv->y0[i] + timestep * priv->k1[i];
+	}
+
+	/* (I - gamma h J) k2 = f(t + h, y0 + h k1) - 2 k1 - gamma h df/dt */
+	cdn_integrator_state_set_integrated_values (state, priv->ytmp);
+	derivatives (integrator, t + timestep, timestep, priv->k2);
+
+	for (i = 0; i < n; ++i)
+	{
+		priv->k2[i] -= 2 * priv->k1[i] + GAMMA * timestep * priv->dfdt[i];
+	}
+
+	if (implicit)
+	{
+		lu_solve (priv->lu, priv->pivots, n, priv->k2);
+	}
+
+	for (i = 0; i < n; ++i)
+	{
+		priv->ytmp[i] = priv->y0[i] +
+		                timestep * (1.5 * priv->k1[i] + 0.5 * priv->k2[i]);
+	}
+
+	cdn_integrator_state_set_integrated_values (state, priv->ytmp);
+
+	cls = CDN_INTEGRATOR_CLASS (cdn_integrator_rosenbrock_parent_class);
+
+	/* Chain up to emit 'step' */
+	return cls->step (integrator, t, timestep);
+}
+
+static gchar const *
+cdn_integrator_rosenbrock_get_name_impl (CdnIntegrator *integrator)
+{
+	return "Rosenbrock";
+}
+
+static void
+cdn_integrator_rosenbrock_class_init (CdnIntegratorRosenbrockClass *klass)
+{
+	GObjectClass *object_class = G_OBJECT_CLASS (klass);
+	CdnIntegratorClass *integrator_class = CDN_INTEGRATOR_CLASS (klass);
+
+	object_class->finalize = cdn_integrator_rosenbrock_finalize;
+
+	integrator_class->step = cdn_integrator_rosenbrock_step_impl;
+	integrator_class->get_name = cdn_integrator_rosenbrock_get_name_impl;
+	integrator_class->reset = cdn_integrator_rosenbrock_reset_impl;
+
+	integrator_class->integrator_id = "rosenbrock";
+
+	g_type_class_add_private (object_class, sizeof(CdnIntegratorRosenbrockPrivate));
+}
+
+static void
+cdn_integrator_rosenbrock_init (CdnIntegratorRosenbrock *self)
+{
+	self->priv = CDN_INTEGRATOR_ROSENBROCK_GET_PRIVATE (self);
+}
+
+/**
+ * cdn_integrator_rosenbrock_new:
+ *
+ * Create a new Rosenbrock integrator.
+ *
+ * Returns: A #CdnIntegratorRosenbrock
+ *
+ **/
+CdnIntegratorRosenbrock *
+cdn_integrator_rosenbrock_new (void)
+{
+	return g_object_new (CDN_TYPE_INTEGRATOR_ROSENBROCK, NULL);
+}
+
+/**
+ * cdn_integrator_rosenbrock_get_symbolic:
+ * @rosenbrock: A #CdnIntegratorRosenbrock
+ *
+ * Get whether the Jacobian is evaluated from symbolic derivatives. This is
+ * only known after the first step of a simulation. When %FALSE, the
+ * Jacobian is approximated with finite differences.
+ *
+ * Returns: %TRUE if the Jacobian is derived symbolically, %FALSE otherwise
+ *
+ **/
+gboolean
+cdn_integrator_rosenbrock_get_symbolic (CdnIntegratorRosenbrock *rosenbrock)
+{
+	g_return_val_if_fail (CDN_IS_INTEGRATOR_ROSENBROCK (rosenbrock), FALSE);
+
+	return rosenbrock->priv->symbolic;
+}
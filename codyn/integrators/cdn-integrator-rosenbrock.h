@@ -0,0 +1,82 @@
+/*
+ * cdn-integrator-rosenbrock.h
+ * This file is part of codyn
+ *
+ * Copyright (C) 2011 - Jesse van den Kieboom
+ *
+ * codyn is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * codyn is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with codyn; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor,
+ * Boston, MA  02110-1301  USA
+ */
+
+#ifndef __CDN_INTEGRATOR_ROSENBROCK_H__
+#define __CDN_INTEGRATOR_ROSENBROCK_H__
+
+#include <codyn/integrators/cdn-integrator.h>
+
+G_BEGIN_DECLS
+
+#define CDN_TYPE_INTEGRATOR_ROSENBROCK				(cdn_integrator_rosenbrock_get_type ())
+#define CDN_INTEGRATOR_ROSENBROCK(obj)				(G_TYPE_CHECK_INSTANCE_CAST ((obj), CDN_TYPE_INTEGRATOR_ROSENBROCK, CdnIntegratorRosenbrock))
+#define CDN_INTEGRATOR_ROSENBROCK_CONST(obj)		(G_TYPE_CHECK_INSTANCE_CAST ((obj), CDN_TYPE_INTEGRATOR_ROSENBROCK, CdnIntegratorRosenbrock const))
+#define CDN_INTEGRATOR_ROSENBROCK_CLASS(klass)		(G_TYPE_CHECK_CLASS_CAST ((klass), CDN_TYPE_INTEGRATOR_ROSENBROCK, CdnIntegratorRosenbrockClass))
+#define CDN_IS_INTEGRATOR_ROSENBROCK(obj)			(G_TYPE_CHECK_INSTANCE_TYPE ((obj), CDN_TYPE_INTEGRATOR_ROSENBROCK))
+#define CDN_IS_INTEGRATOR_ROSENBROCK_CLASS(klass)	(G_TYPE_CHECK_CLASS_TYPE ((klass), CDN_TYPE_INTEGRATOR_ROSENBROCK))
+#define CDN_INTEGRATOR_ROSENBROCK_GET_CLASS(obj)	(G_TYPE_INSTANCE_GET_CLASS ((obj), CDN_TYPE_INTEGRATOR_ROSENBROCK, CdnIntegratorRosenbrockClass))
+
+typedef struct _CdnIntegratorRosenbrock			CdnIntegratorRosenbrock;
+typedef struct _CdnIntegratorRosenbrockClass	CdnIntegratorRosenbrockClass;
+typedef struct _CdnIntegratorRosenbrockPrivate	CdnIntegratorRosenbrockPrivate;
+
+/**
+ * CdnIntegratorRosenbrock:
+ *
+ * Linearly implicit Rosenbrock integrator for stiff systems.
+ *
+ * The Rosenbrock integrator is a #CdnIntegrator subclass implementing the
+ * L-stable, second order ROS2 scheme. Each step solves two linear systems
+ * with the matrix (I - γhJ), where J is the Jacobian of the integrated
+ * edge actions with respect to the integrated variables. This keeps the
+ * integration stable for stiff systems at step sizes far beyond what the
+ * explicit integrators allow.
+ *
+ * The Jacobian is derived symbolically once, after the network has been
+ * compiled, and only evaluated at every step. When the network cannot be
+ * derived symbolically (for example because it contains non scalar
+ * integrated variables or direct edge actions), the Jacobian is
+ * approximated with finite differences instead.
+ */
+struct _CdnIntegratorRosenbrock
+{
+	/*< private >*/
+	CdnIntegrator parent;
+
+	CdnIntegratorRosenbrockPrivate *priv;
+};
+
+struct _CdnIntegratorRosenbrockClass
+{
+	/*< private >*/
+	CdnIntegratorClass parent_class;
+};
+
+GType cdn_integrator_rosenbrock_get_type (void) G_GNUC_CONST;
+
+CdnIntegratorRosenbrock *cdn_integrator_rosenbrock_new (void);
+
+gboolean cdn_integrator_rosenbrock_get_symbolic (CdnIntegratorRosenbrock *rosenbrock);
+
+G_END_DECLS
+
+#endif /* __CDN_INTEGRATOR_ROSENBROCK_H__ */
@@ -30,6 +30,7 @@
 
 struct _CdnIntegratorRungeKuttaPrivate
 {
+	/* y_n followed by K_1 to K_3, in the state vector layout */
 	gdouble *coefficients[MAX_COEFFICIENTS];
 	guint num_coefficients;
 };
@@ -44,61 +45,30 @@ cdn_integrator_runge_kutta_finalize (GObject *object)
 
 	for (i = 0; i < MAX_COEFFICIENTS; ++i)
 	{
-		if (rk->priv->coefficients[i])
-		{
-			g_free (rk->priv->coefficients[i]);
-		}
+		g_free (rk->priv->coefficients[i]);
 	}
 
 	G_OBJECT_CLASS (cdn_integrator_runge_kutta_parent_class)->finalize (object);
 }
 
-static gint
-calculate_length (CdnIntegratorRungeKutta *rk)
-{
-	CdnIntegratorState *state = cdn_integrator_get_state (CDN_INTEGRATOR (rk));
-	GSList const *integrated;
-	gint len = 0;
-
-	integrated = cdn_integrator_state_integrated_variables (state);
-
-	while (integrated)
-	{
-		CdnExpression *expr;
-
-		CdnDimension dim;
-
-		expr = cdn_variable_get_expression (integrated->data);
-		cdn_expression_get_dimension (expr, &dim);
-
-		len += cdn_dimension_size (&dim);
-
-		integrated = g_slist_next (integrated);
-	}
-
-	return len;
-}
-
 static void
 initialize_coefficients (CdnIntegratorRungeKutta *rk)
 {
-	gint len;
+	CdnIntegratorState *state;
+	guint len;
+	guint i;
 
-	len = calculate_length (rk);
+	state = cdn_integrator_get_state (CDN_INTEGRATOR (rk));
+	len = cdn_integrator_state_integrated_size (state);
 
-	if (len == rk->priv->num_coefficients)
+	if (len == rk->priv->num_coefficients && rk->priv->coefficients[0])
 	{
 		return;
 	}
 
-	guint i;
 	for (i = 0; i < MAX_COEFFICIENTS; ++i)
 	{
-		if (rk->priv->coefficients[i])
-		{
-			g_free (rk->priv->coefficients[i]);
-		}
-
+		g_free (rk->priv->coefficients[i]);
 		rk->priv->coefficients[i] = g_new0 (gdouble, len);
 	}
 
@@ -107,84 +77,52 @@ initialize_coefficients (CdnIntegratorRungeKutta *rk)
 
 static void
 store_coefficients (CdnIntegratorRungeKutta *rk,
-                    GSList const            *integrated,
+                    CdnIntegratorState      *state,
                     guint                    order,
                     gdouble                  norm)
 {
-	gint i = 0;
-	gint n;
+	gdouble *y0 = rk->priv->coefficients[0];
+	guint n = rk->priv->num_coefficients;
+	gdouble *stage;
+	guint i;
 
-	while (integrated)
+	if (order == 0)
 	{
-		CdnVariable *prop = integrated->data;
+		cdn_integrator_state_get_integrated_values (state, y0);
+		return;
+	}
 
-		if (order == 0)
-		{
-			CdnMatrix const *vals;
+	/* Compute the next stage in place in the state vector */
+	stage = cdn_integrator_state_get_integrated_storage (state);
 
-			vals = cdn_variable_get_values (prop);
-			cdn_matrix_copy_to (vals, rk->priv->coefficients[0] + i);
+	if (order == MAX_COEFFICIENTS)
+	{
+		gdouble const *k1 = rk->priv->coefficients[1];
+		gdouble const *k2 = rk->priv->coefficients[2];
+		gdouble const *k3 = rk->priv->coefficients[3];
 
-			n = cdn_matrix_size (vals);
-		}
-		else
+		/* Do the final update right away, K_4 goes in the stage */
+		cdn_integrator_state_get_integrated_updates (state, stage);
+
+		for (i = 0; i < n; ++i)
 		{
-			if (order == MAX_COEFFICIENTS)
-			{
-				/* Do the final update right away */
-				gint j;
-				CdnMatrix *up;
-				gdouble *upvals;
-
-				up = cdn_variable_get_update (prop);
-				upvals = cdn_matrix_get_memory (up);
-
-				n = cdn_matrix_size (up);
-
-				for (j = 0; j < n; ++j)
-				{
-					gdouble v;
-					gint idx = i + j;
-
-					v = rk->priv->coefficients[1][idx] +
-					    2 * rk->priv->coefficients[2][idx] +
-					    2 * rk->priv->coefficients[3][idx] +
-					    upvals[j];
-
-					upvals[j] = rk->priv->coefficients[0][idx] +
-					            1.0 / 6.0 * norm * v;
-				}
-
-				cdn_variable_set_values (prop, up);
-			}
-			else
-			{
-				CdnMatrix *ret;
-				gdouble *retvals;
-				gint j;
-
-				ret = cdn_variable_get_update (prop);
-				retvals = cdn_matrix_get_memory (ret);
-
-				n = cdn_matrix_size (ret);
-
-				cdn_matrix_copy_to (ret,
-				                    rk->priv->coefficients[order] + i);
-
-				for (j = 0; j < n; ++j)
-				{
-					retvals[j] = rk->priv->coefficients[0][i + j] +
-					             norm * retvals[j];
-				}
-
-				cdn_variable_set_values (prop, ret);
-			}
+			stage[i] = y0[i] + 1.0 / 6.0 * norm *
+			           (k1[i] + 2 * k2[i] + 2 * k3[i] + stage[i]);
 		}
+	}
+	else
+	{
+		gdouble *k = rk->priv->coefficients[order];
 
-		i += n;
+		cdn_integrator_state_get_integrated_updates (state, k);
 
-		integrated = g_slist_next (integrated);
+		for (i = 0; i < n; ++i)
+		{
+			stage[i] = y0[i] + norm * k[i];
+		}
 	}
+
+	cdn_integrator_state_set_integrated_values (state, stage);
 }
 
 static void
@@ -214,26 +152,25 @@ cdn_integrator_runge_kutta_step_impl (CdnIntegrator *integrator,
 	}
 
 	CdnIntegratorState *state = cdn_integrator_get_state (integrator);
-	GSList const *integrated = cdn_integrator_state_integrated_variables (state);
 
 	/* K_1 = f(t_n, y_n) */
-	store_coefficients (rk, integrated, 0, 0);
+	store_coefficients (rk, state, 0, 0);
 	cdn_integrator_evaluate (integrator, t, timestep);
 
 	/* K_2 = f(t_n + 0.5 * h, y_n + 0.5 * h * K_1) */
-	store_coefficients (rk, integrated, 1, 0.5 * timestep);
+	store_coefficients (rk, state, 1, 0.5 * timestep);
 	cdn_integrator_evaluate (integrator, t + 0.5 * timestep, 0.5 * timestep);
 
 	/* K_3 = f(t_n + 0.5 * h, y_n + 0.5 * h * K_2) */
-	store_coefficients (rk, integrated, 2, 0.5 * timestep);
+	store_coefficients (rk, state, 2, 0.5 * timestep);
 	cdn_integrator_evaluate (integrator, t + 0.5 * timestep, 0.5 * timestep);
 
 	/* K_4 = f(t_n + h, y_n + h * K_3) */
-	store_coefficients (rk, integrated, 3, timestep);
+	store_coefficients (rk, state, 3, timestep);
 	cdn_integrator_evaluate (integrator, t + timestep, timestep);
 
 	/* This last call will also transfer the new state */
-	store_coefficients (rk, integrated, 4, timestep);
+	store_coefficients (rk, state, 4, timestep);
 
 	cls = CDN_INTEGRATOR_CLASS (cdn_integrator_runge_kutta_parent_class);
 
@@ -24,12 +24,76 @@
 #include "cdn-edge.h"
 #include "cdn-io.h"
 #include "instructions/cdn-instruction-custom-operator.h"
+#include "instructions/cdn-instruction-custom-operator-ref.h"
+#include "instructions/cdn-instruction-custom-function.h"
+#include "instructions/cdn-instruction-custom-function-ref.h"
 #include "instructions/cdn-instruction-rand.h"
 #include "cdn-phaseable.h"
 #include "cdn-event.h"
+#include "cdn-profile.h"
+#include "cdn-debug.h"
+#include <string.h>
 
 #define CDN_INTEGRATOR_STATE_GET_PRIVATE(object)(G_TYPE_INSTANCE_GET_PRIVATE((object), CDN_TYPE_INTEGRATOR_STATE, CdnIntegratorStatePrivate))
 
+typedef struct _ParallelPlan ParallelPlan;
+
+typedef struct
+{
+	CdnVariable *variable;
+	CdnExpression *expression;
+	CdnDimension dimension;
+	guint size;
+
+	/* The slice in the state vector */
+	gdouble *storage;
+
+	/* Constrained values cannot be read from the storage */
+	guint constrained : 1;
+} IntegratedSlice;
+
+/* The lists of phaseables which are active in the current phases */
+typedef enum
+{
+	PHASE_LIST_EVENTS,
+	PHASE_LIST_INTEGRATED,
+	PHASE_LIST_DIRECT,
+	PHASE_LIST_DISCRETE,
+	NUM_PHASE_LISTS
+} PhaseList;
+
+/* The phaseables of a node which are active in one of its phases. The
+ * plan of every phase the node can reach is built when the state is
+ * updated, so that changing phase only selects a different plan. */
+typedef struct
+{
+	gchar *phase;
+
+	// Segments of the phase lists, linked together by relink_phase_lists
+	GSList *lists[NUM_PHASE_LISTS];
+	GSList *tails[NUM_PHASE_LISTS];
+
+	// Whether each of the node phaseables is active in this phase
+	guint8 *active;
+} PhasePlan;
+
+typedef struct
+{
+	CdnNode *node;
+
+	// The phaseables which depend on the phase of the node
+	GPtrArray *phaseables;
+
+	// The direct variable infos targeted by these phaseables
+	GSList *direct_infos;
+
+	// Plans by phase, and the plan for when the node has no phase
+	GHashTable *plans;
+	PhasePlan *none;
+
+	PhasePlan *current;
+} NodePhases;
+
 struct _CdnIntegratorStatePrivate
 {
 	CdnObject *object;
@@ -52,14 +116,42 @@ struct _CdnIntegratorStatePrivate
 	GSList *io;
 	GSList *expressions;
 	GSList *events;
-	GSList *phase_events;
 
-	GSList *phase_direct_edge_actions;
-	GSList *phase_integrated_edge_actions;
-	GSList *phase_discrete_edge_actions;
+	/* The active events and edge actions, linked from the plans of the
+	 * current phase of every node in phase_nodes, followed by the
+	 * phaseables which are always active */
+	GSList *phase_lists[NUM_PHASE_LISTS];
+	GSList *base_lists[NUM_PHASE_LISTS];
+	GSList *phase_nodes;
 
 	GHashTable *direct_variables_hash;
+
+	/* Maps nodes with phases to their NodePhases */
 	GHashTable *state_hash;
+
+	CdnExpressionProgram *program;
+
+	gdouble *arena;
+	guint arena_size;
+	GSList *arena_expressions;
+
+	ParallelPlan *parallel_plan;
+
+	/* Integrated edge actions which are left out of fused and parallel
+	   evaluation, since they integrate at a lower rate */
+	GSList *slow_edge_actions;
+	GHashTable *slow_edge_actions_hash;
+
+	/* Layout of the integrated variables in a contiguous state vector,
+	   which is the storage of their values */
+	IntegratedSlice *layout;
+	guint layout_length;
+	gdouble *integrated;
+	guint integrated_size;
+
+	guint fused : 1;
+	guint use_arena : 1;
+	guint parallel : 1;
 };
 
 G_DEFINE_TYPE (CdnIntegratorState, cdn_integrator_state, G_TYPE_OBJECT)
@@ -73,19 +165,41 @@ enum
 enum
 {
 	PROP_0,
-	PROP_OBJECT
+	PROP_OBJECT,
+	PROP_FUSED,
+	PROP_ARENA,
+	PROP_PARALLEL
 };
 
 static guint signals[NUM_SIGNALS] = {0,};
 
+typedef struct
+{
+	CdnEdgeAction *action;
+
+	// The node on whose phase the action depends, and the index of the
+	// action in its phaseables, or NULL if the action is always active
+	NodePhases *node;
+	guint index;
+} DirectSlot;
+
 typedef struct
 {
 	CdnVariable *variable;
 
 	GSList      *actions;
-	GSList      *phase_actions;
+
+	// The actions which can be active
+	DirectSlot  *slots;
+	guint        num_slots;
 } DirectInfo;
 
+static inline gboolean
+direct_slot_active (DirectSlot const *slot)
+{
+	return slot->node == NULL || slot->node->current->active[slot->index];
+}
+
 static void
 evaluate_notify (CdnExpression *expression,
                  DirectInfo    *info);
@@ -138,7 +252,7 @@ direct_info_free (DirectInfo *info)
 	g_slist_foreach (info->actions, (GFunc)g_object_unref, NULL);
 
 	g_slist_free (info->actions);
-	g_slist_free (info->phase_actions);
+	g_free (info->slots);
 
 	g_slice_free (DirectInfo, info);
 }
@@ -156,9 +270,103 @@ clear_list (GSList **lst)
 	*lst = NULL;
 }
 
+static void parallel_plan_free (ParallelPlan *plan);
+static void node_phases_free (NodePhases *np);
+
+static void
+clear_phase_lists (CdnIntegratorState *state)
+{
+	gint i;
+
+	// The phase lists are owned by the base lists and the phase plans,
+	// which cut their segments loose before freeing them
+	for (i = 0; i < NUM_PHASE_LISTS; ++i)
+	{
+		state->priv->phase_lists[i] = NULL;
+		clear_list (&(state->priv->base_lists[i]));
+	}
+
+	clear_list (&(state->priv->phase_nodes));
+}
+
+static void
+clear_program (CdnIntegratorState *state)
+{
+	_cdn_expression_program_free (state->priv->program);
+	state->priv->program = NULL;
+
+	// The parallel plan depends on the active actions in the same way
+	parallel_plan_free (state->priv->parallel_plan);
+	state->priv->parallel_plan = NULL;
+}
+
+static void
+clear_arena (CdnIntegratorState *state)
+{
+	GSList *item;
+
+	for (item = state->priv->arena_expressions; item; item = g_slist_next (item))
+	{
+		_cdn_expression_set_arena (item->data, NULL);
+	}
+
+	g_slist_foreach (state->priv->arena_expressions, (GFunc)g_object_unref, NULL);
+	g_slist_free (state->priv->arena_expressions);
+	state->priv->arena_expressions = NULL;
+
+	g_free (state->priv->arena);
+	state->priv->arena = NULL;
+	state->priv->arena_size = 0;
+}
+
+static void
+clear_layout (CdnIntegratorState *state)
+{
+	guint i;
+
+	for (i = 0; i < state->priv->layout_length; ++i)
+	{
+		IntegratedSlice *slice = &state->priv->layout[i];
+
+		if (_cdn_expression_get_storage (slice->expression) == slice->storage)
+		{
+			_cdn_expression_set_storage (slice->expression, NULL);
+		}
+
+		g_object_unref (slice->expression);
+	}
+
+	g_free (state->priv->layout);
+	state->priv->layout = NULL;
+
+	g_free (state->priv->integrated);
+	state->priv->integrated = NULL;
+
+	state->priv->layout_length = 0;
+	state->priv->integrated_size = 0;
+}
+
+static void
+clear_slow_edge_actions (CdnIntegratorState *state)
+{
+	g_slist_free (state->priv->slow_edge_actions);
+	state->priv->slow_edge_actions = NULL;
+
+	if (state->priv->slow_edge_actions_hash)
+	{
+		g_hash_table_destroy (state->priv->slow_edge_actions_hash);
+		state->priv->slow_edge_actions_hash = NULL;
+	}
+}
+
 static void
 clear_lists (CdnIntegratorState *state)
 {
+	clear_program (state);
+	clear_slow_edge_actions (state);
+	clear_arena (state);
+	clear_layout (state);
+
 	clear_list (&(state->priv->integrated_variables));
 	clear_list (&(state->priv->direct_variables));
 	clear_list (&(state->priv->discrete_variables));
@@ -168,9 +376,7 @@ clear_lists (CdnIntegratorState *state)
 	clear_list (&(state->priv->direct_edge_actions));
 	clear_list (&(state->priv->discrete_edge_actions));
 
-	clear_list (&(state->priv->phase_integrated_edge_actions));
-	clear_list (&(state->priv->phase_direct_edge_actions));
-	clear_list (&(state->priv->phase_discrete_edge_actions));
+	clear_phase_lists (state);
 
 	clear_list (&(state->priv->io));
 	clear_list (&(state->priv->expressions));
@@ -180,7 +386,6 @@ clear_lists (CdnIntegratorState *state)
 	clear_list (&(state->priv->rand_instructions));
 	clear_list (&(state->priv->functions));
 	clear_list (&(state->priv->events));
-	clear_list (&(state->priv->phase_events));
 	clear_list (&(state->priv->nodes));
 
 	// Clear the table
@@ -273,6 +478,15 @@ cdn_integrator_state_set_property (GObject      *object,
 		case PROP_OBJECT:
 			set_object (self, g_value_get_object (value));
 		break;
+		case PROP_FUSED:
+			cdn_integrator_state_set_fused (self, g_value_get_boolean (value));
+		break;
+		case PROP_ARENA:
+			cdn_integrator_state_set_arena (self, g_value_get_boolean (value));
+		break;
+		case PROP_PARALLEL:
+			cdn_integrator_state_set_parallel (self, g_value_get_boolean (value));
+		break;
 		default:
 			G_OBJECT_WARN_INVALID_PROPERTY_ID (object, prop_id, pspec);
 		break;
@@ -292,6 +506,15 @@ cdn_integrator_state_get_property (GObject    *object,
 		case PROP_OBJECT:
 			g_value_set_object (value, self->priv->object);
 		break;
+		case PROP_FUSED:
+			g_value_set_boolean (value, self->priv->fused);
+		break;
+		case PROP_ARENA:
+			g_value_set_boolean (value, self->priv->use_arena);
+		break;
+		case PROP_PARALLEL:
+			g_value_set_boolean (value, self->priv->parallel);
+		break;
 		default:
 			G_OBJECT_WARN_INVALID_PROPERTY_ID (object, prop_id, pspec);
 		break;
@@ -340,28 +563,59 @@ cdn_integrator_state_class_init (CdnIntegratorStateClass *klass)
 	                                                      "Object",
 	                                                      CDN_TYPE_OBJECT,
 	                                                      G_PARAM_READWRITE | G_PARAM_CONSTRUCT_ONLY));
-}
 
-static void
-release_state_node (CdnNode *node)
-{
-	g_object_unref (node);
-}
+	/**
+	 * CdnIntegratorState:fused:
+	 *
+	 * Whether to evaluate all the integrated and direct edge actions
+	 * together as a single program
+	 *
+	 **/
+	g_object_class_install_property (object_class,
+	                                 PROP_FUSED,
+	                                 g_param_spec_boolean ("fused",
+	                                                       "Fused",
+	                                                       "Fused",
+	                                                       FALSE,
+	                                                       G_PARAM_READWRITE |
+	                                                       G_PARAM_STATIC_STRINGS));
 
-static void
-object_unref0 (gpointer ptr)
-{
-	if (ptr != NULL)
-	{
-		g_object_unref (ptr);
-	}
+	/**
+	 * CdnIntegratorState:arena:
+	 *
+	 * Whether the evaluation stacks of all the expressions are allocated
+	 * from a single block of memory
+	 *
+	 **/
+	g_object_class_install_property (object_class,
+	                                 PROP_ARENA,
+	                                 g_param_spec_boolean ("arena",
+	                                                       "Arena",
+	                                                       "Arena",
+	                                                       FALSE,
+	                                                       G_PARAM_READWRITE |
+	                                                       G_PARAM_STATIC_STRINGS));
+
+	/**
+	 * CdnIntegratorState:parallel:
+	 *
+	 * Whether independent integrated edge actions are evaluated in parallel
+	 *
+	 **/
+	g_object_class_install_property (object_class,
+	                                 PROP_PARALLEL,
+	                                 g_param_spec_boolean ("parallel",
+	                                                       "Parallel",
+	                                                       "Parallel",
+	                                                       FALSE,
+	                                                       G_PARAM_READWRITE |
+	                                                       G_PARAM_STATIC_STRINGS));
 }
 
 static void
-release_state_list (GSList *list)
+release_state_node (CdnNode *node)
 {
-	g_slist_foreach (list, (GFunc)object_unref0, NULL);
-	g_slist_free (list);
+	g_object_unref (node);
 }
 
 static void
@@ -379,7 +633,7 @@ cdn_integrator_state_init (CdnIntegratorState *self)
 		g_hash_table_new_full (g_direct_hash,
 		                       g_direct_equal,
 		                       (GDestroyNotify)release_state_node,
-		                       (GDestroyNotify)release_state_list);
+		                       (GDestroyNotify)node_phases_free);
 }
 
 /**
@@ -716,11 +970,17 @@ static void
 evaluate_notify (CdnExpression *expression,
                  DirectInfo    *info)
 {
-	GSList *item;
 	CdnMatrix *update;
+	gboolean active = FALSE;
+	guint i;
+
+	for (i = 0; i < info->num_slots && !active; ++i)
+	{
+		active = direct_slot_active (&info->slots[i]);
+	}
 
 	// Update variable cache from the direct actions
-	if (!info->phase_actions)
+	if (!active)
 	{
 		return;
 	}
@@ -728,14 +988,21 @@ evaluate_notify (CdnExpression *expression,
 	cdn_variable_clear_update (info->variable);
 	update = cdn_variable_get_update (info->variable);
 
-	for (item = info->phase_actions; item; item = g_slist_next (item))
+	for (i = 0; i < info->num_slots; ++i)
 	{
-		CdnEdgeAction *action = item->data;
-		CdnExpression *expr = cdn_edge_action_get_equation (action);
+		CdnEdgeAction *action = info->slots[i].action;
+		CdnExpression *expr;
 		gint const *indices;
 		gint num_indices;
 		CdnMatrix const *values;
 
+		if (!direct_slot_active (&info->slots[i]))
+		{
+			continue;
+		}
+
+		expr = cdn_edge_action_get_equation (action);
+
 		indices = cdn_edge_action_get_indices (action, &num_indices);
 		values = cdn_expression_evaluate_values (expr);
 
@@ -749,27 +1016,25 @@ evaluate_notify (CdnExpression *expression,
 	cdn_variable_set_values (info->variable, update);
 }
 
-static CdnNode *
-find_state_object (CdnIntegratorState  *state,
-                   CdnNode             *parent,
-                   GSList             **lst)
+static NodePhases *
+find_state_object (CdnIntegratorState *state,
+                   CdnNode            *parent)
 {
-	*lst = NULL;
-
 	while (parent)
 	{
-		if (g_hash_table_lookup_extended (state->priv->state_hash,
-		                                  parent,
-		                                  NULL,
-		                                  (gpointer *)lst))
+		NodePhases *np;
+
+		np = g_hash_table_lookup (state->priv->state_hash, parent);
+
+		if (np)
 		{
-			break;
+			return np;
 		}
 
 		parent = cdn_object_get_parent (CDN_OBJECT (parent));
 	}
 
-	return parent;
+	return NULL;
 }
 
 static gboolean
@@ -792,716 +1057,2285 @@ phase_is_active (CdnPhaseable *ph,
 	return cdn_phaseable_is_active (ph, state);
 }
 
-static GSList **
-get_state_list (CdnIntegratorState *state,
-                CdnPhaseable       *ph)
+static PhaseList
+get_phase_list (CdnPhaseable *ph)
 {
 	CdnVariable *tv;
 
 	if (CDN_IS_EVENT (ph))
 	{
-		return &state->priv->phase_events;
+		return PHASE_LIST_EVENTS;
 	}
 
 	tv = cdn_edge_action_get_target_variable (CDN_EDGE_ACTION (ph));
 
 	if (cdn_variable_has_flag (tv, CDN_VARIABLE_FLAG_DISCRETE))
 	{
-		return &state->priv->phase_discrete_edge_actions;
+		return PHASE_LIST_DISCRETE;
 	}
 	else if (cdn_variable_has_flag (tv, CDN_VARIABLE_FLAG_INTEGRATED))
 	{
-		return &state->priv->phase_integrated_edge_actions;
+		return PHASE_LIST_INTEGRATED;
 	}
 	else
 	{
-		return &state->priv->phase_direct_edge_actions;
+		return PHASE_LIST_DIRECT;
 	}
 }
 
-static void
-update_direct_phase (CdnIntegratorState *state,
-                     CdnEdgeAction      *action,
-                     gboolean            add)
+static PhasePlan *
+phase_plan_new (NodePhases  *np,
+                gchar const *phase)
 {
-	CdnVariable *tv;
-	DirectInfo *dinfo;
-
-	// Need to remove from active list in direct
-	// info
-	tv = cdn_edge_action_get_target_variable (action);
+	PhasePlan *plan;
+	gint i;
 
-	dinfo = g_hash_table_lookup (state->priv->direct_variables_hash,
-	                             tv);
+	plan = g_slice_new0 (PhasePlan);
 
-	cdn_expression_force_reset_cache (cdn_variable_get_expression (dinfo->variable));
+	plan->phase = g_strdup (phase);
+	plan->active = g_new0 (guint8, np->phaseables->len);
 
-	if (add)
-	{
-		dinfo->phase_actions = g_slist_prepend (dinfo->phase_actions,
-		                                        action);
-	}
-	else
+	for (i = (gint)np->phaseables->len - 1; i >= 0; --i)
 	{
-		dinfo->phase_actions = g_slist_remove (dinfo->phase_actions,
-		                                       action);
-	}
-}
+		CdnPhaseable *ph = g_ptr_array_index (np->phaseables, i);
+		PhaseList lst;
 
-static gint
-compare_events (CdnEvent *a, CdnEvent *b)
-{
-	CdnNode *pa = cdn_object_get_parent (CDN_OBJECT (a));
-	CdnNode *pb = cdn_object_get_parent (CDN_OBJECT (b));
+		if (!phase_is_active (ph, phase))
+		{
+			continue;
+		}
 
-	return (pa < pb ? -1 : (pa > pb ? 1 : 0));
+		plan->active[i] = 1;
+
+		lst = get_phase_list (ph);
+		plan->lists[lst] = g_slist_prepend (plan->lists[lst], ph);
+
+		if (!plan->tails[lst])
+		{
+			plan->tails[lst] = plan->lists[lst];
+		}
+	}
+
+	return plan;
 }
 
 static void
-add_to_state_hash (CdnIntegratorState *state,
-                   CdnPhaseable       *ph,
-                   CdnNode            *parent)
+phase_plan_free (PhasePlan *plan)
 {
-	GHashTable *states;
-
-	states = cdn_phaseable_get_phase_table (ph);
+	gint i;
 
-	if (states && g_hash_table_size (states) > 0)
+	for (i = 0; i < NUM_PHASE_LISTS; ++i)
 	{
-		CdnNode *st;
-		GSList *lst;
+		// Cut the segment loose from the list it is linked into
+		if (plan->tails[i])
+		{
+			plan->tails[i]->next = NULL;
+		}
 
-		st = find_state_object (state, parent, &lst);
+		g_slist_free (plan->lists[i]);
+	}
 
-		if (st)
-		{
-			gchar const *nst;
+	g_free (plan->active);
+	g_free (plan->phase);
 
-			g_object_ref (ph);
+	g_slice_free (PhasePlan, plan);
+}
 
-			// Make sure to never change the first element of the
-			// list so we don't have to reinsert it in the hash
-			lst->next = g_slist_prepend (lst->next, ph);
-			nst = cdn_node_get_state (st);
+static gsize
+phase_plan_size (NodePhases const *np,
+                 PhasePlan const  *plan)
+{
+	gsize ret;
+	guint i;
 
-			if (phase_is_active (ph, nst))
-			{
-				GSList **ptr;
-
-				ptr = get_state_list (state, ph);
-
-				if (ptr == &state->priv->phase_direct_edge_actions)
-				{
-					update_direct_phase (state,
-					                     CDN_EDGE_ACTION (ph),
-					                     TRUE);
-				}
-
-				if (ptr == &state->priv->phase_events)
-				{
-					*ptr = g_slist_insert_sorted (*ptr,
-					                              ph,
-					                              (GCompareFunc)compare_events);
-				}
-				else
-				{
-					*ptr = g_slist_prepend (*ptr, ph);
-				}
-			}
-		}
-	}
-	else
-	{
-		GSList **ptr;
+	ret = sizeof (PhasePlan) + np->phaseables->len;
 
-		ptr = get_state_list (state, ph);
+	if (plan->phase)
+	{
+		ret += strlen (plan->phase) + 1;
+	}
 
-		if (ptr == &state->priv->phase_direct_edge_actions)
+	for (i = 0; i < np->phaseables->len; ++i)
+	{
+		if (plan->active[i])
 		{
-			update_direct_phase (state,
-			                     CDN_EDGE_ACTION (ph),
-			                     TRUE);
+			ret += sizeof (GSList);
 		}
-
-		*ptr = g_slist_prepend (*ptr, ph);
 	}
+
+	return ret;
 }
 
-static CdnNode *
-state_root_for_edge_action (CdnEdgeAction *action)
+static NodePhases *
+node_phases_new (CdnNode *node)
 {
-	CdnEdge *edge;
-	CdnNode *input;
+	NodePhases *np;
 
-	edge = cdn_edge_action_get_edge (action);
-	input = cdn_edge_get_input (edge);
+	np = g_slice_new0 (NodePhases);
 
-	return input;
+	np->node = node;
+	np->phaseables = g_ptr_array_new_with_free_func ((GDestroyNotify)g_object_unref);
+
+	np->plans = g_hash_table_new_full (g_str_hash,
+	                                   g_str_equal,
+	                                   NULL,
+	                                   (GDestroyNotify)phase_plan_free);
+
+	return np;
 }
 
 static void
-extract_state_hash (CdnIntegratorState *state)
+node_phases_free (NodePhases *np)
 {
-	GSList *item;
-
-	g_hash_table_remove_all (state->priv->state_hash);
+	g_hash_table_destroy (np->plans);
 
-	// Collect all the events on states
-	for (item = state->priv->events; item; item = g_slist_next (item))
+	if (np->none)
 	{
-		CdnEvent *ev = item->data;
-		gchar const *st;
-		GHashTable *states;
-		CdnNode *parent;
-
-		parent = cdn_object_get_parent (CDN_OBJECT (ev));
+		phase_plan_free (np->none);
+	}
 
-		if (g_hash_table_lookup (state->priv->state_hash, parent))
-		{
-			continue;
-		}
+	g_slist_free (np->direct_infos);
+	g_ptr_array_unref (np->phaseables);
 
-		st = cdn_event_get_goto_state (ev);
-		states = cdn_phaseable_get_phase_table (CDN_PHASEABLE (ev));
+	g_slice_free (NodePhases, np);
+}
 
-		if (st != NULL || (states && g_hash_table_size (states) > 0))
-		{
-			g_hash_table_insert (state->priv->state_hash,
-			                     g_object_ref (parent),
-			                     g_slist_prepend (NULL, NULL));
-		}
-	}
+/* Get the plan of @phase, building it if the phase was not known to be
+ * reachable when the state was updated */
+static PhasePlan *
+node_phases_plan (NodePhases  *np,
+                  gchar const *phase)
+{
+	PhasePlan *plan;
 
-	// Also collect all nodes with have an initial state
-	for (item = state->priv->nodes; item; item = g_slist_next (item))
+	if (!phase)
 	{
-		CdnNode *node = item->data;
-
-		if (cdn_node_get_initial_state (node) != NULL &&
-		    !g_hash_table_lookup (state->priv->state_hash, node))
+		if (!np->none)
 		{
-			g_hash_table_insert (state->priv->state_hash,
-			                     g_object_ref (node),
-			                     g_slist_prepend (NULL, NULL));
+			np->none = phase_plan_new (np, NULL);
 		}
-	}
-
-	// Now, collect phaseables
-	for (item = state->priv->integrated_edge_actions; item; item = g_slist_next (item))
-	{
-		CdnNode *parent;
 
-		parent = state_root_for_edge_action (item->data);
-		add_to_state_hash (state, item->data, parent);
+		return np->none;
 	}
 
-	for (item = state->priv->direct_edge_actions; item; item = g_slist_next (item))
-	{
-		CdnNode *parent;
-
-		parent = state_root_for_edge_action (item->data);
-		add_to_state_hash (state, item->data, parent);
-	}
+	plan = g_hash_table_lookup (np->plans, phase);
 
-	for (item = state->priv->discrete_edge_actions; item; item = g_slist_next (item))
+	if (!plan)
 	{
-		CdnNode *parent;
-
-		parent = state_root_for_edge_action (item->data);
-		add_to_state_hash (state, item->data, parent);
+		plan = phase_plan_new (np, phase);
+		g_hash_table_insert (np->plans, plan->phase, plan);
 	}
 
-	for (item = state->priv->events; item; item = g_slist_next (item))
-	{
-		CdnNode *parent;
-
-		parent = CDN_NODE (cdn_object_get_parent (item->data));
-		add_to_state_hash (state, item->data, parent);
-	}
+	return plan;
 }
 
 static void
-sort_events (CdnIntegratorState *state)
+relink_phase_lists (CdnIntegratorState *state)
 {
-	state->priv->events =
-		g_slist_reverse (state->priv->events);
+	gint i;
 
-	state->priv->events =
-		g_slist_sort (state->priv->events, (GCompareFunc)compare_events);
-}
+	for (i = 0; i < NUM_PHASE_LISTS; ++i)
+	{
+		GSList *head = NULL;
+		GSList *tail = NULL;
+		GSList *item;
 
-/**
- * cdn_integrator_state_update:
- * @state: A #CdnIntegratorState
+		for (item = state->priv->phase_nodes; item; item = g_slist_next (item))
+		{
+			PhasePlan *plan = ((NodePhases *)item->data)->current;
+
+			if (!plan->lists[i])
+			{
+				continue;
+			}
+
+			if (tail)
+			{
+				tail->next = plan->lists[i];
+			}
+			else
+			{
+				head = plan->lists[i];
+			}
+
+			tail = plan->tails[i];
+		}
+
+		if (tail)
+		{
+			tail->next = state->priv->base_lists[i];
+		}
+		else
+		{
+			head = state->priv->base_lists[i];
+		}
+
+		state->priv->phase_lists[i] = head;
+	}
+}
+
+static void
+add_direct_slot (CdnIntegratorState *state,
+                 CdnEdgeAction      *action,
+                 NodePhases         *np,
+                 guint               index)
+{
+	DirectInfo *info;
+	DirectSlot *slot;
+
+	info = g_hash_table_lookup (state->priv->direct_variables_hash,
+	                            cdn_edge_action_get_target_variable (action));
+
+	info->slots = g_renew (DirectSlot, info->slots, info->num_slots + 1);
+	slot = &info->slots[info->num_slots++];
+
+	slot->action = action;
+	slot->node = np;
+	slot->index = index;
+
+	if (np && !g_slist_find (np->direct_infos, info))
+	{
+		np->direct_infos = g_slist_prepend (np->direct_infos, info);
+	}
+}
+
+static gint
+compare_events (CdnEvent *a, CdnEvent *b)
+{
+	CdnNode *pa = cdn_object_get_parent (CDN_OBJECT (a));
+	CdnNode *pb = cdn_object_get_parent (CDN_OBJECT (b));
+
+	return (pa < pb ? -1 : (pa > pb ? 1 : 0));
+}
+
+static gint
+compare_node_phases (NodePhases const *a,
+                     NodePhases const *b)
+{
+	return (a->node < b->node ? -1 : (a->node > b->node ? 1 : 0));
+}
+
+static void
+add_to_state_hash (CdnIntegratorState *state,
+                   CdnPhaseable       *ph,
+                   CdnNode            *parent)
+{
+	GHashTable *states;
+	PhaseList lst;
+
+	states = cdn_phaseable_get_phase_table (ph);
+	lst = get_phase_list (ph);
+
+	if (states && g_hash_table_size (states) > 0)
+	{
+		NodePhases *np;
+
+		np = find_state_object (state, parent);
+
+		if (np)
+		{
+			if (lst == PHASE_LIST_DIRECT)
+			{
+				add_direct_slot (state,
+				                 CDN_EDGE_ACTION (ph),
+				                 np,
+				                 np->phaseables->len);
+			}
+
+			g_ptr_array_add (np->phaseables, g_object_ref (ph));
+		}
+	}
+	else
+	{
+		if (lst == PHASE_LIST_DIRECT)
+		{
+			add_direct_slot (state, CDN_EDGE_ACTION (ph), NULL, 0);
+		}
+
+		state->priv->base_lists[lst] =
+			g_slist_prepend (state->priv->base_lists[lst], ph);
+	}
+}
+
+static void
+add_phase (GHashTable  *phases,
+           gchar const *phase)
+{
+	if (phase)
+	{
+		g_hash_table_insert (phases, (gpointer)phase, (gpointer)phase);
+	}
+}
+
+/* Build the plans of all the phases @np can be in: the phases in which
+ * any of its phaseables are active, the phases its events go to, and its
+ * initial and current phase */
+static void
+build_phase_plans (CdnIntegratorState *state,
+                   NodePhases         *np)
+{
+	GHashTable *phases;
+	GHashTableIter iter;
+	gchar const *phase;
+	GSList *item;
+	gchar **names = NULL;
+	GSList *alloced = NULL;
+	gsize size = 0;
+	guint i;
+
+	phases = g_hash_table_new (g_str_hash, g_str_equal);
+
+	for (i = 0; i < np->phaseables->len; ++i)
+	{
+		gchar **ptr;
+
+		names = cdn_phaseable_get_phases (g_ptr_array_index (np->phaseables, i));
+		alloced = g_slist_prepend (alloced, names);
+
+		for (ptr = names; ptr && *ptr; ++ptr)
+		{
+			add_phase (phases, *ptr);
+		}
+	}
+
+	for (item = state->priv->events; item; item = g_slist_next (item))
+	{
+		if (cdn_object_get_parent (item->data) == np->node)
+		{
+			add_phase (phases, cdn_event_get_goto_state (item->data));
+		}
+	}
+
+	add_phase (phases, cdn_node_get_initial_state (np->node));
+	add_phase (phases, cdn_node_get_state (np->node));
+
+	g_hash_table_iter_init (&iter, phases);
+
+	while (g_hash_table_iter_next (&iter, (gpointer *)&phase, NULL))
+	{
+		size += phase_plan_size (np, node_phases_plan (np, phase));
+	}
+
+	np->current = node_phases_plan (np, cdn_node_get_state (np->node));
+
+	cdn_debug_message (DEBUG_INTEGRATOR,
+	                   "Phase plans for `%s': %u (%" G_GSIZE_FORMAT " bytes)",
+	                   cdn_object_get_id (CDN_OBJECT (np->node)),
+	                   g_hash_table_size (np->plans),
+	                   size);
+
+	g_slist_foreach (alloced, (GFunc)g_strfreev, NULL);
+	g_slist_free (alloced);
+
+	g_hash_table_destroy (phases);
+}
+
+static CdnNode *
+state_root_for_edge_action (CdnEdgeAction *action)
+{
+	CdnEdge *edge;
+	CdnNode *input;
+
+	edge = cdn_edge_action_get_edge (action);
+	input = cdn_edge_get_input (edge);
+
+	return input;
+}
+
+static void
+add_state_node (CdnIntegratorState *state,
+                CdnNode            *node)
+{
+	g_hash_table_insert (state->priv->state_hash,
+	                     g_object_ref (node),
+	                     node_phases_new (node));
+}
+
+static void
+extract_state_hash (CdnIntegratorState *state)
+{
+	GHashTableIter iter;
+	NodePhases *np;
+	GSList *item;
+
+	g_hash_table_remove_all (state->priv->state_hash);
+
+	// Collect all the events on states
+	for (item = state->priv->events; item; item = g_slist_next (item))
+	{
+		CdnEvent *ev = item->data;
+		gchar const *st;
+		GHashTable *states;
+		CdnNode *parent;
+
+		parent = cdn_object_get_parent (CDN_OBJECT (ev));
+
+		if (g_hash_table_lookup (state->priv->state_hash, parent))
+		{
+			continue;
+		}
+
+		st = cdn_event_get_goto_state (ev);
+		states = cdn_phaseable_get_phase_table (CDN_PHASEABLE (ev));
+
+		if (st != NULL || (states && g_hash_table_size (states) > 0))
+		{
+			add_state_node (state, parent);
+		}
+	}
+
+	// Also collect all nodes with have an initial state
+	for (item = state->priv->nodes; item; item = g_slist_next (item))
+	{
+		CdnNode *node = item->data;
+
+		if (cdn_node_get_initial_state (node) != NULL &&
+		    !g_hash_table_lookup (state->priv->state_hash, node))
+		{
+			add_state_node (state, node);
+		}
+	}
+
+	// Now, collect phaseables
+	for (item = state->priv->integrated_edge_actions; item; item = g_slist_next (item))
+	{
+		CdnNode *parent;
+
+		parent = state_root_for_edge_action (item->data);
+		add_to_state_hash (state, item->data, parent);
+	}
+
+	for (item = state->priv->direct_edge_actions; item; item = g_slist_next (item))
+	{
+		CdnNode *parent;
+
+		parent = state_root_for_edge_action (item->data);
+		add_to_state_hash (state, item->data, parent);
+	}
+
+	for (item = state->priv->discrete_edge_actions; item; item = g_slist_next (item))
+	{
+		CdnNode *parent;
+
+		parent = state_root_for_edge_action (item->data);
+		add_to_state_hash (state, item->data, parent);
+	}
+
+	for (item = state->priv->events; item; item = g_slist_next (item))
+	{
+		CdnNode *parent;
+
+		parent = CDN_NODE (cdn_object_get_parent (item->data));
+		add_to_state_hash (state, item->data, parent);
+	}
+
+	// Precompile the plans of the phases of every node, ordered on the
+	// node such that the active events are grouped by node
+	g_hash_table_iter_init (&iter, state->priv->state_hash);
+
+	while (g_hash_table_iter_next (&iter, NULL, (gpointer *)&np))
+	{
+		build_phase_plans (state, np);
+
+		state->priv->phase_nodes =
+			g_slist_insert_sorted (state->priv->phase_nodes,
+			                       np,
+			                       (GCompareFunc)compare_node_phases);
+	}
+
+	relink_phase_lists (state);
+}
+
+static void
+sort_events (CdnIntegratorState *state)
+{
+	state->priv->events =
+		g_slist_reverse (state->priv->events);
+
+	state->priv->events =
+		g_slist_sort (state->priv->events, (GCompareFunc)compare_events);
+}
+
+static void
+program_visit (GHashTable     *visited,
+               GHashTable     *direct,
+               CdnExpression  *expression,
+               GSList        **order)
+{
+	GSList const *dep;
+	DirectInfo *info;
+
+	// This also breaks cycles, which are left to the lazy evaluation
+	if (g_hash_table_lookup (visited, expression))
+	{
+		return;
+	}
+
+	g_hash_table_insert (visited, expression, expression);
+
+	for (dep = cdn_expression_get_dependencies (expression); dep; dep = g_slist_next (dep))
+	{
+		program_visit (visited, direct, dep->data, order);
+	}
+
+	// Direct variables get their value from their active edge actions
+	info = g_hash_table_lookup (direct, expression);
+
+	if (info)
+	{
+		guint i;
+
+		for (i = 0; i < info->num_slots; ++i)
+		{
+			if (direct_slot_active (&info->slots[i]))
+			{
+				program_visit (visited,
+				               direct,
+				               cdn_edge_action_get_equation (info->slots[i].action),
+				               order);
+			}
+		}
+	}
+
+	// Uncached expressions are evaluated in the context of their user
+	if (cdn_expression_get_has_cache (expression))
+	{
+		*order = g_slist_prepend (*order, expression);
+	}
+}
+
+static GHashTable *
+direct_expressions_new (CdnIntegratorState *state)
+{
+	GHashTable *direct;
+	GHashTableIter iter;
+	DirectInfo *info;
+
+	direct = g_hash_table_new (g_direct_hash, g_direct_equal);
+
+	g_hash_table_iter_init (&iter, state->priv->direct_variables_hash);
+
+	while (g_hash_table_iter_next (&iter, NULL, (gpointer *)&info))
+	{
+		g_hash_table_insert (direct,
+		                     cdn_variable_get_expression (info->variable),
+		                     info);
+	}
+
+	return direct;
+}
+
+static gboolean
+is_slow_edge_action (CdnIntegratorState *state,
+                     CdnEdgeAction      *action)
+{
+	return state->priv->slow_edge_actions_hash &&
+	       g_hash_table_lookup (state->priv->slow_edge_actions_hash, action);
+}
+
+static void
+build_program (CdnIntegratorState *state)
+{
+	GHashTable *visited;
+	GHashTable *direct;
+	GSList *order = NULL;
+	GSList *item;
+
+	clear_program (state);
+
+	visited = g_hash_table_new (g_direct_hash, g_direct_equal);
+	direct = direct_expressions_new (state);
+
+	for (item = state->priv->phase_lists[PHASE_LIST_INTEGRATED]; item; item = g_slist_next (item))
+	{
+		if (is_slow_edge_action (state, item->data))
+		{
+			continue;
+		}
+
+		program_visit (visited,
+		               direct,
+		               cdn_edge_action_get_equation (item->data),
+		               &order);
+	}
+
+	for (item = state->priv->phase_lists[PHASE_LIST_DIRECT]; item; item = g_slist_next (item))
+	{
+		CdnVariable *target;
+
+		target = cdn_edge_action_get_target_variable (item->data);
+
+		program_visit (visited,
+		               direct,
+		               cdn_variable_get_expression (target),
+		               &order);
+	}
+
+	order = g_slist_reverse (order);
+	state->priv->program = _cdn_expression_program_new (order);
+
+	g_slist_free (order);
+	g_hash_table_destroy (direct);
+	g_hash_table_destroy (visited);
+}
+
+typedef struct
+{
+	ParallelPlan *plan;
+	GSList *equations;
+} ParallelGroup;
+
+struct _ParallelPlan
+{
+	// Expressions used by more than one action. These are evaluated
+	// before the groups, which then only read their cached values
+	GSList *shared;
+
+	// Equations which can not be evaluated in parallel
+	GSList *serial;
+
+	ParallelGroup *groups;
+	guint num_groups;
+
+	GMutex mutex;
+	GCond cond;
+	guint pending;
+};
+
+typedef struct
+{
+	GHashTable *visited;
+	GSList *expressions;
+	CdnExpression *equation;
+	gboolean serial;
+} ParallelClosure;
+
+static void
+parallel_plan_free (ParallelPlan *plan)
+{
+	guint i;
+
+	if (!plan)
+	{
+		return;
+	}
+
+	for (i = 0; i < plan->num_groups; ++i)
+	{
+		g_slist_free (plan->groups[i].equations);
+	}
+
+	g_free (plan->groups);
+
+	g_slist_free (plan->shared);
+	g_slist_free (plan->serial);
+
+	g_mutex_clear (&plan->mutex);
+	g_cond_clear (&plan->cond);
+
+	g_slice_free (ParallelPlan, plan);
+}
+
+static gboolean
+has_shared_state (CdnExpression *expression)
+{
+	GSList const *item;
+
+	// User defined functions and operators keep state outside of the
+	// expression (function arguments, operator histories)
+	for (item = cdn_expression_get_instructions (expression); item; item = g_slist_next (item))
+	{
+		if (CDN_IS_INSTRUCTION_CUSTOM_FUNCTION (item->data) ||
+		    CDN_IS_INSTRUCTION_CUSTOM_FUNCTION_REF (item->data) ||
+		    CDN_IS_INSTRUCTION_CUSTOM_OPERATOR (item->data) ||
+		    CDN_IS_INSTRUCTION_CUSTOM_OPERATOR_REF (item->data))
+		{
+			return TRUE;
+		}
+	}
+
+	return FALSE;
+}
+
+static void
+parallel_visit (GHashTable      *direct,
+                CdnExpression   *expression,
+                ParallelClosure *closure)
+{
+	GSList const *dep;
+	DirectInfo *info;
+
+	if (g_hash_table_lookup (closure->visited, expression))
+	{
+		return;
+	}
+
+	g_hash_table_insert (closure->visited, expression, expression);
+
+	if (has_shared_state (expression))
+	{
+		closure->serial = TRUE;
+	}
+
+	for (dep = cdn_expression_get_dependencies (expression); dep; dep = g_slist_next (dep))
+	{
+		parallel_visit (direct, dep->data, closure);
+	}
+
+	info = g_hash_table_lookup (direct, expression);
+
+	if (info)
+	{
+		guint i;
+
+		for (i = 0; i < info->num_slots; ++i)
+		{
+			if (direct_slot_active (&info->slots[i]))
+			{
+				parallel_visit (direct,
+				                cdn_edge_action_get_equation (info->slots[i].action),
+				                closure);
+			}
+		}
+	}
+
+	closure->expressions = g_slist_prepend (closure->expressions, expression);
+}
+
+/* Whether evaluating @expression resets the cache of expressions outside of
+ * @closure, which other groups might be evaluating or resetting at the same
+ * time */
+static gboolean
+has_outside_dependents (ParallelClosure *closure,
+                        CdnExpression   *expression)
+{
+	GSList const *item;
+
+	for (item = cdn_expression_get_depends_on_me (expression); item; item = g_slist_next (item))
+	{
+		if (!g_hash_table_lookup (closure->visited, item->data))
+		{
+			return TRUE;
+		}
+	}
+
+	return FALSE;
+}
+
+static ParallelPlan *
+parallel_plan_new (CdnIntegratorState *state,
+                   GSList const       *actions,
+                   guint               num_threads)
+{
+	ParallelPlan *plan;
+	GHashTable *direct;
+	GHashTable *counts;
+	GHashTable *shared;
+	GSList *closures = NULL;
+	GSList *candidates = NULL;
+	GSList *item;
+	guint num_candidates = 0;
+	guint total = 0;
+	guint acc = 0;
+	guint g = 0;
+
+	plan = g_slice_new0 (ParallelPlan);
+
+	g_mutex_init (&plan->mutex);
+	g_cond_init (&plan->cond);
+
+	direct = direct_expressions_new (state);
+	counts = g_hash_table_new (g_direct_hash, g_direct_equal);
+	shared = g_hash_table_new (g_direct_hash, g_direct_equal);
+
+	// Collect all the expressions each action needs to evaluate
+	for (; actions; actions = g_slist_next (actions))
+	{
+		ParallelClosure *closure;
+
+		if (!cdn_edge_action_get_target_variable (actions->data) ||
+		    is_slow_edge_action (state, actions->data))
+		{
+			continue;
+		}
+
+		closure = g_slice_new0 (ParallelClosure);
+
+		closure->visited = g_hash_table_new (g_direct_hash, g_direct_equal);
+		closure->equation = cdn_edge_action_get_equation (actions->data);
+
+		parallel_visit (direct, closure->equation, closure);
+		closure->expressions = g_slist_reverse (closure->expressions);
+
+		for (item = closure->expressions; item; item = g_slist_next (item))
+		{
+			guint cnt;
+
+			cnt = GPOINTER_TO_UINT (g_hash_table_lookup (counts, item->data));
+			g_hash_table_insert (counts, item->data, GUINT_TO_POINTER (cnt + 1));
+		}
+
+		closures = g_slist_prepend (closures, closure);
+	}
+
+	closures = g_slist_reverse (closures);
+
+	// Expressions used by more than one action are shared. So are direct
+	// variables, since evaluating them sets their value, which resets the
+	// cache of the expressions depending on them. For the same reason,
+	// expressions with dependents outside of the action are shared, so
+	// that groups only ever reset caches within their own actions.
+	for (item = closures; item; item = g_slist_next (item))
+	{
+		ParallelClosure *closure = item->data;
+		GSList *expr;
+
+		for (expr = closure->expressions; expr; expr = g_slist_next (expr))
+		{
+			if (GPOINTER_TO_UINT (g_hash_table_lookup (counts, expr->data)) < 2 &&
+			    !g_hash_table_lookup (direct, expr->data) &&
+			    !has_outside_dependents (closure, expr->data))
+			{
+				continue;
+			}
+
+			// An uncached expression would be evaluated again by
+			// every user
+			if (!cdn_expression_get_has_cache (expr->data))
+			{
+				closure->serial = TRUE;
+				continue;
+			}
+
+			if (!g_hash_table_lookup (shared, expr->data))
+			{
+				g_hash_table_insert (shared, expr->data, expr->data);
+				plan->shared = g_slist_prepend (plan->shared, expr->data);
+			}
+		}
+	}
+
+	plan->shared = g_slist_reverse (plan->shared);
+
+	for (item = closures; item; item = g_slist_next (item))
+	{
+		ParallelClosure *closure = item->data;
+
+		if (closure->serial)
+		{
+			plan->serial = g_slist_prepend (plan->serial,
+			                                closure->equation);
+		}
+		else
+		{
+			candidates = g_slist_prepend (candidates, closure);
+			++num_candidates;
+
+			total += g_slist_length (closure->expressions);
+		}
+	}
+
+	plan->serial = g_slist_reverse (plan->serial);
+	candidates = g_slist_reverse (candidates);
+
+	if (num_candidates > 1 && num_threads > 1)
+	{
+		// Split the independent actions in consecutive groups of
+		// roughly the same number of expressions. Using more groups
+		// than threads lets the pool balance uneven groups.
+		plan->num_groups = MIN (num_candidates, num_threads * 2);
+		plan->groups = g_new0 (ParallelGroup, plan->num_groups);
+
+		for (item = candidates; item; item = g_slist_next (item))
+		{
+			ParallelClosure *closure = item->data;
+
+			plan->groups[g].equations =
+				g_slist_prepend (plan->groups[g].equations,
+				                 closure->equation);
+
+			acc += g_slist_length (closure->expressions);
+
+			if (g + 1 < plan->num_groups &&
+			    acc * plan->num_groups >= total * (g + 1))
+			{
+				++g;
+			}
+		}
+
+		plan->num_groups = g + 1;
+
+		for (g = 0; g < plan->num_groups; ++g)
+		{
+			plan->groups[g].plan = plan;
+			plan->groups[g].equations =
+				g_slist_reverse (plan->groups[g].equations);
+		}
+	}
+
+	for (item = closures; item; item = g_slist_next (item))
+	{
+		ParallelClosure *closure = item->data;
+
+		g_hash_table_destroy (closure->visited);
+		g_slist_free (closure->expressions);
+
+		g_slice_free (ParallelClosure, closure);
+	}
+
+	g_slist_free (closures);
+	g_slist_free (candidates);
+
+	g_hash_table_destroy (shared);
+	g_hash_table_destroy (counts);
+	g_hash_table_destroy (direct);
+
+	return plan;
+}
+
+static void
+evaluate_expressions (GSList const *expressions)
+{
+	while (expressions)
+	{
+		cdn_expression_evaluate_values (expressions->data);
+		expressions = g_slist_next (expressions);
+	}
+}
+
+static void
+parallel_worker (ParallelGroup *group,
+                 gpointer       userdata)
+{
+	ParallelPlan *plan = group->plan;
+
+	evaluate_expressions (group->equations);
+
+	g_mutex_lock (&plan->mutex);
+
+	if (--plan->pending == 0)
+	{
+		g_cond_signal (&plan->cond);
+	}
+
+	g_mutex_unlock (&plan->mutex);
+}
+
+static GThreadPool *
+parallel_pool (void)
+{
+	static gsize initialized = 0;
+	static GThreadPool *pool = NULL;
+
+	if (g_once_init_enter (&initialized))
+	{
+		guint num;
+
+		// The calling thread evaluates a group itself
+		num = g_get_num_processors ();
+
+		if (num > 1)
+		{
+			pool = g_thread_pool_new ((GFunc)parallel_worker,
+			                          NULL,
+			                          num - 1,
+			                          TRUE,
+			                          NULL);
+		}
+
+		g_once_init_leave (&initialized, 1);
+	}
+
+	return pool;
+}
+
+static void
+arena_visit (GHashTable     *members,
+             GHashTable     *visited,
+             CdnExpression  *expression,
+             GSList        **order)
+{
+	GSList const *dep;
+
+	if (g_hash_table_lookup (visited, expression))
+	{
+		return;
+	}
+
+	g_hash_table_insert (visited, expression, expression);
+
+	for (dep = cdn_expression_get_dependencies (expression); dep; dep = g_slist_next (dep))
+	{
+		arena_visit (members, visited, dep->data, order);
+	}
+
+	if (g_hash_table_lookup (members, expression))
+	{
+		*order = g_slist_prepend (*order, expression);
+	}
+}
+
+static void
+build_arena (CdnIntegratorState *state)
+{
+	GHashTable *members;
+	GHashTable *visited;
+	GSList *order = NULL;
+	GSList *item;
+	gdouble *ptr;
+
+	clear_arena (state);
+
+	members = g_hash_table_new (g_direct_hash, g_direct_equal);
+	visited = g_hash_table_new (g_direct_hash, g_direct_equal);
+
+	for (item = state->priv->expressions; item; item = g_slist_next (item))
+	{
+		g_hash_table_insert (members, item->data, item->data);
+	}
+
+	// Lay out the stacks in the order in which the expressions are
+	// evaluated, dependencies first
+	for (item = state->priv->expressions; item; item = g_slist_next (item))
+	{
+		arena_visit (members, visited, item->data, &order);
+	}
+
+	order = g_slist_reverse (order);
+
+	for (item = order; item; item = g_slist_next (item))
+	{
+		state->priv->arena_size += cdn_expression_get_stack_size (item->data);
+	}
+
+	if (state->priv->arena_size > 0)
+	{
+		state->priv->arena = g_new0 (gdouble, state->priv->arena_size);
+	}
+
+	ptr = state->priv->arena;
+
+	for (item = order; item; item = g_slist_next (item))
+	{
+		guint size;
+
+		size = cdn_expression_get_stack_size (item->data);
+
+		if (size == 0)
+		{
+			continue;
+		}
+
+		_cdn_expression_set_arena (item->data, ptr);
+		ptr += size;
+
+		state->priv->arena_expressions =
+			g_slist_prepend (state->priv->arena_expressions,
+			                 g_object_ref (item->data));
+	}
+
+	state->priv->arena_expressions =
+		g_slist_reverse (state->priv->arena_expressions);
+
+	g_slist_free (order);
+	g_hash_table_destroy (visited);
+	g_hash_table_destroy (members);
+}
+
+/**
+ * cdn_integrator_state_update:
+ * @state: A #CdnIntegratorState
+ *
+ * Update the integrator state. This recursively goes through all the objects
+ * contained in the associated #CdnIntegratorState:object and collects the
+ * links and variables that need to be integrated.
+ *
+ **/
+void
+cdn_integrator_state_update (CdnIntegratorState *state)
+{
+	g_return_if_fail (CDN_IS_INTEGRATOR_STATE (state));
+
+	clear_lists (state);
+
+	collect (state, CDN_OBJECT (state->priv->object));
+
+	state->priv->all_variables =
+		g_slist_reverse (state->priv->all_variables);
+
+	state->priv->integrated_variables =
+		g_slist_reverse (state->priv->integrated_variables);
+
+	state->priv->direct_variables =
+		g_slist_reverse (state->priv->direct_variables);
+
+	state->priv->discrete_variables =
+		g_slist_reverse (state->priv->discrete_variables);
+
+	state->priv->io =
+		g_slist_reverse (state->priv->io);
+
+	sort_events (state);
+
+	/* order the direct link actions based on their dependencies */
+	sort_edge_actions (state);
+
+	extract_state_hash (state);
+
+	if (state->priv->fused)
+	{
+		build_program (state);
+	}
+
+	cdn_object_foreach_expression (CDN_OBJECT (state->priv->object),
+	                               (CdnForeachExpressionFunc)collect_expressions,
+	                               state);
+
+	state->priv->expressions =
+		g_slist_reverse (state->priv->expressions);
+
+	state->priv->rand_expressions =
+		g_slist_reverse (state->priv->rand_expressions);
+
+	state->priv->rand_instructions =
+		g_slist_reverse (state->priv->rand_instructions);
+
+	state->priv->operators =
+		g_slist_reverse (state->priv->operators);
+
+	if (state->priv->use_arena)
+	{
+		build_arena (state);
+	}
+
+	g_signal_emit (state, signals[UPDATED], 0);
+}
+
+/**
+ * cdn_integrator_state_integrated_variables:
+ * @state: A #CdnIntegratorState
+ *
+ * Get the integrated variables which are acted upon by links.
+ *
+ * Returns: (element-type CdnVariable) (transfer none): A #GSList of #CdnVariable
+ *
+ **/
+const GSList *
+cdn_integrator_state_integrated_variables (CdnIntegratorState *state)
+{
+	/* Omit check for speed up */
+	return state->priv->integrated_variables;
+}
+
+static void
+ensure_layout (CdnIntegratorState *state)
+{
+	GSList const *item;
+	gdouble *storage;
+	guint i = 0;
+
+	if (state->priv->layout || !state->priv->integrated_variables)
+	{
+		return;
+	}
+
+	state->priv->layout_length = g_slist_length (state->priv->integrated_variables);
+	state->priv->layout = g_new0 (IntegratedSlice, state->priv->layout_length);
+
+	for (item = state->priv->integrated_variables; item; item = g_slist_next (item))
+	{
+		IntegratedSlice *slice = &state->priv->layout[i++];
+
+		slice->variable = item->data;
+		slice->expression = g_object_ref (cdn_variable_get_expression (item->data));
+		slice->constrained = cdn_variable_get_constraint (item->data) != NULL;
+
+		cdn_expression_get_dimension (slice->expression, &slice->dimension);
+
+		slice->size = cdn_dimension_size (&slice->dimension);
+		state->priv->integrated_size += slice->size;
+	}
+
+	state->priv->integrated = g_new0 (gdouble, state->priv->integrated_size);
+	storage = state->priv->integrated;
+
+	for (i = 0; i < state->priv->layout_length; ++i)
+	{
+		state->priv->layout[i].storage = storage;
+		storage += state->priv->layout[i].size;
+	}
+}
+
+/* Make sure that the value of the variable of @slice is stored in the slice
+ * of the state vector, and return whether the slice holds the current value.
+ * The storage is attached once the variable has a value of the expected
+ * dimension, and falls off again if the dimension of the value changes.
+ */
+static inline gboolean
+slice_is_stored (IntegratedSlice *slice)
+{
+	CdnDimension dim;
+
+	if (slice->constrained || !cdn_expression_is_cached (slice->expression))
+	{
+		return FALSE;
+	}
+
+	if (_cdn_expression_get_storage (slice->expression) == slice->storage)
+	{
+		return TRUE;
+	}
+
+	if (!cdn_expression_get_dimension (slice->expression, &dim) ||
+	    !cdn_dimension_equal (&dim, &slice->dimension))
+	{
+		return FALSE;
+	}
+
+	_cdn_expression_set_storage (slice->expression, slice->storage);
+	return TRUE;
+}
+
+/**
+ * cdn_integrator_state_integrated_size:
+ * @state: A #CdnIntegratorState
+ *
+ * Get the size of the state vector of the integrated variables. Every
+ * integrated variable occupies a slice of the state vector, in the order of
+ * #cdn_integrator_state_integrated_variables.
+ *
+ * Returns: the number of values in the state vector
+ *
+ **/
+guint
+cdn_integrator_state_integrated_size (CdnIntegratorState *state)
+{
+	g_return_val_if_fail (CDN_IS_INTEGRATOR_STATE (state), 0);
+
+	ensure_layout (state);
+	return state->priv->integrated_size;
+}
+
+/**
+ * cdn_integrator_state_get_integrated_storage:
+ * @state: A #CdnIntegratorState
+ *
+ * Get the state vector in which the values of the integrated variables are
+ * stored. The values can be computed in place, after which they have to be
+ * passed to #cdn_integrator_state_set_integrated_values to update anything
+ * that depends on them. Setting values from the storage itself does not
+ * copy any values.
+ *
+ * Returns: (transfer none): the state vector of
+ *          #cdn_integrator_state_integrated_size values
+ *
+ **/
+gdouble *
+cdn_integrator_state_get_integrated_storage (CdnIntegratorState *state)
+{
+	/* Omit check for speed up */
+	ensure_layout (state);
+	return state->priv->integrated;
+}
+
+/**
+ * cdn_integrator_state_get_integrated_values:
+ * @state: A #CdnIntegratorState
+ * @values: (out caller-allocates): the state vector
+ *
+ * Copy the values of all the integrated variables into the state vector
+ * @values, which must hold #cdn_integrator_state_integrated_size values.
+ *
+ **/
+void
+cdn_integrator_state_get_integrated_values (CdnIntegratorState *state,
+                                            gdouble            *values)
+{
+	guint i;
+
+	/* Omit check for speed up */
+	ensure_layout (state);
+
+	if (values != state->priv->integrated)
+	{
+		memcpy (values,
+		        state->priv->integrated,
+		        sizeof (gdouble) * state->priv->integrated_size);
+	}
+
+	/* Only values which are not (yet) in the storage need to be read
+	   separately, which normally happens only on the first step */
+	for (i = 0; i < state->priv->layout_length; ++i)
+	{
+		IntegratedSlice *slice = &state->priv->layout[i];
+
+		if (!slice_is_stored (slice))
+		{
+			memcpy (values + (slice->storage - state->priv->integrated),
+			        cdn_matrix_get (cdn_variable_get_values (slice->variable)),
+			        sizeof (gdouble) * slice->size);
+		}
+	}
+}
+
+/**
+ * cdn_integrator_state_set_integrated_values:
+ * @state: A #CdnIntegratorState
+ * @values: the state vector
+ *
+ * Set the values of all the integrated variables from the state vector
+ * @values, which must hold #cdn_integrator_state_integrated_size values.
+ *
+ **/
+void
+cdn_integrator_state_set_integrated_values (CdnIntegratorState *state,
+                                            gdouble const      *values)
+{
+	guint i;
+
+	/* Omit check for speed up */
+	ensure_layout (state);
+
+	for (i = 0; i < state->priv->layout_length; ++i)
+	{
+		IntegratedSlice *slice = &state->priv->layout[i];
+		CdnMatrix tmp;
+
+		tmp = cdn_matrix_init ((gdouble *)values, &slice->dimension);
+		cdn_variable_set_values (slice->variable, &tmp);
+
+		slice_is_stored (slice);
+		values += slice->size;
+	}
+}
+
+/**
+ * cdn_integrator_state_get_integrated_updates:
+ * @state: A #CdnIntegratorState
+ * @updates: (out caller-allocates): the derivative vector
+ *
+ * Copy the updates (i.e. the derivatives computed by the last evaluation)
+ * of all the integrated variables into @updates, using the same layout as
+ * #cdn_integrator_state_get_integrated_values.
+ *
+ **/
+void
+cdn_integrator_state_get_integrated_updates (CdnIntegratorState *state,
+                                             gdouble            *updates)
+{
+	guint i;
+
+	/* Omit check for speed up */
+	ensure_layout (state);
+
+	for (i = 0; i < state->priv->layout_length; ++i)
+	{
+		IntegratedSlice *slice = &state->priv->layout[i];
+
+		memcpy (updates,
+		        cdn_matrix_get (cdn_variable_get_update (slice->variable)),
+		        sizeof (gdouble) * slice->size);
+
+		updates += slice->size;
+	}
+}
+
+/**
+ * cdn_integrator_state_direct_variables:
+ * @state: A #CdnIntegratorState
+ *
+ * Get non-integrated variables which are acted upon by links.
+ *
+ * Returns: (element-type CdnVariable) (transfer none): A #GSList of #CdnVariable
+ *
+ **/
+const GSList *
+cdn_integrator_state_direct_variables (CdnIntegratorState *state)
+{
+	/* Omit check for speed up */
+	return state->priv->direct_variables;
+}
+
+/**
+ * cdn_integrator_state_discrete_variables:
+ * @state: A #CdnIntegratorState
+ *
+ * Get the discrete variables which are acted upon by links.
+ *
+ * Returns: (element-type CdnVariable) (transfer none): A #GSList of #CdnVariable
+ *
+ **/
+const GSList *
+cdn_integrator_state_discrete_variables (CdnIntegratorState *state)
+{
+	/* Omit check for speed up */
+	return state->priv->discrete_variables;
+}
+
+/**
+ * cdn_integrator_state_integrated_edge_actions:
+ * @state: A #CdnIntegratorState
+ *
+ * Get the link actions that act on integrated variables.
+ *
+ * Returns: (element-type CdnEdgeAction) (transfer none): A #GSList of #CdnEdgeAction
+ *
+ **/
+const GSList *
+cdn_integrator_state_integrated_edge_actions (CdnIntegratorState *state)
+{
+	g_return_val_if_fail (CDN_IS_INTEGRATOR_STATE (state), NULL);
+	return state->priv->integrated_edge_actions;
+}
+
+/**
+ * cdn_integrator_state_set_slow_edge_actions:
+ * @state: A #CdnIntegratorState
+ * @actions: (element-type CdnEdgeAction) (allow-none): A #GSList of #CdnEdgeAction
+ *
+ * Set the integrated edge actions which integrate at a lower rate than the
+ * rest of the state. These are not evaluated ahead by
+ * #cdn_integrator_state_evaluate_fused and
+ * #cdn_integrator_state_evaluate_parallel, since most steps do not need
+ * them. The list is cleared when the state is updated.
+ *
+ **/
+void
+cdn_integrator_state_set_slow_edge_actions (CdnIntegratorState *state,
+                                            GSList const       *actions)
+{
+	g_return_if_fail (CDN_IS_INTEGRATOR_STATE (state));
+
+	clear_slow_edge_actions (state);
+	clear_program (state);
+
+	if (!actions)
+	{
+		return;
+	}
+
+	state->priv->slow_edge_actions = g_slist_copy ((GSList *)actions);
+	state->priv->slow_edge_actions_hash = g_hash_table_new (g_direct_hash,
+	                                                        g_direct_equal);
+
+	for (; actions; actions = g_slist_next (actions))
+	{
+		g_hash_table_insert (state->priv->slow_edge_actions_hash,
+		                     actions->data,
+		                     actions->data);
+	}
+}
+
+/**
+ * cdn_integrator_state_slow_edge_actions:
+ * @state: A #CdnIntegratorState
+ *
+ * Get the integrated edge actions which integrate at a lower rate, see
+ * #cdn_integrator_state_set_slow_edge_actions.
+ *
+ * Returns: (element-type CdnEdgeAction) (transfer none): A #GSList of #CdnEdgeAction
+ *
+ **/
+const GSList *
+cdn_integrator_state_slow_edge_actions (CdnIntegratorState *state)
+{
+	/* Omit check for speed up */
+	return state->priv->slow_edge_actions;
+}
+
+/**
+ * cdn_integrator_state_phase_integrated_edge_actions:
+ * @state: A #CdnIntegratorState
+ *
+ * Get the integrated edge actions in the current phase.
+ *
+ * Returns: (element-type CdnEdgeAction) (transfer none): A #GSList
+ *
+ **/
+GSList const *
+cdn_integrator_state_phase_integrated_edge_actions (CdnIntegratorState *state)
+{
+	g_return_val_if_fail (CDN_IS_INTEGRATOR_STATE (state), NULL);
+	return state->priv->phase_lists[PHASE_LIST_INTEGRATED];
+}
+
+/**
+ * cdn_integrator_state_direct_edge_actions:
+ * @state: A #CdnIntegratorState
+ *
+ * Get the link actions that act on non-integrated variables.
+ *
+ * Returns: (element-type CdnEdgeAction) (transfer none): A #GSList of #CdnEdgeAction
+ *
+ **/
+const GSList *
+cdn_integrator_state_direct_edge_actions (CdnIntegratorState *state)
+{
+	g_return_val_if_fail (CDN_IS_INTEGRATOR_STATE (state), NULL);
+	return state->priv->direct_edge_actions;
+}
+
+/**
+ * cdn_integrator_state_phase_direct_edge_actions:
+ * @state: A #CdnIntegratorState
+ *
+ * Get the edge actions that act on non-integrated variables in the current
+ * phase.
+ *
+ * Returns: (element-type CdnEdgeAction) (transfer none): A #GSList
+ *
+ **/
+GSList const *
+cdn_integrator_state_phase_direct_edge_actions (CdnIntegratorState *state)
+{
+	g_return_val_if_fail (CDN_IS_INTEGRATOR_STATE (state), NULL);
+	return state->priv->phase_lists[PHASE_LIST_DIRECT];
+}
+
+/**
+ * cdn_integrator_state_discrete_edge_actions:
+ * @state: A #CdnIntegratorState
+ *
+ * Get the link actions that act on discrete variables.
+ *
+ * Returns: (element-type CdnEdgeAction) (transfer none): A #GSList of #CdnEdgeAction
+ *
+ **/
+const GSList *
+cdn_integrator_state_discrete_edge_actions (CdnIntegratorState *state)
+{
+	g_return_val_if_fail (CDN_IS_INTEGRATOR_STATE (state), NULL);
+	return state->priv->discrete_edge_actions;
+}
+
+/**
+ * cdn_integrator_state_phase_discrete_edge_actions:
+ * @state: A #CdnIntegratorState
+ *
+ * Get the discrete edge actions in the current phase.
+ *
+ * Returns: (element-type CdnEdgeAction) (transfer none): A #GSList
+ *
+ **/
+GSList const *
+cdn_integrator_state_phase_discrete_edge_actions (CdnIntegratorState *state)
+{
+	g_return_val_if_fail (CDN_IS_INTEGRATOR_STATE (state), NULL);
+	return state->priv->phase_lists[PHASE_LIST_DISCRETE];
+}
+
+/**
+ * cdn_integrator_state_all_variables:
+ * @state: A #CdnIntegratorState
+ *
+ * Get the link actions that act on non-integrated variables.
+ *
+ * Returns: (element-type CdnVariable) (transfer none): A #GSList of #CdnVariable
+ *
+ **/
+const GSList *
+cdn_integrator_state_all_variables (CdnIntegratorState *state)
+{
+	g_return_val_if_fail (CDN_IS_INTEGRATOR_STATE (state), NULL);
+	return state->priv->all_variables;
+}
+
+/**
+ * cdn_integrator_state_io:
+ * @state: A #CdnIntegratorState
+ *
+ * Get the io states.
+ *
+ * Returns: (element-type CdnIo) (transfer none): A #GSList of #CdnIo
+ *
+ **/
+const GSList *
+cdn_integrator_state_io (CdnIntegratorState *state)
+{
+	g_return_val_if_fail (CDN_IS_INTEGRATOR_STATE (state), NULL);
+
+	return state->priv->io;
+}
+
+/**
+ * cdn_integrator_state_expressions:
+ * @state: A #CdnIntegratorState
+ *
+ * Get the expressions in the network.
+ *
+ * Returns: (element-type CdnExpression) (transfer none): A #GSList of #CdnExpression
+ *
+ **/
+const GSList *
+cdn_integrator_state_expressions (CdnIntegratorState *state)
+{
+	return state->priv->expressions;
+}
+
+/**
+ * cdn_integrator_state_get_object:
+ * @state: A #CdnIntegratorState
+ *
+ * Get the object of the integrator state.
+ *
+ * Returns: (transfer none): A #CdnObject
+ *
+ **/
+CdnObject *
+cdn_integrator_state_get_object (CdnIntegratorState *state)
+{
+	/* Omit check to speed up */
+	return state->priv->object;
+}
+
+/**
+ * cdn_integrator_state_operators:
+ * @state: A #CdnIntegratorState
  *
- * Update the integrator state. This recursively goes through all the objects
- * contained in the associated #CdnIntegratorState:object and collects the
- * links and variables that need to be integrated.
+ * Get the list of operators.
+ *
+ * Returns: (element-type CdnOperator) (transfer none): A #GSList
  *
  **/
-void
-cdn_integrator_state_update (CdnIntegratorState *state)
+GSList const *
+cdn_integrator_state_operators (CdnIntegratorState *state)
 {
-	g_return_if_fail (CDN_IS_INTEGRATOR_STATE (state));
-
-	clear_lists (state);
-
-	collect (state, CDN_OBJECT (state->priv->object));
-
-	state->priv->all_variables =
-		g_slist_reverse (state->priv->all_variables);
-
-	state->priv->integrated_variables =
-		g_slist_reverse (state->priv->integrated_variables);
-
-	state->priv->direct_variables =
-		g_slist_reverse (state->priv->direct_variables);
-
-	state->priv->discrete_variables =
-		g_slist_reverse (state->priv->discrete_variables);
-
-	state->priv->io =
-		g_slist_reverse (state->priv->io);
-
-	sort_events (state);
-
-	/* order the direct link actions based on their dependencies */
-	sort_edge_actions (state);
-
-	extract_state_hash (state);
-
-	cdn_object_foreach_expression (CDN_OBJECT (state->priv->object),
-	                               (CdnForeachExpressionFunc)collect_expressions,
-	                               state);
-
-	state->priv->expressions =
-		g_slist_reverse (state->priv->expressions);
-
-	state->priv->rand_expressions =
-		g_slist_reverse (state->priv->rand_expressions);
+	/* Omit check to speed up */
+	return state->priv->operators;
+}
 
-	state->priv->rand_instructions =
-		g_slist_reverse (state->priv->rand_instructions);
+/**
+ * cdn_integrator_state_rand_instructions:
+ * @state: A #CdnIntegratorState
+ *
+ * Get the list of rand instructions.
+ *
+ * Returns: (element-type CdnInstructionRand) (transfer none): A #GSList
+ *
+ **/
+GSList const *
+cdn_integrator_state_rand_instructions (CdnIntegratorState *state)
+{
+	/* Omit check to speed up */
+	return state->priv->rand_instructions;
+}
 
-	state->priv->operators =
-		g_slist_reverse (state->priv->operators);
+/**
+ * cdn_integrator_state_rand_expressions:
+ * @state: A #CdnIntegratorState
+ *
+ * Get the list of rand expressions.
+ *
+ * Returns: (element-type CdnExpression) (transfer none): A #GSList
+ *
+ **/
+GSList const *
+cdn_integrator_state_rand_expressions (CdnIntegratorState *state)
+{
+	/* Omit check to speed up */
+	return state->priv->rand_expressions;
+}
 
-	g_signal_emit (state, signals[UPDATED], 0);
+/**
+ * cdn_integrator_state_functions:
+ * @state: A #CdnIntegratorState
+ *
+ * Get the list of functions.
+ *
+ * Returns: (element-type CdnFunction) (transfer none): A #GSList
+ *
+ **/
+GSList const *
+cdn_integrator_state_functions (CdnIntegratorState *state)
+{
+	/* Omit check to speed up */
+	return state->priv->functions;
 }
 
 /**
- * cdn_integrator_state_integrated_variables:
+ * cdn_integrator_state_events:
  * @state: A #CdnIntegratorState
  *
- * Get the integrated variables which are acted upon by links.
+ * Get the list of events.
  *
- * Returns: (element-type CdnVariable) (transfer none): A #GSList of #CdnVariable
+ * Returns: (element-type CdnEvent) (transfer none): A #GSList
  *
  **/
-const GSList *
-cdn_integrator_state_integrated_variables (CdnIntegratorState *state)
+GSList const *
+cdn_integrator_state_events (CdnIntegratorState *state)
 {
-	/* Omit check for speed up */
-	return state->priv->integrated_variables;
+	/* Omit check to speed up */
+	return state->priv->events;
 }
 
 /**
- * cdn_integrator_state_direct_variables:
+ * cdn_integrator_state_phase_events:
  * @state: A #CdnIntegratorState
  *
- * Get non-integrated variables which are acted upon by links.
+ * Get the list of events in the current phase.
  *
- * Returns: (element-type CdnVariable) (transfer none): A #GSList of #CdnVariable
+ * Returns: (element-type CdnEvent) (transfer none): A #GSList
  *
  **/
-const GSList *
-cdn_integrator_state_direct_variables (CdnIntegratorState *state)
+GSList const *
+cdn_integrator_state_phase_events (CdnIntegratorState *state)
 {
-	/* Omit check for speed up */
-	return state->priv->direct_variables;
+	/* Omit check to speed up */
+	return state->priv->phase_lists[PHASE_LIST_EVENTS];
 }
 
 /**
- * cdn_integrator_state_discrete_variables:
+ * cdn_integrator_state_phase_nodes:
  * @state: A #CdnIntegratorState
  *
- * Get the discrete variables which are acted upon by links.
+ * Get the nodes whose state (phase) can change during the simulation, i.e.
+ * the nodes for which #cdn_integrator_state_set_state can be used.
  *
- * Returns: (element-type CdnVariable) (transfer none): A #GSList of #CdnVariable
+ * Returns: (element-type CdnNode) (transfer container): A #GSList
  *
  **/
-const GSList *
-cdn_integrator_state_discrete_variables (CdnIntegratorState *state)
+GSList *
+cdn_integrator_state_phase_nodes (CdnIntegratorState *state)
 {
-	/* Omit check for speed up */
-	return state->priv->discrete_variables;
+	GHashTableIter iter;
+	CdnNode *node;
+	GSList *ret = NULL;
+
+	g_return_val_if_fail (CDN_IS_INTEGRATOR_STATE (state), NULL);
+
+	g_hash_table_iter_init (&iter, state->priv->state_hash);
+
+	while (g_hash_table_iter_next (&iter, (gpointer *)&node, NULL))
+	{
+		ret = g_slist_prepend (ret, node);
+	}
+
+	return ret;
 }
 
 /**
- * cdn_integrator_state_integrated_edge_actions:
+ * cdn_integrator_state_phase_plans:
  * @state: A #CdnIntegratorState
+ * @node: A #CdnNode
  *
- * Get the link actions that act on integrated variables.
+ * Get the phases of @node for which an execution plan has been compiled.
+ * Plans are compiled for all the phases @node can reach when the state is
+ * updated, such that changing the phase of @node only selects a different
+ * plan.
  *
- * Returns: (element-type CdnEdgeAction) (transfer none): A #GSList of #CdnEdgeAction
+ * Returns: (element-type utf8) (transfer container): A #GSList
  *
  **/
-const GSList *
-cdn_integrator_state_integrated_edge_actions (CdnIntegratorState *state)
+GSList *
+cdn_integrator_state_phase_plans (CdnIntegratorState *state,
+                                  CdnNode            *node)
 {
+	GHashTableIter iter;
+	NodePhases *np;
+	gchar const *phase;
+	GSList *ret = NULL;
+
 	g_return_val_if_fail (CDN_IS_INTEGRATOR_STATE (state), NULL);
-	return state->priv->integrated_edge_actions;
+	g_return_val_if_fail (CDN_IS_NODE (node), NULL);
+
+	np = g_hash_table_lookup (state->priv->state_hash, node);
+
+	if (!np)
+	{
+		return NULL;
+	}
+
+	g_hash_table_iter_init (&iter, np->plans);
+
+	while (g_hash_table_iter_next (&iter, (gpointer *)&phase, NULL))
+	{
+		ret = g_slist_prepend (ret, (gpointer)phase);
+	}
+
+	return ret;
+}
+
+/**
+ * cdn_integrator_state_phase_plan_size:
+ * @state: A #CdnIntegratorState
+ * @node: A #CdnNode
+ * @phase: (allow-none): the phase
+ *
+ * Get the memory used by the execution plan of @node in @phase.
+ *
+ * Returns: the size of the plan in bytes, or 0 if there is no plan for
+ *          @phase
+ *
+ **/
+gsize
+cdn_integrator_state_phase_plan_size (CdnIntegratorState *state,
+                                      CdnNode            *node,
+                                      gchar const        *phase)
+{
+	NodePhases *np;
+	PhasePlan *plan;
+
+	g_return_val_if_fail (CDN_IS_INTEGRATOR_STATE (state), 0);
+	g_return_val_if_fail (CDN_IS_NODE (node), 0);
+
+	np = g_hash_table_lookup (state->priv->state_hash, node);
+
+	if (!np)
+	{
+		return 0;
+	}
+
+	plan = phase ? g_hash_table_lookup (np->plans, phase) : np->none;
+
+	return plan ? phase_plan_size (np, plan) : 0;
+}
+
+/**
+ * cdn_integrator_state_set_state:
+ * @state: A #CdnIntegratorState
+ * @node: A #CdnNode
+ * @st: the state
+ * @events_added: (element-type CdnEvent) (transfer container): return value for the events added by changing the state
+ * @events_removed: (element-type CdnEvent) (transfer container): return value for the events removed changing the state
+ *
+ * Change the active state of @node to @st.
+ *
+ */
+void
+cdn_integrator_state_set_state (CdnIntegratorState  *state,
+                                CdnNode             *node,
+                                gchar const         *st,
+                                GSList             **events_added,
+                                GSList             **events_removed)
+{
+	NodePhases *np;
+	PhasePlan *prev;
+	PhasePlan *plan;
+	gint i;
+
+	if (events_added)
+	{
+		*events_added = NULL;
+	}
+
+	if (events_removed)
+	{
+		*events_removed = NULL;
+	}
+
+	np = g_hash_table_lookup (state->priv->state_hash, node);
+
+	if (!np || !np->current)
+	{
+		cdn_node_set_state (node, st);
+		return;
+	}
+
+	// Switching the phase swaps in the precompiled plan of @st
+	prev = np->current;
+	plan = node_phases_plan (np, st);
+
+	if (prev == plan)
+	{
+		cdn_node_set_state (node, st);
+		return;
+	}
+
+	for (i = 0; i < (gint)np->phaseables->len; ++i)
+	{
+		CdnPhaseable *ph = g_ptr_array_index (np->phaseables, i);
+
+		if (!CDN_IS_EVENT (ph) || prev->active[i] == plan->active[i])
+		{
+			continue;
+		}
+
+		if (plan->active[i] && events_added)
+		{
+			*events_added = g_slist_prepend (*events_added, ph);
+		}
+		else if (prev->active[i] && events_removed)
+		{
+			*events_removed = g_slist_prepend (*events_removed, ph);
+		}
+	}
+
+	np->current = plan;
+	relink_phase_lists (state);
+
+	if (prev->lists[PHASE_LIST_DIRECT] || plan->lists[PHASE_LIST_DIRECT])
+	{
+		GSList *item;
+
+		for (item = np->direct_infos; item; item = g_slist_next (item))
+		{
+			DirectInfo *info = item->data;
+
+			cdn_expression_force_reset_cache (cdn_variable_get_expression (info->variable));
+		}
+	}
+
+	for (i = PHASE_LIST_INTEGRATED; i < NUM_PHASE_LISTS; ++i)
+	{
+		if (prev->lists[i] || plan->lists[i])
+		{
+			clear_program (state);
+			break;
+		}
+	}
+
+	if (events_added)
+	{
+		*events_added = g_slist_reverse (*events_added);
+	}
+
+	if (events_removed)
+	{
+		*events_removed = g_slist_reverse (*events_removed);
+	}
+
+	cdn_node_set_state (node, st);
 }
 
 /**
- * cdn_integrator_state_phase_integrated_edge_actions:
+ * cdn_integrator_state_set_fused:
  * @state: A #CdnIntegratorState
+ * @fused: whether to use fused evaluation
  *
- * Get the integrated edge actions in the current phase.
- *
- * Returns: (element-type CdnEdgeAction) (transfer none): A #GSList
+ * Set whether the integrated and direct edge actions are evaluated as a
+ * single program. When enabled, all the expressions needed to compute the
+ * active edge actions are sorted on their dependencies once, after the state
+ * is updated. They are then recomputed in that order by
+ * #cdn_integrator_state_evaluate_fused instead of being invalidated one
+ * by one whenever a variable changes. This trades some redundant
+ * computation for a per-step cost which no longer depends on the size of
+ * the dependency graph.
  *
  **/
-GSList const *
-cdn_integrator_state_phase_integrated_edge_actions (CdnIntegratorState *state)
+void
+cdn_integrator_state_set_fused (CdnIntegratorState *state,
+                                gboolean            fused)
 {
-	g_return_val_if_fail (CDN_IS_INTEGRATOR_STATE (state), NULL);
-	return state->priv->phase_integrated_edge_actions;
-}
+	g_return_if_fail (CDN_IS_INTEGRATOR_STATE (state));
 
-/**
- * cdn_integrator_state_direct_edge_actions:
- * @state: A #CdnIntegratorState
- *
- * Get the link actions that act on non-integrated variables.
- *
- * Returns: (element-type CdnEdgeAction) (transfer none): A #GSList of #CdnEdgeAction
- *
- **/
-const GSList *
-cdn_integrator_state_direct_edge_actions (CdnIntegratorState *state)
-{
-	g_return_val_if_fail (CDN_IS_INTEGRATOR_STATE (state), NULL);
-	return state->priv->direct_edge_actions;
+	if (state->priv->fused == fused)
+	{
+		return;
+	}
+
+	state->priv->fused = fused;
+	clear_program (state);
+
+	g_object_notify (G_OBJECT (state), "fused");
 }
 
 /**
- * cdn_integrator_state_phase_direct_edge_actions:
+ * cdn_integrator_state_get_fused:
  * @state: A #CdnIntegratorState
  *
- * Get the edge actions that act on non-integrated variables in the current
- * phase.
+ * Get whether the integrated and direct edge actions are evaluated as a
+ * single program.
  *
- * Returns: (element-type CdnEdgeAction) (transfer none): A #GSList
+ * Returns: %TRUE if fused evaluation is enabled, %FALSE otherwise
  *
  **/
-GSList const *
-cdn_integrator_state_phase_direct_edge_actions (CdnIntegratorState *state)
+gboolean
+cdn_integrator_state_get_fused (CdnIntegratorState *state)
 {
-	g_return_val_if_fail (CDN_IS_INTEGRATOR_STATE (state), NULL);
-	return state->priv->phase_direct_edge_actions;
+	g_return_val_if_fail (CDN_IS_INTEGRATOR_STATE (state), FALSE);
+
+	return state->priv->fused;
 }
 
 /**
- * cdn_integrator_state_discrete_edge_actions:
+ * cdn_integrator_state_evaluate_fused:
  * @state: A #CdnIntegratorState
  *
- * Get the link actions that act on discrete variables.
+ * Evaluate all the expressions needed for the active integrated and direct
+ * edge actions in a single pass. This does nothing unless fused evaluation
+ * is enabled (see #cdn_integrator_state_set_fused).
  *
- * Returns: (element-type CdnEdgeAction) (transfer none): A #GSList of #CdnEdgeAction
+ * Returns: %TRUE if the expressions were evaluated, %FALSE otherwise
  *
  **/
-const GSList *
-cdn_integrator_state_discrete_edge_actions (CdnIntegratorState *state)
+gboolean
+cdn_integrator_state_evaluate_fused (CdnIntegratorState *state)
 {
-	g_return_val_if_fail (CDN_IS_INTEGRATOR_STATE (state), NULL);
-	return state->priv->discrete_edge_actions;
+	/* Omit type check to increase speed */
+	if (!state->priv->fused)
+	{
+		return FALSE;
+	}
+
+	// Changing the active phase drops the program
+	if (!state->priv->program)
+	{
+		build_program (state);
+	}
+
+	_cdn_expression_program_evaluate (state->priv->program);
+	return TRUE;
 }
 
 /**
- * cdn_integrator_state_phase_discrete_edge_actions:
+ * cdn_integrator_state_set_arena:
  * @state: A #CdnIntegratorState
+ * @arena: whether to allocate the expressions from an arena
  *
- * Get the discrete edge actions in the current phase.
- *
- * Returns: (element-type CdnEdgeAction) (transfer none): A #GSList
+ * Set whether the evaluation stacks of all the expressions of the integrated
+ * object are allocated from a single block of memory. The stacks are laid
+ * out in evaluation order (dependencies first), which keeps the memory
+ * touched during a single step close together. Since the bottom of each
+ * stack contains the last computed value of its expression, the cached
+ * values of the whole object can be saved and restored in one go with
+ * #cdn_integrator_state_arena_snapshot and
+ * #cdn_integrator_state_arena_restore.
  *
  **/
-GSList const *
-cdn_integrator_state_phase_discrete_edge_actions (CdnIntegratorState *state)
+void
+cdn_integrator_state_set_arena (CdnIntegratorState *state,
+                                gboolean            arena)
 {
-	g_return_val_if_fail (CDN_IS_INTEGRATOR_STATE (state), NULL);
-	return state->priv->phase_discrete_edge_actions;
+	g_return_if_fail (CDN_IS_INTEGRATOR_STATE (state));
+
+	if (state->priv->use_arena == arena)
+	{
+		return;
+	}
+
+	state->priv->use_arena = arena;
+
+	if (arena && state->priv->object &&
+	    cdn_object_is_compiled (state->priv->object))
+	{
+		build_arena (state);
+	}
+	else
+	{
+		clear_arena (state);
+	}
+
+	g_object_notify (G_OBJECT (state), "arena");
 }
 
 /**
- * cdn_integrator_state_all_variables:
+ * cdn_integrator_state_get_arena:
  * @state: A #CdnIntegratorState
  *
- * Get the link actions that act on non-integrated variables.
+ * Get whether the evaluation stacks of the expressions are allocated from
+ * a single block of memory.
  *
- * Returns: (element-type CdnVariable) (transfer none): A #GSList of #CdnVariable
+ * Returns: %TRUE if the arena is used, %FALSE otherwise
  *
  **/
-const GSList *
-cdn_integrator_state_all_variables (CdnIntegratorState *state)
+gboolean
+cdn_integrator_state_get_arena (CdnIntegratorState *state)
 {
-	g_return_val_if_fail (CDN_IS_INTEGRATOR_STATE (state), NULL);
-	return state->priv->all_variables;
+	g_return_val_if_fail (CDN_IS_INTEGRATOR_STATE (state), FALSE);
+
+	return state->priv->use_arena;
 }
 
 /**
- * cdn_integrator_state_io:
+ * cdn_integrator_state_arena_snapshot:
  * @state: A #CdnIntegratorState
+ * @size: (out): return value for the number of values in the snapshot
  *
- * Get the io states.
+ * Make a copy of the arena, which contains the values of all the
+ * expressions. The snapshot can later be passed to
+ * #cdn_integrator_state_arena_restore. The snapshot is only valid as long
+ * as the state is not updated.
  *
- * Returns: (element-type CdnIo) (transfer none): A #GSList of #CdnIo
+ * Returns: (array length=size) (transfer full): a copy of the arena, or
+ *          %NULL if the arena is not used
  *
  **/
-const GSList *
-cdn_integrator_state_io (CdnIntegratorState *state)
+gdouble *
+cdn_integrator_state_arena_snapshot (CdnIntegratorState *state,
+                                     guint              *size)
 {
+	gdouble *ret;
+
 	g_return_val_if_fail (CDN_IS_INTEGRATOR_STATE (state), NULL);
 
-	return state->priv->io;
-}
+	if (size)
+	{
+		*size = state->priv->arena_size;
+	}
 
-/**
- * cdn_integrator_state_expressions:
- * @state: A #CdnIntegratorState
- *
- * Get the expressions in the network.
- *
- * Returns: (element-type CdnExpression) (transfer none): A #GSList of #CdnExpression
- *
- **/
-const GSList *
-cdn_integrator_state_expressions (CdnIntegratorState *state)
-{
-	return state->priv->expressions;
-}
+	if (!state->priv->arena)
+	{
+		return NULL;
+	}
 
-/**
- * cdn_integrator_state_get_object:
- * @state: A #CdnIntegratorState
- *
- * Get the object of the integrator state.
- *
- * Returns: (transfer none): A #CdnObject
- *
- **/
-CdnObject *
-cdn_integrator_state_get_object (CdnIntegratorState *state)
-{
-	/* Omit check to speed up */
-	return state->priv->object;
-}
+	ret = g_new (gdouble, state->priv->arena_size);
+	memcpy (ret, state->priv->arena, sizeof (gdouble) * state->priv->arena_size);
 
-/**
- * cdn_integrator_state_operators:
- * @state: A #CdnIntegratorState
- *
- * Get the list of operators.
- *
- * Returns: (element-type CdnOperator) (transfer none): A #GSList
- *
- **/
-GSList const *
-cdn_integrator_state_operators (CdnIntegratorState *state)
-{
-	/* Omit check to speed up */
-	return state->priv->operators;
+	return ret;
 }
 
 /**
- * cdn_integrator_state_rand_instructions:
+ * cdn_integrator_state_arena_restore:
  * @state: A #CdnIntegratorState
+ * @snapshot: (array length=size): a snapshot of the arena
+ * @size: the number of values in @snapshot
  *
- * Get the list of rand instructions.
+ * Restore the values of all the expressions from a snapshot obtained with
+ * #cdn_integrator_state_arena_snapshot. Whether an expression is considered
+ * to be cached is not changed.
  *
- * Returns: (element-type CdnInstructionRand) (transfer none): A #GSList
+ * Returns: %TRUE if the snapshot was restored, %FALSE otherwise
  *
  **/
-GSList const *
-cdn_integrator_state_rand_instructions (CdnIntegratorState *state)
+gboolean
+cdn_integrator_state_arena_restore (CdnIntegratorState *state,
+                                    gdouble const      *snapshot,
+                                    guint               size)
 {
-	/* Omit check to speed up */
-	return state->priv->rand_instructions;
-}
+	GSList *item;
 
-/**
- * cdn_integrator_state_rand_expressions:
- * @state: A #CdnIntegratorState
- *
- * Get the list of rand expressions.
- *
- * Returns: (element-type CdnExpression) (transfer none): A #GSList
- *
- **/
-GSList const *
-cdn_integrator_state_rand_expressions (CdnIntegratorState *state)
-{
-	/* Omit check to speed up */
-	return state->priv->rand_expressions;
+	g_return_val_if_fail (CDN_IS_INTEGRATOR_STATE (state), FALSE);
+	g_return_val_if_fail (snapshot != NULL || size == 0, FALSE);
+
+	if (!state->priv->arena || size != state->priv->arena_size)
+	{
+		return FALSE;
+	}
+
+	memcpy (state->priv->arena, snapshot, sizeof (gdouble) * size);
+
+	for (item = state->priv->arena_expressions; item; item = g_slist_next (item))
+	{
+		_cdn_expression_load_arena (item->data);
+	}
+
+	return TRUE;
 }
 
 /**
- * cdn_integrator_state_functions:
+ * cdn_integrator_state_set_parallel:
  * @state: A #CdnIntegratorState
+ * @parallel: whether to evaluate edge actions in parallel
  *
- * Get the list of functions.
+ * Set whether independent integrated edge actions are evaluated in
+ * parallel. When enabled, the active integrated edge actions are split in
+ * groups which do not share any expressions. Expressions used by more than
+ * one action are evaluated first, after which the groups are evaluated on
+ * a thread pool by #cdn_integrator_state_evaluate_parallel. The results
+ * are still summed into the variables in the original order, so that the
+ * outcome does not depend on the number of threads.
  *
- * Returns: (element-type CdnFunction) (transfer none): A #GSList
+ * Actions using user defined functions or operators are always evaluated
+ * serially.
  *
  **/
-GSList const *
-cdn_integrator_state_functions (CdnIntegratorState *state)
+void
+cdn_integrator_state_set_parallel (CdnIntegratorState *state,
+                                   gboolean            parallel)
 {
-	/* Omit check to speed up */
-	return state->priv->functions;
+	g_return_if_fail (CDN_IS_INTEGRATOR_STATE (state));
+
+	if (state->priv->parallel == parallel)
+	{
+		return;
+	}
+
+	state->priv->parallel = parallel;
+	clear_program (state);
+
+	g_object_notify (G_OBJECT (state), "parallel");
 }
 
 /**
- * cdn_integrator_state_events:
+ * cdn_integrator_state_get_parallel:
  * @state: A #CdnIntegratorState
  *
- * Get the list of events.
+ * Get whether independent integrated edge actions are evaluated in
+ * parallel.
  *
- * Returns: (element-type CdnEvent) (transfer none): A #GSList
+ * Returns: %TRUE if edge actions are evaluated in parallel, %FALSE otherwise
  *
  **/
-GSList const *
-cdn_integrator_state_events (CdnIntegratorState *state)
+gboolean
+cdn_integrator_state_get_parallel (CdnIntegratorState *state)
 {
-	/* Omit check to speed up */
-	return state->priv->events;
+	g_return_val_if_fail (CDN_IS_INTEGRATOR_STATE (state), FALSE);
+
+	return state->priv->parallel;
 }
 
 /**
- * cdn_integrator_state_phase_events:
+ * cdn_integrator_state_evaluate_parallel:
  * @state: A #CdnIntegratorState
  *
- * Get the list of events in the current phase.
+ * Evaluate the equations of the active integrated edge actions in parallel.
+ * This does nothing unless parallel evaluation is enabled (see
+ * #cdn_integrator_state_set_parallel). Fused evaluation, profiling and
+ * math debugging also disable parallel evaluation.
  *
- * Returns: (element-type CdnEvent) (transfer none): A #GSList
+ * Returns: %TRUE if the equations were evaluated, %FALSE otherwise
  *
  **/
-GSList const *
-cdn_integrator_state_phase_events (CdnIntegratorState *state)
-{
-	/* Omit check to speed up */
-	return state->priv->phase_events;
-}
-
-/**
- * cdn_integrator_state_set_state:
- * @state: A #CdnIntegratorState
- * @node: A #CdnNode
- * @st: the state
- * @events_added: (element-type CdnEvent) (transfer container): return value for the events added by changing the state
- * @events_removed: (element-type CdnEvent) (transfer container): return value for the events removed changing the state
- *
- * Change the active state of @node to @st.
- *
- */
-void
-cdn_integrator_state_set_state (CdnIntegratorState  *state,
-                                CdnNode             *node,
-                                gchar const         *st,
-                                GSList             **events_added,
-                                GSList             **events_removed)
+gboolean
+cdn_integrator_state_evaluate_parallel (CdnIntegratorState *state)
 {
-	gchar const *curst;
-	GSList *lst;
-	GSList *item;
-
-	// Set the state of @node to st. Update all the phaseables that
-	// depend on this state
-	curst = cdn_node_get_state (node);
-	lst = g_hash_table_lookup (state->priv->state_hash, node);
+	ParallelPlan *plan;
+	GThreadPool *pool;
+	guint i;
 
-	if (events_added)
+	/* Omit type check to increase speed */
+	if (!state->priv->parallel || state->priv->fused)
 	{
-		*events_added = NULL;
+		return FALSE;
 	}
 
-	if (events_removed)
+	if (cdn_profile_get_enabled () || cdn_debug_is_enabled (CDN_DEBUG_MATH))
 	{
-		*events_removed = NULL;
+		return FALSE;
 	}
 
-	// Note: first item is always NULL
-	for (item = lst->next; item; item = g_slist_next (item))
-	{
-		CdnPhaseable *ph = item->data;
-		gboolean activenow;
-		gboolean activelater;
-
-		activenow = phase_is_active (ph, curst);
-		activelater = phase_is_active (ph, st);
-
-		// See if ph is active now, but not later
-		if (activenow && !activelater)
-		{
-			GSList **ptr;
-
-			// Remove from list
-			ptr = get_state_list (state, ph);
-
-			if (ptr == &state->priv->phase_direct_edge_actions)
-			{
-				update_direct_phase (state, item->data, FALSE);
-			}
+	pool = parallel_pool ();
 
-			*ptr = g_slist_remove (*ptr, ph);
+	if (!pool)
+	{
+		return FALSE;
+	}
 
-			if (events_removed && CDN_IS_EVENT (item->data))
-			{
-				*events_removed = g_slist_prepend (*events_removed,
-				                                   item->data);
-			}
-		}
-		else if (!activenow && activelater)
-		{
-			GSList **ptr;
+	// Changing the active phase drops the plan
+	if (!state->priv->parallel_plan)
+	{
+		state->priv->parallel_plan =
+			parallel_plan_new (state,
+			                   state->priv->phase_lists[PHASE_LIST_INTEGRATED],
+			                   g_thread_pool_get_max_threads (pool) + 1);
+	}
 
-			// Add to list
-			ptr = get_state_list (state, ph);
+	plan = state->priv->parallel_plan;
 
-			if (ptr == &state->priv->phase_direct_edge_actions)
-			{
-				update_direct_phase (state, item->data, TRUE);
-			}
+	if (plan->num_groups == 0)
+	{
+		return FALSE;
+	}
 
-			if (ptr == &state->priv->phase_events)
-			{
-				*ptr = g_slist_insert_sorted (*ptr,
-				                              ph,
-				                              (GCompareFunc)compare_events);
-			}
-			else
-			{
-				*ptr = g_slist_prepend (*ptr, ph);
-			}
+	evaluate_expressions (plan->shared);
+	evaluate_expressions (plan->serial);
 
-			if (events_added && CDN_IS_EVENT (item->data))
-			{
-				*events_added = g_slist_prepend (*events_added,
-				                                 item->data);
-			}
-		}
-	}
+	plan->pending = plan->num_groups - 1;
 
-	if (events_added)
+	for (i = 1; i < plan->num_groups; ++i)
 	{
-		*events_added = g_slist_reverse (*events_added);
+		g_thread_pool_push (pool, &plan->groups[i], NULL);
 	}
 
-	if (events_removed)
+	evaluate_expressions (plan->groups[0].equations);
+
+	g_mutex_lock (&plan->mutex);
+
+	while (plan->pending > 0)
 	{
-		*events_removed = g_slist_reverse (*events_removed);
+		g_cond_wait (&plan->cond, &plan->mutex);
 	}
 
-	cdn_node_set_state (node, st);
+	g_mutex_unlock (&plan->mutex);
+	return TRUE;
 }
@@ -80,6 +80,19 @@ const GSList       *cdn_integrator_state_phase_integrated_edge_actions (CdnInteg
 const GSList       *cdn_integrator_state_phase_direct_edge_actions     (CdnIntegratorState *state);
 const GSList       *cdn_integrator_state_phase_discrete_edge_actions   (CdnIntegratorState *state);
 
+void                cdn_integrator_state_set_slow_edge_actions   (CdnIntegratorState *state,
+                                                                  GSList const       *actions);
+const GSList       *cdn_integrator_state_slow_edge_actions       (CdnIntegratorState *state);
+
+guint               cdn_integrator_state_integrated_size         (CdnIntegratorState *state);
+gdouble            *cdn_integrator_state_get_integrated_storage  (CdnIntegratorState *state);
+void                cdn_integrator_state_get_integrated_values   (CdnIntegratorState *state,
+                                                                  gdouble            *values);
+void                cdn_integrator_state_set_integrated_values   (CdnIntegratorState *state,
+                                                                  gdouble const      *values);
+void                cdn_integrator_state_get_integrated_updates  (CdnIntegratorState *state,
+                                                                  gdouble            *updates);
+
 const GSList       *cdn_integrator_state_io                      (CdnIntegratorState *state);
 
 const GSList       *cdn_integrator_state_events                  (CdnIntegratorState *state);
@@ -94,6 +107,35 @@ const GSList       *cdn_integrator_state_operators               (CdnIntegratorS
 
 void                cdn_integrator_state_update                  (CdnIntegratorState *state);
 
+void                cdn_integrator_state_set_fused               (CdnIntegratorState *state,
+                                                                  gboolean            fused);
+gboolean            cdn_integrator_state_get_fused               (CdnIntegratorState *state);
+
+gboolean            cdn_integrator_state_evaluate_fused          (CdnIntegratorState *state);
+
+void                cdn_integrator_state_set_arena               (CdnIntegratorState *state,
+                                                                  gboolean            arena);
+gboolean            cdn_integrator_state_get_arena               (CdnIntegratorState *state);
+
+gdouble            *cdn_integrator_state_arena_snapshot          (CdnIntegratorState *state,
+                                                                  guint              *size);
+gboolean            cdn_integrator_state_arena_restore           (CdnIntegratorState *state,
+                                                                  gdouble const      *snapshot,
+                                                                  guint               size);
+
+void                cdn_integrator_state_set_parallel            (CdnIntegratorState *state,
+                                                                  gboolean            parallel);
+gboolean            cdn_integrator_state_get_parallel            (CdnIntegratorState *state);
+
+gboolean            cdn_integrator_state_evaluate_parallel       (CdnIntegratorState *state);
+
+GSList             *cdn_integrator_state_phase_nodes             (CdnIntegratorState  *state);
+GSList             *cdn_integrator_state_phase_plans             (CdnIntegratorState  *state,
+                                                                  CdnNode             *node);
+gsize               cdn_integrator_state_phase_plan_size         (CdnIntegratorState  *state,
+                                                                  CdnNode             *node,
+                                                                  gchar const         *phase);
+
 void                cdn_integrator_state_set_state               (CdnIntegratorState  *state,
                                                                   CdnNode             *node,
                                                                   gchar const         *st,
@@ -0,0 +1,247 @@
+/*
+ * cdn-integrator-yoshida.c
+ * This file is part of codyn
+ *
+ * Copyright (C) 2011 - Jesse van den Kieboom
+ *
+ * codyn is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * codyn is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with codyn; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor,
+ * Boston, MA  02110-1301  USA
+ */
+
+#include "cdn-integrator-yoshida.h"
+#include "cdn-network.h"
+
+#define CDN_INTEGRATOR_YOSHIDA_GET_PRIVATE(object)(G_TYPE_INSTANCE_GET_PRIVATE((object), CDN_TYPE_INTEGRATOR_YOSHIDA, CdnIntegratorYoshidaPrivate))
+
+#define MIN_ORDER 4
+#define MAX_ORDER 6
+#define DEFAULT_ORDER 4
+
+/* Step fractions of the composed leap frog steps. The fourth order scheme
+ * is the triple jump, the sixth order scheme is solution A of Yoshida
+ * (1990). */
+static const gdouble weights4[] = {
+	1.3512071919596578,
+	-1.7024143839193153,
+	1.3512071919596578
+};
+
+static const gdouble weights6[] = {
+	0.784513610477560,
+	0.235573213359357,
+	-1.17767998417887,
+	1.31518632068390630,
+	-1.17767998417887,
+	0.235573213359357,
+	0.784513610477560
+};
+
+struct _CdnIntegratorYoshidaPrivate
+{
+	guint order;
+};
+
+/* Properties */
+enum
+{
+	PROP_0,
+	PROP_ORDER
+};
+
+G_DEFINE_TYPE (CdnIntegratorYoshida, cdn_integrator_yoshida, CDN_TYPE_INTEGRATOR_LEAP_FROG)
+
+static gchar const *
+cdn_integrator_yoshida_get_name_impl (CdnIntegrator *integrator)
+{
+	return "Yoshida";
+}
+
+static gdouble
+cdn_integrator_yoshida_step_impl (CdnIntegrator *integrator,
+                                  gdouble        t,
+                                  gdouble        timestep)
+{
+	CdnIntegratorYoshida *self;
+	CdnIntegratorLeapFrog *lf;
+	CdnIntegratorClass *cls;
+	gdouble const *weights;
+	guint num;
+	gdouble drift;
+	gdouble tx;
+	guint i;
+
+	if (!cdn_integrator_step_prepare (integrator, t, timestep))
+	{
+		return 0;
+	}
+
+	self = CDN_INTEGRATOR_YOSHIDA (integrator);
+	lf = CDN_INTEGRATOR_LEAP_FROG (integrator);
+
+	if (self->priv->order == 6)
+	{
+		weights = weights6;
+		num = G_N_ELEMENTS (weights6);
+	}
+	else
+	{
+		weights = weights4;
+		num = G_N_ELEMENTS (weights4);
+	}
+
+	/* Consecutive half drifts of neighbouring leap frog steps are merged
+	 * into a single drift */
+	tx = t;
+	drift = weights[0] / 2;
+
+	for (i = 0; i < num; ++i)
+	{
+		cdn_integrator_leap_frog_drift (lf, tx, drift * timestep);
+		tx += drift * timestep;
+
+		cdn_integrator_leap_frog_kick (lf, tx, weights[i] * timestep);
+
+		drift = (weights[i] + (i + 1 < num ? weights[i + 1] : 0)) / 2;
+	}
+
+	cdn_integrator_leap_frog_drift (lf, tx, drift * timestep);
+
+	/* Chain up to the base integrator to emit 'step', skipping the leap
+	 * frog step itself */
+	cls = CDN_INTEGRATOR_CLASS (g_type_class_peek_parent (cdn_integrator_yoshida_parent_class));
+
+	return cls->step (integrator, t, timestep);
+}
+
+static void
+cdn_integrator_yoshida_set_property (GObject      *object,
+                                     guint         prop_id,
+                                     const GValue *value,
+                                     GParamSpec   *pspec)
+{
+	CdnIntegratorYoshida *self = CDN_INTEGRATOR_YOSHIDA (object);
+
+	switch (prop_id)
+	{
+		case PROP_ORDER:
+			/* Only even orders exist for symmetric compositions */
+			self->priv->order = g_value_get_uint (value) >= 6 ? 6 : 4;
+		break;
+		default:
+			G_OBJECT_WARN_INVALID_PROPERTY_ID (object, prop_id, pspec);
+		break;
+	}
+}
+
+static void
+cdn_integrator_yoshida_get_property (GObject    *object,
+                                     guint       prop_id,
+                                     GValue     *value,
+                                     GParamSpec *pspec)
+{
+	CdnIntegratorYoshida *self = CDN_INTEGRATOR_YOSHIDA (object);
+
+	switch (prop_id)
+	{
+		case PROP_ORDER:
+			g_value_set_uint (value, self->priv->order);
+		break;
+		default:
+			G_OBJECT_WARN_INVALID_PROPERTY_ID (object, prop_id, pspec);
+		break;
+	}
+}
+
+static void
+cdn_integrator_yoshida_class_init (CdnIntegratorYoshidaClass *klass)
+{
+	GObjectClass *object_class = G_OBJECT_CLASS (klass);
+	CdnIntegratorClass *integrator_class = CDN_INTEGRATOR_CLASS (klass);
+
+	object_class->set_property = cdn_integrator_yoshida_set_property;
+	object_class->get_property = cdn_integrator_yoshida_get_property;
+
+	integrator_class->step = cdn_integrator_yoshida_step_impl;
+	integrator_class->get_name = cdn_integrator_yoshida_get_name_impl;
+
+	integrator_class->integrator_id = "yoshida";
+
+	g_object_class_install_property (object_class,
+	                                 PROP_ORDER,
+	                                 g_param_spec_uint ("order",
+	                                                    "Order",
+	                                                    "Order (4 or 6)",
+	                                                    MIN_ORDER,
+	                                                    MAX_ORDER,
+	                                                    DEFAULT_ORDER,
+	                                                    G_PARAM_READWRITE | G_PARAM_CONSTRUCT));
+
+	g_type_class_add_private (object_class, sizeof(CdnIntegratorYoshidaPrivate));
+}
+
+static void
+cdn_integrator_yoshida_init (CdnIntegratorYoshida *self)
+{
+	self->priv = CDN_INTEGRATOR_YOSHIDA_GET_PRIVATE (self);
+}
+
+/**
+ * cdn_integrator_yoshida_new:
+ *
+ * Create a new Yoshida integrator.
+ *
+ * Returns: A #CdnIntegratorYoshida
+ *
+ **/
+CdnIntegratorYoshida *
+cdn_integrator_yoshida_new (void)
+{
+	return g_object_new (CDN_TYPE_INTEGRATOR_YOSHIDA, NULL);
+}
+
+/**
+ * cdn_integrator_yoshida_get_order:
+ * @yoshida: A #CdnIntegratorYoshida
+ *
+ * Get the order of the integration scheme.
+ *
+ * Returns: the order (4 or 6)
+ *
+ **/
+guint
+cdn_integrator_yoshida_get_order (CdnIntegratorYoshida *yoshida)
+{
+	g_return_val_if_fail (CDN_IS_INTEGRATOR_YOSHIDA (yoshida), 0);
+
+	return yoshida->priv->order;
+}
+
+/**
+ * cdn_integrator_yoshida_set_order:
+ * @yoshida: A #CdnIntegratorYoshida
+ * @order: the order (4 or 6)
+ *
+ * Set the order of the integration scheme.
+ *
+ **/
+void
+cdn_integrator_yoshida_set_order (CdnIntegratorYoshida *yoshida,
+                                  guint                 order)
+{
+	g_return_if_fail (CDN_IS_INTEGRATOR_YOSHIDA (yoshida));
+	g_return_if_fail (order == 4 || order == 6);
+
+	g_object_set (yoshida, "order", order, NULL);
+}
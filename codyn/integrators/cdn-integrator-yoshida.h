@@ -0,0 +1,80 @@
+/*
+ * cdn-integrator-yoshida.h
+ * This file is part of codyn
+ *
+ * Copyright (C) 2011 - Jesse van den Kieboom
+ *
+ * codyn is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * codyn is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with codyn; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor,
+ * Boston, MA  02110-1301  USA
+ */
+
+#ifndef __CDN_INTEGRATOR_YOSHIDA_H__
+#define __CDN_INTEGRATOR_YOSHIDA_H__
+
+#include <codyn/integrators/cdn-integrator-leap-frog.h>
+
+G_BEGIN_DECLS
+
+#define CDN_TYPE_INTEGRATOR_YOSHIDA				(cdn_integrator_yoshida_get_type ())
+#define CDN_INTEGRATOR_YOSHIDA(obj)				(G_TYPE_CHECK_INSTANCE_CAST ((obj), CDN_TYPE_INTEGRATOR_YOSHIDA, CdnIntegratorYoshida))
+#define CDN_INTEGRATOR_YOSHIDA_CONST(obj)		(G_TYPE_CHECK_INSTANCE_CAST ((obj), CDN_TYPE_INTEGRATOR_YOSHIDA, CdnIntegratorYoshida const))
+#define CDN_INTEGRATOR_YOSHIDA_CLASS(klass)		(G_TYPE_CHECK_CLASS_CAST ((klass), CDN_TYPE_INTEGRATOR_YOSHIDA, CdnIntegratorYoshidaClass))
+#define CDN_IS_INTEGRATOR_YOSHIDA(obj)			(G_TYPE_CHECK_INSTANCE_TYPE ((obj), CDN_TYPE_INTEGRATOR_YOSHIDA))
+#define CDN_IS_INTEGRATOR_YOSHIDA_CLASS(klass)	(G_TYPE_CHECK_CLASS_TYPE ((klass), CDN_TYPE_INTEGRATOR_YOSHIDA))
+#define CDN_INTEGRATOR_YOSHIDA_GET_CLASS(obj)	(G_TYPE_INSTANCE_GET_CLASS ((obj), CDN_TYPE_INTEGRATOR_YOSHIDA, CdnIntegratorYoshidaClass))
+
+typedef struct _CdnIntegratorYoshida			CdnIntegratorYoshida;
+typedef struct _CdnIntegratorYoshidaClass		CdnIntegratorYoshidaClass;
+typedef struct _CdnIntegratorYoshidaPrivate		CdnIntegratorYoshidaPrivate;
+
+/**
+ * CdnIntegratorYoshida:
+ *
+ * Higher order symplectic integrator.
+ *
+ * The Yoshida integrator is a #CdnIntegratorLeapFrog subclass which composes
+ * a step from several second order leap frog (drift-kick-drift) steps with
+ * carefully chosen (partly negative) step fractions. This yields a symplectic
+ * integration scheme of fourth or sixth order, which keeps the energy of
+ * conservative second order systems bounded over long simulations while
+ * allowing much larger steps than the leap frog integrator. Like the leap
+ * frog integrator, it splits the integrated variables into positions and
+ * velocities. Variables which are not part of a second order system are
+ * only integrated with (composed) Euler steps.
+ */
+struct _CdnIntegratorYoshida
+{
+	/*< private >*/
+	CdnIntegratorLeapFrog parent;
+
+	CdnIntegratorYoshidaPrivate *priv;
+};
+
+struct _CdnIntegratorYoshidaClass
+{
+	/*< private >*/
+	CdnIntegratorLeapFrogClass parent_class;
+};
+
+GType cdn_integrator_yoshida_get_type (void) G_GNUC_CONST;
+
+CdnIntegratorYoshida *cdn_integrator_yoshida_new (void);
+
+guint cdn_integrator_yoshida_get_order (CdnIntegratorYoshida *yoshida);
+void cdn_integrator_yoshida_set_order (CdnIntegratorYoshida *yoshida, guint order);
+
+G_END_DECLS
+
+#endif /* __CDN_INTEGRATOR_YOSHIDA_H__ */
@@ -20,6 +20,10 @@
  * Boston, MA  02110-1301  USA
  */
 
+#ifdef HAVE_CONFIG_H
+#include <config.h>
+#endif
+
 #include "cdn-integrator.h"
 #include "cdn-edge.h"
 #include "cdn-compile-error.h"
@@ -30,12 +34,32 @@
 #include "instructions/cdn-instruction-rand.h"
 #include "cdn-debug.h"
 #include "cdn-phaseable.h"
+#include "cdn-node.h"
 
 #include <math.h>
 #include <string.h>
+#include <errno.h>
+#include <time.h>
+
+#if defined(HAVE_SCHED_SETSCHEDULER) || defined(HAVE_SCHED_SETAFFINITY)
+#include <sched.h>
+#endif
 
 #define CDN_INTEGRATOR_GET_PRIVATE(object)(G_TYPE_INSTANCE_GET_PRIVATE((object), CDN_TYPE_INTEGRATOR, CdnIntegratorPrivate))
 
+#define MAX_EVENT_ITERATIONS 50
+
+/* Maximum number of steps for which an event is left unchecked */
+#define MAX_DORMANT_STEPS 100
+
+#define CHECKPOINT_MAGIC "codyn-checkpoint"
+#define CHECKPOINT_VERSION 1
+
+/* magic, version, integrator id, time, step count, stateful variables,
+ * node states, rate intervals, operator states, random instruction states,
+ * integrator specific state */
+#define CHECKPOINT_FORMAT "(susdta(sad)a(ss)a(udad)a(uv)a(axay)mv)"
+
 typedef gdouble (*CdnIntegratorStepFunc)(CdnIntegrator *, gdouble, gdouble);
 
 /* Properties */
@@ -48,7 +72,11 @@ enum
 	PROP_STATE,
 	PROP_REAL_TIME,
 	PROP_MINIMUM_TIMESTEP,
-	PROP_DEFAULT_TIMESTEP
+	PROP_DEFAULT_TIMESTEP,
+	PROP_EVENT_TOLERANCE,
+	PROP_REAL_TIME_PRIORITY,
+	PROP_REAL_TIME_CPU,
+	PROP_EVENT_SCREENING
 };
 
 /* Signals */
@@ -60,6 +88,33 @@ enum
 	NUM_SIGNALS
 };
 
+typedef struct
+{
+	guint every;
+
+	/* The integrated variables of the group, and their values at the
+	 * start of the current interval and their rate of change over the
+	 * interval, in the order of the variables */
+	GSList *variables;
+	guint size;
+	gdouble *start;
+	gdouble *slope;
+
+	/* The end of the current interval */
+	gdouble until;
+	guint active : 1;
+} RateGroup;
+
+typedef struct
+{
+	RateGroup *group;
+	gdouble *slope;
+	guint size;
+
+	/* The last evaluation in which the slope was added */
+	guint64 stamp;
+} RateVariable;
+
 struct _CdnIntegratorPrivate
 {
 	CdnObject *object;
@@ -68,18 +123,65 @@ struct _CdnIntegratorPrivate
 	CdnVariable *property_timestep;
 
 	CdnIntegratorState *state;
-	GSList *saved_state;
 
+	/* Integrated values at the start of the step, in the state vector
+	 * layout, used to restore the state when events fire */
+	gdouble *saved_state;
+
+	/* Integrated values interpolated within the step while locating
+	 * events */
+	gdouble *dense_state;
+
+	/* Groups of the integrated variables of nodes which integrate at a
+	 * lower rate (slowest first), the RateVariable of each of their
+	 * variables and integrated edge actions, the group which is
+	 * integrating its interval (if any) and a copy of the state vector to
+	 * restore afterwards */
+	GSList *rate_groups;
+	GHashTable *rate_variables;
+	GHashTable *rate_actions;
+	RateGroup *rate_step;
+	guint64 rate_stamp;
+	gdouble *rate_state;
+	guint64 step_count;
 
-	GTimer *step_timer;
 	gdouble real_time;
-	gdouble rt_correction;
+	gint real_time_priority;
+	gint real_time_cpu;
+
+	/* Absolute deadline of the current real-time step, and the time at
+	 * which the previous step woke up, in nanoseconds on the monotonic
+	 * clock */
+	gint64 rt_deadline;
+	gint64 rt_wake;
+	CdnIntegratorRealTimeStats rt_stats;
+
+#ifdef HAVE_SCHED_SETSCHEDULER
+	gint rt_saved_policy;
+	struct sched_param rt_saved_param;
+#endif
+
+#ifdef HAVE_SCHED_SETAFFINITY
+	cpu_set_t rt_saved_cpus;
+#endif
+
 	gdouble minimum_timestep;
+	gdouble event_tolerance;
 	gdouble default_timestep;
 
+	/* Safety factor on the event horizons (0 disables screening), the
+	 * dormant events (mapping to a DormantEvent), and the number of event
+	 * condition evaluations skipped */
+	gdouble event_screening;
+	GHashTable *dormant_events;
+	guint64 skipped_event_evaluations;
+
 	guint terminate : 1;
 	guint inner_event_loop : 1;
 	guint events_handled : 1;
+	guint warming_up : 1;
+	guint rt_scheduled : 1;
+	guint rt_pinned : 1;
 };
 
 static guint integrator_signals[NUM_SIGNALS] = {0,};
@@ -88,29 +190,269 @@ G_DEFINE_TYPE (CdnIntegrator, cdn_integrator, CDN_TYPE_OBJECT)
 
 typedef struct
 {
-	CdnVariable *property;
-	CdnMatrix values;
-} SavedState;
+	/* Time before which the event cannot happen */
+	gdouble until;
 
-static SavedState *
-saved_state_new (CdnVariable *property)
+	/* Whether the condition values of the event were not updated since
+	 * it became dormant */
+	guint stale : 1;
+} DormantEvent;
+
+static void
+rate_group_free (RateGroup *self)
 {
-	SavedState *ret;
+	g_slist_free (self->variables);
 
-	ret = g_slice_new0 (SavedState);
+	g_free (self->start);
+	g_free (self->slope);
 
-	ret->property = g_object_ref_sink (property);
+	g_slice_free (RateGroup, self);
+}
 
-	return ret;
+static void
+rate_variable_free (RateVariable *self)
+{
+	g_slice_free (RateVariable, self);
+}
+
+static void
+clear_rate_groups (CdnIntegrator *integrator)
+{
+	g_slist_foreach (integrator->priv->rate_groups,
+	                 (GFunc)rate_group_free,
+	                 NULL);
+
+	g_slist_free (integrator->priv->rate_groups);
+	integrator->priv->rate_groups = NULL;
+
+	if (integrator->priv->rate_actions)
+	{
+		g_hash_table_destroy (integrator->priv->rate_actions);
+		integrator->priv->rate_actions = NULL;
+	}
+
+	if (integrator->priv->rate_variables)
+	{
+		g_hash_table_destroy (integrator->priv->rate_variables);
+		integrator->priv->rate_variables = NULL;
+	}
+
+	g_free (integrator->priv->rate_state);
+	integrator->priv->rate_state = NULL;
+}
+
+/**
+ * cdn_integrator_error_quark:
+ *
+ * Get the error quark for the integrator error type.
+ *
+ * Returns: a #GQuark for the integrator error type
+ *
+ */
+GQuark
+cdn_integrator_error_quark ()
+{
+	static GQuark quark = 0;
+
+	if (G_UNLIKELY (quark == 0))
+	{
+		quark = g_quark_from_static_string ("cdn_integrator_error");
+	}
+
+	return quark;
+}
+
+static gint64
+monotonic_time_ns (void)
+{
+#ifdef HAVE_CLOCK_NANOSLEEP
+	struct timespec ts;
+
+	clock_gettime (CLOCK_MONOTONIC, &ts);
+	return (gint64)ts.tv_sec * 1000000000 + ts.tv_nsec;
+#else
+	return g_get_monotonic_time () * 1000;
+#endif
+}
+
+static void
+sleep_until_ns (gint64 deadline)
+{
+#ifdef HAVE_CLOCK_NANOSLEEP
+	struct timespec ts;
+
+	ts.tv_sec = deadline / 1000000000;
+	ts.tv_nsec = deadline % 1000000000;
+
+	// Absolute deadlines do not drift when the sleep is interrupted
+	while (clock_nanosleep (CLOCK_MONOTONIC,
+	                        TIMER_ABSTIME,
+	                        &ts,
+	                        NULL) == EINTR)
+	{
+	}
+#else
+	gint64 now = monotonic_time_ns ();
+
+	if (deadline > now)
+	{
+		g_usleep ((deadline - now) / 1000);
+	}
+#endif
 }
 
 static void
-saved_state_free (SavedState *self)
+real_time_anchor (CdnIntegrator *integrator)
 {
-	cdn_matrix_destroy (&self->values);
+	integrator->priv->rt_wake = monotonic_time_ns ();
+	integrator->priv->rt_deadline = integrator->priv->rt_wake;
+}
+
+static void
+real_time_acquire (CdnIntegrator *integrator)
+{
+#ifdef HAVE_SCHED_SETSCHEDULER
+	if (integrator->priv->real_time_priority > 0 &&
+	    !integrator->priv->rt_scheduled)
+	{
+		struct sched_param param = {0,};
+
+		integrator->priv->rt_saved_policy = sched_getscheduler (0);
+		sched_getparam (0, &integrator->priv->rt_saved_param);
+
+		param.sched_priority = integrator->priv->real_time_priority;
+
+		if (sched_setscheduler (0, SCHED_FIFO, &param) == 0)
+		{
+			integrator->priv->rt_scheduled = TRUE;
+		}
+		else
+		{
+			g_warning ("Could not set real-time priority %d: %s",
+			           integrator->priv->real_time_priority,
+			           g_strerror (errno));
+		}
+	}
+#else
+	if (integrator->priv->real_time_priority > 0)
+	{
+		g_warning ("Real-time priority is not supported on this platform");
+	}
+#endif
+
+#ifdef HAVE_SCHED_SETAFFINITY
+	if (integrator->priv->real_time_cpu >= 0 &&
+	    integrator->priv->real_time_cpu < CPU_SETSIZE &&
+	    !integrator->priv->rt_pinned)
+	{
+		cpu_set_t cpus;
+
+		sched_getaffinity (0,
+		                   sizeof (cpu_set_t),
+		                   &integrator->priv->rt_saved_cpus);
+
+		CPU_ZERO (&cpus);
+		CPU_SET (integrator->priv->real_time_cpu, &cpus);
+
+		if (sched_setaffinity (0, sizeof (cpu_set_t), &cpus) == 0)
+		{
+			integrator->priv->rt_pinned = TRUE;
+		}
+		else
+		{
+			g_warning ("Could not pin integration to cpu %d: %s",
+			           integrator->priv->real_time_cpu,
+			           g_strerror (errno));
+		}
+	}
+#else
+	if (integrator->priv->real_time_cpu >= 0)
+	{
+		g_warning ("Real-time cpu affinity is not supported on this platform");
+	}
+#endif
+}
+
+static void
+real_time_release (CdnIntegrator *integrator)
+{
+#ifdef HAVE_SCHED_SETSCHEDULER
+	if (integrator->priv->rt_scheduled)
+	{
+		sched_setscheduler (0,
+		                    integrator->priv->rt_saved_policy,
+		                    &integrator->priv->rt_saved_param);
+
+		integrator->priv->rt_scheduled = FALSE;
+	}
+#endif
+
+#ifdef HAVE_SCHED_SETAFFINITY
+	if (integrator->priv->rt_pinned)
+	{
+		sched_setaffinity (0,
+		                   sizeof (cpu_set_t),
+		                   &integrator->priv->rt_saved_cpus);
+
+		integrator->priv->rt_pinned = FALSE;
+	}
+#endif
+}
+
+static void
+real_time_wait (CdnIntegrator *integrator,
+                gdouble        timestep)
+{
+	CdnIntegratorRealTimeStats *stats = &integrator->priv->rt_stats;
+	gint64 period;
+	gint64 now;
+	gint64 busy;
+	gdouble load;
+	gint bin;
+
+	period = (gint64)(timestep / integrator->priv->real_time * 1e9);
+
+	now = monotonic_time_ns ();
+	busy = now - integrator->priv->rt_wake;
+
+	integrator->priv->rt_deadline += period;
+
+	++stats->steps;
 
-	g_object_unref (self->property);
-	g_slice_free (SavedState, self);
+	if (busy * 1e-9 > stats->worst_step)
+	{
+		stats->worst_step = busy * 1e-9;
+	}
+
+	load = period > 0 ? (gdouble)busy / period : G_MAXDOUBLE;
+	bin = load * 10 >= CDN_INTEGRATOR_REAL_TIME_BINS - 1 ?
+	      CDN_INTEGRATOR_REAL_TIME_BINS - 1 : (gint)(load * 10);
+
+	++stats->histogram[bin];
+
+	if (now > integrator->priv->rt_deadline)
+	{
+		// Deadline missed, start counting from now instead of trying
+		// to catch up by running subsequent steps short
+		++stats->overruns;
+
+		integrator->priv->rt_deadline = now;
+		integrator->priv->rt_wake = now;
+	}
+	else
+	{
+		gint64 latency;
+
+		sleep_until_ns (integrator->priv->rt_deadline);
+
+		integrator->priv->rt_wake = monotonic_time_ns ();
+		latency = integrator->priv->rt_wake - integrator->priv->rt_deadline;
+
+		if (latency * 1e-9 > stats->worst_latency)
+		{
+			stats->worst_latency = latency * 1e-9;
+		}
+	}
 }
 
 static void
@@ -124,10 +466,17 @@ cdn_integrator_finalize (GObject *object)
 		                              (gpointer *)&(self->priv->object));
 	}
 
-	g_slist_foreach (self->priv->saved_state, (GFunc)saved_state_free, NULL);
-	g_slist_free (self->priv->saved_state);
+	g_free (self->priv->saved_state);
+	g_free (self->priv->dense_state);
 
-	g_timer_destroy (self->priv->step_timer);
+	clear_rate_groups (self);
+
+	if (self->priv->dormant_events)
+	{
+		g_hash_table_destroy (self->priv->dormant_events);
+	}
+
+	real_time_release (self);
 
 	G_OBJECT_CLASS (cdn_integrator_parent_class)->finalize (object);
 }
@@ -216,6 +565,18 @@ cdn_integrator_set_property (GObject      *object,
 		case PROP_DEFAULT_TIMESTEP:
 			self->priv->default_timestep = g_value_get_double (value);
 			break;
+		case PROP_EVENT_TOLERANCE:
+			self->priv->event_tolerance = g_value_get_double (value);
+			break;
+		case PROP_EVENT_SCREENING:
+			self->priv->event_screening = g_value_get_double (value);
+			break;
+		case PROP_REAL_TIME_PRIORITY:
+			self->priv->real_time_priority = g_value_get_int (value);
+			break;
+		case PROP_REAL_TIME_CPU:
+			self->priv->real_time_cpu = g_value_get_int (value);
+			break;
 		default:
 			G_OBJECT_WARN_INVALID_PROPERTY_ID (object, prop_id, pspec);
 		break;
@@ -250,12 +611,134 @@ cdn_integrator_get_property (GObject    *object,
 		case PROP_DEFAULT_TIMESTEP:
 			g_value_set_double (value, self->priv->default_timestep);
 			break;
+		case PROP_EVENT_TOLERANCE:
+			g_value_set_double (value, self->priv->event_tolerance);
+			break;
+		case PROP_EVENT_SCREENING:
+			g_value_set_double (value, self->priv->event_screening);
+			break;
+		case PROP_REAL_TIME_PRIORITY:
+			g_value_set_int (value, self->priv->real_time_priority);
+			break;
+		case PROP_REAL_TIME_CPU:
+			g_value_set_int (value, self->priv->real_time_cpu);
+			break;
 		default:
 			G_OBJECT_WARN_INVALID_PROPERTY_ID (object, prop_id, pspec);
 		break;
 	}
 }
 
+static void
+read_rate_group (RateGroup *group,
+                 gdouble   *values)
+{
+	GSList *item;
+
+	for (item = group->variables; item; item = g_slist_next (item))
+	{
+		CdnMatrix const *m;
+
+		m = cdn_variable_get_values (item->data);
+
+		memcpy (values,
+		        cdn_matrix_get (m),
+		        sizeof (gdouble) * cdn_matrix_size (m));
+
+		values += cdn_matrix_size (m);
+	}
+}
+
+/* Integrate the variables of a group of slow nodes over their next interval
+ * of every timesteps at once, using the integration method itself. Other
+ * slow groups follow their current rate and faster variables are held.
+ * Only the rate of change over the interval is kept, after which the state
+ * of the network and the integrator are restored. */
+static void
+begin_rate_interval (CdnIntegrator *integrator,
+                     RateGroup     *group,
+                     gdouble        t,
+                     gdouble        timestep)
+{
+	CdnIntegratorClass *klass = CDN_INTEGRATOR_GET_CLASS (integrator);
+	GVariant *specific = NULL;
+	gdouble realstep;
+	guint i;
+
+	cdn_integrator_state_get_integrated_values (integrator->priv->state,
+	                                            integrator->priv->rate_state);
+
+	read_rate_group (group, group->start);
+
+	if (klass->save_state && klass->restore_state)
+	{
+		specific = klass->save_state (integrator);
+
+		if (specific)
+		{
+			g_variant_ref_sink (specific);
+		}
+	}
+
+	integrator->priv->rate_step = group;
+	realstep = klass->step (integrator, t, timestep * group->every);
+	integrator->priv->rate_step = NULL;
+
+	group->active = realstep > 0;
+
+	if (group->active)
+	{
+		read_rate_group (group, group->slope);
+
+		for (i = 0; i < group->size; ++i)
+		{
+			group->slope[i] = (group->slope[i] - group->start[i]) / realstep;
+		}
+
+		group->until = t + realstep;
+	}
+
+	cdn_integrator_state_set_integrated_values (integrator->priv->state,
+	                                            integrator->priv->rate_state);
+
+	cdn_integrator_set_time (integrator, t);
+
+	if (specific)
+	{
+		klass->restore_state (integrator, specific);
+		g_variant_unref (specific);
+	}
+}
+
+/* Perform a single step, starting the next interval of slow nodes where
+ * needed. Steps do not cross the end of an interval. */
+static gdouble
+integrate_step (CdnIntegrator         *integrator,
+                CdnIntegratorStepFunc  step_func,
+                gdouble                t,
+                gdouble                timestep)
+{
+	GSList *item;
+
+	for (item = integrator->priv->rate_groups; item; item = g_slist_next (item))
+	{
+		RateGroup *group = item->data;
+
+		// Allow for rounding in the accumulated time
+		if (!group->active || group->until - t <= timestep * 1e-9)
+		{
+			begin_rate_interval (integrator, group, t, timestep);
+		}
+
+		if (group->active && group->until - t < timestep)
+		{
+			timestep = group->until - t;
+		}
+	}
+
+	return step_func (integrator, t, timestep);
+}
+
 static void
 cdn_integrator_run_impl (CdnIntegrator *integrator,
                          gdouble        from,
@@ -276,7 +759,7 @@ cdn_integrator_run_impl (CdnIntegrator *integrator,
 			timestep = to - from;
 		}
 
-		gdouble realstep = step_func (integrator, from, timestep);
+		gdouble realstep = integrate_step (integrator, step_func, from, timestep);
 
 		if (realstep <= 0 || integrator->priv->terminate)
 		{
@@ -338,7 +821,83 @@ reset_function_cache (CdnIntegrator *integrator)
 }
 
 static void
-update_events (CdnIntegrator *integrator)
+clear_dormant_events (CdnIntegrator *integrator)
+{
+	if (integrator->priv->dormant_events)
+	{
+		g_hash_table_remove_all (integrator->priv->dormant_events);
+	}
+}
+
+static DormantEvent *
+dormant_event (CdnIntegrator *integrator,
+               CdnEvent      *event)
+{
+	if (!integrator->priv->dormant_events)
+	{
+		return NULL;
+	}
+
+	return g_hash_table_lookup (integrator->priv->dormant_events, event);
+}
+
+/* Whether @event cannot happen before @t */
+static gboolean
+event_is_dormant (CdnIntegrator *integrator,
+                  CdnEvent      *event,
+                  gdouble        t)
+{
+	DormantEvent *dormant;
+
+	dormant = dormant_event (integrator, event);
+	return dormant && t < dormant->until;
+}
+
+static void
+screen_event (CdnIntegrator *integrator,
+              CdnEvent      *event,
+              gdouble        t,
+              gdouble        timestep)
+{
+	gdouble horizon;
+	DormantEvent *dormant;
+
+	if (!integrator->priv->dormant_events)
+	{
+		integrator->priv->dormant_events =
+			g_hash_table_new_full (g_direct_hash,
+			                       g_direct_equal,
+			                       NULL,
+			                       (GDestroyNotify)g_free);
+	}
+
+	horizon = cdn_event_horizon (event, integrator->priv->property_time) /
+	          MAX (1, integrator->priv->event_screening);
+
+	horizon = MIN (horizon, MAX_DORMANT_STEPS * timestep);
+
+	if (horizon <= 0)
+	{
+		g_hash_table_remove (integrator->priv->dormant_events, event);
+		return;
+	}
+
+	dormant = g_hash_table_lookup (integrator->priv->dormant_events, event);
+
+	if (!dormant)
+	{
+		dormant = g_new0 (DormantEvent, 1);
+		g_hash_table_insert (integrator->priv->dormant_events, event, dormant);
+	}
+
+	dormant->until = t + horizon;
+	dormant->stale = FALSE;
+}
+
+static void
+update_events (CdnIntegrator *integrator,
+               gdouble        t,
+               gdouble        timestep)
 {
 	GSList const *events;
 
@@ -347,7 +906,41 @@ update_events (CdnIntegrator *integrator)
 
 	while (events)
 	{
-		cdn_event_update (events->data);
+		CdnEvent *ev = events->data;
+		DormantEvent *dormant;
+
+		dormant = dormant_event (integrator, ev);
+
+		// Dormant events keep their old value as long as the next
+		// step (allowing it to grow) cannot reach their horizon, so
+		// that the value is up to date when they are checked again
+		if (dormant && t + 2 * timestep < dormant->until)
+		{
+			++integrator->priv->skipped_event_evaluations;
+			dormant->stale = TRUE;
+		}
+		else if (dormant && dormant->stale && cdn_event_happened (ev, NULL))
+		{
+			// The condition crossed while the event was dormant.
+			// Keep the value from before the crossing and wake the
+			// event up, so that it is handled in the next step
+			dormant->until = t;
+		}
+		else
+		{
+			cdn_event_update (ev);
+
+			if (dormant)
+			{
+				dormant->stale = FALSE;
+			}
+
+			if (integrator->priv->event_screening > 0)
+			{
+				screen_event (integrator, ev, t, timestep);
+			}
+		}
+
 		events = g_slist_next (events);
 	}
 }
@@ -358,13 +951,12 @@ prepare_next_step (CdnIntegrator *integrator,
                    gdouble        timestep,
                    gboolean       genrand)
 {
-	GSList *item;
 	GSList const *io;
 	GSList const *ops;
 
 	if (!integrator->priv->events_handled)
 	{
-		update_events (integrator);
+		update_events (integrator, t, timestep);
 	}
 
 	cdn_variable_set_value (integrator->priv->property_time, t);
@@ -377,22 +969,22 @@ prepare_next_step (CdnIntegrator *integrator,
 
 	reset_function_cache (integrator);
 
-	// Update io
-	io = cdn_integrator_state_io (integrator->priv->state);
-
-	while (io)
+	// Update io, which is not done while warming up
+	if (!integrator->priv->warming_up)
 	{
-		cdn_io_update (CDN_IO (io->data), integrator);
-		io = g_slist_next (io);
-	}
+		io = cdn_integrator_state_io (integrator->priv->state);
 
-	for (item = integrator->priv->saved_state; item; item = g_slist_next (item))
-	{
-		SavedState *s = item->data;
-		CdnMatrix const *vals;
+		while (io)
+		{
+			cdn_io_update (CDN_IO (io->data), integrator);
+			io = g_slist_next (io);
+		}
+	}
 
-		vals = cdn_variable_get_values (s->property);
-		cdn_matrix_copy (&s->values, vals);
+	if (integrator->priv->saved_state)
+	{
+		cdn_integrator_state_get_integrated_values (integrator->priv->state,
+		                                            integrator->priv->saved_state);
 	}
 
 	// Update operators
@@ -408,23 +1000,24 @@ prepare_next_step (CdnIntegrator *integrator,
 static void
 restore_saved_state (CdnIntegrator *integrator)
 {
-	GSList *item;
-
-	for (item = integrator->priv->saved_state; item; item = g_slist_next (item))
+	if (integrator->priv->saved_state)
 	{
-		SavedState *s = item->data;
-
-		cdn_variable_set_values (s->property, &s->values);
+		cdn_integrator_state_set_integrated_values (integrator->priv->state,
+		                                            integrator->priv->saved_state);
 	}
 }
 
 static void
 execute_events (CdnIntegrator *integrator,
-                GSList        *events)
+                GSList        *events,
+                gdouble        t,
+                gdouble        timestep)
 {
 	gchar const *state;
 
-	update_events (integrator);
+	// Events can change anything, so all events are checked again
+	clear_dormant_events (integrator);
+	update_events (integrator, t, timestep);
 
 	while (events)
 	{
@@ -514,70 +1107,357 @@ append_happened (GSList    *events,
 	return first;
 }
 
-static void
-handle_events (CdnIntegrator *integrator,
-               gdouble        t,
-               gdouble       *timestep)
+/* Collect the events which happened and occur first, optionally also
+ * collecting all the events which happened in @all */
+static GSList *
+events_happened (GSList const  *events,
+                 GSList       **all,
+                 gdouble       *smallest)
 {
-	GSList const *events;
 	GSList *happened = NULL;
 	CdnEvent *smallest_event = NULL;
-	gdouble smallest = 0;
 
-	if (!integrator->priv->inner_event_loop)
+	*smallest = 0;
+
+	while (events)
 	{
-		integrator->priv->events_handled = FALSE;
+		CdnEvent *ev = events->data;
+
+		if (cdn_event_happened (ev, NULL))
+		{
+			happened = append_happened (happened, ev, smallest, &smallest_event);
+
+			if (all)
+			{
+				*all = g_slist_prepend (*all, ev);
+			}
+		}
+
+		events = g_slist_next (events);
 	}
 
-	// Here we are going to check our events
-	events = cdn_integrator_state_phase_events (integrator->priv->state);
+	return happened;
+}
+
+/* Events which wake up within the step starting at @t while still having
+ * the condition values from before they became dormant. Their condition is
+ * checked at the start of the step first: if it crossed during the dormant
+ * interval before the step, the old values are kept so that the event
+ * fires at the start of the step. Otherwise the values are updated to the
+ * start of the step, so that the crossing is located within the step. */
+static void
+wake_events (CdnIntegrator *integrator,
+             GSList const  *events,
+             gdouble        t)
+{
+	gdouble *end = NULL;
+	gdouble tend = 0;
 
 	while (events)
 	{
 		CdnEvent *ev = events->data;
+		DormantEvent *dormant;
 
-		if (cdn_event_happened (ev, NULL))
+		dormant = dormant_event (integrator, ev);
+		events = g_slist_next (events);
+
+		if (!dormant || !dormant->stale || !integrator->priv->saved_state)
+		{
+			continue;
+		}
+
+		dormant->stale = FALSE;
+
+		if (!end)
+		{
+			guint size;
+
+			size = cdn_integrator_state_integrated_size (integrator->priv->state);
+			end = g_new (gdouble, MAX (size, 1));
+
+			cdn_integrator_state_get_integrated_values (integrator->priv->state,
+			                                            end);
+
+			tend = cdn_variable_get_value (integrator->priv->property_time);
+
+			restore_saved_state (integrator);
+			cdn_variable_set_value (integrator->priv->property_time, t);
+		}
+
+		if (!cdn_event_happened (ev, NULL))
+		{
+			cdn_event_update (ev);
+		}
+	}
+
+	if (end)
+	{
+		cdn_integrator_state_set_integrated_values (integrator->priv->state,
+		                                            end);
+
+		cdn_variable_set_value (integrator->priv->property_time, tend);
+		g_free (end);
+	}
+}
+
+/* Collect the events which can have happened at @t */
+static GSList *
+awake_events (CdnIntegrator *integrator,
+              GSList const  *events,
+              gdouble        t)
+{
+	GSList *ret = NULL;
+
+	while (events)
+	{
+		if (event_is_dormant (integrator, events->data, t))
+		{
+			++integrator->priv->skipped_event_evaluations;
+		}
+		else
 		{
-			happened = append_happened (happened, ev, &smallest, &smallest_event);
+			ret = g_slist_prepend (ret, events->data);
 		}
 
 		events = g_slist_next (events);
 	}
 
-	if (happened)
+	return g_slist_reverse (ret);
+}
+
+static gdouble
+events_crossing (GSList const *events,
+                 gboolean      initial)
+{
+	gdouble ret = -G_MAXDOUBLE;
+
+	/* The earliest crossing of any of the events is where the largest
+	 * of their crossing values crosses zero */
+	while (events)
+	{
+		ret = MAX (ret, cdn_event_crossing (events->data, initial));
+		events = g_slist_next (events);
+	}
+
+	return ret;
+}
+
+static void
+event_trial_step (CdnIntegrator *integrator,
+                  gdouble        t,
+                  gdouble        timestep)
+{
+	gboolean isinner;
+
+	restore_saved_state (integrator);
+
+	isinner = integrator->priv->inner_event_loop;
+	integrator->priv->inner_event_loop = TRUE;
+
+	cdn_integrator_step (integrator, t, timestep);
+
+	integrator->priv->inner_event_loop = isinner;
+}
+
+/* Set the integrated values to the dense output of the integrator at
+ * t + timestep, without stepping. Returns FALSE if the integrator has no
+ * dense output covering that time */
+static gboolean
+event_trial_interpolate (CdnIntegrator *integrator,
+                         gdouble        t,
+                         gdouble        timestep)
+{
+	CdnIntegratorClass *klass;
+
+	klass = CDN_INTEGRATOR_GET_CLASS (integrator);
+
+	if (!klass->interpolate || !integrator->priv->dense_state ||
+	    !klass->interpolate (integrator,
+	                         t + timestep,
+	                         integrator->priv->dense_state))
+	{
+		return FALSE;
+	}
+
+	cdn_integrator_state_set_integrated_values (integrator->priv->state,
+	                                            integrator->priv->dense_state);
+
+	cdn_variable_set_value (integrator->priv->property_time, t + timestep);
+	cdn_variable_set_value (integrator->priv->property_timestep, timestep);
+
+	return TRUE;
+}
+
+/* Locate the earliest time within the step at which one of the happened
+ * events crosses, using the Illinois variant of regula falsi on the
+ * fraction of the step. The interval [a, b] always brackets the crossing,
+ * where the events have not happened at a and have happened at b. Trial
+ * points are evaluated on the dense output of the integrator where it
+ * has one, and otherwise cost a single integration step from the saved
+ * state. On return, the integrator state is at the end of the located
+ * step and the step size is returned. */
+static gdouble
+locate_events (CdnIntegrator *integrator,
+               GSList const  *candidates,
+               gdouble        t,
+               gdouble        timestep)
+{
+	gdouble a = 0;
+	gdouble b = 1;
+	gdouble ga;
+	gdouble gb;
+	gdouble lower;
+	gint side = 0;
+	gboolean atb = TRUE;
+	gboolean stepped;
+	guint i;
+
+	ga = events_crossing (candidates, TRUE);
+	gb = events_crossing (candidates, FALSE);
+
+	lower = MIN (1, integrator->priv->minimum_timestep / timestep);
+
+	for (i = 0; i < MAX_EVENT_ITERATIONS; ++i)
 	{
-		// Backup the simulation a bit if needed
-		if (smallest < (1 - 1e-9) && *timestep > integrator->priv->minimum_timestep)
+		GSList *happened;
+		gdouble smallest;
+		gdouble theta;
+		gdouble g;
+
+		if ((b - a) * timestep <= integrator->priv->event_tolerance ||
+		    b <= lower)
 		{
-			gdouble nts;
-			gboolean isinner;
+			break;
+		}
 
-			restore_saved_state (integrator);
+		if (gb > ga)
+		{
+			theta = b - gb * (b - a) / (gb - ga);
+		}
+		else
+		{
+			theta = a + 0.5 * (b - a);
+		}
 
-			*timestep = smallest * *timestep;
+		if (theta <= a || theta >= b)
+		{
+			theta = a + 0.5 * (b - a);
+		}
 
-			if (*timestep < integrator->priv->minimum_timestep)
-			{
-				*timestep = integrator->priv->minimum_timestep;
-			}
+		theta = MAX (theta, lower);
+
+		if (event_trial_interpolate (integrator, t, theta * timestep))
+		{
+			stepped = FALSE;
+		}
+		else
+		{
+			event_trial_step (integrator, t, theta * timestep);
+			stepped = TRUE;
+		}
+
+		g = events_crossing (candidates, FALSE);
+		happened = events_happened (candidates, NULL, &smallest);
 
-			isinner = integrator->priv->inner_event_loop;
-			integrator->priv->inner_event_loop = TRUE;
+		if (happened)
+		{
+			g_slist_free (happened);
 
-			nts = cdn_integrator_step (integrator, t, *timestep);
+			if (side == 1)
+			{
+				ga *= 0.5;
+			}
 
-			integrator->priv->inner_event_loop = isinner;
+			b = theta;
+			gb = g;
+			side = 1;
+			atb = stepped;
 
-			*timestep = nts;
+			/* Condition is within the event approximation */
+			if (smallest >= 1 - 1e-9)
+			{
+				break;
+			}
 		}
 		else
 		{
-			execute_events (integrator, happened);
-			integrator->priv->events_handled = TRUE;
+			if (side == -1)
+			{
+				gb *= 0.5;
+			}
+
+			a = theta;
+			ga = g;
+			side = -1;
+			atb = FALSE;
 		}
+	}
+
+	if (!atb)
+	{
+		event_trial_step (integrator, t, b * timestep);
+	}
+
+	return b * timestep;
+}
+
+static void
+handle_events (CdnIntegrator *integrator,
+               gdouble        t,
+               gdouble       *timestep)
+{
+	GSList const *events;
+	GSList *happened;
+	GSList *candidates = NULL;
+	gdouble smallest;
+
+	if (integrator->priv->inner_event_loop)
+	{
+		/* Events are checked by the locating loop */
+		return;
+	}
+
+	integrator->priv->events_handled = FALSE;
+
+	// Here we are going to check our events
+	events = cdn_integrator_state_phase_events (integrator->priv->state);
+
+	if (integrator->priv->dormant_events &&
+	    g_hash_table_size (integrator->priv->dormant_events) > 0)
+	{
+		GSList *awake;
+
+		awake = awake_events (integrator, events, t + *timestep);
+		wake_events (integrator, awake, t);
+
+		happened = events_happened (awake, &candidates, &smallest);
+		g_slist_free (awake);
+	}
+	else
+	{
+		happened = events_happened (events, &candidates, &smallest);
+	}
+
+	if (!happened)
+	{
+		return;
+	}
 
+	// Locate the event in the step if needed
+	if (smallest < (1 - 1e-9) && *timestep > integrator->priv->minimum_timestep)
+	{
 		g_slist_free (happened);
+
+		*timestep = locate_events (integrator, candidates, t, *timestep);
+		happened = events_happened (candidates, NULL, &smallest);
 	}
+
+	g_slist_free (candidates);
+
+	execute_events (integrator, happened, t + *timestep, *timestep);
+	integrator->priv->events_handled = TRUE;
+
+	g_slist_free (happened);
 }
 
 static void
@@ -641,7 +1521,12 @@ cdn_integrator_step_impl (CdnIntegrator *integrator,
                           gdouble        t,
                           gdouble        timestep)
 {
-	gdouble elapsed;
+	/* The interval of slow nodes is integrated ahead of the actual step,
+	 * see begin_rate_interval */
+	if (integrator->priv->rate_step)
+	{
+		return timestep;
+	}
 
 	update_discrete (integrator);
 
@@ -654,6 +1539,13 @@ cdn_integrator_step_impl (CdnIntegrator *integrator,
 
 	prepare_next_step (integrator, t + timestep, timestep, TRUE);
 
+	++integrator->priv->step_count;
+
+	if (integrator->priv->warming_up)
+	{
+		return timestep;
+	}
+
 	g_signal_emit (integrator,
 	               integrator_signals[STEP],
 	               0,
@@ -662,27 +1554,11 @@ cdn_integrator_step_impl (CdnIntegrator *integrator,
 
 	cdn_debug_message (DEBUG_INTEGRATOR, "Step");
 
-	elapsed = g_timer_elapsed (integrator->priv->step_timer, NULL);
-
-	if (integrator->priv->real_time > 0 &&
-	    timestep > elapsed * integrator->priv->real_time)
+	if (integrator->priv->real_time > 0)
 	{
-		gdouble s = (timestep - elapsed) / integrator->priv->real_time +
-		            integrator->priv->rt_correction;
-		gulong ms = (gulong)(G_USEC_PER_SEC * s);
-		gdouble slept;
-
-		if (s > 0)
-		{
-			g_usleep (ms);
-		}
-
-		slept = g_timer_elapsed (integrator->priv->step_timer, NULL);
-		integrator->priv->rt_correction = s - slept;
+		real_time_wait (integrator, timestep);
 	}
 
-	g_timer_reset (integrator->priv->step_timer);
-
 	return timestep;
 }
 
@@ -723,102 +1599,295 @@ cdn_integrator_constructor (GType                  type,
 	return ret;
 }
 
-static void
-cdn_integrator_reset_impl (CdnIntegrator *integrator)
+static guint
+integrate_every (CdnVariable *variable)
 {
-	GSList const *items;
-
-	g_slist_foreach (integrator->priv->saved_state, (GFunc)saved_state_free, NULL);
-	g_slist_free (integrator->priv->saved_state);
-	integrator->priv->saved_state = NULL;
-
-	integrator->priv->terminate = FALSE;
+	CdnObject *obj;
 
-	if (!integrator->priv->state)
-	{
-		return;
-	}
+	obj = cdn_variable_get_object (variable);
 
-	/* Only store state if needed (i.e. when there are events) */
-	if (cdn_integrator_state_events (integrator->priv->state))
+	while (obj)
 	{
-		items = cdn_integrator_state_integrated_variables (integrator->priv->state);
-
-		while (items)
+		if (CDN_IS_NODE (obj))
 		{
-			integrator->priv->saved_state =
-				g_slist_prepend (integrator->priv->saved_state,
-				                 saved_state_new (items->data));
+			guint every;
+
+			every = cdn_node_get_integrate_every (CDN_NODE (obj));
 
-			items = g_slist_next (items);
+			if (every != 0)
+			{
+				return every;
+			}
 		}
+
+		obj = CDN_OBJECT (cdn_object_get_parent (obj));
 	}
 
-	items = cdn_integrator_state_operators (integrator->priv->state);
+	return 1;
+}
 
-	while (items)
-	{
-		cdn_operator_initialize_integrate (items->data, integrator);
-		items = g_slist_next (items);
-	}
+static gint
+compare_rate_groups (RateGroup const *a,
+                     RateGroup const *b)
+{
+	/* Slowest first */
+	return a->every > b->every ? -1 : (a->every < b->every ? 1 : 0);
 }
 
-static gboolean
-ensure_compiled (CdnIntegrator  *integrator,
-                 GError        **err)
+static RateGroup *
+find_rate_group (CdnIntegrator *integrator,
+                 guint          every)
 {
-	CdnObject *object = cdn_integrator_state_get_object (integrator->priv->state);
+	GSList *item;
+	RateGroup *ret;
 
-	if (!cdn_object_is_compiled (object))
+	for (item = integrator->priv->rate_groups; item; item = g_slist_next (item))
 	{
-		CdnCompileError *error = cdn_compile_error_new ();
-		gboolean ret = cdn_object_compile (object, NULL, error);
+		ret = item->data;
 
-		if (!ret && err)
+		if (ret->every == every)
 		{
-			*err = g_error_copy (cdn_compile_error_get_error (error));
+			return ret;
 		}
+	}
 
-		g_object_unref (error);
+	ret = g_slice_new0 (RateGroup);
+	ret->every = every;
 
-		return ret;
-	}
+	integrator->priv->rate_groups =
+		g_slist_prepend (integrator->priv->rate_groups, ret);
 
-	return TRUE;
+	return ret;
 }
 
 static void
-cdn_integrator_class_init (CdnIntegratorClass *klass)
+update_rate_groups (CdnIntegrator *integrator)
 {
-	GObjectClass *object_class = G_OBJECT_CLASS (klass);
+	GSList const *actions;
+	GSList *slow = NULL;
+	GSList *item;
 
-	object_class->constructor = cdn_integrator_constructor;
-	object_class->finalize = cdn_integrator_finalize;
-	object_class->dispose = cdn_integrator_dispose;
+	clear_rate_groups (integrator);
 
-	object_class->set_property = cdn_integrator_set_property;
-	object_class->get_property = cdn_integrator_get_property;
+	actions = cdn_integrator_state_integrated_edge_actions (integrator->priv->state);
 
-	klass->run = cdn_integrator_run_impl;
-	klass->step = cdn_integrator_step_impl;
-	klass->reset = cdn_integrator_reset_impl;
+	for (; actions; actions = g_slist_next (actions))
+	{
+		CdnVariable *target;
+		RateVariable *rv;
+		guint every;
 
-	/**
-	 * CdnIntegrator:object:
-	 *
-	 * The object to integrate
-	 *
-	 **/
-	g_object_class_install_property (object_class,
-	                                 PROP_OBJECT,
-	                                 g_param_spec_object ("object",
-	                                                      "Object",
-	                                                      "Object",
-	                                                      CDN_TYPE_OBJECT,
-	                                                      G_PARAM_READWRITE));
+		target = cdn_edge_action_get_target_variable (actions->data);
+		every = target ? integrate_every (target) : 1;
 
-	/**
-	 * CdnIntegrator:time:
+		if (every <= 1)
+		{
+			continue;
+		}
+
+		if (!integrator->priv->rate_actions)
+		{
+			integrator->priv->rate_actions =
+				g_hash_table_new (g_direct_hash, g_direct_equal);
+
+			integrator->priv->rate_variables =
+				g_hash_table_new_full (g_direct_hash,
+				                       g_direct_equal,
+				                       NULL,
+				                       (GDestroyNotify)rate_variable_free);
+		}
+
+		rv = g_hash_table_lookup (integrator->priv->rate_variables, target);
+
+		if (!rv)
+		{
+			rv = g_slice_new0 (RateVariable);
+			rv->group = find_rate_group (integrator, every);
+
+			rv->group->variables = g_slist_prepend (rv->group->variables,
+			                                        target);
+
+			g_hash_table_insert (integrator->priv->rate_variables,
+			                     target,
+			                     rv);
+		}
+
+		g_hash_table_insert (integrator->priv->rate_actions,
+		                     actions->data,
+		                     rv);
+
+		slow = g_slist_prepend (slow, actions->data);
+	}
+
+	integrator->priv->rate_groups =
+		g_slist_sort (integrator->priv->rate_groups,
+		              (GCompareFunc)compare_rate_groups);
+
+	for (item = integrator->priv->rate_groups; item; item = g_slist_next (item))
+	{
+		RateGroup *group = item->data;
+		GSList *variable;
+		gdouble *slope;
+
+		for (variable = group->variables; variable; variable = g_slist_next (variable))
+		{
+			RateVariable *rv;
+			CdnDimension dim;
+
+			rv = g_hash_table_lookup (integrator->priv->rate_variables,
+			                          variable->data);
+
+			cdn_variable_get_dimension (variable->data, &dim);
+
+			rv->size = cdn_dimension_size (&dim);
+			group->size += rv->size;
+		}
+
+		group->start = g_new0 (gdouble, group->size);
+		group->slope = g_new0 (gdouble, group->size);
+
+		slope = group->slope;
+
+		for (variable = group->variables; variable; variable = g_slist_next (variable))
+		{
+			RateVariable *rv;
+
+			rv = g_hash_table_lookup (integrator->priv->rate_variables,
+			                          variable->data);
+
+			rv->slope = slope;
+			slope += rv->size;
+		}
+	}
+
+	if (integrator->priv->rate_groups)
+	{
+		guint size;
+
+		size = cdn_integrator_state_integrated_size (integrator->priv->state);
+		integrator->priv->rate_state = g_new0 (gdouble, MAX (size, 1));
+	}
+
+	// The slow equations are not needed in most evaluations
+	slow = g_slist_reverse (slow);
+	cdn_integrator_state_set_slow_edge_actions (integrator->priv->state, slow);
+	g_slist_free (slow);
+}
+
+static void
+reset_rate_groups (CdnIntegrator *integrator)
+{
+	GSList *item;
+
+	integrator->priv->step_count = 0;
+
+	for (item = integrator->priv->rate_groups; item; item = g_slist_next (item))
+	{
+		((RateGroup *)item->data)->active = FALSE;
+	}
+}
+
+static void
+cdn_integrator_reset_impl (CdnIntegrator *integrator)
+{
+	GSList const *items;
+
+	g_free (integrator->priv->saved_state);
+	integrator->priv->saved_state = NULL;
+
+	g_free (integrator->priv->dense_state);
+	integrator->priv->dense_state = NULL;
+
+	integrator->priv->terminate = FALSE;
+
+	clear_dormant_events (integrator);
+
+	if (!integrator->priv->state)
+	{
+		return;
+	}
+
+	/* Only store state if needed (i.e. when there are events) */
+	if (cdn_integrator_state_events (integrator->priv->state))
+	{
+		guint size;
+
+		size = cdn_integrator_state_integrated_size (integrator->priv->state);
+		integrator->priv->saved_state = g_new0 (gdouble, MAX (size, 1));
+
+		if (CDN_INTEGRATOR_GET_CLASS (integrator)->interpolate)
+		{
+			integrator->priv->dense_state = g_new0 (gdouble, MAX (size, 1));
+		}
+	}
+
+	items = cdn_integrator_state_operators (integrator->priv->state);
+
+	while (items)
+	{
+		cdn_operator_initialize_integrate (items->data, integrator);
+		items = g_slist_next (items);
+	}
+
+	update_rate_groups (integrator);
+}
+
+static gboolean
+ensure_compiled (CdnIntegrator  *integrator,
+                 GError        **err)
+{
+	CdnObject *object = cdn_integrator_state_get_object (integrator->priv->state);
+
+	if (!cdn_object_is_compiled (object))
+	{
+		CdnCompileError *error = cdn_compile_error_new ();
+		gboolean ret = cdn_object_compile (object, NULL, error);
+
+		if (!ret && err)
+		{
+			*err = g_error_copy (cdn_compile_error_get_error (error));
+		}
+
+		g_object_unref (error);
+
+		return ret;
+	}
+
+	return TRUE;
+}
+
+static void
+cdn_integrator_class_init (CdnIntegratorClass *klass)
+{
+	GObjectClass *object_class = G_OBJECT_CLASS (klass);
+
+	object_class->constructor = cdn_integrator_constructor;
+	object_class->finalize = cdn_integrator_finalize;
+	object_class->dispose = cdn_integrator_dispose;
+
+	object_class->set_property = cdn_integrator_set_property;
+	object_class->get_property = cdn_integrator_get_property;
+
+	klass->run = cdn_integrator_run_impl;
+	klass->step = cdn_integrator_step_impl;
+	klass->reset = cdn_integrator_reset_impl;
+
+	/**
+	 * CdnIntegrator:object:
+	 *
+	 * The object to integrate
+	 *
+	 **/
+	g_object_class_install_property (object_class,
+	                                 PROP_OBJECT,
+	                                 g_param_spec_object ("object",
+	                                                      "Object",
+	                                                      "Object",
+	                                                      CDN_TYPE_OBJECT,
+	                                                      G_PARAM_READWRITE));
+
+	/**
+	 * CdnIntegrator:time:
 	 *
 	 * The current simulated time
 	 *
@@ -937,6 +2006,84 @@ cdn_integrator_class_init (CdnIntegratorClass *klass)
 	                                                      G_PARAM_READWRITE |
 	                                                      G_PARAM_STATIC_STRINGS |
 	                                                      G_PARAM_CONSTRUCT));
+
+	/**
+	 * CdnIntegrator:event-tolerance:
+	 *
+	 * The tolerance (in time) with which the time of an event within a
+	 * step is located.
+	 *
+	 **/
+	g_object_class_install_property (object_class,
+	                                 PROP_EVENT_TOLERANCE,
+	                                 g_param_spec_double ("event-tolerance",
+	                                                      "Event Tolerance",
+	                                                      "Event tolerance",
+	                                                      G_MINDOUBLE,
+	                                                      G_MAXDOUBLE,
+	                                                      1e-9,
+	                                                      G_PARAM_READWRITE |
+	                                                      G_PARAM_STATIC_STRINGS |
+	                                                      G_PARAM_CONSTRUCT));
+
+	/**
+	 * CdnIntegrator:real-time-priority:
+	 *
+	 * The SCHED_FIFO priority with which to integrate when running in
+	 * real-time. The special value 0 keeps the default scheduling.
+	 *
+	 **/
+	g_object_class_install_property (object_class,
+	                                 PROP_REAL_TIME_PRIORITY,
+	                                 g_param_spec_int ("real-time-priority",
+	                                                   "Real Time Priority",
+	                                                   "Real time priority",
+	                                                   0,
+	                                                   99,
+	                                                   0,
+	                                                   G_PARAM_READWRITE |
+	                                                   G_PARAM_STATIC_STRINGS |
+	                                                   G_PARAM_CONSTRUCT));
+
+	/**
+	 * CdnIntegrator:real-time-cpu:
+	 *
+	 * The cpu to which to pin the integration when running in real-time.
+	 * The special value -1 keeps the default cpu affinity.
+	 *
+	 **/
+	g_object_class_install_property (object_class,
+	                                 PROP_REAL_TIME_CPU,
+	                                 g_param_spec_int ("real-time-cpu",
+	                                                   "Real Time Cpu",
+	                                                   "Real time cpu",
+	                                                   -1,
+	                                                   G_MAXINT,
+	                                                   -1,
+	                                                   G_PARAM_READWRITE |
+	                                                   G_PARAM_STATIC_STRINGS |
+	                                                   G_PARAM_CONSTRUCT));
+
+	/**
+	 * CdnIntegrator:event-screening:
+	 *
+	 * The safety factor with which the horizons of events are divided
+	 * when screening events (see #cdn_event_horizon). Events are not
+	 * checked until their screened horizon has passed. The special value 0
+	 * disables event screening.
+	 *
+	 **/
+	g_object_class_install_property (object_class,
+	                                 PROP_EVENT_SCREENING,
+	                                 g_param_spec_double ("event-screening",
+	                                                      "Event Screening",
+	                                                      "Event screening",
+	                                                      0,
+	                                                      G_MAXDOUBLE,
+	                                                      0,
+	                                                      G_PARAM_READWRITE |
+	                                                      G_PARAM_STATIC_STRINGS |
+	                                                      G_PARAM_CONSTRUCT));
 }
 
 static void
@@ -956,7 +2103,7 @@ cdn_integrator_init (CdnIntegrator *self)
 
 	cdn_object_add_variable (CDN_OBJECT (self), self->priv->property_timestep, NULL);
 
-	self->priv->step_timer = g_timer_new ();
+	real_time_anchor (self);
 }
 
 static void
@@ -977,6 +2124,46 @@ sum_values (gdouble       *values,
 	}
 }
 
+/* Whether an integrated edge action is held in the current evaluation. The
+ * actions of slow nodes are only evaluated while their group integrates its
+ * interval, during which the faster variables are held. In all other
+ * evaluations, slow variables change at the constant rate of their
+ * interval, such that every stage of the integrator sees them linearly
+ * interpolated between the ends of the interval. */
+static gboolean
+rate_holds_action (CdnIntegrator *integrator,
+                   CdnEdgeAction *action,
+                   CdnVariable   *target,
+                   guint64        stamp)
+{
+	RateVariable *rv;
+
+	rv = g_hash_table_lookup (integrator->priv->rate_actions, action);
+
+	if (!rv)
+	{
+		return integrator->priv->rate_step != NULL;
+	}
+
+	if (rv->group == integrator->priv->rate_step)
+	{
+		return FALSE;
+	}
+
+	// Add the rate once, for all the actions on the variable
+	if (rv->stamp != stamp && rv->group->active)
+	{
+		rv->stamp = stamp;
+
+		sum_values (cdn_matrix_get_memory (cdn_variable_get_update (target)),
+		            rv->slope,
+		            NULL,
+		            rv->size);
+	}
+
+	return TRUE;
+}
+
 /**
  * cdn_integrator_simulation_step_integrate:
  * @integrator: A #CdnIntegrator
@@ -989,9 +2176,25 @@ void
 cdn_integrator_simulation_step_integrate (CdnIntegrator *integrator,
                                           GSList const  *actions)
 {
+	guint64 stamp = 0;
+
 	if (!actions)
 	{
 		actions = cdn_integrator_state_phase_integrated_edge_actions (integrator->priv->state);
+
+		// Compute the independent equations up front when evaluating in
+		// parallel. The sum below then only reads their cached values.
+		// The plan does not cover the slow equations, which are simply
+		// evaluated in place when their group integrates its interval.
+		if (!integrator->priv->rate_step)
+		{
+			cdn_integrator_state_evaluate_parallel (integrator->priv->state);
+		}
+	}
+
+	if (integrator->priv->rate_actions)
+	{
+		stamp = ++integrator->priv->rate_stamp;
 	}
 
 	while (actions)
@@ -1002,7 +2205,8 @@ cdn_integrator_simulation_step_integrate (CdnIntegrator *integrator,
 		action = actions->data;
 		target = cdn_edge_action_get_target_variable (action);
 
-		if (target != NULL)
+		if (target != NULL &&
+		    !(stamp && rate_holds_action (integrator, action, target, stamp)))
 		{
 			CdnExpression *expr;
 			CdnMatrix *update;
@@ -1042,6 +2246,9 @@ simulation_step (CdnIntegrator *integrator)
 		integrated = g_slist_next (integrated);
 	}
 
+	// Compute all the values up front when using fused evaluation
+	cdn_integrator_state_evaluate_fused (integrator->priv->state);
+
 	cdn_integrator_simulation_step_integrate (integrator, NULL);
 }
 
@@ -1164,10 +2371,21 @@ cdn_integrator_begin (CdnIntegrator  *integrator,
 
 	integrator->priv->terminate = FALSE;
 
+	reset_rate_groups (integrator);
+
+	clear_dormant_events (integrator);
+	integrator->priv->skipped_event_evaluations = 0;
+
 	// Generate set of next random values
 	prepare_next_step (integrator, start, 0, FALSE);
 
-	g_timer_reset (integrator->priv->step_timer);
+	if (integrator->priv->real_time > 0)
+	{
+		real_time_acquire (integrator);
+	}
+
+	cdn_integrator_reset_real_time_stats (integrator);
+	real_time_anchor (integrator);
 
 	g_signal_emit (integrator,
 	               integrator_signals[BEGIN],
@@ -1202,6 +2420,8 @@ cdn_integrator_end (CdnIntegrator  *integrator,
 	                  cdn_io_finalize_finish,
 	                  error);
 
+	real_time_release (integrator);
+
 	g_signal_emit (integrator, integrator_signals[END], 0);
 
 	cdn_debug_message (DEBUG_INTEGRATOR, "End");
@@ -1252,62 +2472,155 @@ cdn_integrator_run (CdnIntegrator  *integrator,
 }
 
 /**
- * cdn_integrator_step:
+ * cdn_integrator_warm_up:
  * @integrator: A #CdnIntegrator
- * @t: The time at which to perform the integration step
- * @timestep: The timestep with which to perform the integration step
+ * @from: The time at which to start the warm-up
+ * @timestep: The timestep to use for integration
+ * @to: The time until which to warm up at most
+ * @until: (allow-none): A compiled #CdnExpression or %NULL
  *
- * Perform a single integration step. Use #cdn_integrator_run if you want to
- * run the integration for a period of time.
+ * Integrate the object without recording anything, to discard the initial
+ * transient of a simulation. This integrates from @from until @to, or until
+ * @until evaluates to a non-zero value (checked before every step). While
+ * warming up, the ::step signal is not emitted (so monitors do not record),
+ * io is not updated and the integrator does not run in real time. This
+ * should be called after #cdn_integrator_begin, and the simulation can then
+ * be continued from the returned time.
  *
- * Returns: The real time step with which the integration was performed
+ * Returns: the time at which the warm-up ended
  *
  **/
 gdouble
-cdn_integrator_step (CdnIntegrator *integrator,
-                     gdouble        t,
-                     gdouble        timestep)
+cdn_integrator_warm_up (CdnIntegrator *integrator,
+                        gdouble        from,
+                        gdouble        timestep,
+                        gdouble        to,
+                        CdnExpression *until)
 {
-	g_return_val_if_fail (CDN_IS_INTEGRATOR (integrator), 0);
+	CdnIntegratorStepFunc step_func;
+	GSList const *io;
+
+	g_return_val_if_fail (CDN_IS_INTEGRATOR (integrator), from);
+	g_return_val_if_fail (until == NULL || CDN_IS_EXPRESSION (until), from);
+
+	step_func = CDN_INTEGRATOR_GET_CLASS (integrator)->step;
+
+	if (!step_func)
+	{
+		return from;
+	}
 
 	if (timestep == 0)
 	{
 		timestep = integrator->priv->default_timestep;
 	}
 
-	return CDN_INTEGRATOR_GET_CLASS (integrator)->step (integrator, t, timestep);
-}
+	integrator->priv->warming_up = TRUE;
 
-/**
- * cdn_integrator_get_object:
- * @integrator: A #CdnIntegrator
- *
- * Get the object associated with the integrator.
- *
- * Returns: (transfer none): A #CdnObject
- *
- **/
-CdnObject *
-cdn_integrator_get_object (CdnIntegrator *integrator)
-{
-	g_return_val_if_fail (CDN_IS_INTEGRATOR (integrator), NULL);
+	while (from < to)
+	{
+		gdouble realstep;
 
-	return integrator->priv->object;
-}
+		if (until)
+		{
+			cdn_expression_reset_cache (until);
 
-/**
- * cdn_integrator_evaluate:
- * @integrator: A #CdnIntegrator
- * @t: The time at which to evaluate the object
- * @timestep: The timestep with which the current step is evaluating
- *
- * Evaluate the system of equations comprising the object. This is a utility
- * function for integrator implementations. Call this function to calculate
- * all the states. After this function completes, the update values for the
- * states can be found (@see #cdn_integrator_state_get_update)
- *
- **/
-void
+			if (cdn_expression_evaluate (until) != 0)
+			{
+				break;
+			}
+		}
+
+		if (to - from < timestep)
+		{
+			timestep = to - from;
+		}
+
+		realstep = integrate_step (integrator, step_func, from, timestep);
+		from += realstep;
+
+		if (realstep <= 0 || integrator->priv->terminate)
+		{
+			break;
+		}
+	}
+
+	integrator->priv->warming_up = FALSE;
+
+	// Bring io up to date with the state at which recording starts
+	io = cdn_integrator_state_io (integrator->priv->state);
+
+	while (io)
+	{
+		cdn_io_update (CDN_IO (io->data), integrator);
+		io = g_slist_next (io);
+	}
+
+	real_time_anchor (integrator);
+
+	return from;
+}
+
+/**
+ * cdn_integrator_step:
+ * @integrator: A #CdnIntegrator
+ * @t: The time at which to perform the integration step
+ * @timestep: The timestep with which to perform the integration step
+ *
+ * Perform a single integration step. Use #cdn_integrator_run if you want to
+ * run the integration for a period of time.
+ *
+ * Returns: The real time step with which the integration was performed
+ *
+ **/
+gdouble
+cdn_integrator_step (CdnIntegrator *integrator,
+                     gdouble        t,
+                     gdouble        timestep)
+{
+	g_return_val_if_fail (CDN_IS_INTEGRATOR (integrator), 0);
+
+	if (timestep == 0)
+	{
+		timestep = integrator->priv->default_timestep;
+	}
+
+	return integrate_step (integrator,
+	                       CDN_INTEGRATOR_GET_CLASS (integrator)->step,
+	                       t,
+	                       timestep);
+}
+
+/**
+ * cdn_integrator_get_object:
+ * @integrator: A #CdnIntegrator
+ *
+ * Get the object associated with the integrator.
+ *
+ * Returns: (transfer none): A #CdnObject
+ *
+ **/
+CdnObject *
+cdn_integrator_get_object (CdnIntegrator *integrator)
+{
+	g_return_val_if_fail (CDN_IS_INTEGRATOR (integrator), NULL);
+
+	return integrator->priv->object;
+}
+
+/**
+ * cdn_integrator_evaluate:
+ * @integrator: A #CdnIntegrator
+ * @t: The time at which to evaluate the object
+ * @timestep: The timestep with which the current step is evaluating
+ *
+ * Evaluate the system of equations comprising the object. This is a utility
+ * function for integrator implementations. Call this function to calculate
+ * all the states. After this function completes, the update values for the
+ * states can be found (@see #cdn_integrator_state_get_update)
+ *
+ **/
+void
 cdn_integrator_evaluate (CdnIntegrator *integrator,
                          gdouble        t,
                          gdouble        timestep)
@@ -1351,6 +2664,27 @@ cdn_integrator_step_prepare (CdnIntegrator *integrator,
 	return TRUE;
 }
 
+/**
+ * cdn_integrator_get_integrate_every:
+ * @integrator: A #CdnIntegrator
+ *
+ * Get the number of timesteps covered by the step which is currently being
+ * integrated. The integrated variables of nodes which integrate every n
+ * steps (see #cdn_node_set_integrate_every) are integrated over n timesteps
+ * at once, at the start of each interval. This can be used by integrator
+ * implementations which keep a history of previous steps, since that
+ * history does not apply to such a step.
+ *
+ * Returns: n while integrating the interval of slow nodes, 1 otherwise
+ *
+ */
+guint
+cdn_integrator_get_integrate_every (CdnIntegrator *integrator)
+{
+	/* Omit type check to increase speed */
+	return integrator->priv->rate_step ? integrator->priv->rate_step->every : 1;
+}
+
 /**
  * cdn_integrator_get_time:
  * @integrator: A #CdnIntegrator
@@ -1478,6 +2812,11 @@ cdn_integrator_set_state (CdnIntegrator      *integrator,
  * sleep to pause the integration if needed. Note that this can only make your
  * network integrate slower, not faster.
  *
+ * Steps are scheduled against absolute deadlines on the monotonic clock. A
+ * step which finishes after its deadline is counted as an overrun (see
+ * #cdn_integrator_get_real_time_stats) and the next deadline is then taken
+ * relative to the end of that step.
+ *
  **/
 void
 cdn_integrator_set_real_time (CdnIntegrator *integrator,
@@ -1508,6 +2847,180 @@ cdn_integrator_get_real_time (CdnIntegrator *integrator)
 	return integrator->priv->real_time;
 }
 
+/**
+ * cdn_integrator_set_real_time_priority:
+ * @integrator: a #CdnIntegrator.
+ * @priority: the SCHED_FIFO priority.
+ *
+ * Set the SCHED_FIFO priority of the integrating thread while running in
+ * real-time. The priority is applied when the integration begins and the
+ * previous scheduling is restored when it ends. Set @priority to 0 to keep
+ * the default scheduling.
+ *
+ **/
+void
+cdn_integrator_set_real_time_priority (CdnIntegrator *integrator,
+                                       gint           priority)
+{
+	g_return_if_fail (CDN_IS_INTEGRATOR (integrator));
+	g_return_if_fail (priority >= 0);
+
+	g_object_set (integrator, "real-time-priority", priority, NULL);
+}
+
+/**
+ * cdn_integrator_get_real_time_priority:
+ * @integrator: a #CdnIntegrator.
+ *
+ * Get the SCHED_FIFO priority of the integrating thread while running in
+ * real-time.
+ *
+ * Returns: the priority, or 0 for the default scheduling.
+ *
+ **/
+gint
+cdn_integrator_get_real_time_priority (CdnIntegrator *integrator)
+{
+	g_return_val_if_fail (CDN_IS_INTEGRATOR (integrator), 0);
+
+	return integrator->priv->real_time_priority;
+}
+
+/**
+ * cdn_integrator_set_real_time_cpu:
+ * @integrator: a #CdnIntegrator.
+ * @cpu: the cpu.
+ *
+ * Pin the integrating thread to @cpu while running in real-time. The
+ * affinity is applied when the integration begins and restored when it
+ * ends. Set @cpu to -1 to keep the default affinity.
+ *
+ **/
+void
+cdn_integrator_set_real_time_cpu (CdnIntegrator *integrator,
+                                  gint           cpu)
+{
+	g_return_if_fail (CDN_IS_INTEGRATOR (integrator));
+	g_return_if_fail (cpu >= -1);
+
+	g_object_set (integrator, "real-time-cpu", cpu, NULL);
+}
+
+/**
+ * cdn_integrator_get_real_time_cpu:
+ * @integrator: a #CdnIntegrator.
+ *
+ * Get the cpu to which the integrating thread is pinned while running in
+ * real-time.
+ *
+ * Returns: the cpu, or -1 for the default affinity.
+ *
+ **/
+gint
+cdn_integrator_get_real_time_cpu (CdnIntegrator *integrator)
+{
+	g_return_val_if_fail (CDN_IS_INTEGRATOR (integrator), -1);
+
+	return integrator->priv->real_time_cpu;
+}
+
+/**
+ * cdn_integrator_get_real_time_stats:
+ * @integrator: a #CdnIntegrator.
+ * @stats: (out caller-allocates): return location for the statistics.
+ *
+ * Get the timing statistics of the steps made in real-time since the
+ * integration began, or since they were last reset.
+ *
+ **/
+void
+cdn_integrator_get_real_time_stats (CdnIntegrator              *integrator,
+                                    CdnIntegratorRealTimeStats *stats)
+{
+	g_return_if_fail (CDN_IS_INTEGRATOR (integrator));
+	g_return_if_fail (stats != NULL);
+
+	*stats = integrator->priv->rt_stats;
+}
+
+/**
+ * cdn_integrator_reset_real_time_stats:
+ * @integrator: a #CdnIntegrator.
+ *
+ * Reset the real-time timing statistics. This is done automatically when
+ * the integration begins.
+ *
+ **/
+void
+cdn_integrator_reset_real_time_stats (CdnIntegrator *integrator)
+{
+	g_return_if_fail (CDN_IS_INTEGRATOR (integrator));
+
+	memset (&integrator->priv->rt_stats, 0, sizeof (CdnIntegratorRealTimeStats));
+}
+
+/**
+ * cdn_integrator_set_event_screening:
+ * @integrator: a #CdnIntegrator.
+ * @screening: the safety factor.
+ *
+ * Set the safety factor used to screen events. When screening is enabled,
+ * the integrator bounds after each check of an event how long it takes
+ * before the event can happen (see #cdn_event_horizon). The event is not
+ * checked again until this horizon, divided by @screening, has passed. The
+ * horizon holds for the exact solution, the safety factor (at least 1)
+ * covers the error of the numerical solution. Events without such a bound
+ * are checked every step.
+ * Events are never left unchecked for more than 100 steps, and all events
+ * are checked again whenever an event fires. Set @screening to 0 to
+ * disable event screening.
+ *
+ **/
+void
+cdn_integrator_set_event_screening (CdnIntegrator *integrator,
+                                    gdouble        screening)
+{
+	g_return_if_fail (CDN_IS_INTEGRATOR (integrator));
+	g_return_if_fail (screening >= 0);
+
+	g_object_set (integrator, "event-screening", screening, NULL);
+}
+
+/**
+ * cdn_integrator_get_event_screening:
+ * @integrator: a #CdnIntegrator.
+ *
+ * Get the safety factor used to screen events.
+ *
+ * Returns: the safety factor, or 0 if events are not screened.
+ *
+ **/
+gdouble
+cdn_integrator_get_event_screening (CdnIntegrator *integrator)
+{
+	g_return_val_if_fail (CDN_IS_INTEGRATOR (integrator), 0);
+
+	return integrator->priv->event_screening;
+}
+
+/**
+ * cdn_integrator_get_skipped_event_evaluations:
+ * @integrator: a #CdnIntegrator.
+ *
+ * Get the number of event condition evaluations which were skipped by
+ * event screening since the integration began.
+ *
+ * Returns: the number of skipped evaluations.
+ *
+ **/
+guint64
+cdn_integrator_get_skipped_event_evaluations (CdnIntegrator *integrator)
+{
+	g_return_val_if_fail (CDN_IS_INTEGRATOR (integrator), 0);
+
+	return integrator->priv->skipped_event_evaluations;
+}
+
 /**
  * cdn_integrator_get_terminate:
  * @integrator: the #CdnIntegrator
@@ -1559,3 +3072,696 @@ cdn_integrator_set_default_timestep (CdnIntegrator *integrator,
 	integrator->priv->default_timestep = timestep;
 	g_object_notify (G_OBJECT (integrator), "default-timestep");
 }
+
+static GVariant *
+new_double_array (gdouble const *values,
+                  gsize          num)
+{
+	return g_variant_new_fixed_array (G_VARIANT_TYPE_DOUBLE,
+	                                  values,
+	                                  num,
+	                                  sizeof (gdouble));
+}
+
+/* The variables which carry state from one step to the next. These are the
+ * integrated and discrete variables, and the variables set by events. All
+ * other variables are computed from these. */
+static GSList *
+stateful_variables (CdnIntegrator *integrator)
+{
+	GHashTable *seen;
+	GSList *ret = NULL;
+	GSList const *item;
+
+	seen = g_hash_table_new (g_direct_hash, g_direct_equal);
+
+	for (item = cdn_integrator_state_integrated_variables (integrator->priv->state);
+	     item;
+	     item = g_slist_next (item))
+	{
+		g_hash_table_insert (seen, item->data, item->data);
+		ret = g_slist_prepend (ret, item->data);
+	}
+
+	for (item = cdn_integrator_state_discrete_variables (integrator->priv->state);
+	     item;
+	     item = g_slist_next (item))
+	{
+		if (!g_hash_table_lookup (seen, item->data))
+		{
+			g_hash_table_insert (seen, item->data, item->data);
+			ret = g_slist_prepend (ret, item->data);
+		}
+	}
+
+	for (item = cdn_integrator_state_events (integrator->priv->state);
+	     item;
+	     item = g_slist_next (item))
+	{
+		GSList const *sv;
+
+		for (sv = cdn_event_get_set_variables (item->data);
+		     sv;
+		     sv = g_slist_next (sv))
+		{
+			CdnVariable *v;
+
+			v = cdn_event_set_variable_get_variable (sv->data);
+
+			if (!g_hash_table_lookup (seen, v))
+			{
+				g_hash_table_insert (seen, v, v);
+				ret = g_slist_prepend (ret, v);
+			}
+		}
+	}
+
+	g_hash_table_destroy (seen);
+	return g_slist_reverse (ret);
+}
+
+/**
+ * cdn_integrator_save_checkpoint:
+ * @integrator: the #CdnIntegrator
+ *
+ * Save the full dynamic state of the simulation to a compact, versioned
+ * binary checkpoint. Besides the values of the integrated, discrete and
+ * event variables, the checkpoint contains the simulation time, the active
+ * states of the nodes, the histories of operators (such as delayed), the
+ * current random values and any state kept by the integrator itself (such
+ * as the history of the predict-correct integrator). The checkpoint should
+ * be taken in between simulation steps and can be restored on an integrator
+ * of the same type, on the same network, using
+ * #cdn_integrator_restore_checkpoint.
+ *
+ * Returns: (transfer full): a #GBytes
+ *
+ */
+GBytes *
+cdn_integrator_save_checkpoint (CdnIntegrator *integrator)
+{
+	CdnIntegratorClass *klass;
+	GVariantBuilder variables;
+	GVariantBuilder nodes;
+	GVariantBuilder rates;
+	GVariantBuilder operators;
+	GVariantBuilder rands;
+	GVariant *specific = NULL;
+	GVariant *ret;
+	GBytes *bytes;
+	GSList *lst;
+	GSList *item;
+	GSList const *citem;
+	guint i;
+
+	g_return_val_if_fail (CDN_IS_INTEGRATOR (integrator), NULL);
+
+	if (!ensure_compiled (integrator, NULL))
+	{
+		return NULL;
+	}
+
+	g_variant_builder_init (&variables, G_VARIANT_TYPE ("a(sad)"));
+	g_variant_builder_init (&nodes, G_VARIANT_TYPE ("a(ss)"));
+	g_variant_builder_init (&rates, G_VARIANT_TYPE ("a(udad)"));
+	g_variant_builder_init (&operators, G_VARIANT_TYPE ("a(uv)"));
+	g_variant_builder_init (&rands, G_VARIANT_TYPE ("a(axay)"));
+
+	lst = stateful_variables (integrator);
+
+	for (item = lst; item; item = g_slist_next (item))
+	{
+		CdnMatrix const *values;
+		gchar *name;
+
+		values = cdn_variable_get_values (item->data);
+		name = cdn_variable_get_full_name (item->data);
+
+		g_variant_builder_add (&variables,
+		                       "(s@ad)",
+		                       name,
+		                       new_double_array (cdn_matrix_get (values),
+		                                         cdn_matrix_size (values)));
+
+		g_free (name);
+	}
+
+	g_slist_free (lst);
+
+	lst = cdn_integrator_state_phase_nodes (integrator->priv->state);
+
+	for (item = lst; item; item = g_slist_next (item))
+	{
+		gchar const *st;
+		gchar *id;
+
+		st = cdn_node_get_state (item->data);
+
+		if (!st)
+		{
+			continue;
+		}
+
+		id = cdn_object_get_full_id (item->data);
+		g_variant_builder_add (&nodes, "(ss)", id, st);
+		g_free (id);
+	}
+
+	g_slist_free (lst);
+
+	for (lst = integrator->priv->rate_groups, i = 0; lst; lst = g_slist_next (lst), ++i)
+	{
+		RateGroup *group = lst->data;
+
+		if (!group->active)
+		{
+			continue;
+		}
+
+		g_variant_builder_add (&rates,
+		                       "(ud@ad)",
+		                       i,
+		                       group->until,
+		                       new_double_array (group->slope, group->size));
+	}
+
+	citem = cdn_integrator_state_operators (integrator->priv->state);
+
+	for (i = 0; citem; citem = g_slist_next (citem), ++i)
+	{
+		GVariant *st;
+
+		st = cdn_operator_save_state (citem->data);
+
+		if (st)
+		{
+			g_variant_builder_add (&operators, "(uv)", i, st);
+		}
+	}
+
+	citem = cdn_integrator_state_rand_instructions (integrator->priv->state);
+
+	for (; citem; citem = g_slist_next (citem))
+	{
+		g_variant_builder_add_value (&rands,
+		                             cdn_instruction_rand_save_state (citem->data));
+	}
+
+	klass = CDN_INTEGRATOR_GET_CLASS (integrator);
+
+	if (klass->save_state)
+	{
+		specific = klass->save_state (integrator);
+	}
+
+	ret = g_variant_new (CHECKPOINT_FORMAT,
+	                     CHECKPOINT_MAGIC,
+	                     CHECKPOINT_VERSION,
+	                     cdn_integrator_get_class_id (integrator),
+	                     cdn_integrator_get_time (integrator),
+	                     integrator->priv->step_count,
+	                     &variables,
+	                     &nodes,
+	                     &rates,
+	                     &operators,
+	                     &rands,
+	                     specific);
+
+	g_variant_ref_sink (ret);
+
+	/* Checkpoints are always stored in little endian */
+	if (G_BYTE_ORDER == G_BIG_ENDIAN)
+	{
+		GVariant *swapped;
+
+		swapped = g_variant_byteswap (ret);
+		g_variant_unref (ret);
+
+		ret = swapped;
+	}
+
+	bytes = g_variant_get_data_as_bytes (ret);
+	g_variant_unref (ret);
+
+	return bytes;
+}
+
+static gboolean
+checkpoint_error (GError      **error,
+                  gchar const  *format,
+                  ...) G_GNUC_PRINTF (2, 3);
+
+static gboolean
+checkpoint_error (GError      **error,
+                  gchar const  *format,
+                  ...)
+{
+	va_list ap;
+	gchar *msg;
+
+	va_start (ap, format);
+	msg = g_strdup_vprintf (format, ap);
+	va_end (ap);
+
+	g_set_error_literal (error,
+	                     CDN_INTEGRATOR_ERROR,
+	                     CDN_INTEGRATOR_ERROR_CHECKPOINT,
+	                     msg);
+
+	g_free (msg);
+	return FALSE;
+}
+
+static gboolean
+check_checkpoint_variables (GVariant    *variables,
+                            GHashTable  *names,
+                            GError     **error)
+{
+	GVariantIter iter;
+	gchar const *name;
+	GVariant *values;
+
+	g_variant_iter_init (&iter, variables);
+
+	while (g_variant_iter_next (&iter, "(&s@ad)", &name, &values))
+	{
+		CdnVariable *v;
+		gsize num;
+
+		v = g_hash_table_lookup (names, name);
+		num = g_variant_n_children (values);
+		g_variant_unref (values);
+
+		if (!v)
+		{
+			return checkpoint_error (error,
+			                         "The checkpoint contains the unknown variable `%s'",
+			                         name);
+		}
+
+		if (num != (gsize)cdn_matrix_size (cdn_variable_get_values (v)))
+		{
+			return checkpoint_error (error,
+			                         "The checkpoint contains %u values for variable `%s' (expected %d)",
+			                         (guint)num,
+			                         name,
+			                         cdn_matrix_size (cdn_variable_get_values (v)));
+		}
+	}
+
+	return TRUE;
+}
+
+static gboolean
+check_checkpoint_nodes (GVariant    *nodes,
+                        GHashTable  *ids,
+                        GError     **error)
+{
+	GVariantIter iter;
+	gchar const *id;
+
+	g_variant_iter_init (&iter, nodes);
+
+	while (g_variant_iter_next (&iter, "(&s&s)", &id, NULL))
+	{
+		if (!g_hash_table_lookup (ids, id))
+		{
+			return checkpoint_error (error,
+			                         "The checkpoint contains the state of the unknown node `%s'",
+			                         id);
+		}
+	}
+
+	return TRUE;
+}
+
+static gboolean
+check_checkpoint_indices (GVariant     *items,
+                          guint         num,
+                          gchar const  *what,
+                          GError      **error)
+{
+	GVariantIter iter;
+	GVariant *child;
+
+	g_variant_iter_init (&iter, items);
+
+	while ((child = g_variant_iter_next_value (&iter)))
+	{
+		guint idx;
+
+		g_variant_get_child (child, 0, "u", &idx);
+		g_variant_unref (child);
+
+		if (idx >= num)
+		{
+			return checkpoint_error (error,
+			                         "The checkpoint contains the state of an unknown %s",
+			                         what);
+		}
+	}
+
+	return TRUE;
+}
+
+static void
+restore_rate_groups (CdnIntegrator *integrator,
+                     GVariant      *rates)
+{
+	GVariantIter iter;
+	GVariant *values;
+	gdouble until;
+	guint idx;
+
+	g_variant_iter_init (&iter, rates);
+
+	while (g_variant_iter_next (&iter, "(ud@ad)", &idx, &until, &values))
+	{
+		RateGroup *group;
+		gdouble const *vals;
+		gsize num;
+
+		group = g_slist_nth_data (integrator->priv->rate_groups, idx);
+		vals = g_variant_get_fixed_array (values, &num, sizeof (gdouble));
+
+		if (num == group->size)
+		{
+			memcpy (group->slope, vals, sizeof (gdouble) * num);
+
+			group->until = until;
+			group->active = TRUE;
+		}
+
+		g_variant_unref (values);
+	}
+}
+
+/**
+ * cdn_integrator_restore_checkpoint:
+ * @integrator: the #CdnIntegrator
+ * @checkpoint: a #GBytes obtained from #cdn_integrator_save_checkpoint
+ * @error: a #GError or %NULL
+ *
+ * Restore the full dynamic state of the simulation from a checkpoint saved
+ * with #cdn_integrator_save_checkpoint. This should be called after
+ * #cdn_integrator_begin, after which the simulation continues from the time
+ * stored in the checkpoint (see #cdn_integrator_get_time). The checkpoint
+ * is validated against the network before anything is restored. If a
+ * subsequent failure occurs, the simulation state is undefined and should be
+ * reset. Restoring a checkpoint clears the termination of the simulation by
+ * an event (see #cdn_integrator_get_terminate).
+ *
+ * Note that when random instructions do not use streams, the state of the
+ * random number generator itself cannot be restored and only the current
+ * random values are.
+ *
+ * Returns: %TRUE if the checkpoint was restored, %FALSE otherwise
+ *
+ */
+gboolean
+cdn_integrator_restore_checkpoint (CdnIntegrator  *integrator,
+                                   GBytes         *checkpoint,
+                                   GError        **error)
+{
+	CdnIntegratorClass *klass;
+	GVariant *v;
+	gchar const *magic;
+	guint32 version;
+	gchar const *id;
+	gdouble t;
+	guint64 step_count;
+	GVariant *variables;
+	GVariant *nodes;
+	GVariant *rates;
+	GVariant *operators;
+	GVariant *rands;
+	GVariant *specific;
+	GHashTable *names;
+	GHashTable *ids;
+	GSList *lst;
+	GSList *item;
+	GSList const *ops;
+	GSList const *rnd;
+	GVariantIter iter;
+	gchar const *name;
+	gchar const *st;
+	GVariant *values;
+	GVariant *child;
+	gboolean ret = FALSE;
+
+	g_return_val_if_fail (CDN_IS_INTEGRATOR (integrator), FALSE);
+	g_return_val_if_fail (checkpoint != NULL, FALSE);
+
+	if (!ensure_compiled (integrator, error))
+	{
+		return FALSE;
+	}
+
+	v = g_variant_new_from_bytes (G_VARIANT_TYPE (CHECKPOINT_FORMAT),
+	                              checkpoint,
+	                              FALSE);
+
+	g_variant_ref_sink (v);
+
+	if (G_BYTE_ORDER == G_BIG_ENDIAN)
+	{
+		GVariant *swapped;
+
+		swapped = g_variant_byteswap (v);
+		g_variant_unref (v);
+
+		v = swapped;
+	}
+
+	g_variant_get (v,
+	               "(&su&sdt@a(sad)@a(ss)@a(udad)@a(uv)@a(axay)mv)",
+	               &magic,
+	               &version,
+	               &id,
+	               &t,
+	               &step_count,
+	               &variables,
+	               &nodes,
+	               &rates,
+	               &operators,
+	               &rands,
+	               &specific);
+
+	names = g_hash_table_new_full (g_str_hash, g_str_equal, g_free, NULL);
+	ids = g_hash_table_new_full (g_str_hash, g_str_equal, g_free, NULL);
+
+	lst = stateful_variables (integrator);
+
+	for (item = lst; item; item = g_slist_next (item))
+	{
+		g_hash_table_insert (names,
+		                     cdn_variable_get_full_name (item->data),
+		                     item->data);
+	}
+
+	g_slist_free (lst);
+
+	lst = cdn_integrator_state_phase_nodes (integrator->priv->state);
+
+	for (item = lst; item; item = g_slist_next (item))
+	{
+		g_hash_table_insert (ids,
+		                     cdn_object_get_full_id (item->data),
+		                     item->data);
+	}
+
+	g_slist_free (lst);
+
+	ops = cdn_integrator_state_operators (integrator->priv->state);
+	rnd = cdn_integrator_state_rand_instructions (integrator->priv->state);
+	klass = CDN_INTEGRATOR_GET_CLASS (integrator);
+
+	if (g_strcmp0 (magic, CHECKPOINT_MAGIC) != 0)
+	{
+		checkpoint_error (error, "The data is not a codyn checkpoint");
+		goto out;
+	}
+
+	if (version != CHECKPOINT_VERSION)
+	{
+		checkpoint_error (error,
+		                  "Unsupported checkpoint version %u (expected %u)",
+		                  version,
+		                  CHECKPOINT_VERSION);
+		goto out;
+	}
+
+	if (g_strcmp0 (id, cdn_integrator_get_class_id (integrator)) != 0)
+	{
+		checkpoint_error (error,
+		                  "The checkpoint was saved with the `%s' integrator, but the network uses `%s'",
+		                  id,
+		                  cdn_integrator_get_class_id (integrator));
+		goto out;
+	}
+
+	if (!check_checkpoint_variables (variables, names, error) ||
+	    !check_checkpoint_nodes (nodes, ids, error) ||
+	    !check_checkpoint_indices (rates,
+	                               g_slist_length (integrator->priv->rate_groups),
+	                               "rate group",
+	                               error) ||
+	    !check_checkpoint_indices (operators,
+	                               g_slist_length ((GSList *)ops),
+	                               "operator",
+	                               error))
+	{
+		goto out;
+	}
+
+	if (g_variant_n_children (rands) != g_slist_length ((GSList *)rnd))
+	{
+		checkpoint_error (error,
+		                  "The checkpoint contains %u random instructions (expected %u)",
+		                  (guint)g_variant_n_children (rands),
+		                  g_slist_length ((GSList *)rnd));
+		goto out;
+	}
+
+	if ((specific != NULL) != (klass->restore_state != NULL && klass->save_state != NULL))
+	{
+		checkpoint_error (error,
+		                  "The checkpoint does not match the state of the `%s' integrator",
+		                  id);
+		goto out;
+	}
+
+	/* Restore the states of the nodes first, since changing states
+	 * updates the active phaseables */
+	g_variant_iter_init (&iter, nodes);
+
+	while (g_variant_iter_next (&iter, "(&s&s)", &name, &st))
+	{
+		CdnNode *node;
+
+		node = g_hash_table_lookup (ids, name);
+
+		if (g_strcmp0 (cdn_node_get_state (node), st) != 0)
+		{
+			cdn_integrator_state_set_state (integrator->priv->state,
+			                                node,
+			                                st,
+			                                NULL,
+			                                NULL);
+		}
+	}
+
+	g_variant_iter_init (&iter, variables);
+
+	while (g_variant_iter_next (&iter, "(&s@ad)", &name, &values))
+	{
+		CdnVariable *variable;
+		CdnDimension dim;
+		CdnMatrix m;
+		gsize num;
+
+		variable = g_hash_table_lookup (names, name);
+		cdn_variable_get_dimension (variable, &dim);
+
+		m = cdn_matrix_init ((gdouble *)g_variant_get_fixed_array (values,
+		                                                           &num,
+		                                                           sizeof (gdouble)),
+		                     &dim);
+
+		cdn_variable_set_values (variable, &m);
+		g_variant_unref (values);
+	}
+
+	g_variant_iter_init (&iter, operators);
+
+	while ((child = g_variant_iter_next_value (&iter)))
+	{
+		CdnOperator *op;
+		GVariant *opstate;
+		guint idx;
+		gboolean restored;
+
+		g_variant_get (child, "(uv)", &idx, &opstate);
+		g_variant_unref (child);
+
+		op = g_slist_nth_data ((GSList *)ops, idx);
+		restored = cdn_operator_restore_state (op, opstate);
+
+		g_variant_unref (opstate);
+
+		if (!restored)
+		{
+			checkpoint_error (error,
+			                  "Could not restore the state of the operator `%s'",
+			                  cdn_operator_get_name (op));
+			goto out;
+		}
+	}
+
+	g_variant_iter_init (&iter, rands);
+
+	for (; rnd; rnd = g_slist_next (rnd))
+	{
+		gboolean restored;
+
+		child = g_variant_iter_next_value (&iter);
+		restored = cdn_instruction_rand_restore_state (rnd->data, child);
+		g_variant_unref (child);
+
+		if (!restored)
+		{
+			checkpoint_error (error,
+			                  "Could not restore the state of a random instruction");
+			goto out;
+		}
+	}
+
+	restore_rate_groups (integrator, rates);
+	integrator->priv->step_count = step_count;
+
+	cdn_integrator_set_time (integrator, t);
+
+	if (specific && !klass->restore_state (integrator, specific))
+	{
+		checkpoint_error (error,
+		                  "Could not restore the state of the `%s' integrator",
+		                  id);
+		goto out;
+	}
+
+	for (rnd = cdn_integrator_state_rand_expressions (integrator->priv->state);
+	     rnd;
+	     rnd = g_slist_next (rnd))
+	{
+		_cdn_expression_reset_rand_cache (rnd->data);
+	}
+
+	reset_function_cache (integrator);
+
+	integrator->priv->events_handled = FALSE;
+	integrator->priv->terminate = FALSE;
+
+	clear_dormant_events (integrator);
+	update_events (integrator, t, 0);
+
+	ret = TRUE;
+
+out:
+	g_hash_table_destroy (names);
+	g_hash_table_destroy (ids);
+
+	g_variant_unref (variables);
+	g_variant_unref (nodes);
+	g_variant_unref (rates);
+	g_variant_unref (operators);
+	g_variant_unref (rands);
+
+	if (specific)
+	{
+		g_variant_unref (specific);
+	}
+
+	g_variant_unref (v);
+
+	return ret;
+}
@@ -41,6 +41,44 @@ typedef struct _CdnIntegrator        CdnIntegrator;
 typedef struct _CdnIntegratorClass   CdnIntegratorClass;
 typedef struct _CdnIntegratorPrivate CdnIntegratorPrivate;
 
+#define CDN_INTEGRATOR_ERROR (cdn_integrator_error_quark ())
+
+/**
+ * CdnIntegratorError:
+ * @CDN_INTEGRATOR_ERROR_CHECKPOINT: invalid or incompatible checkpoint
+ * @CDN_INTEGRATOR_ERROR_NUM: num
+ *
+ * Integrator error codes.
+ */
+typedef enum
+{
+	CDN_INTEGRATOR_ERROR_CHECKPOINT,
+	CDN_INTEGRATOR_ERROR_NUM
+} CdnIntegratorError;
+
+#define CDN_INTEGRATOR_REAL_TIME_BINS 20
+
+/**
+ * CdnIntegratorRealTimeStats:
+ * @steps: the number of steps made in real-time
+ * @overruns: the number of steps which finished after their deadline
+ * @worst_step: the longest time (in seconds) spent computing a step
+ * @worst_latency: the longest time (in seconds) between a deadline and
+ *                 waking up for it
+ * @histogram: the number of steps per computation time, in bins of a tenth
+ *             of the step period. The last bin also counts all longer steps.
+ *
+ * Timing statistics of integrating in real-time.
+ */
+typedef struct
+{
+	guint64 steps;
+	guint64 overruns;
+	gdouble worst_step;
+	gdouble worst_latency;
+	guint64 histogram[CDN_INTEGRATOR_REAL_TIME_BINS];
+} CdnIntegratorRealTimeStats;
+
 /**
  * CdnIntegrator:
  *
@@ -63,6 +101,11 @@ struct _CdnIntegrator
  * @step: step virtual function
  * @get_name: get_name virtual function
  * @reset: reset virtual function
+ * @save_state: save_state virtual function
+ * @restore_state: restore_state virtual function
+ * @interpolate: interpolate virtual function, fills in the integrated values
+ *               at a time within the last step from the dense output of
+ *               the integrator, if it has any
  * @integrator_id: the integrator id
  *
  * The CdnIntegrator class
@@ -87,12 +130,22 @@ struct _CdnIntegratorClass
 
 	void         (*reset)        (CdnIntegrator *integrator);
 
+	GVariant    *(*save_state)    (CdnIntegrator *integrator);
+	gboolean     (*restore_state) (CdnIntegrator *integrator,
+	                               GVariant      *state);
+
+	gboolean     (*interpolate)   (CdnIntegrator *integrator,
+	                               gdouble        t,
+	                               gdouble       *values);
+
 	/* private field */
 	const gchar *integrator_id;
 };
 
 GType                cdn_integrator_get_type        (void) G_GNUC_CONST;
 
+GQuark               cdn_integrator_error_quark     (void);
+
 CdnIntegratorState  *cdn_integrator_get_state       (CdnIntegrator *integrator);
 void                 cdn_integrator_set_state       (CdnIntegrator *integrator,
                                                      CdnIntegratorState *state);
@@ -114,6 +167,12 @@ gdouble              cdn_integrator_step            (CdnIntegrator *integrator,
                                                      gdouble        t,
                                                      gdouble        timestep);
 
+gdouble              cdn_integrator_warm_up         (CdnIntegrator *integrator,
+                                                     gdouble        from,
+                                                     gdouble        timestep,
+                                                     gdouble        to,
+                                                     CdnExpression *until);
+
 gboolean             cdn_integrator_step_prepare    (CdnIntegrator *integrator,
                                                      gdouble        t,
                                                      gdouble        timestep);
@@ -125,6 +184,8 @@ void                 cdn_integrator_evaluate        (CdnIntegrator *integrator,
 void                 cdn_integrator_simulation_step_integrate (CdnIntegrator *integrator,
                                                                GSList const  *actions);
 
+guint                cdn_integrator_get_integrate_every (CdnIntegrator *integrator);
+
 void                 cdn_integrator_reset           (CdnIntegrator *integrator);
 
 const gchar         *cdn_integrator_get_class_id    (CdnIntegrator *integrator);
@@ -141,12 +202,35 @@ void                 cdn_integrator_set_real_time   (CdnIntegrator *integrator,
 
 gdouble              cdn_integrator_get_real_time   (CdnIntegrator *integrator);
 
+void                 cdn_integrator_set_real_time_priority (CdnIntegrator *integrator,
+                                                            gint           priority);
+gint                 cdn_integrator_get_real_time_priority (CdnIntegrator *integrator);
+
+void                 cdn_integrator_set_real_time_cpu (CdnIntegrator *integrator,
+                                                       gint           cpu);
+gint                 cdn_integrator_get_real_time_cpu (CdnIntegrator *integrator);
+
+void                 cdn_integrator_get_real_time_stats   (CdnIntegrator              *integrator,
+                                                           CdnIntegratorRealTimeStats *stats);
+void                 cdn_integrator_reset_real_time_stats (CdnIntegrator              *integrator);
+
+void                 cdn_integrator_set_event_screening (CdnIntegrator *integrator,
+                                                         gdouble        screening);
+gdouble              cdn_integrator_get_event_screening (CdnIntegrator *integrator);
+
+guint64              cdn_integrator_get_skipped_event_evaluations (CdnIntegrator *integrator);
+
 gboolean             cdn_integrator_get_terminate   (CdnIntegrator *integrator);
 
 gdouble              cdn_integrator_get_default_timestep (CdnIntegrator *integrator);
 void                 cdn_integrator_set_default_timestep (CdnIntegrator *integrator,
                                                           gdouble        timestep);
 
+GBytes              *cdn_integrator_save_checkpoint    (CdnIntegrator  *integrator);
+gboolean             cdn_integrator_restore_checkpoint (CdnIntegrator  *integrator,
+                                                        GBytes         *checkpoint,
+                                                        GError        **error);
+
 G_END_DECLS
 
 #endif /* __CDN_INTEGRATOR_H__ */
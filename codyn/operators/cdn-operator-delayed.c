@@ -33,34 +33,32 @@
 
 #define CDN_OPERATOR_DELAYED_GET_PRIVATE(object)(G_TYPE_INSTANCE_GET_PRIVATE((object), CDN_TYPE_OPERATOR_DELAYED, CdnOperatorDelayedPrivate))
 
-typedef struct _HistoryItem HistoryItem;
-
-struct _HistoryItem
+/* Time ordered ring buffer of samples. Samples older than needed by the
+ * largest delay are released from the front, so the capacity settles at
+ * the largest delay divided by the smallest step. */
+typedef struct
 {
-	HistoryItem *next;
-	HistoryItem *prev;
-
-	gdouble t;
-
+	gdouble *t;
 	gdouble *v;
-};
 
-typedef struct
-{
-	HistoryItem *first;
-	HistoryItem *last;
+	guint capacity;
+	guint start;
 	guint size;
-} HistoryList;
+
+	// number of values per sample
+	guint n;
+} History;
 
 struct _CdnOperatorDelayedPrivate
 {
-	HistoryList history;
-	HistoryList history_pool;
+	History history;
 
 	CdnExpression *expression;
 	CdnExpression *initial_value;
 	CdnExpression *delay_expression;
 
+	CdnOperatorDelayedInterpolation interpolation;
+
 	gdouble last_t;
 	gboolean first_last_t;
 
@@ -82,213 +80,262 @@ enum
 	PROP_INITIAL_VALUE
 };
 
+static inline guint
+history_index (History const *history,
+               guint          i)
+{
+	i += history->start;
+
+	return i >= history->capacity ? i - history->capacity : i;
+}
+
+static inline gdouble
+history_t (History const *history,
+           guint          i)
+{
+	return history->t[history_index (history, i)];
+}
+
+static inline gdouble const *
+history_v (History const *history,
+           guint          i)
+{
+	return history->v + history_index (history, i) * history->n;
+}
+
 static void
-history_remove_slice (HistoryList *history,
-                      HistoryItem *start,
-                      HistoryItem *end,
-                      guint        num)
+history_grow (History *history)
 {
-	if (num == 0)
-	{
-		return;
-	}
+	guint capacity;
+	gdouble *t;
+	gdouble *v;
+	guint i;
 
-	if (start->prev)
-	{
-		start->prev->next = end->next;
-	}
+	capacity = history->capacity ? history->capacity * 2 : 16;
 
-	if (end->next)
-	{
-		end->next->prev = start->prev;
-	}
+	t = g_new (gdouble, capacity);
+	v = g_new (gdouble, capacity * history->n);
 
-	if (history->first == start)
+	// Unwrap the samples to the start of the new buffer
+	for (i = 0; i < history->size; ++i)
 	{
-		history->first = end->next;
-	}
+		t[i] = history_t (history, i);
 
-	if (history->last == end)
-	{
-		history->last = start->prev;
+		memcpy (v + i * history->n,
+		        history_v (history, i),
+		        sizeof (gdouble) * history->n);
 	}
 
-	history->size -= num;
+	g_free (history->t);
+	g_free (history->v);
 
-	start->prev = end->next = NULL;
+	history->t = t;
+	history->v = v;
+	history->capacity = capacity;
+	history->start = 0;
 }
 
 static void
-history_append_slice (HistoryList *history,
-                      HistoryItem *first,
-                      HistoryItem *last,
-                      guint         num)
+history_append (History       *history,
+                gdouble        t,
+                gdouble const *v)
 {
-	if (num == 0)
+	guint idx;
+
+	if (history->size == history->capacity)
 	{
-		return;
+		history_grow (history);
 	}
 
-	first->prev = history->last;
+	idx = history_index (history, history->size);
 
-	if (history->last)
+	history->t[idx] = t;
+	memcpy (history->v + idx * history->n, v, sizeof (gdouble) * history->n);
+
+	++history->size;
+}
+
+/* Index of the last sample before @t, or 0 if there is none. Samples are
+ * usually appended at a fixed step, in which case the index is guessed
+ * directly from the time span of the history. Otherwise, or when the guess
+ * is wrong, the index is found by bisection. */
+static guint
+history_find (History const *history,
+              gdouble        t)
+{
+	gdouble first;
+	gdouble last;
+	guint lo;
+	guint hi;
+
+	if (history->size < 2)
 	{
-		history->last->next = first;
+		return 0;
 	}
 
-	history->last = last;
+	first = history_t (history, 0);
+	last = history_t (history, history->size - 1);
 
-	if (history->first == NULL)
+	if (t > first && last > first)
 	{
-		history->first = first;
+		gdouble guess;
+
+		guess = (t - first) / (last - first) * (history->size - 1);
+
+		if (guess < history->size - 1)
+		{
+			guint i = (guint)guess;
+
+			if (history_t (history, i) < t &&
+			    history_t (history, i + 1) >= t)
+			{
+				return i;
+			}
+		}
 	}
 
-	history->size += num;
-}
+	// Find the first sample at or after t
+	lo = 0;
+	hi = history->size;
 
-static void
-history_concat (HistoryList *l1,
-                HistoryList *l2)
-{
-	history_append_slice (l1, l2->first, l2->last, l2->size);
+	while (lo < hi)
+	{
+		guint mid = lo + (hi - lo) / 2;
+
+		if (history_t (history, mid) < t)
+		{
+			lo = mid + 1;
+		}
+		else
+		{
+			hi = mid;
+		}
+	}
 
-	l2->first = NULL;
-	l2->last = NULL;
-	l2->size = 0;
+	return lo > 0 ? lo - 1 : 0;
 }
 
+/* Release samples which are no longer needed to look up @fromt, keeping
+ * the last sample before @fromt to interpolate from and @keep samples
+ * before that */
 static void
-history_to_pool (CdnOperatorDelayed *operator,
-                 gdouble             fromt)
+history_release (History *history,
+                 gdouble  fromt,
+                 guint    keep)
 {
-	HistoryItem *item;
-	guint num = 0;
-	HistoryItem *first;
-
-	item = operator->priv->history.first;
+	guint num;
 
-	if (!item || item->t >= fromt)
+	if (history->size == 0 || history_t (history, 0) >= fromt)
 	{
 		return;
 	}
 
-	while (item->next && item->next->t < fromt)
-	{
-		item = item->next;
-		++num;
-	}
-
-	item = item->prev;
+	num = history_find (history, fromt);
 
-	if (num == 0 || !item)
+	if (num <= keep)
 	{
 		return;
 	}
 
-	first = operator->priv->history.first;
-
-	history_remove_slice (&operator->priv->history,
-	                      first,
-	                      item,
-	                      num);
+	num -= keep;
 
-	history_append_slice (&operator->priv->history_pool,
-	                      first,
-	                      item,
-	                      num);
+	history->start = history_index (history, num);
+	history->size -= num;
 }
 
 static void
-history_reset (CdnOperatorDelayed *operator)
+history_reset (History *history)
 {
-	history_concat (&operator->priv->history_pool,
-	                &operator->priv->history);
+	history->start = 0;
+	history->size = 0;
 }
 
-static HistoryItem *
-pool_to_history (CdnOperatorDelayed  *operator,
-                 gint                 num)
+static void
+history_free (History *history)
 {
-	HistoryItem *ret;
+	g_free (history->t);
+	g_free (history->v);
 
-	if (num == 0)
-	{
-		return NULL;
-	}
+	history->t = NULL;
+	history->v = NULL;
+	history->capacity = 0;
 
-	ret = operator->priv->history_pool.first;
+	history_reset (history);
+}
 
-	// Remove from the pool
-	if (num >= operator->priv->history_pool.size)
-	{
-		gint i;
-		gint n;
+/* Slope at sample @i from its neighbours, one sided at the ends */
+static gdouble
+history_slope (History const *history,
+               guint          i,
+               guint          k)
+{
+	guint i0 = i > 0 ? i - 1 : i;
+	guint i1 = i + 1 < history->size ? i + 1 : i;
 
-		HistoryItem *slice_start = NULL;
-		HistoryItem *slice_end = NULL;
+	if (i0 == i1)
+	{
+		return 0;
+	}
 
-		n = num - operator->priv->history_pool.size;
+	return (history_v (history, i1)[k] - history_v (history, i0)[k]) /
+	       (history_t (history, i1) - history_t (history, i0));
+}
 
-		history_concat (&operator->priv->history,
-		                &operator->priv->history_pool);
+static void
+push_interpolated (CdnOperatorDelayed *d,
+                   guint               i,
+                   gdouble             td,
+                   CdnStack           *stack)
+{
+	History const *history = &d->priv->history;
+	gdouble const *v0;
+	gdouble const *v1;
+	gdouble t0;
+	gdouble dt;
+	gdouble s;
+	guint k;
 
-		for (i = 0; i < n; ++i)
-		{
-			HistoryItem *h;
+	t0 = history_t (history, i);
+	dt = history_t (history, i + 1) - t0;
 
-			h = g_slice_new0 (HistoryItem);
+	v0 = history_v (history, i);
+	v1 = history_v (history, i + 1);
 
-			if (slice_start == NULL)
-			{
-				slice_start = slice_end = h;
-			}
-			else
-			{
-				h->prev = slice_end;
-				slice_end->next = h;
-
-				slice_end = h;
-			}
-		}
+	if (fabs (td - t0) < 1e-13)
+	{
+		s = 0;
+	}
+	else
+	{
+		s = (td - t0) / dt;
+	}
 
-		if (!ret)
+	if (d->priv->interpolation == CDN_OPERATOR_DELAYED_INTERPOLATION_LINEAR)
+	{
+		for (k = 0; k < history->n; ++k)
 		{
-			ret = slice_start;
+			cdn_stack_push (stack, v0[k] + s * (v1[k] - v0[k]));
 		}
-
-		history_append_slice (&operator->priv->history,
-		                      slice_start,
-		                      slice_end,
-		                      n);
 	}
 	else
 	{
-		// Remove first num from pool
-		HistoryItem *ptr = ret;
-		gint i;
+		gdouble s2 = s * s;
+		gdouble s3 = s2 * s;
 
-		for (i = 0; i < num - 1; ++i)
+		gdouble h00 = 2 * s3 - 3 * s2 + 1;
+		gdouble h10 = s3 - 2 * s2 + s;
+		gdouble h01 = -2 * s3 + 3 * s2;
+		gdouble h11 = s3 - s2;
+
+		for (k = 0; k < history->n; ++k)
 		{
-			ptr = ptr->next;
+			cdn_stack_push (stack,
+			                h00 * v0[k] +
+			                h10 * dt * history_slope (history, i, k) +
+			                h01 * v1[k] +
+			                h11 * dt * history_slope (history, i + 1, k));
 		}
-
-		history_remove_slice (&operator->priv->history_pool,
-		                      ret,
-		                      ptr,
-		                      num);
-
-		history_append_slice (&operator->priv->history,
-		                      ret,
-		                      ptr,
-		                      num);
-	}
-
-	if (!ret)
-	{
-		ret = operator->priv->history.first;
 	}
-
-	return ret;
 }
 
 static gchar *
@@ -330,12 +377,12 @@ cdn_operator_delayed_initialize (CdnOperator   *op,
 		llen = g_slist_length ((GSList *)expressions[0]);
 	}
 
-	if (num_expressions != 1 || llen > 2)
+	if (num_expressions != 1 || llen > 3)
 	{
 		g_set_error (error,
 		             CDN_NETWORK_LOAD_ERROR,
 		             CDN_NETWORK_LOAD_ERROR_OPERATOR,
-		             "The operator `delayed' expects one or two "
+		             "The operator `delayed' expects one to three "
 		             "expressions, but got %d",
 		             llen);
 
@@ -397,8 +444,33 @@ cdn_operator_delayed_initialize (CdnOperator   *op,
 
 			return FALSE;
 		}
+
+		if (expressions[0]->next->next)
+		{
+			gint order;
+
+			order = (gint)(cdn_expression_evaluate (expressions[0]->next->next->data) + 0.5);
+
+			if (order == 3)
+			{
+				delayed->priv->interpolation = CDN_OPERATOR_DELAYED_INTERPOLATION_CUBIC;
+			}
+			else if (order != 1)
+			{
+				g_set_error (error,
+				             CDN_NETWORK_LOAD_ERROR,
+				             CDN_NETWORK_LOAD_ERROR_OPERATOR,
+				             "The operator `delayed' supports linear (1) "
+				             "or cubic (3) interpolation (got %d)",
+				             order);
+
+				return FALSE;
+			}
+		}
 	}
 
+	delayed->priv->history.n = cdn_stack_arg_size (&delayed->priv->smanip.push);
+
 	cdn_stack_args_copy (&delayed->priv->smanip.pop, argdim);
 	return TRUE;
 }
@@ -439,10 +511,11 @@ cdn_operator_delayed_execute (CdnOperator     *op,
                               CdnStack        *stack)
 {
 	CdnOperatorDelayed *d;
+	History *history;
 	gdouble td;
-	HistoryItem *h;
 	gdouble delay;
 	gdouble t;
+	guint i;
 
 	d = (CdnOperatorDelayed *)op;
 
@@ -475,9 +548,9 @@ cdn_operator_delayed_execute (CdnOperator     *op,
 		d->priv->first_last_t = FALSE;
 	}
 
-	h = d->priv->history.first;
+	history = &d->priv->history;
 
-	if (!h || h->t > td)
+	if (history->size == 0 || history_t (history, 0) > td)
 	{
 		if (d->priv->initial_value)
 		{
@@ -497,14 +570,11 @@ cdn_operator_delayed_execute (CdnOperator     *op,
 		return;
 	}
 
-	while (h->next && h->next->t < td)
-	{
-		h = h->next;
-	}
+	i = history_find (history, td);
 
-	if (!h->next)
+	if (i + 1 == history->size)
 	{
-		if (fabs (h->t - td) > 1e-13)
+		if (fabs (history_t (history, i) - td) > 1e-13)
 		{
 			if (d->priv->initial_value)
 			{
@@ -526,70 +596,19 @@ cdn_operator_delayed_execute (CdnOperator     *op,
 				                   d->priv->expression,
 				                   stack);
 			}
-
-			return;
 		}
 		else
 		{
-			gint i;
-			gint n;
-
-			n = cdn_stack_arg_size (&d->priv->smanip.push);
-
-			for (i = 0; i < n; ++i)
-			{
-				cdn_stack_push (stack, h->v[i]);
-			}
+			cdn_stack_pushn (stack, history_v (history, i), history->n);
 		}
 	}
 	else
 	{
-		// Interpolate value between h and h->next
-		gdouble factor;
-		gint i;
-		gint n;
-
-		if (fabs (td - h->t) < 1e-13)
-		{
-			factor = 0;
-		}
-		else
-		{
-			factor = (td - h->t) / (h->next->t - h->t);
-		}
-
-		n = cdn_stack_arg_size (&d->priv->smanip.push);
-
-		for (i = 0; i < n; ++i)
-		{
-			cdn_stack_push (stack,
-			                h->v[i] +
-			                factor * (h->next->v[i] - h->v[i]));
-		}
+		// Interpolate value between sample i and i + 1
+		push_interpolated (d, i, td, stack);
 	}
 }
 
-static void
-history_free (HistoryList *history)
-{
-	HistoryItem *item;
-
-	item = history->first;
-
-	while (item)
-	{
-		HistoryItem *next;
-		next = item->next;
-
-		g_free (item->v);
-		g_slice_free (HistoryItem, item);
-		item = next;
-	}
-
-	history->first = history->last = NULL;
-	history->size = 0;
-}
-
 static void
 cdn_operator_delayed_finalize (GObject *object)
 {
@@ -598,7 +617,6 @@ cdn_operator_delayed_finalize (GObject *object)
 	delayed = CDN_OPERATOR_DELAYED (object);
 
 	history_free (&delayed->priv->history);
-	history_free (&delayed->priv->history_pool);
 
 	if (delayed->priv->expression)
 	{
@@ -671,6 +689,11 @@ cdn_operator_delayed_equal (CdnOperator *op,
 		return FALSE;
 	}
 
+	if (delayed->priv->interpolation != odel->priv->interpolation)
+	{
+		return FALSE;
+	}
+
 	if (!cdn_expression_equal (delayed->priv->expression,
 	                           odel->priv->expression,
 	                           asstring))
@@ -695,20 +718,16 @@ cdn_operator_delayed_step (CdnOperator *op,
                            gdouble      timestep)
 {
 	CdnOperatorDelayed *d;
-	HistoryItem *current;
 	CdnMatrix const *v;
-	gint nd;
 
 	// direct cast for efficiency
 	d = (CdnOperatorDelayed *)op;
 
-	// release ancient history
-	history_to_pool (d, d->priv->last_t);
-
-	// append current value to history
-	current = pool_to_history (d, 1);
-
-	current->t = t;
+	// release ancient history, cubic interpolation needs one more sample
+	// to compute the slope at the start of the interval
+	history_release (&d->priv->history,
+	                 d->priv->last_t,
+	                 d->priv->interpolation == CDN_OPERATOR_DELAYED_INTERPOLATION_CUBIC ? 1 : 0);
 
 	if (t != d->priv->eval_at_t)
 	{
@@ -719,14 +738,8 @@ cdn_operator_delayed_step (CdnOperator *op,
 
 	d->priv->eval_at_t = t;
 
-	nd = cdn_matrix_size (v);
-
-	if (current->v == NULL)
-	{
-		current->v = g_new (gdouble, nd);
-	}
-
-	memcpy (current->v, cdn_matrix_get (v), sizeof (gdouble) * nd);
+	// append current value to history
+	history_append (&d->priv->history, t, cdn_matrix_get (v));
 	d->priv->first_last_t = TRUE;
 }
 
@@ -761,7 +774,100 @@ cdn_operator_delayed_reset (CdnOperator *op)
 	d->priv->eval_at_t = 0;
 	d->priv->first_last_t = FALSE;
 
-	history_reset (d);
+	history_reset (&d->priv->history);
+}
+
+static GVariant *
+cdn_operator_delayed_save_state (CdnOperator *op)
+{
+	CdnOperatorDelayed *d;
+	GVariantBuilder history;
+	guint i;
+
+	d = (CdnOperatorDelayed *)op;
+
+	g_variant_builder_init (&history, G_VARIANT_TYPE ("a(dad)"));
+
+	for (i = 0; i < d->priv->history.size; ++i)
+	{
+		GVariant *v;
+
+		v = g_variant_new_fixed_array (G_VARIANT_TYPE_DOUBLE,
+		                               history_v (&d->priv->history, i),
+		                               d->priv->history.n,
+		                               sizeof (gdouble));
+
+		g_variant_builder_add (&history,
+		                       "(d@ad)",
+		                       history_t (&d->priv->history, i),
+		                       v);
+	}
+
+	return g_variant_new ("(ddba(dad))",
+	                      d->priv->last_t,
+	                      d->priv->eval_at_t,
+	                      d->priv->first_last_t,
+	                      &history);
+}
+
+static gboolean
+cdn_operator_delayed_restore_state (CdnOperator *op,
+                                    GVariant    *state)
+{
+	CdnOperatorDelayed *d;
+	GVariantIter *iter;
+	GVariant *v;
+	gdouble last_t;
+	gdouble eval_at_t;
+	gboolean first_last_t;
+	gdouble t;
+
+	d = (CdnOperatorDelayed *)op;
+
+	if (!g_variant_is_of_type (state, G_VARIANT_TYPE ("(ddba(dad))")))
+	{
+		return FALSE;
+	}
+
+	g_variant_get (state,
+	               "(ddba(dad))",
+	               &last_t,
+	               &eval_at_t,
+	               &first_last_t,
+	               &iter);
+
+	history_reset (&d->priv->history);
+
+	while (g_variant_iter_next (iter, "(d@ad)", &t, &v))
+	{
+		gdouble const *values;
+		gsize num;
+
+		values = g_variant_get_fixed_array (v, &num, sizeof (gdouble));
+
+		if (num != d->priv->history.n ||
+		    (d->priv->history.size > 0 &&
+		     t < history_t (&d->priv->history, d->priv->history.size - 1)))
+		{
+			g_variant_unref (v);
+			g_variant_iter_free (iter);
+
+			history_reset (&d->priv->history);
+			return FALSE;
+		}
+
+		history_append (&d->priv->history, t, values);
+		g_variant_unref (v);
+	}
+
+	g_variant_iter_free (iter);
+
+	d->priv->last_t = last_t;
+	d->priv->eval_at_t = eval_at_t;
+	d->priv->first_last_t = first_last_t;
+
+	cdn_expression_reset_cache (d->priv->expression);
+	return TRUE;
 }
 
 static void
@@ -783,6 +889,8 @@ cdn_operator_delayed_class_init (CdnOperatorDelayedClass *klass)
 	op_class->initialize_integrate = cdn_operator_delayed_initialize_integrate;
 	op_class->get_stack_manipulation = cdn_operator_delayed_get_stack_manipulation;
 	op_class->reset = cdn_operator_delayed_reset;
+	op_class->save_state = cdn_operator_delayed_save_state;
+	op_class->restore_state = cdn_operator_delayed_restore_state;
 
 	g_type_class_add_private (object_class, sizeof(CdnOperatorDelayedPrivate));
 
@@ -856,3 +964,22 @@ cdn_operator_delayed_get_initial_value (CdnOperatorDelayed *delayed)
 
 	return delayed->priv->initial_value;
 }
+
+/**
+ * cdn_operator_delayed_get_interpolation:
+ * @delayed: A #CdnOperatorDelayed
+ *
+ * Get how the delayed value is interpolated between two samples of the
+ * history.
+ *
+ * Returns: A #CdnOperatorDelayedInterpolation
+ *
+ **/
+CdnOperatorDelayedInterpolation
+cdn_operator_delayed_get_interpolation (CdnOperatorDelayed *delayed)
+{
+	g_return_val_if_fail (CDN_IS_OPERATOR_DELAYED (delayed),
+	                      CDN_OPERATOR_DELAYED_INTERPOLATION_LINEAR);
+
+	return delayed->priv->interpolation;
+}
@@ -40,6 +40,19 @@ typedef struct _CdnOperatorDelayed		CdnOperatorDelayed;
 typedef struct _CdnOperatorDelayedClass		CdnOperatorDelayedClass;
 typedef struct _CdnOperatorDelayedPrivate	CdnOperatorDelayedPrivate;
 
+/**
+ * CdnOperatorDelayedInterpolation:
+ * @CDN_OPERATOR_DELAYED_INTERPOLATION_LINEAR: linear interpolation
+ * @CDN_OPERATOR_DELAYED_INTERPOLATION_CUBIC: cubic Hermite interpolation
+ *
+ * Interpolation of a delayed value between two samples of the history.
+ */
+typedef enum
+{
+	CDN_OPERATOR_DELAYED_INTERPOLATION_LINEAR,
+	CDN_OPERATOR_DELAYED_INTERPOLATION_CUBIC
+} CdnOperatorDelayedInterpolation;
+
 /**
  * CdnOperatorDelayed:
  *
@@ -48,6 +61,11 @@ typedef struct _CdnOperatorDelayedPrivate	CdnOperatorDelayedPrivate;
  * The #CdnOperatorDelayed is a special operator that can be used in
  * mathematical expressions ('delay'). When evaluated, it will return the
  * delayed value of its argument (which can be an arbitrary expression).
+ *
+ * The operator takes the expression to delay, an optional initial value
+ * used before the history starts, and an optional interpolation order
+ * (1 for linear, the default, or 3 for cubic Hermite), for example
+ * delayed[x, 0, 3](0.1).
  */
 struct _CdnOperatorDelayed
 {
@@ -69,6 +87,9 @@ CdnOperatorDelayed *cdn_operator_delayed_new               (void);
 CdnExpression      *cdn_operator_delayed_get_expression    (CdnOperatorDelayed *delayed);
 CdnExpression      *cdn_operator_delayed_get_initial_value (CdnOperatorDelayed *delayed);
 
+CdnOperatorDelayedInterpolation
+                    cdn_operator_delayed_get_interpolation (CdnOperatorDelayed *delayed);
+
 G_END_DECLS
 
 #endif /* __CDN_OPERATOR_DELAYED_H__ */
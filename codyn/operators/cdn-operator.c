@@ -361,6 +361,19 @@ cdn_operator_initialize_integrate_default (CdnOperator   *op,
 {
 }
 
+static GVariant *
+cdn_operator_save_state_default (CdnOperator *op)
+{
+	return NULL;
+}
+
+static gboolean
+cdn_operator_restore_state_default (CdnOperator *op,
+                                    GVariant    *state)
+{
+	return FALSE;
+}
+
 static void
 cdn_operator_class_init (CdnOperatorClass *klass)
 {
@@ -379,6 +392,8 @@ cdn_operator_class_init (CdnOperatorClass *klass)
 	klass->reset = cdn_operator_reset_default;
 	klass->step = cdn_operator_step_default;
 	klass->initialize_integrate = cdn_operator_initialize_integrate_default;
+	klass->save_state = cdn_operator_save_state_default;
+	klass->restore_state = cdn_operator_restore_state_default;
 
 	g_type_class_add_private (object_class, sizeof (CdnOperatorPrivate));
 }
@@ -877,3 +892,43 @@ cdn_operator_initialize_integrate (CdnOperator   *op,
 
 	CDN_OPERATOR_GET_CLASS (op)->initialize_integrate (op, integrator);
 }
+
+/**
+ * cdn_operator_save_state:
+ * @op: the #CdnOperator
+ *
+ * Save the dynamic state of the operator (for example its history) such
+ * that it can later be restored with #cdn_operator_restore_state. Operators
+ * without any state return %NULL.
+ *
+ * Returns: (transfer full) (allow-none): a floating #GVariant or %NULL
+ *
+ */
+GVariant *
+cdn_operator_save_state (CdnOperator *op)
+{
+	g_return_val_if_fail (CDN_IS_OPERATOR (op), NULL);
+
+	return CDN_OPERATOR_GET_CLASS (op)->save_state (op);
+}
+
+/**
+ * cdn_operator_restore_state:
+ * @op: the #CdnOperator
+ * @state: a #GVariant obtained from #cdn_operator_save_state
+ *
+ * Restore the dynamic state of the operator previously saved with
+ * #cdn_operator_save_state.
+ *
+ * Returns: %TRUE if the state could be restored, %FALSE otherwise
+ *
+ */
+gboolean
+cdn_operator_restore_state (CdnOperator *op,
+                            GVariant    *state)
+{
+	g_return_val_if_fail (CDN_IS_OPERATOR (op), FALSE);
+	g_return_val_if_fail (state != NULL, FALSE);
+
+	return CDN_OPERATOR_GET_CLASS (op)->restore_state (op, state);
+}
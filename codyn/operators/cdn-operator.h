@@ -118,6 +118,10 @@ struct _CdnOperatorClass
 
 	void             (*initialize_integrate) (CdnOperator *op,
 	                                          CdnIntegrator *integrator);
+
+	GVariant        *(*save_state)       (CdnOperator *op);
+	gboolean         (*restore_state)    (CdnOperator *op,
+	                                      GVariant    *state);
 };
 
 GType                cdn_operator_get_type                    (void) G_GNUC_CONST;
@@ -182,6 +186,10 @@ void                 cdn_operator_initialize_integrate       (CdnOperator
 
 CdnStackManipulation const *cdn_operator_get_stack_manipulation    (CdnOperator *op);
 
+GVariant            *cdn_operator_save_state                 (CdnOperator       *op);
+gboolean             cdn_operator_restore_state              (CdnOperator       *op,
+                                                              GVariant          *state);
+
 
 G_END_DECLS
 
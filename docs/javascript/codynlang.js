@@ -22,7 +22,7 @@ CodeMirror.defineMode("codyn", function() {
     return ret;
   };
 
-  var keywords = w("action all any apply as at bidirectional context debug-print defines delete discrete edge event from import in include initial-state integrated integrator interface io layout link-library node no-self object of on once out parse piece polynomial probability require set settings state terminate to unapply when with within");
+  var keywords = w("action all any apply as at bidirectional context debug-print defines delete discrete edge event from import in include initial-state integrate-every integrated integrator interface io layout link-library node no-self object of on once out parse piece polynomial probability require set settings state terminate to unapply when with within");
 
   var selectors = w("actions append-context applied-templates children count debug edges first from-set functions has-flag has-template if ifstr imports input input-name inputs last name nodes not notstr objects output output-name outputs parent recurse reduce reverse root self siblings sort subset templates templates-root type unique variables");
 
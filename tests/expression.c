@@ -112,6 +112,132 @@ test_globals ()
 	cdn_assert_tol (1, cdn_variable_get_value (x));
 }
 
+static void
+test_deep ()
+{
+	GString *s;
+	gint i;
+
+	// Deeply nested scalar expressions need more stack than the scalar
+	// evaluator provides
+	s = g_string_new ("");
+
+	for (i = 1; i < 40; ++i)
+	{
+		g_string_append_printf (s, "%d + (", i);
+	}
+
+	g_string_append (s, "40");
+
+	for (i = 1; i < 40; ++i)
+	{
+		g_string_append_c (s, ')');
+	}
+
+	expression_initialize (s->str);
+	cdn_assert_tol (expression_eval (), 820);
+
+	expression_initialize ("1 + (2 + (3 * (4 - 5)))");
+	cdn_assert_tol (expression_eval (), 0);
+
+	g_string_free (s, TRUE);
+}
+
+static void
+assert_values (gdouble x1, gdouble x2)
+{
+	CdnMatrix const *values;
+
+	cdn_expression_reset_cache (expression);
+	values = cdn_expression_evaluate_values (expression);
+
+	cdn_assert_tol (cdn_matrix_get (values)[0], x1);
+	cdn_assert_tol (cdn_matrix_get (values)[1], x2);
+}
+
+static void
+test_factorization_cache ()
+{
+	CdnObject *obj = CDN_OBJECT (cdn_node_new (NULL));
+	CdnDimension dima = CDN_DIMENSION (2, 2);
+	CdnDimension dimb = CDN_DIMENSION (2, 1);
+	gdouble avals[] = {1, 3, 2, 4};
+	gdouble bvals[] = {5, 5};
+	CdnVariable *a;
+	CdnVariable *b;
+	CdnMatrix *m;
+
+	a = cdn_variable_new ("A", cdn_expression_new ("[4, 1; 2, 3]"), 0);
+	cdn_object_add_variable (obj, a, NULL);
+
+	b = cdn_variable_new ("b", cdn_expression_new ("[1; 2]"), 0);
+	cdn_object_add_variable (obj, b, NULL);
+
+	cdn_object_reset (obj);
+
+	expression_initialize_context ("linsolve(A, b) + inv(A) * b", obj);
+
+	assert_values (0.2, 1.2);
+
+	// Same matrix operand, reuses the factorization
+	assert_values (0.2, 1.2);
+
+	m = cdn_matrix_new (bvals, &dimb);
+	cdn_variable_set_values (b, m);
+	cdn_matrix_free (m);
+
+	assert_values (2, 2);
+
+	// Changed matrix operand, needs a new factorization
+	m = cdn_matrix_new (avals, &dima);
+	cdn_variable_set_values (a, m);
+	cdn_matrix_free (m);
+
+	assert_values (-10, 10);
+
+	g_object_unref (obj);
+}
+
+static void
+test_sparsity_variable ()
+{
+	CdnObject *obj = CDN_OBJECT (cdn_node_new (NULL));
+	CdnDimension dim = CDN_DIMENSION (3, 3);
+	gdouble lvals[] = {2, 1, 0, 1, 3, 4, 0, 0, 5};
+	CdnVariable *l;
+	CdnMatrix *m;
+
+	cdn_object_add_variable (obj,
+	                         cdn_variable_new ("x", cdn_expression_new ("1"), 0),
+	                         NULL);
+
+	// Lower triangular by structure, solved by substitution
+	l = cdn_variable_new ("L",
+	                      cdn_expression_new ("[2, 0, 0; x, 3, 0; 0, 4, 5]"),
+	                      0);
+
+	cdn_object_add_variable (obj, l, NULL);
+	cdn_object_add_variable (obj,
+	                         cdn_variable_new ("b", cdn_expression_new ("[2; 7; 13]"), 0),
+	                         NULL);
+
+	cdn_object_reset (obj);
+
+	expression_initialize_context ("linsolve(L, b)", obj);
+
+	assert_values (1, 2);
+
+	// Setting the value from outside breaks the structure of L, the
+	// system has to be solved in full
+	m = cdn_matrix_new (lvals, &dim);
+	cdn_variable_set_values (l, m);
+	cdn_matrix_free (m);
+
+	assert_values (-0.2, 2.4);
+
+	g_object_unref (obj);
+}
+
 static void
 test_math ()
 {
@@ -141,6 +267,9 @@ main (int   argc,
 	g_test_add_func ("/expression/complex", test_complex);
 	g_test_add_func ("/expression/random", test_random);
 	g_test_add_func ("/expression/globals", test_globals);
+	g_test_add_func ("/expression/deep", test_deep);
+	g_test_add_func ("/expression/factorization_cache", test_factorization_cache);
+	g_test_add_func ("/expression/sparsity_variable", test_sparsity_variable);
 
 	g_test_run ();
 
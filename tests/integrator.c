@@ -35,6 +35,1134 @@ test_switch ()
 	g_object_unref (network);
 }
 
+static gchar const *fused_network =
+	"node \"n\"\n"
+	"{\n"
+	"  x = 1 | integrated\n"
+	"  y = 0\n"
+	"  z = \"2 * x + sin(t)\"\n"
+	"\n"
+	"  edge self\n"
+	"  {\n"
+	"    y <= \"z * z\"\n"
+	"    x' += \"-y - z\"\n"
+	"  }\n"
+	"}\n";
+
+static gdouble
+run_fused (gboolean fused)
+{
+	CdnNetwork *network;
+	CdnIntegrator *integrator;
+	CdnVariable *x;
+	gdouble ret;
+
+	network = test_load_network (fused_network, NULL);
+	integrator = cdn_network_get_integrator (network);
+
+	cdn_integrator_state_set_fused (cdn_integrator_get_state (integrator),
+	                                fused);
+
+	cdn_network_run (network, 0, 0.01, 1, NULL);
+
+	x = cdn_node_find_variable (CDN_NODE (network), "n.x");
+	ret = cdn_variable_get_value (x);
+
+	g_object_unref (network);
+	return ret;
+}
+
+static void
+test_fused ()
+{
+	cdn_assert_tol (run_fused (TRUE), run_fused (FALSE));
+}
+
+static gdouble
+run_arena (gboolean arena)
+{
+	CdnNetwork *network;
+	CdnIntegrator *integrator;
+	CdnVariable *x;
+	gdouble ret;
+
+	network = test_load_network (fused_network, NULL);
+	integrator = cdn_network_get_integrator (network);
+
+	cdn_integrator_state_set_arena (cdn_integrator_get_state (integrator),
+	                                arena);
+
+	cdn_network_run (network, 0, 0.01, 1, NULL);
+
+	x = cdn_node_find_variable (CDN_NODE (network), "n.x");
+	ret = cdn_variable_get_value (x);
+
+	g_object_unref (network);
+	return ret;
+}
+
+static void
+test_arena ()
+{
+	cdn_assert_tol (run_arena (TRUE), run_arena (FALSE));
+}
+
+static void
+test_arena_snapshot ()
+{
+	CdnNetwork *network;
+	CdnIntegratorState *state;
+	CdnVariable *x;
+	gdouble *snapshot;
+	gdouble value;
+	guint size;
+
+	network = test_load_network (fused_network, NULL);
+	state = cdn_integrator_get_state (cdn_network_get_integrator (network));
+
+	cdn_integrator_state_set_arena (state, TRUE);
+	cdn_network_run (network, 0, 0.01, 0.5, NULL);
+
+	x = cdn_node_find_variable (CDN_NODE (network), "n.x");
+	value = cdn_variable_get_value (x);
+
+	snapshot = cdn_integrator_state_arena_snapshot (state, &size);
+	g_assert (snapshot != NULL);
+
+	cdn_variable_set_value (x, value + 1);
+	cdn_assert_tol (cdn_variable_get_value (x), value + 1);
+
+	g_assert (cdn_integrator_state_arena_restore (state, snapshot, size));
+	cdn_assert_tol (cdn_variable_get_value (x), value);
+
+	g_free (snapshot);
+	g_object_unref (network);
+}
+
+static gchar const *parallel_network =
+	"node \"limb{1:8}\"\n"
+	"{\n"
+	"  x = \"@1\" | integrated\n"
+	"  y = \"0.1 * @1\" | integrated\n"
+	"  z = \"sin(x) * cos(y)\"\n"
+	"\n"
+	"  edge self\n"
+	"  {\n"
+	"    x' += \"-z * y + g\"\n"
+	"    y' += \"z * x - g\"\n"
+	"  }\n"
+	"}\n"
+	"\n"
+	"g = \"0.5 * sin(t)\"\n";
+
+static gdouble
+run_parallel (gboolean parallel)
+{
+	CdnNetwork *network;
+	CdnIntegrator *integrator;
+	gdouble ret = 0;
+	gint i;
+
+	network = test_load_network (parallel_network, NULL);
+	integrator = cdn_network_get_integrator (network);
+
+	cdn_integrator_state_set_parallel (cdn_integrator_get_state (integrator),
+	                                   parallel);
+
+	cdn_network_run (network, 0, 0.01, 1, NULL);
+
+	for (i = 1; i <= 8; ++i)
+	{
+		gchar *name;
+		CdnVariable *x;
+
+		name = g_strdup_printf ("limb%d.x", i);
+		x = cdn_node_find_variable (CDN_NODE (network), name);
+		g_free (name);
+
+		ret += cdn_variable_get_value (x) * i;
+	}
+
+	g_object_unref (network);
+	return ret;
+}
+
+static void
+test_parallel ()
+{
+	cdn_assert_tol (run_parallel (TRUE), run_parallel (FALSE));
+}
+
+/* p and q are each used by one integrated action only, but the direct
+ * variable d depends on both */
+static gchar const *parallel_direct_network =
+	"node \"n\"\n"
+	"{\n"
+	"  p = \"sin(t) * x\"\n"
+	"  q = \"cos(t) * y\"\n"
+	"  x = 1 | integrated\n"
+	"  y = 1 | integrated\n"
+	"  d = 0\n"
+	"\n"
+	"  edge self\n"
+	"  {\n"
+	"    x' += \"p\"\n"
+	"    y' += \"q\"\n"
+	"    d <= \"p + q\"\n"
+	"  }\n"
+	"}\n";
+
+static void
+run_parallel_direct (gboolean  parallel,
+                     gdouble  *ret)
+{
+	CdnNetwork *network;
+	CdnIntegrator *integrator;
+
+	network = test_load_network (parallel_direct_network, NULL);
+	integrator = cdn_network_get_integrator (network);
+
+	cdn_integrator_state_set_parallel (cdn_integrator_get_state (integrator),
+	                                   parallel);
+
+	cdn_network_run (network, 0, 0.001, 1, NULL);
+
+	ret[0] = cdn_variable_get_value (cdn_node_find_variable (CDN_NODE (network), "n.x"));
+	ret[1] = cdn_variable_get_value (cdn_node_find_variable (CDN_NODE (network), "n.y"));
+	ret[2] = cdn_variable_get_value (cdn_node_find_variable (CDN_NODE (network), "n.d"));
+
+	g_object_unref (network);
+}
+
+static void
+test_parallel_direct ()
+{
+	gdouble serial[3];
+	gdouble parallel[3];
+	gint i;
+
+	run_parallel_direct (FALSE, serial);
+	run_parallel_direct (TRUE, parallel);
+
+	for (i = 0; i < 3; ++i)
+	{
+		cdn_assert_tol (parallel[i], serial[i]);
+	}
+}
+
+static gchar const *decay_network =
+	"integrator { method = \"dormand-prince\" }\n"
+	"\n"
+	"node \"n\"\n"
+	"{\n"
+	"  x = 1 | integrated\n"
+	"\n"
+	"  edge self\n"
+	"  {\n"
+	"    x' += \"-x\"\n"
+	"  }\n"
+	"}\n";
+
+static void
+test_dormand_prince ()
+{
+	CdnNetwork *network;
+	CdnIntegrator *integrator;
+	CdnIntegratorDormandPrince *dp;
+	CdnVariable *x;
+
+	network = test_load_network (decay_network, NULL);
+	integrator = cdn_network_get_integrator (network);
+
+	g_assert (CDN_IS_INTEGRATOR_DORMAND_PRINCE (integrator));
+	dp = CDN_INTEGRATOR_DORMAND_PRINCE (integrator);
+
+	cdn_network_run (network, 0, 0.01, 1, NULL);
+
+	x = cdn_node_find_variable (CDN_NODE (network), "n.x");
+	g_assert (fabs (cdn_variable_get_value (x) - exp (-1)) < 1e-5);
+
+	/* Internal steps span many requested steps */
+	g_assert_cmpuint (cdn_integrator_dormand_prince_get_num_steps (dp), <, 100);
+
+	g_object_unref (network);
+}
+
+static gchar const *dormand_prince_failure_network =
+	"integrator { method = \"dormand-prince\" }\n"
+	"\n"
+	"node \"n\"\n"
+	"{\n"
+	"  x = %s | integrated\n"
+	"\n"
+	"  edge self\n"
+	"  {\n"
+	"    x' += \"%s\"\n"
+	"  }\n"
+	"}\n";
+
+static CdnNetwork *
+load_dormand_prince_failure (gchar const *x,
+                             gchar const *dx)
+{
+	CdnNetwork *network;
+	gchar *s;
+
+	s = g_strdup_printf (dormand_prince_failure_network, x, dx);
+	network = test_load_network (s, NULL);
+	g_free (s);
+
+	return network;
+}
+
+static void
+test_dormand_prince_tolerance ()
+{
+	CdnNetwork *network;
+	CdnIntegrator *integrator;
+
+	network = load_dormand_prince_failure ("1", "-1000 * x");
+	integrator = cdn_network_get_integrator (network);
+
+	/* The tolerance cannot be met at the minimum step size, which is
+	 * reported once */
+	g_object_set (integrator, "minimum-step", 0.01, NULL);
+
+	g_test_expect_message (NULL, G_LOG_LEVEL_WARNING, "*tolerance is not met*");
+	cdn_network_run (network, 0, 0.01, 0.05, NULL);
+	g_test_assert_expected_messages ();
+
+	cdn_assert_tol (cdn_integrator_get_time (integrator), 0.05);
+
+	g_object_unref (network);
+
+	/* A step without a finite error fails instead */
+	network = load_dormand_prince_failure ("-1", "sqrt(x)");
+	integrator = cdn_network_get_integrator (network);
+
+	g_test_expect_message (NULL, G_LOG_LEVEL_WARNING, "*not finite*");
+	cdn_network_run (network, 0, 0.01, 0.05, NULL);
+	g_test_assert_expected_messages ();
+
+	cdn_assert_tol (cdn_integrator_get_time (integrator), 0);
+	cdn_assert_tol (cdn_variable_get_value (cdn_node_find_variable (CDN_NODE (network), "n.x")), -1);
+
+	g_object_unref (network);
+}
+
+static gchar const *stiff_network =
+	"integrator { method = \"rosenbrock\" }\n"
+	"\n"
+	"node \"n\"\n"
+	"{\n"
+	"  x = 1 | integrated\n"
+	"  y = 0 | integrated\n"
+	"\n"
+	"  edge self\n"
+	"  {\n"
+	"    x' += \"-1000 * (x - cos(t))\"\n"
+	"    y' += \"x - y\"\n"
+	"  }\n"
+	"}\n";
+
+static void
+test_rosenbrock ()
+{
+	CdnNetwork *network;
+	CdnIntegrator *integrator;
+	CdnVariable *x;
+
+	network = test_load_network (stiff_network, NULL);
+	integrator = cdn_network_get_integrator (network);
+
+	g_assert (CDN_IS_INTEGRATOR_ROSENBROCK (integrator));
+
+	/* An explicit integrator diverges at this step size */
+	cdn_network_run (network, 0, 0.05, 1, NULL);
+
+	g_assert (cdn_integrator_rosenbrock_get_symbolic (CDN_INTEGRATOR_ROSENBROCK (integrator)));
+
+	x = cdn_node_find_variable (CDN_NODE (network), "n.x");
+	g_assert (fabs (cdn_variable_get_value (x) - cos (1)) < 1e-2);
+
+	g_object_unref (network);
+}
+
+/* 1 / (gamma h) is an eigenvalue of the Jacobian at h = 0.05, making the
+ * iteration matrix singular */
+static gchar const *singular_network =
+	"integrator { method = \"rosenbrock\" }\n"
+	"\n"
+	"node \"n\"\n"
+	"{\n"
+	"  x = 1 | integrated\n"
+	"\n"
+	"  edge self\n"
+	"  {\n"
+	"    x' += \"x / (1.7071067811865475 * 0.05)\"\n"
+	"  }\n"
+	"}\n";
+
+static void
+test_rosenbrock_singular ()
+{
+	CdnNetwork *network;
+	CdnVariable *x;
+	gdouble half;
+
+	network = test_load_network (singular_network, NULL);
+	x = cdn_node_find_variable (CDN_NODE (network), "n.x");
+
+	cdn_network_run (network, 0, 0.025, 0.1, NULL);
+	half = cdn_variable_get_value (x);
+
+	/* The singular steps are rejected and redone at half the step size */
+	cdn_network_run (network, 0, 0.05, 0.1, NULL);
+
+	g_assert (isfinite (cdn_variable_get_value (x)));
+	cdn_assert_tol (cdn_variable_get_value (x), half);
+
+	g_object_unref (network);
+}
+
+static gchar const *multirate_network =
+	"integrator { method = \"euler\" }\n"
+	"\n"
+	"node \"fast\"\n"
+	"{\n"
+	"  x = 0 | integrated\n"
+	"\n"
+	"  edge self\n"
+	"  {\n"
+	"    x' += \"t\"\n"
+	"  }\n"
+	"}\n"
+	"\n"
+	"node \"slow\"\n"
+	"{\n"
+	"  integrate-every 10\n"
+	"\n"
+	"  node \"inner\"\n"
+	"  {\n"
+	"    y = 0 | integrated\n"
+	"\n"
+	"    edge self\n"
+	"    {\n"
+	"      y' += \"t\"\n"
+	"    }\n"
+	"  }\n"
+	"}\n";
+
+static void
+test_multirate ()
+{
+	CdnNetwork *network;
+	CdnVariable *x;
+	CdnVariable *y;
+
+	network = test_load_network (multirate_network, NULL);
+
+	cdn_network_run (network, 0, 0.01, 1, NULL);
+
+	x = cdn_node_find_variable (CDN_NODE (network), "fast.x");
+	y = cdn_node_find_variable (CDN_NODE (network), "slow.inner.y");
+
+	/* Euler on t at dt = 0.01 */
+	cdn_assert_tol (cdn_variable_get_value (x), 0.495);
+
+	/* Euler on t over the intervals of 10 steps */
+	cdn_assert_tol (cdn_variable_get_value (y), 0.45);
+
+	g_object_unref (network);
+}
+
+static gchar const *multirate_stages_network =
+	"integrator { method = \"%s\" }\n"
+	"\n"
+	"node \"slow\"\n"
+	"{\n"
+	"  integrate-every 10\n"
+	"\n"
+	"  y = 0 | integrated\n"
+	"\n"
+	"  edge self\n"
+	"  {\n"
+	"    y' += \"t\"\n"
+	"  }\n"
+	"}\n"
+	"\n"
+	"node \"fast\"\n"
+	"{\n"
+	"  z = 0 | integrated\n"
+	"}\n"
+	"\n"
+	"edge from \"slow\" to \"fast\"\n"
+	"{\n"
+	"  z' += \"input.y\"\n"
+	"}\n";
+
+static void
+run_multirate_stages (gchar const *method,
+                      gboolean     fused)
+{
+	CdnNetwork *network;
+	CdnIntegrator *integrator;
+	CdnVariable *y;
+	CdnVariable *z;
+	gchar *s;
+
+	s = g_strdup_printf (multirate_stages_network, method);
+	network = test_load_network (s, NULL);
+	g_free (s);
+
+	integrator = cdn_network_get_integrator (network);
+	cdn_integrator_state_set_fused (cdn_integrator_get_state (integrator),
+	                                fused);
+
+	cdn_network_run (network, 0, 0.01, 1, NULL);
+
+	y = cdn_node_find_variable (CDN_NODE (network), "slow.y");
+	z = cdn_node_find_variable (CDN_NODE (network), "fast.z");
+
+	/* The intervals are integrated with all the stages of the method,
+	 * which is exact for y = t^2 / 2 */
+	cdn_assert_tol (cdn_variable_get_value (y), 0.5);
+
+	/* Every stage sees y interpolated linearly over the intervals of
+	 * 0.1, which integrates to the trapezoidal sum of t^2 / 2 */
+	cdn_assert_tol (cdn_variable_get_value (z), 1 / 6.0 + 1 / 1200.0);
+
+	g_object_unref (network);
+}
+
+static void
+test_multirate_stages ()
+{
+	run_multirate_stages ("runge-kutta", FALSE);
+	run_multirate_stages ("runge-kutta", TRUE);
+	run_multirate_stages ("dormand-prince", FALSE);
+}
+
+static gchar const *state_vector_network =
+	"integrator { method = \"%s\" }\n"
+	"\n"
+	"node \"n\"\n"
+	"{\n"
+	"  x = \"[1, 2, 3]\"\n"
+	"  x' = \"-x\"\n"
+	"\n"
+	"  y = 1\n"
+	"  y' = \"-y\"\n"
+	"}\n";
+
+static void
+run_state_vector (gchar const *method)
+{
+	CdnNetwork *network;
+	CdnIntegratorState *state;
+	CdnVariable *x;
+	CdnVariable *y;
+	gdouble const *xvals;
+	gdouble const *storage;
+	gdouble values[4];
+	gdouble sum = 0;
+	gchar *s;
+	gint i;
+
+	s = g_strdup_printf (state_vector_network, method);
+	network = test_load_network (s, NULL);
+	g_free (s);
+
+	cdn_network_run (network, 0, 0.01, 1, NULL);
+
+	x = cdn_node_find_variable (CDN_NODE (network), "n.x");
+	y = cdn_node_find_variable (CDN_NODE (network), "n.y");
+
+	xvals = cdn_matrix_get (cdn_variable_get_values (x));
+
+	for (i = 0; i < 3; ++i)
+	{
+		g_assert (fabs (xvals[i] - (i + 1) * exp (-1)) < 1e-5);
+	}
+
+	g_assert (fabs (cdn_variable_get_value (y) - exp (-1)) < 1e-5);
+
+	state = cdn_integrator_get_state (cdn_network_get_integrator (network));
+	g_assert_cmpuint (cdn_integrator_state_integrated_size (state), ==, 4);
+
+	/* The state vector round trips through the variables */
+	cdn_integrator_state_get_integrated_values (state, values);
+
+	for (i = 0; i < 4; ++i)
+	{
+		sum += values[i];
+		values[i] *= 2;
+	}
+
+	cdn_integrator_state_set_integrated_values (state, values);
+	xvals = cdn_matrix_get (cdn_variable_get_values (x));
+
+	cdn_assert_tol (xvals[0] + xvals[1] + xvals[2] + cdn_variable_get_value (y),
+	                2 * sum);
+
+	/* The state vector is the storage of the variables, values set from
+	   outside the integrator show up in it as well */
+	storage = cdn_integrator_state_get_integrated_storage (state);
+	g_assert (xvals == storage);
+
+	cdn_variable_set_value (y, 5);
+	cdn_assert_tol (storage[3], 5);
+
+	cdn_integrator_state_get_integrated_values (state, values);
+	cdn_assert_tol (values[3], 5);
+
+	g_object_unref (network);
+}
+
+static void
+test_state_vector ()
+{
+	run_state_vector ("runge-kutta");
+	run_state_vector ("predict-correct");
+}
+
+static gchar const *event_network =
+	"integrator { method = \"runge-kutta\" }\n"
+	"\n"
+	"initial-state \"air\"\n"
+	"\n"
+	"v = 0\n"
+	"v' = \"-10\"\n"
+	"\n"
+	"y = 1\n"
+	"y' = \"v\"\n"
+	"\n"
+	"impact = 0\n"
+	"\n"
+	"event \"air\" to \"ground\" when \"y < 0\" within 1e-9\n"
+	"{\n"
+	"  set impact = \"v\"\n"
+	"}\n";
+
+static void
+test_event_location ()
+{
+	CdnNetwork *network;
+	CdnVariable *impact;
+
+	network = test_load_network (event_network, NULL);
+
+	cdn_network_run (network, 0, 0.1, 1, NULL);
+
+	impact = cdn_node_find_variable (CDN_NODE (network), "impact");
+
+	/* Falls from 1 with g = 10, hits the ground at v = -sqrt(20) */
+	g_assert (fabs (cdn_variable_get_value (impact) + sqrt (20)) < 1e-6);
+
+	g_object_unref (network);
+}
+
+static gchar const *dense_event_network =
+	"integrator { method = \"dormand-prince\" }\n"
+	"\n"
+	"initial-state \"air\"\n"
+	"\n"
+	"v = 0\n"
+	"v' = \"-10\"\n"
+	"\n"
+	"y = 1\n"
+	"y' = \"v\"\n"
+	"\n"
+	"impact = 0\n"
+	"\n"
+	"event \"air\" to \"ground\" when \"y < 0\" within 1e-9\n"
+	"{\n"
+	"  set impact = \"v\"\n"
+	"}\n";
+
+static void
+test_event_location_dense ()
+{
+	CdnNetwork *network;
+	CdnIntegratorDormandPrince *dp;
+	CdnVariable *impact;
+
+	network = test_load_network (dense_event_network, NULL);
+	dp = CDN_INTEGRATOR_DORMAND_PRINCE (cdn_network_get_integrator (network));
+
+	cdn_network_run (network, 0, 0.1, 1, NULL);
+
+	impact = cdn_node_find_variable (CDN_NODE (network), "impact");
+	g_assert (fabs (cdn_variable_get_value (impact) + sqrt (20)) < 1e-6);
+
+	/* The crossing is located on the interpolant, only the located step
+	 * itself is integrated again */
+	g_assert_cmpuint (cdn_integrator_dormand_prince_get_num_steps (dp), <, 20);
+
+	g_object_unref (network);
+}
+
+/* Starts at rest with a vanishing first and second derivative of the
+ * condition, only the third derivative (of y) is non-zero */
+static gchar const *resting_event_network =
+	"integrator { method = \"runge-kutta\" }\n"
+	"\n"
+	"initial-state \"air\"\n"
+	"\n"
+	"w = 0\n"
+	"w' = \"-10\"\n"
+	"\n"
+	"v = 0\n"
+	"v' = \"w\"\n"
+	"\n"
+	"y = 1\n"
+	"y' = \"v\"\n"
+	"\n"
+	"impact = 0\n"
+	"\n"
+	"event \"air\" to \"ground\" when \"y < 0\" within 1e-9\n"
+	"{\n"
+	"  set impact = \"t\"\n"
+	"}\n";
+
+static gdouble
+run_event_screening_network (gchar const *s,
+                             gdouble      screening,
+                             guint64     *skipped)
+{
+	CdnNetwork *network;
+	CdnIntegrator *integrator;
+	gdouble ret;
+
+	network = test_load_network (s, NULL);
+	integrator = cdn_network_get_integrator (network);
+
+	cdn_integrator_set_event_screening (integrator, screening);
+	cdn_network_run (network, 0, 0.01, 1, NULL);
+
+	ret = cdn_variable_get_value (cdn_node_find_variable (CDN_NODE (network), "impact"));
+	*skipped = cdn_integrator_get_skipped_event_evaluations (integrator);
+
+	g_object_unref (network);
+	return ret;
+}
+
+static gdouble
+run_event_screening (gdouble   screening,
+                     guint64  *skipped)
+{
+	return run_event_screening_network (event_network, screening, skipped);
+}
+
+static void
+test_event_screening ()
+{
+	guint64 skipped;
+	gdouble impact;
+
+	impact = run_event_screening (0, &skipped);
+	g_assert_cmpuint (skipped, ==, 0);
+
+	/* Screened events are located at the same time, while the condition
+	 * is not evaluated during most of the fall */
+	cdn_assert_tol (run_event_screening (2, &skipped), impact);
+	g_assert_cmpuint (skipped, >, 0);
+}
+
+static void
+test_event_screening_resting ()
+{
+	guint64 skipped;
+	gdouble impact;
+
+	/* Hits the ground at t = cbrt(0.6) */
+	impact = run_event_screening_network (resting_event_network, 0, &skipped);
+	g_assert (fabs (impact - cbrt (0.6)) < 1e-6);
+
+	/* Not moving at the start says nothing about how soon the condition
+	 * can change, so the event is not put to sleep beyond its crossing */
+	impact = run_event_screening_network (resting_event_network, 1, &skipped);
+	g_assert (fabs (impact - cbrt (0.6)) < 1e-6);
+}
+
+/* The peak condition oscillates and is never a polynomial in time, the
+ * ground condition falls linearly */
+static gchar const *oscillating_event_network =
+	"integrator { method = \"runge-kutta\" }\n"
+	"\n"
+	"x = 1\n"
+	"x'' = \"-400 * x\"\n"
+	"\n"
+	"y = 2\n"
+	"y' = \"-1\"\n"
+	"\n"
+	"peaks = 0\n"
+	"last_peak = 0\n"
+	"ground = 0\n"
+	"\n"
+	"event when \"x > 0.9\"\n"
+	"{\n"
+	"  set peaks = \"peaks + 1\"\n"
+	"  set last_peak = \"t\"\n"
+	"}\n"
+	"\n"
+	"event when \"y < 0\"\n"
+	"{\n"
+	"  set ground = \"t\"\n"
+	"}\n";
+
+static void
+run_oscillating_event (gdouble   screening,
+                       gdouble  *peaks,
+                       gdouble  *last_peak,
+                       gdouble  *ground,
+                       guint64  *skipped)
+{
+	CdnNetwork *network;
+	CdnIntegrator *integrator;
+
+	network = test_load_network (oscillating_event_network, NULL);
+	integrator = cdn_network_get_integrator (network);
+
+	cdn_integrator_set_event_screening (integrator, screening);
+	cdn_network_run (network, 0, 0.01, 3, NULL);
+
+	*peaks = cdn_variable_get_value (cdn_node_find_variable (CDN_NODE (network), "peaks"));
+	*last_peak = cdn_variable_get_value (cdn_node_find_variable (CDN_NODE (network), "last_peak"));
+	*ground = cdn_variable_get_value (cdn_node_find_variable (CDN_NODE (network), "ground"));
+	*skipped = cdn_integrator_get_skipped_event_evaluations (integrator);
+
+	g_object_unref (network);
+}
+
+static void
+test_event_screening_oscillating ()
+{
+	gdouble peaks;
+	gdouble last_peak;
+	gdouble ground;
+	gdouble speaks;
+	gdouble slast_peak;
+	gdouble sground;
+	guint64 skipped;
+
+	run_oscillating_event (0, &peaks, &last_peak, &ground, &skipped);
+	g_assert_cmpuint (skipped, ==, 0);
+	g_assert_cmpfloat (peaks, >, 5);
+
+	/* No bound exists for the oscillating condition, it is checked every
+	 * step and fires exactly as often and as late as without screening,
+	 * while the ground condition sleeps for most of the run (300 steps) */
+	run_oscillating_event (2, &speaks, &slast_peak, &sground, &skipped);
+
+	g_assert_cmpfloat (speaks, ==, peaks);
+	cdn_assert_tol (slast_peak, last_peak);
+	cdn_assert_tol (sground, ground);
+
+	g_assert_cmpuint (skipped, >, 0);
+	g_assert_cmpuint (skipped, <=, 300);
+}
+
+static gchar const *phase_network =
+	"integrator { method = \"runge-kutta\" }\n"
+	"\n"
+	"initial-state \"up\"\n"
+	"\n"
+	"x = 0\n"
+	"x' = \"1\" state \"up\"\n"
+	"x' = \"-1\" state \"down\"\n"
+	"\n"
+	"event \"up\" to \"down\" when \"x > 0.5\"\n"
+	"event \"down\" to \"up\" when \"x < 0\"\n";
+
+static void
+test_phase_plans ()
+{
+	CdnNetwork *network;
+	CdnIntegrator *integrator;
+	CdnIntegratorState *state;
+	GSList *plans;
+	gdouble x;
+
+	network = test_load_network (phase_network, NULL);
+	integrator = cdn_network_get_integrator (network);
+	state = cdn_integrator_get_state (integrator);
+
+	/* Both reachable phases are compiled up front */
+	plans = cdn_integrator_state_phase_plans (state, CDN_NODE (network));
+	g_assert_cmpuint (g_slist_length (plans), ==, 2);
+	g_slist_free (plans);
+
+	g_assert (cdn_integrator_state_phase_plan_size (state, CDN_NODE (network), "up") > 0);
+	g_assert (cdn_integrator_state_phase_plan_size (state, CDN_NODE (network), "down") > 0);
+	g_assert_cmpuint (cdn_integrator_state_phase_plan_size (state, CDN_NODE (network), "other"), ==, 0);
+
+	g_assert_cmpuint (g_slist_length ((GSList *)cdn_integrator_state_phase_integrated_edge_actions (state)), ==, 1);
+	g_assert_cmpuint (g_slist_length ((GSList *)cdn_integrator_state_phase_events (state)), ==, 1);
+
+	cdn_network_run (network, 0, 0.01, 2, NULL);
+
+	/* Switching phase swaps in the other plan */
+	x = cdn_variable_get_value (cdn_node_find_variable (CDN_NODE (network), "x"));
+
+	g_assert (x > -0.05 && x < 0.55);
+	g_assert_cmpuint (g_slist_length ((GSList *)cdn_integrator_state_phase_integrated_edge_actions (state)), ==, 1);
+	g_assert_cmpuint (g_slist_length ((GSList *)cdn_integrator_state_phase_events (state)), ==, 1);
+
+	g_object_unref (network);
+}
+
+static gchar const *oscillator_network =
+	"integrator { method = \"yoshida\" order = \"%d\" }\n"
+	"\n"
+	"x = 1\n"
+	"x'' = \"-x\"\n";
+
+static gdouble
+run_yoshida (guint order)
+{
+	CdnNetwork *network;
+	CdnIntegrator *integrator;
+	CdnVariable *x;
+	gdouble ret;
+	gchar *s;
+
+	s = g_strdup_printf (oscillator_network, order);
+	network = test_load_network (s, NULL);
+	g_free (s);
+
+	integrator = cdn_network_get_integrator (network);
+
+	g_assert (CDN_IS_INTEGRATOR_YOSHIDA (integrator));
+	g_assert_cmpuint (cdn_integrator_yoshida_get_order (CDN_INTEGRATOR_YOSHIDA (integrator)), ==, order);
+
+	cdn_network_run (network, 0, 0.1, 10, NULL);
+
+	x = cdn_node_find_variable (CDN_NODE (network), "x");
+	ret = fabs (cdn_variable_get_value (x) - cos (10));
+
+	g_object_unref (network);
+	return ret;
+}
+
+static void
+test_yoshida ()
+{
+	g_assert (run_yoshida (4) < 1e-4);
+	g_assert (run_yoshida (6) < 1e-7);
+}
+
+static gchar const *checkpoint_network =
+	"integrator { method = \"predict-correct\" }\n"
+	"\n"
+	"initial-state \"up\"\n"
+	"\n"
+	"d = 1\n"
+	"\n"
+	"x = 0\n"
+	"x' = \"d\"\n"
+	"\n"
+	"y = 1\n"
+	"y' = \"-y + delayed[x](0.1)\"\n"
+	"\n"
+	"event \"up\" to \"down\" when \"x > 0.75\"\n"
+	"{\n"
+	"  set d = \"-1\"\n"
+	"}\n";
+
+static void
+run_checkpoint_steps (CdnIntegrator *integrator,
+                      gdouble        to)
+{
+	gdouble t;
+
+	t = cdn_integrator_get_time (integrator);
+
+	while (t < to - 1e-9)
+	{
+		t += cdn_integrator_step (integrator, t, 0.01);
+	}
+}
+
+static void
+test_checkpoint ()
+{
+	CdnNetwork *network;
+	CdnIntegrator *integrator;
+	GBytes *checkpoint;
+	GBytes *garbage;
+	GError *error = NULL;
+	gdouble t;
+	gdouble x;
+	gdouble y;
+
+	network = test_load_network (checkpoint_network, NULL);
+	integrator = cdn_network_get_integrator (network);
+
+	g_assert (cdn_integrator_begin (integrator, 0, NULL));
+
+	/* Save after the event changed the state of the network */
+	run_checkpoint_steps (integrator, 1);
+	g_assert_cmpstr (cdn_node_get_state (CDN_NODE (network)), ==, "down");
+
+	checkpoint = cdn_integrator_save_checkpoint (integrator);
+	g_assert (checkpoint != NULL);
+
+	t = cdn_integrator_get_time (integrator);
+
+	run_checkpoint_steps (integrator, 1.5);
+
+	x = cdn_variable_get_value (cdn_node_find_variable (CDN_NODE (network), "x"));
+	y = cdn_variable_get_value (cdn_node_find_variable (CDN_NODE (network), "y"));
+
+	cdn_integrator_end (integrator, NULL);
+	g_object_unref (network);
+
+	/* Resume on a freshly loaded network */
+	network = test_load_network (checkpoint_network, NULL);
+	integrator = cdn_network_get_integrator (network);
+
+	g_assert (cdn_integrator_begin (integrator, 0, NULL));
+	g_assert (cdn_integrator_restore_checkpoint (integrator, checkpoint, &error));
+	g_assert_no_error (error);
+
+	cdn_assert_tol (cdn_integrator_get_time (integrator), t);
+	g_assert_cmpstr (cdn_node_get_state (CDN_NODE (network)), ==, "down");
+
+	run_checkpoint_steps (integrator, 1.5);
+
+	cdn_assert_tol (cdn_variable_get_value (cdn_node_find_variable (CDN_NODE (network), "x")), x);
+	cdn_assert_tol (cdn_variable_get_value (cdn_node_find_variable (CDN_NODE (network), "y")), y);
+
+	/* Anything else is rejected */
+	garbage = g_bytes_new ("garbage", 7);
+
+	g_assert (!cdn_integrator_restore_checkpoint (integrator, garbage, &error));
+	g_assert_error (error, CDN_INTEGRATOR_ERROR, CDN_INTEGRATOR_ERROR_CHECKPOINT);
+
+	g_error_free (error);
+	g_bytes_unref (garbage);
+
+	cdn_integrator_end (integrator, NULL);
+	g_object_unref (network);
+
+	g_bytes_unref (checkpoint);
+}
+
+static gchar const *warm_up_network =
+	"x = 0\n"
+	"x' = \"1\"\n";
+
+static void
+on_warm_up_step (CdnIntegrator *integrator,
+                 gdouble        t,
+                 gdouble        timestep,
+                 guint         *count)
+{
+	++*count;
+}
+
+static void
+test_warm_up ()
+{
+	CdnNetwork *network;
+	CdnIntegrator *integrator;
+	CdnCompileContext *context;
+	CdnExpression *until;
+	guint count = 0;
+	gdouble t;
+
+	network = test_load_network (warm_up_network, NULL);
+	integrator = cdn_network_get_integrator (network);
+
+	g_signal_connect (integrator,
+	                  "step",
+	                  G_CALLBACK (on_warm_up_step),
+	                  &count);
+
+	until = g_object_ref_sink (cdn_expression_new ("x >= 0.5 - 1e-9"));
+	context = cdn_object_get_compile_context (CDN_OBJECT (network), NULL);
+
+	g_assert (cdn_expression_compile (until, context, NULL));
+	g_object_unref (context);
+
+	g_assert (cdn_integrator_begin (integrator, 0, NULL));
+
+	/* Runs until the condition holds, without emitting step */
+	t = cdn_integrator_warm_up (integrator, 0, 0.01, 10, until);
+
+	cdn_assert_tol (t, 0.5);
+	g_assert_cmpuint (count, ==, 0);
+
+	/* Runs until the end time without a condition */
+	t = cdn_integrator_warm_up (integrator, t, 0.01, 0.75, NULL);
+
+	cdn_assert_tol (t, 0.75);
+	cdn_assert_tol (cdn_variable_get_value (cdn_node_find_variable (CDN_NODE (network), "x")), 0.75);
+	g_assert_cmpuint (count, ==, 0);
+
+	cdn_integrator_step (integrator, t, 0.01);
+	g_assert_cmpuint (count, ==, 1);
+
+	cdn_integrator_end (integrator, NULL);
+
+	g_object_unref (until);
+	g_object_unref (network);
+}
+
+static void
+test_real_time ()
+{
+	CdnNetwork *network;
+	CdnIntegrator *integrator;
+	CdnIntegratorRealTimeStats stats;
+	guint64 binned = 0;
+	gint64 start;
+	gdouble t = 0;
+	gint i;
+
+	network = test_load_network (warm_up_network, NULL);
+	integrator = cdn_network_get_integrator (network);
+
+	/* Steps of 10ms at ten times real time, i.e. a 1ms period */
+	cdn_integrator_set_real_time (integrator, 10);
+
+	g_assert (cdn_integrator_begin (integrator, 0, NULL));
+
+	start = g_get_monotonic_time ();
+
+	for (i = 0; i < 20; ++i)
+	{
+		t += cdn_integrator_step (integrator, t, 0.01);
+	}
+
+	/* Every step either slept until its deadline or overran it */
+	g_assert_cmpint (g_get_monotonic_time () - start, >=, 20 * 1000);
+
+	cdn_integrator_end (integrator, NULL);
+
+	cdn_integrator_get_real_time_stats (integrator, &stats);
+
+	g_assert_cmpuint (stats.steps, ==, 20);
+	g_assert_cmpuint (stats.overruns, <=, stats.steps);
+	g_assert_cmpfloat (stats.worst_step, >=, 0);
+	g_assert_cmpfloat (stats.worst_latency, >=, 0);
+
+	for (i = 0; i < CDN_INTEGRATOR_REAL_TIME_BINS; ++i)
+	{
+		binned += stats.histogram[i];
+	}
+
+	g_assert_cmpuint (binned, ==, stats.steps);
+
+	cdn_integrator_reset_real_time_stats (integrator);
+	cdn_integrator_get_real_time_stats (integrator, &stats);
+
+	g_assert_cmpuint (stats.steps, ==, 0);
+
+	g_object_unref (network);
+}
+
 int
 main (int   argc,
       char *argv[])
@@ -46,6 +1174,28 @@ main (int   argc,
 	g_test_init (&argc, &argv, NULL);
 
 	g_test_add_func ("/integrator/switch", test_switch);
+	g_test_add_func ("/integrator/fused", test_fused);
+	g_test_add_func ("/integrator/arena", test_arena);
+	g_test_add_func ("/integrator/arena_snapshot", test_arena_snapshot);
+	g_test_add_func ("/integrator/parallel", test_parallel);
+	g_test_add_func ("/integrator/parallel_direct", test_parallel_direct);
+	g_test_add_func ("/integrator/dormand_prince", test_dormand_prince);
+	g_test_add_func ("/integrator/dormand_prince_tolerance", test_dormand_prince_tolerance);
+	g_test_add_func ("/integrator/rosenbrock", test_rosenbrock);
+	g_test_add_func ("/integrator/rosenbrock_singular", test_rosenbrock_singular);
+	g_test_add_func ("/integrator/multirate", test_multirate);
+	g_test_add_func ("/integrator/multirate_stages", test_multirate_stages);
+	g_test_add_func ("/integrator/state_vector", test_state_vector);
+	g_test_add_func ("/integrator/event_location", test_event_location);
+	g_test_add_func ("/integrator/event_location_dense", test_event_location_dense);
+	g_test_add_func ("/integrator/phase_plans", test_phase_plans);
+	g_test_add_func ("/integrator/event_screening", test_event_screening);
+	g_test_add_func ("/integrator/event_screening_resting", test_event_screening_resting);
+	g_test_add_func ("/integrator/event_screening_oscillating", test_event_screening_oscillating);
+	g_test_add_func ("/integrator/yoshida", test_yoshida);
+	g_test_add_func ("/integrator/checkpoint", test_checkpoint);
+	g_test_add_func ("/integrator/warm_up", test_warm_up);
+	g_test_add_func ("/integrator/real_time", test_real_time);
 
 	g_test_run ();
 
@@ -1,6 +1,8 @@
 #include <codyn/codyn.h>
 #include <codyn/cdn-expression.h>
 #include <codyn/cdn-object.h>
+#include <codyn/cdn-statement.h>
+#include <string.h>
 
 #include "utils.h"
 
@@ -24,6 +26,21 @@ static gchar simple_node_xml[] = ""
 "  edge \"edge\" from \"s1\" to \"s1\" { x' += 1 }"
 "}";
 
+static gchar optimize_xml[] = ""
+"node \"s1\"\n"
+"{\n"
+"  a = 2\n"
+"  b = \"a * 3 + 1\"\n"
+"  x = 1 | integrated\n"
+"  y = \"sin(x) * b + cos(t)\"\n"
+"  z = \"sin(x) * b - a\"\n"
+"\n"
+"  edge self\n"
+"  {\n"
+"    x' += \"-(sin(x) * b) * 0.1 + b / a\"\n"
+"  }\n"
+"}\n";
+
 static void
 test_load ()
 {
@@ -248,6 +265,94 @@ test_node_reset ()
 	cdn_assert_tol (cdn_variable_get_value (prop), 0);
 }
 
+static gdouble
+run_optimize (gboolean     optimize,
+              gchar const *path)
+{
+	CdnNetwork *network;
+	CdnVariable *prop;
+	gdouble ret;
+
+	network = test_load_network (optimize_xml, NULL);
+
+	if (optimize)
+	{
+		cdn_network_optimize (network);
+	}
+
+	cdn_network_run (network, 0, 0.01, 1, NULL);
+
+	prop = cdn_node_find_variable (CDN_NODE (network), path);
+	ret = cdn_variable_get_value (prop);
+
+	g_object_unref (network);
+	return ret;
+}
+
+static void
+test_optimize ()
+{
+	CdnNetwork *network;
+	CdnVariable *prop;
+
+	network = test_load_network (optimize_xml, NULL);
+	cdn_network_optimize (network);
+
+	// b only depends on constants and is folded into a number
+	prop = cdn_node_find_variable (CDN_NODE (network), "s1.b");
+
+	g_assert_cmpint (g_slist_length ((GSList *)cdn_expression_get_instructions (cdn_variable_get_expression (prop))),
+	                 ==,
+	                 1);
+
+	cdn_assert_tol (cdn_variable_get_value (prop), 7);
+
+	// sin(x) * b is shared between y, z and the edge action
+	g_assert (cdn_object_get_variable (CDN_OBJECT (network), "_cse0") != NULL);
+
+	g_object_unref (network);
+
+	cdn_assert_tol (run_optimize (TRUE, "s1.x"), run_optimize (FALSE, "s1.x"));
+	cdn_assert_tol (run_optimize (TRUE, "s1.y"), run_optimize (FALSE, "s1.y"));
+	cdn_assert_tol (run_optimize (TRUE, "s1.z"), run_optimize (FALSE, "s1.z"));
+}
+
+static void
+test_profile ()
+{
+	CdnNetwork *network;
+	CdnVariable *prop;
+	gint line;
+	gchar *report;
+
+	network = test_load_network (optimize_xml, NULL);
+
+	// Expressions remember where they were defined
+	prop = cdn_node_find_variable (CDN_NODE (network), "s1.y");
+	cdn_statement_get_line (CDN_STATEMENT (cdn_variable_get_expression (prop)), &line, NULL);
+
+	g_assert_cmpint (line, >, 0);
+
+	cdn_profile_reset ();
+	cdn_profile_set_enabled (TRUE);
+
+	cdn_network_run (network, 0, 0.01, 0.1, NULL);
+
+	cdn_profile_set_enabled (FALSE);
+
+	report = cdn_profile_report (CDN_OBJECT (network),
+	                             CDN_PROFILE_SORT_SELF_TIME,
+	                             0);
+
+	g_assert (strstr (report, "s1.y = ") != NULL);
+	g_assert (strstr (report, "CdnInstructionVariable") != NULL);
+
+	g_free (report);
+
+	cdn_profile_reset ();
+	g_object_unref (network);
+}
+
 int
 main (int   argc,
       char *argv[])
@@ -269,6 +374,8 @@ main (int   argc,
 	g_test_add_func ("/network/node/reset", test_node_reset);
 
 	g_test_add_func ("/network/variadic", test_variadic);
+	g_test_add_func ("/network/optimize", test_optimize);
+	g_test_add_func ("/network/profile", test_profile);
 
 
 	g_test_run ();
@@ -74,6 +74,49 @@ test_delayed_dt ()
 	g_object_unref (network);
 }
 
+static gchar cubic_xml[] = "node \"state\" { x = \"t * t\" xl = \"delayed[x](0.15)\" xc = \"delayed[x, 0, 3](0.15)\" }";
+
+static void
+test_delayed_cubic ()
+{
+	CdnNetwork *network;
+	gint i;
+
+	network = test_load_network (cubic_xml,
+	                             CDN_PATH_OBJECT, "state",
+	                             NULL);
+
+	CdnVariable *linear = cdn_node_find_variable (CDN_NODE (network), "state.xl");
+	CdnVariable *cubic = cdn_node_find_variable (CDN_NODE (network), "state.xc");
+
+	g_assert (linear);
+	g_assert (cubic);
+
+	cdn_network_begin (network, 0, NULL);
+
+	for (i = 0; i < 6; ++i)
+	{
+		gdouble t = i * 0.1;
+
+		/* Once the slopes at both ends of the interval are central
+		 * differences, cubic interpolation of a quadratic is exact */
+		if (i >= 3)
+		{
+			cdn_assert_tol (cdn_variable_get_value (cubic),
+			                (t - 0.15) * (t - 0.15));
+
+			cdn_assert_neq_tol (cdn_variable_get_value (linear),
+			                    (t - 0.15) * (t - 0.15));
+		}
+
+		cdn_network_step (network, 0.1);
+	}
+
+	cdn_network_end (network, NULL);
+
+	g_object_unref (network);
+}
+
 int
 main (int   argc,
       char *argv[])
@@ -85,6 +128,7 @@ main (int   argc,
 
 	g_test_add_func ("/operator/delayed", test_delayed);
 	g_test_add_func ("/operator/delayed_dt", test_delayed_dt);
+	g_test_add_func ("/operator/delayed_cubic", test_delayed_cubic);
 
 	g_test_run ();
 
@@ -42,10 +42,19 @@ static gdouble to = 1;
 static guint seed = 0;
 static gboolean seed_set = FALSE;
 static gboolean simplify = FALSE;
+static gboolean optimize = FALSE;
+static gboolean profile = FALSE;
+static CdnProfileSort profile_sort = CDN_PROFILE_SORT_SELF_TIME;
 static gboolean timestamp = FALSE;
 static gboolean rawc = FALSE;
 static gchar *precision = NULL;
 static gboolean display = FALSE;
+static gchar *checkpoint = NULL;
+static gdouble checkpoint_interval = 60;
+static gchar *resume = NULL;
+static gdouble warm_up_to = 0;
+static gboolean warm_up_set = FALSE;
+static gchar *warm_up_until = NULL;
 
 #define CDN_MONITOR_ERROR (cdn_monitor_error_quark())
 
@@ -57,7 +66,8 @@ cdn_monitor_error_quark ()
 
 typedef enum
 {
-	CDN_MONITOR_ERROR_RANGE
+	CDN_MONITOR_ERROR_RANGE,
+	CDN_MONITOR_ERROR_PROFILE_SORT
 } CdnMonitorError;
 
 static gboolean
@@ -168,6 +178,56 @@ parse_seed (gchar const  *option_name,
 	seed = (guint)g_ascii_strtoull (value, NULL, 10);
 }
 
+static gboolean
+parse_profile_sort (gchar const  *option_name,
+                    gchar const  *value,
+                    gpointer      data,
+                    GError      **error)
+{
+	if (g_strcmp0 (value, "self") == 0)
+	{
+		profile_sort = CDN_PROFILE_SORT_SELF_TIME;
+	}
+	else if (g_strcmp0 (value, "time") == 0)
+	{
+		profile_sort = CDN_PROFILE_SORT_TIME;
+	}
+	else if (g_strcmp0 (value, "calls") == 0)
+	{
+		profile_sort = CDN_PROFILE_SORT_EVALUATIONS;
+	}
+	else if (g_strcmp0 (value, "misses") == 0)
+	{
+		profile_sort = CDN_PROFILE_SORT_MISSES;
+	}
+	else
+	{
+		if (error)
+		{
+			g_set_error (error,
+			             CDN_MONITOR_ERROR,
+			             CDN_MONITOR_ERROR_PROFILE_SORT,
+			             "Invalid profile sort key `%s' (expected self, time, calls or misses)",
+			             value);
+		}
+
+		return FALSE;
+	}
+
+	profile = TRUE;
+	return TRUE;
+}
+
+static void
+parse_warm_up (gchar const  *option_name,
+               gchar const  *value,
+               gpointer      data,
+               GError      **error)
+{
+	warm_up_set = TRUE;
+	warm_up_to = g_ascii_strtod (value, NULL);
+}
+
 static GOptionEntry entries[] = {
 	{"monitor", 'm', 0, G_OPTION_ARG_CALLBACK, parse_monitored,
 	 "Selector for variables to monitor (e.g. /state_.*/.\"{x,y}\")", "SEL"},
@@ -181,6 +241,12 @@ static GOptionEntry entries[] = {
 	 "Random numbers seed (defaults to current time)", "SEED"},
 	{"simplify", 'x', 0, G_OPTION_ARG_NONE, &simplify,
 	 "Enable global simplifications", NULL},
+	{"optimize", 'O', 0, G_OPTION_ARG_NONE, &optimize,
+	 "Fold constants and share common subexpressions", NULL},
+	{"profile", 'P', 0, G_OPTION_ARG_NONE, &profile,
+	 "Write a profile of the expression evaluations to standard error", NULL},
+	{"profile-sort", 0, 0, G_OPTION_ARG_CALLBACK, parse_profile_sort,
+	 "Sort the profile by self time (self, default), total time (time), number of evaluations (calls) or cache misses (misses)", "KEY"},
 	{"timestamp", 'p', 0, G_OPTION_ARG_NONE, &timestamp,
 	 "Write a timestamp (Unix time) at the beginning of each line", NULL},
 	{"rawc", 'r', 0, G_OPTION_ARG_NONE, &rawc,
@@ -189,6 +255,16 @@ static GOptionEntry entries[] = {
 	 "Precision at which to print values (printf style)", "FORMAT"},
 	{"display", 'd', 0, G_OPTION_ARG_NONE, &display,
 	 "Display variable contents after simulation", NULL},
+	{"warm-up", 'w', 0, G_OPTION_ARG_CALLBACK, parse_warm_up,
+	 "Run without recording until the given time, to discard the initial transient", "TIME"},
+	{"warm-up-until", 'W', 0, G_OPTION_ARG_STRING, &warm_up_until,
+	 "Run without recording until the expression becomes true", "EXPR"},
+	{"checkpoint", 'k', 0, G_OPTION_ARG_FILENAME, &checkpoint,
+	 "Periodically save a checkpoint of the simulation state", "FILE"},
+	{"checkpoint-interval", 0, 0, G_OPTION_ARG_DOUBLE, &checkpoint_interval,
+	 "Interval in (wall clock) seconds between checkpoints (defaults to 60)", "SECONDS"},
+	{"resume", 'R', 0, G_OPTION_ARG_FILENAME, &resume,
+	 "Resume the simulation from a checkpoint", "FILE"},
 	{NULL}
 };
 
@@ -728,11 +804,76 @@ resolve_all_monitors (CdnMonitorImplementation *implementation)
 	return TRUE;
 }
 
+static void
+save_checkpoint (CdnMonitorImplementation *implementation)
+{
+	GError *error = NULL;
+
+	if (!implementation->save_checkpoint (implementation,
+	                                      checkpoint,
+	                                      &error))
+	{
+		g_printerr ("Could not save checkpoint `%s': %s\n",
+		            checkpoint,
+		            error->message);
+
+		g_error_free (error);
+	}
+}
+
+static gboolean
+warm_up (CdnMonitorImplementation *implementation,
+         gdouble                  *t)
+{
+	gdouble until = warm_up_set ? MIN (warm_up_to, to) : to;
+
+	if (implementation->warm_up)
+	{
+		return implementation->warm_up (implementation,
+		                                t,
+		                                step,
+		                                until,
+		                                warm_up_until);
+	}
+
+	if (warm_up_until)
+	{
+		g_printerr ("Warm-up conditions are not supported for this network\n");
+		return FALSE;
+	}
+
+	while (*t < until)
+	{
+		gdouble realstep;
+
+		realstep = implementation->step (implementation,
+		                                 *t,
+		                                 MIN (step, until - *t));
+
+		*t += realstep;
+
+		if (realstep <= 0 || implementation->terminated (implementation))
+		{
+			break;
+		}
+	}
+
+	return TRUE;
+}
+
 static gint
 run_simple_monitor (CdnMonitorImplementation *implementation)
 {
+	GTimer *checkpoint_timer = NULL;
 	gdouble t;
 
+	if ((checkpoint || resume) &&
+	    (!implementation->save_checkpoint || !implementation->restore_checkpoint))
+	{
+		g_printerr ("Checkpoints are not supported for this network\n");
+		return 1;
+	}
+
 	if (!resolve_all_monitors (implementation))
 	{
 		return 1;
@@ -759,11 +900,44 @@ run_simple_monitor (CdnMonitorImplementation *implementation)
 
 	implementation->begin (implementation, t, step);
 
-	if (!display)
+	if (resume)
+	{
+		GError *error = NULL;
+
+		if (!implementation->restore_checkpoint (implementation,
+		                                         resume,
+		                                         &t,
+		                                         &error))
+		{
+			g_printerr ("Could not resume from checkpoint `%s': %s\n",
+			            resume,
+			            error->message);
+
+			g_error_free (error);
+			return 1;
+		}
+	}
+
+	if (warm_up_set || warm_up_until)
+	{
+		if (!warm_up (implementation, &t))
+		{
+			return 1;
+		}
+	}
+
+	// When resuming, the values at the resumed time were already written
+	// by the run which saved the checkpoint
+	if (!display && (!resume || warm_up_set || warm_up_until))
 	{
 		write_values (implementation);
 	}
 
+	if (checkpoint)
+	{
+		checkpoint_timer = g_timer_new ();
+	}
+
 	while (t < to)
 	{
 		gdouble realstep;
@@ -788,6 +962,19 @@ run_simple_monitor (CdnMonitorImplementation *implementation)
 		{
 			break;
 		}
+
+		if (checkpoint_timer &&
+		    g_timer_elapsed (checkpoint_timer, NULL) >= checkpoint_interval)
+		{
+			save_checkpoint (implementation);
+			g_timer_start (checkpoint_timer);
+		}
+	}
+
+	if (checkpoint_timer)
+	{
+		save_checkpoint (implementation);
+		g_timer_destroy (checkpoint_timer);
 	}
 
 	if (implementation->end)
@@ -967,7 +1154,23 @@ monitor_network (gchar const *filename)
 		implementation->simplify (implementation);
 	}
 
+	if (optimize && implementation->optimize)
+	{
+		implementation->optimize (implementation);
+	}
+
+	if (profile && implementation->profile_begin)
+	{
+		implementation->profile_begin (implementation);
+	}
+
 	ret = run_simple_monitor (implementation);
+
+	if (profile && implementation->profile_report)
+	{
+		implementation->profile_report (implementation, profile_sort);
+	}
+
 	cdn_monitor_implementation_free (implementation);
 	return ret;
 }
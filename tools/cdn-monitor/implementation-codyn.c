@@ -65,6 +65,35 @@ set_seed (CdnMonitorImplementation *implementation,
 	cdn_network_set_random_seed (implementation->network, seed);
 }
 
+static void
+monitor_optimize (CdnMonitorImplementation *implementation)
+{
+	cdn_network_optimize (implementation->network);
+}
+
+static void
+monitor_profile_begin (CdnMonitorImplementation *implementation)
+{
+	cdn_profile_reset ();
+	cdn_profile_set_enabled (TRUE);
+}
+
+static void
+monitor_profile_report (CdnMonitorImplementation *implementation,
+                        CdnProfileSort            sort)
+{
+	gchar *report;
+
+	cdn_profile_set_enabled (FALSE);
+
+	report = cdn_profile_report (CDN_OBJECT (implementation->network),
+	                             sort,
+	                             0);
+
+	g_printerr ("%s", report);
+	g_free (report);
+}
+
 static gdouble
 monitor_step (CdnMonitorImplementation *implementation,
               gdouble                   t,
@@ -89,6 +118,127 @@ monitor_begin (CdnMonitorImplementation *implementation,
 	cdn_integrator_begin (integrator, t, NULL);
 }
 
+static gboolean
+monitor_warm_up (CdnMonitorImplementation *implementation,
+                 gdouble                  *t,
+                 gdouble                   timestep,
+                 gdouble                   to,
+                 gchar const              *until)
+{
+	CdnIntegrator *integrator;
+	CdnExpression *expr = NULL;
+
+	integrator = cdn_network_get_integrator (implementation->network);
+
+	if (until)
+	{
+		CdnCompileContext *context;
+		CdnCompileError *err;
+
+		expr = g_object_ref_sink (cdn_expression_new (until));
+
+		context = cdn_object_get_compile_context (CDN_OBJECT (implementation->network),
+		                                          NULL);
+
+		err = cdn_compile_error_new ();
+
+		if (!cdn_expression_compile (expr, context, err))
+		{
+			gchar *msg;
+
+			msg = cdn_compile_error_get_formatted_string (err);
+
+			g_printerr ("Failed to compile warm-up condition `%s'\n\n%s\n",
+			            until,
+			            msg);
+
+			g_free (msg);
+
+			g_object_unref (err);
+			g_object_unref (context);
+			g_object_unref (expr);
+
+			return FALSE;
+		}
+
+		g_object_unref (err);
+		g_object_unref (context);
+	}
+
+	*t = cdn_integrator_warm_up (integrator, *t, timestep, to, expr);
+
+	if (expr)
+	{
+		g_object_unref (expr);
+	}
+
+	return TRUE;
+}
+
+static gboolean
+monitor_save_checkpoint (CdnMonitorImplementation  *implementation,
+                         gchar const               *filename,
+                         GError                   **error)
+{
+	CdnIntegrator *integrator;
+	GBytes *bytes;
+	gconstpointer data;
+	gsize size;
+	gboolean ret;
+
+	integrator = cdn_network_get_integrator (implementation->network);
+	bytes = cdn_integrator_save_checkpoint (integrator);
+
+	if (!bytes)
+	{
+		g_set_error (error,
+		             CDN_INTEGRATOR_ERROR,
+		             CDN_INTEGRATOR_ERROR_CHECKPOINT,
+		             "Could not save a checkpoint of the network");
+
+		return FALSE;
+	}
+
+	data = g_bytes_get_data (bytes, &size);
+
+	// Note that this atomically replaces the previous checkpoint
+	ret = g_file_set_contents (filename, data, size, error);
+
+	g_bytes_unref (bytes);
+	return ret;
+}
+
+static gboolean
+monitor_restore_checkpoint (CdnMonitorImplementation  *implementation,
+                            gchar const               *filename,
+                            gdouble                   *t,
+                            GError                   **error)
+{
+	CdnIntegrator *integrator;
+	GBytes *bytes;
+	gchar *contents;
+	gsize size;
+	gboolean ret;
+
+	if (!g_file_get_contents (filename, &contents, &size, error))
+	{
+		return FALSE;
+	}
+
+	integrator = cdn_network_get_integrator (implementation->network);
+	bytes = g_bytes_new_take (contents, size);
+
+	ret = cdn_integrator_restore_checkpoint (integrator, bytes, error);
+	g_bytes_unref (bytes);
+
+	if (ret)
+	{
+		*t = cdn_integrator_get_time (integrator);
+	}
+
+	return ret;
+}
+
 static gboolean
 monitor_terminated (CdnMonitorImplementation *implementation)
 {
@@ -206,7 +356,13 @@ cdn_monitor_implementation_codyn_new (gchar const *filename)
 	ret->step = monitor_step;
 	ret->get_time = monitor_get_time;
 	ret->set_seed = set_seed;
+	ret->optimize = monitor_optimize;
+	ret->profile_begin = monitor_profile_begin;
+	ret->profile_report = monitor_profile_report;
 	ret->default_timestep = default_timestep;
+	ret->warm_up = monitor_warm_up;
+	ret->save_checkpoint = monitor_save_checkpoint;
+	ret->restore_checkpoint = monitor_restore_checkpoint;
 
 	ret->terminated = monitor_terminated;
 
@@ -3,6 +3,7 @@
 
 #include <codyn/codyn.h>
 #include <codyn/cdn-selector.h>
+#include <codyn/cdn-profile.h>
 #include "cdn-rawc-types.h"
 #include "monitor.h"
 
@@ -18,6 +19,11 @@ struct _CdnMonitorImplementation
 	                    CdnSelector              *selector);
 
 	void (*simplify) (CdnMonitorImplementation *implementation);
+	void (*optimize) (CdnMonitorImplementation *implementation);
+
+	void (*profile_begin) (CdnMonitorImplementation *implementation);
+	void (*profile_report) (CdnMonitorImplementation *implementation,
+	                        CdnProfileSort            sort);
 
 	gboolean (*free) (CdnMonitorImplementation *implementation);
 	gboolean (*terminated) (CdnMonitorImplementation *implementation);
@@ -32,6 +38,21 @@ struct _CdnMonitorImplementation
 	void (*end) (CdnMonitorImplementation *implementation);
 
 	gdouble (*default_timestep) (CdnMonitorImplementation *implementation);
+
+	gboolean (*warm_up) (CdnMonitorImplementation *implementation,
+	                     gdouble                  *t,
+	                     gdouble                   timestep,
+	                     gdouble                   to,
+	                     gchar const              *until);
+
+	gboolean (*save_checkpoint) (CdnMonitorImplementation  *implementation,
+	                             gchar const               *filename,
+	                             GError                   **error);
+
+	gboolean (*restore_checkpoint) (CdnMonitorImplementation  *implementation,
+	                                gchar const               *filename,
+	                                gdouble                   *t,
+	                                GError                   **error);
 };
 
 void cdn_monitor_implementation_free (CdnMonitorImplementation *implementation);